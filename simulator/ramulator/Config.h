@@ -145,6 +145,17 @@ public:
       return false;
     }
 
+    bool with_drampower() const {
+      // the default value is false
+      if (options.find("drampower") != options.end()) {
+        if ((options.find("drampower"))->second == "on") {
+          return true;
+        }
+        return false;
+      }
+      return false;
+    }
+
     void set_application_name(const std::string& _application_name){
       application_name = _application_name;
     }
@@ -54,6 +54,14 @@ void Controller<ALDRAM>::update_temp(ALDRAM::Temp current_temperature){
 template <>
 void Controller<TLDRAM>::tick(){
     clk++;
+
+    /*** 0. All ranks sleep and nothing is outstanding: only keep refresh going ***/
+    if (lowpower && lowpower->all_asleep() && !readq.size() && !writeq.size()
+            && !otherq.size() && pending.empty() && pending_write.empty()) {
+        refresh->tick_ref();
+        return;
+    }
+
     (*req_queue_length_sum) += readq.size() + writeq.size() + pending.size();
     (*read_req_queue_length_sum) += readq.size() + pending.size();
     (*write_req_queue_length_sum) += writeq.size();
@@ -72,18 +80,37 @@ void Controller<TLDRAM>::tick(){
         }
     }
 
+    /*** 1.1. Serve completed writes ***/
+    if (pending_write.size()) {
+        Request& req = pending_write[0];
+        if (req.depart <= clk) {
+            req.callback(req);
+            pending_write.pop_front();
+        }
+    }
+
     /*** 2. Should we schedule refreshes? ***/
     refresh->tick_ref();
 
+    /*** 2.1. Power-down, self-refresh and wake-up of ranks ***/
+    if (lowpower) {
+        TLDRAM::Command cmd;
+        vector<int> addr_vec;
+        if (lowpower->tick(cmd, addr_vec)) {
+            issue_cmd(cmd, addr_vec);
+            return;
+        }
+    }
+
     /*** 3. Should we schedule writes? ***/
     if (!write_mode) {
         // yes -- write queue is almost full or read queue is empty
-        if (writeq.size() >= int(0.8 * writeq.max) || readq.size() == 0)
+        if (writeq.size() >= (unsigned int)(write_high_watermark * writeq.max) || readq.size() == 0)
             write_mode = true;
     }
     else {
         // no -- write queue is almost empty and read queue is not empty
-        if (writeq.size() <= int(0.2 * writeq.max) && readq.size() != 0)
+        if (writeq.size() <= (unsigned int)(write_low_watermark * writeq.max) && readq.size() != 0)
             write_mode = false;
     }
 
@@ -157,6 +184,8 @@ void Controller<TLDRAM>::tick(){
     }
     if (req->type == Request::Type::WRITE) {
         channel->update_serving_requests(req->addr_vec.data(), -1, clk);
+        req->depart = clk + channel->spec->write_latency;
+        pending_write.push_back(*req);
     }
 
     // remove request from queue
@@ -166,6 +195,14 @@ void Controller<TLDRAM>::tick(){
 template<>
 void Controller<WideIO2>::tick() {
     clk++;
+
+    /*** 0. All ranks sleep and nothing is outstanding: only keep refresh going ***/
+    if (lowpower && lowpower->all_asleep() && !readq.size() && !writeq.size()
+            && !otherq.size() && pending.empty() && pending_write.empty()) {
+        refresh->tick_ref();
+        return;
+    }
+
     (*req_queue_length_sum) += readq.size() + writeq.size() + pending.size();
     (*read_req_queue_length_sum) += readq.size() + pending.size();
     (*write_req_queue_length_sum) += writeq.size();
@@ -195,6 +232,16 @@ void Controller<WideIO2>::tick() {
     /*** 2. Refresh scheduler ***/
     refresh->tick_ref();
 
+    /*** 2.1. Power-down, self-refresh and wake-up of ranks ***/
+    if (lowpower) {
+        WideIO2::Command cmd;
+        vector<int> addr_vec;
+        if (lowpower->tick(cmd, addr_vec)) {
+            issue_cmd(cmd, addr_vec);
+            return;
+        }
+    }
+
     /*** 3. Should we schedule writes? ***/
     if (!write_mode) {
         // yes -- write queue is almost full or read queue is empty
@@ -1,8 +1,10 @@
 #ifndef __CONTROLLER_H
 #define __CONTROLLER_H
 
+#include <algorithm>
 #include <cassert>
 #include <cstdio>
+#include <cstdlib>
 #include <deque>
 #include <fstream>
 #include <list>
@@ -11,6 +13,8 @@
 #include <iostream>
 #include "Config.h"
 #include "DRAM.h"
+#include "Energy.h"
+#include "LowPower.h"
 #include "Refresh.h"
 #include "Request.h"
 #include "Scheduler.h"
@@ -53,107 +57,28 @@ public:
     ScalarStat* req_queue_length_sum;
     ScalarStat* read_req_queue_length_sum;
     ScalarStat* write_req_queue_length_sum;
-    // DRAM power estimation statistics
-    ScalarStat act_energy;
-    ScalarStat pre_energy;
-    ScalarStat read_energy;
-    ScalarStat write_energy;
-
-    ScalarStat act_stdby_energy;
-    ScalarStat pre_stdby_energy;
-    ScalarStat idle_energy_act;
-    ScalarStat idle_energy_pre;
-
-    ScalarStat f_act_pd_energy;
-    ScalarStat f_pre_pd_energy;
-    ScalarStat s_act_pd_energy;
-    ScalarStat s_pre_pd_energy;
-    ScalarStat sref_energy;
-    ScalarStat sref_ref_energy;
-    ScalarStat sref_ref_act_energy;
-    ScalarStat sref_ref_pre_energy;
-
-    ScalarStat spup_energy;
-    ScalarStat spup_ref_energy;
-    ScalarStat spup_ref_act_energy;
-    ScalarStat spup_ref_pre_energy;
-    ScalarStat pup_act_energy;
-    ScalarStat pup_pre_energy;
-
-    ScalarStat IO_power;
-    ScalarStat WR_ODT_power;
-    ScalarStat TermRD_power;
-    ScalarStat TermWR_power;
-
-    ScalarStat read_io_energy;
-    ScalarStat write_term_energy;
-    ScalarStat read_oterm_energy;
-    ScalarStat write_oterm_energy;
-    ScalarStat io_term_energy;
-
-    ScalarStat ref_energy;
-
-    ScalarStat total_energy;
-    ScalarStat average_power;
-
-    // drampower counter
-
-    // Number of activate commands
-    ScalarStat numberofacts_s;
-    // Number of precharge commands
-    ScalarStat numberofpres_s;
-    // Number of reads commands
-    ScalarStat numberofreads_s;
-    // Number of writes commands
-    ScalarStat numberofwrites_s;
-    // Number of refresh commands
-    ScalarStat numberofrefs_s;
-    // Number of precharge cycles
-    ScalarStat precycles_s;
-    // Number of active cycles
-    ScalarStat actcycles_s;
-    // Number of Idle cycles in the active state
-    ScalarStat idlecycles_act_s;
-    // Number of Idle cycles in the precharge state
-    ScalarStat idlecycles_pre_s;
-    // Number of fast-exit activate power-downs
-    ScalarStat f_act_pdns_s;
-    // Number of slow-exit activate power-downs
-    ScalarStat s_act_pdns_s;
-    // Number of fast-exit precharged power-downs
-    ScalarStat f_pre_pdns_s;
-    // Number of slow-exit activate power-downs
-    ScalarStat s_pre_pdns_s;
-    // Number of self-refresh commands
-    ScalarStat numberofsrefs_s;
-    // Number of clock cycles in fast-exit activate power-down mode
-    ScalarStat f_act_pdcycles_s;
-    // Number of clock cycles in slow-exit activate power-down mode
-    ScalarStat s_act_pdcycles_s;
-    // Number of clock cycles in fast-exit precharged power-down mode
-    ScalarStat f_pre_pdcycles_s;
-    // Number of clock cycles in slow-exit precharged power-down mode
-    ScalarStat s_pre_pdcycles_s;
-    // Number of clock cycles in self-refresh mode
-    ScalarStat sref_cycles_s;
-    // Number of clock cycles in activate power-up mode
-    ScalarStat pup_act_cycles_s;
-    // Number of clock cycles in precharged power-up mode
-    ScalarStat pup_pre_cycles_s;
-    // Number of clock cycles in self-refresh power-up mode
-    ScalarStat spup_cycles_s;
-
-    // Number of active auto-refresh cycles in self-refresh mode
-    ScalarStat sref_ref_act_cycles_s;
-    // Number of precharged auto-refresh cycles in self-refresh mode
-    ScalarStat sref_ref_pre_cycles_s;
-    // Number of active auto-refresh cycles during self-refresh exit
-    ScalarStat spup_ref_act_cycles_s;
-    // Number of precharged auto-refresh cycles during self-refresh exit
-    ScalarStat spup_ref_pre_cycles_s;
-
-    //libDRAMPower* drampower;
-    long update_counter = 0;
+    // DRAM energy estimation (only allocated when drampower = on)
+    EnergyModel<T>* energy = nullptr;
+
+    // Write cancellation (Qureshi et al., HPCA 2010): a read that needs to
+    // switch the row of a bank may abort the write that is still programming
+    // it, unless the write is past cancel_threshold of its duration. The
+    // cancelled write goes back to the write queue. Only useful for memories
+    // with long write pulses (PCM, STT-MRAM).
+    bool write_cancellation = false;
+    float cancel_threshold = 0.75f;
+    ScalarStat* write_cancellations = nullptr;
+
+    struct InflightWrite {
+        Request req;
+        long issued, done;
+        long next_pre, next_act;  // bank timing before the write was issued
+        bool cancellable;  // false once another column command used the bank
+    };
+    list<InflightWrite> inflight_writes;  // ordered by completion
+
+    // Rank power-down and self-refresh (only allocated when a timeout is set)
+    LowPower<T>* lowpower = nullptr;
 
 public:
     /* Member Variables */
@@ -178,6 +103,9 @@ public:
     deque<Request> pending;  // read requests that are about to receive data from DRAM
     deque<Request> pending_write;  // read requests that are about to receive data from DRAM
     bool write_mode = false;  // whether write requests should be prioritized over reads
+    // write queue occupancy that starts / stops draining writes
+    float write_high_watermark = 0.8f;
+    float write_low_watermark = 0.2f;
     //long refreshed = 0;  // last time refresh requests were generated
 
     /* Command trace for DRAMPower 3.1 */
@@ -226,321 +154,29 @@ public:
             for (unsigned int i = 0; i < channel->children.size(); i++)
                 cmd_trace_files[i].open(prefix + to_string(i) + suffix);
         }
-        with_drampower = false;
+        with_drampower = configs.with_drampower();
         fake_ideal_DRAM(configs);
-        if (with_drampower) {
-          act_energy
-              .name("act_energy_" + to_string(channel->id))
-              .desc("act_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          pre_energy
-              .name("pre_energy_" + to_string(channel->id))
-              .desc("pre_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          read_energy
-              .name("read_energy_" + to_string(channel->id))
-              .desc("read_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          write_energy
-              .name("write_energy_" + to_string(channel->id))
-              .desc("write_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-
-          act_stdby_energy
-              .name("act_stdby_energy_" + to_string(channel->id))
-              .desc("act_stdby_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-
-          pre_stdby_energy
-              .name("pre_stdby_energy_" + to_string(channel->id))
-              .desc("pre_stdby_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-
-          idle_energy_act
-              .name("idle_energy_act_" + to_string(channel->id))
-              .desc("idle_energy_act_" + to_string(channel->id))
-              .precision(6)
-              ;
-
-          idle_energy_pre
-              .name("idle_energy_pre_" + to_string(channel->id))
-              .desc("idle_energy_pre_" + to_string(channel->id))
-              .precision(6)
-              ;
-
-          f_act_pd_energy
-              .name("f_act_pd_energy_" + to_string(channel->id))
-              .desc("f_act_pd_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          f_pre_pd_energy
-              .name("f_pre_pd_energy_" + to_string(channel->id))
-              .desc("f_pre_pd_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          s_act_pd_energy
-              .name("s_act_pd_energy_" + to_string(channel->id))
-              .desc("s_act_pd_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          s_pre_pd_energy
-              .name("s_pre_pd_energy_" + to_string(channel->id))
-              .desc("s_pre_pd_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          sref_energy
-              .name("sref_energy_" + to_string(channel->id))
-              .desc("sref_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          sref_ref_energy
-              .name("sref_ref_energy_" + to_string(channel->id))
-              .desc("sref_ref_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          sref_ref_act_energy
-              .name("sref_ref_act_energy_" + to_string(channel->id))
-              .desc("sref_ref_act_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          sref_ref_pre_energy
-              .name("sref_ref_pre_energy_" + to_string(channel->id))
-              .desc("sref_ref_pre_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-
-          spup_energy
-              .name("spup_energy_" + to_string(channel->id))
-              .desc("spup_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          spup_ref_energy
-              .name("spup_ref_energy_" + to_string(channel->id))
-              .desc("spup_ref_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          spup_ref_act_energy
-              .name("spup_ref_act_energy_" + to_string(channel->id))
-              .desc("spup_ref_act_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          spup_ref_pre_energy
-              .name("spup_ref_pre_energy_" + to_string(channel->id))
-              .desc("spup_ref_pre_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          pup_act_energy
-              .name("pup_act_energy_" + to_string(channel->id))
-              .desc("pup_act_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          pup_pre_energy
-              .name("pup_pre_energy_" + to_string(channel->id))
-              .desc("pup_pre_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-
-          IO_power
-              .name("IO_power_" + to_string(channel->id))
-              .desc("IO_power_" + to_string(channel->id))
-              .precision(6)
-              ;
-          WR_ODT_power
-              .name("WR_ODT_power_" + to_string(channel->id))
-              .desc("WR_ODT_power_" + to_string(channel->id))
-              .precision(6)
-              ;
-          TermRD_power
-              .name("TermRD_power_" + to_string(channel->id))
-              .desc("TermRD_power_" + to_string(channel->id))
-              .precision(6)
-              ;
-          TermWR_power
-              .name("TermWR_power_" + to_string(channel->id))
-              .desc("TermWR_power_" + to_string(channel->id))
-              .precision(6)
-              ;
-
-          read_io_energy
-              .name("read_io_energy_" + to_string(channel->id))
-              .desc("read_io_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          write_term_energy
-              .name("write_term_energy_" + to_string(channel->id))
-              .desc("write_term_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          read_oterm_energy
-              .name("read_oterm_energy_" + to_string(channel->id))
-              .desc("read_oterm_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          write_oterm_energy
-              .name("write_oterm_energy_" + to_string(channel->id))
-              .desc("write_oterm_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          io_term_energy
-              .name("io_term_energy_" + to_string(channel->id))
-              .desc("io_term_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-
-          ref_energy
-              .name("ref_energy_" + to_string(channel->id))
-              .desc("ref_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-
-          total_energy
-              .name("total_energy_" + to_string(channel->id))
-              .desc("total_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          average_power
-              .name("average_power_" + to_string(channel->id))
-              .desc("average_power_" + to_string(channel->id))
-              .precision(6)
-              ;
-
-          numberofacts_s
-              .name("numberofacts_s_" + to_string(channel->id))
-              .desc("Number of activate commands_" + to_string(channel->id))
-              .precision(0)
-              ;
-          numberofpres_s
-              .name("numberofpres_s_" + to_string(channel->id))
-              .desc("Number of precharge commands_" + to_string(channel->id))
-              .precision(0)
-              ;
-          numberofreads_s
-              .name("numberofreads_s_" + to_string(channel->id))
-              .desc("Number of reads commands_" + to_string(channel->id))
-              .precision(0)
-              ;
-          numberofwrites_s
-              .name("numberofwrites_s_" + to_string(channel->id))
-              .desc("Number of writes commands_" + to_string(channel->id))
-              .precision(0)
-              ;
-          numberofrefs_s
-              .name("numberofrefs_s_" + to_string(channel->id))
-              .desc("Number of refresh commands_" + to_string(channel->id))
-              .precision(0)
-              ;
-          precycles_s
-              .name("precycles_s_" + to_string(channel->id))
-              .desc("Number of precharge cycles_" + to_string(channel->id))
-              .precision(0)
-              ;
-          actcycles_s
-              .name("actcycles_s_" + to_string(channel->id))
-              .desc("Number of active cycles_" + to_string(channel->id))
-              .precision(0)
-              ;
-          idlecycles_act_s
-              .name("idlecycles_act_s_" + to_string(channel->id))
-              .desc("Number of Idle cycles in the active state_" + to_string(channel->id))
-              .precision(0)
-              ;
-          idlecycles_pre_s
-              .name("idlecycles_pre_s_" + to_string(channel->id))
-              .desc("Number of Idle cycles in the precharge state_" + to_string(channel->id))
-              .precision(0)
-              ;
-          f_act_pdns_s
-              .name("f_act_pdns_s_" + to_string(channel->id))
-              .desc("Number of fast-exit activate power-downs_" + to_string(channel->id))
-              .precision(0)
-              ;
-          s_act_pdns_s
-              .name("s_act_pdns_s_" + to_string(channel->id))
-              .desc("Number of slow-exit activate power-downs_" + to_string(channel->id))
-              .precision(0)
-              ;
-          f_pre_pdns_s
-              .name("f_pre_pdns_s_" + to_string(channel->id))
-              .desc("Number of fast-exit precharged power-downs_" + to_string(channel->id))
-              .precision(0)
-              ;
-          s_pre_pdns_s
-              .name("s_pre_pdns_s_" + to_string(channel->id))
-              .desc("Number of slow-exit activate power-downs_" + to_string(channel->id))
-              .precision(0)
-              ;
-          numberofsrefs_s
-              .name("numberofsrefs_s_" + to_string(channel->id))
-              .desc("Number of self-refresh commands_" + to_string(channel->id))
-              .precision(0)
-              ;
-          f_act_pdcycles_s
-              .name("f_act_pdcycles_s_" + to_string(channel->id))
-              .desc("Number of clock cycles in fast-exit activate power-down mode_" + to_string(channel->id))
-              .precision(0)
-              ;
-          s_act_pdcycles_s
-              .name("s_act_pdcycles_s_" + to_string(channel->id))
-              .desc("Number of clock cycles in slow-exit activate power-down mode_" + to_string(channel->id))
-              .precision(0)
-              ;
-          f_pre_pdcycles_s
-              .name("f_pre_pdcycles_s_" + to_string(channel->id))
-              .desc("Number of clock cycles in fast-exit precharged power-down mode_" + to_string(channel->id))
-              .precision(0)
-              ;
-          s_pre_pdcycles_s
-              .name("s_pre_pdcycles_s_" + to_string(channel->id))
-              .desc("Number of clock cycles in slow-exit precharged power-down mode_" + to_string(channel->id))
-              .precision(0)
-              ;
-          sref_cycles_s
-              .name("sref_cycles_s_" + to_string(channel->id))
-              .desc("Number of clock cycles in self-refresh mode_" + to_string(channel->id))
-              .precision(0)
-              ;
-          pup_act_cycles_s
-              .name("pup_act_cycles_s_" + to_string(channel->id))
-              .desc("Number of clock cycles in activate power-up mode_" + to_string(channel->id))
-              .precision(0)
-              ;
-          pup_pre_cycles_s
-              .name("pup_pre_cycles_s_" + to_string(channel->id))
-              .desc("Number of clock cycles in precharged power-up mode_" + to_string(channel->id))
-              .precision(0)
-              ;
-          spup_cycles_s
-              .name("spup_cycles_s_" + to_string(channel->id))
-              .desc("Number of clock cycles in self-refresh power-up mode_" + to_string(channel->id))
-              .precision(0)
-              ;
-          sref_ref_act_cycles_s
-              .name("sref_ref_act_cycles_s_" + to_string(channel->id))
-              .desc("Number of active auto-refresh cycles in self-refresh mode_" + to_string(channel->id))
-              .precision(0)
-              ;
-          sref_ref_pre_cycles_s
-              .name("sref_ref_pre_cycles_s_" + to_string(channel->id))
-              .desc("Number of precharged auto-refresh cycles in self-refresh mode_" + to_string(channel->id))
-              .precision(0)
-              ;
-          spup_ref_act_cycles_s
-              .name("spup_ref_act_cycles_s_" + to_string(channel->id))
-              .desc("Number of active auto-refresh cycles during self-refresh exit_" + to_string(channel->id))
-              .precision(0)
-              ;
-          spup_ref_pre_cycles_s
-              .name("spup_ref_pre_cycles_s_" + to_string(channel->id))
-              .desc("Number of precharged auto-refresh cycles during self-refresh exit_" + to_string(channel->id))
-              .precision(0)
-              ;
+        if (with_drampower)
+            energy = new EnergyModel<T>(configs, channel->spec, channel->id,
+                                        channel->children.size(), int(T::Level::Rank) + 1);
+
+        if (configs.contains("write_queue_size"))
+            writeq.max = configs.get_int_value("write_queue_size");
+        if (configs.contains("write_high_watermark"))
+            write_high_watermark = atof(configs["write_high_watermark"].c_str());
+        if (configs.contains("write_low_watermark"))
+            write_low_watermark = atof(configs["write_low_watermark"].c_str());
+        write_cancellation = configs["write_cancellation"] == "on";
+        if (write_cancellation) {
+            if (configs.contains("write_cancel_threshold"))
+                cancel_threshold = atof(configs["write_cancel_threshold"].c_str());
+            write_cancellations = new ScalarStat();
+            write_cancellations->name("write_cancellations_" + to_string(channel->id))
+                .desc("Number of writes aborted in favor of a read")
+                .precision(0);
         }
+        if (LowPower<T>::enabled(configs))
+            lowpower = new LowPower<T>(configs, this);
     }
 
     ~Controller(){
@@ -549,12 +185,17 @@ public:
         delete rowtable;
         delete channel;
         delete refresh;
+        delete energy;
+        delete write_cancellations;
+        delete lowpower;
         for (auto& file : cmd_trace_files)
             file.close();
         cmd_trace_files.clear();
     }
 
     void finish(long dram_cycles) {
+      if (energy)
+        energy->finish(clk);
       channel->finish(dram_cycles);
     }
 
@@ -591,6 +232,14 @@ public:
     void tick()
     {
         clk++;
+
+        /*** 0. All ranks sleep and nothing is outstanding: only keep refresh going ***/
+        if (lowpower && lowpower->all_asleep() && !readq.size() && !writeq.size()
+                && !otherq.size() && pending.empty() && pending_write.empty()) {
+            refresh->tick_ref();
+            return;
+        }
+
         (*req_queue_length_sum) += readq.size() + writeq.size() + pending.size();
         (*read_req_queue_length_sum) += readq.size() + pending.size();
         (*write_req_queue_length_sum) += writeq.size();
@@ -620,15 +269,25 @@ public:
         /*** 2. Refresh scheduler ***/
         refresh->tick_ref();
 
+        /*** 2.1. Power-down, self-refresh and wake-up of ranks ***/
+        if (lowpower) {
+            typename T::Command cmd;
+            vector<int> addr_vec;
+            if (lowpower->tick(cmd, addr_vec)) {
+                issue_cmd(cmd, addr_vec);
+                return;
+            }
+        }
+
         /*** 3. Should we schedule writes? ***/
         if (!write_mode) {
             // yes -- write queue is almost full or read queue is empty
-            if (writeq.size() >= int(0.8 * writeq.max) || readq.size() == 0)
+            if (writeq.size() >= (unsigned int)(write_high_watermark * writeq.max) || readq.size() == 0)
                 write_mode = true;
         }
         else {
             // no -- write queue is almost empty and read queue is not empty
-            if (writeq.size() <= int(0.2 * writeq.max) && readq.size() != 0)
+            if (writeq.size() <= (unsigned int)(write_low_watermark * writeq.max) && readq.size() != 0)
                 write_mode = false;
         }
 
@@ -638,6 +297,8 @@ public:
             queue = &otherq;  // "other" requests are rare, so we give them precedence over reads/writes
 
         auto req = scheduler->get_head(queue->q);
+        if (write_cancellation && queue == &readq && req != queue->q.end() && !is_ready(req))
+            cancel_write(req);
         if (req == queue->q.end() || !is_ready(req)) {
           if (!no_DRAM_latency) {
             // we couldn't find a command to schedule -- let's try to be speculative
@@ -690,7 +351,10 @@ public:
 
         // issue command on behalf of request
         auto cmd = get_first_cmd(req);
-        issue_cmd(cmd, get_addr_vec(cmd, req));
+        if (write_cancellation)
+            issue_tracked_cmd(cmd, req);
+        else
+            issue_cmd(cmd, get_addr_vec(cmd, req));
 
         // check whether this is the last command (which finishes the request)
         if (cmd != channel->spec->translate[int(req->type)])
@@ -765,6 +429,23 @@ public:
     void record_core(int coreid) {
     }
 
+    // Functional warming: leaves the row of addr_vec open as a read would,
+    // with state-only updates (no timing, energy or statistics)
+    void warm(const vector<int>& addr_vec)
+    {
+        if (no_DRAM_latency)
+            return;
+        typename T::Command access = channel->spec->translate[int(Request::Type::READ)];
+        // at most a precharge and an activate; sleeping ranks are left alone
+        for (int i = 0; i < 2; i++) {
+            typename T::Command cmd = channel->decode(access, addr_vec.data());
+            if (!channel->spec->is_opening(cmd) && !channel->spec->is_closing(cmd))
+                return;
+            channel->update_state(cmd, addr_vec.data());
+            rowtable->update(cmd, addr_vec, clk);
+        }
+    }
+
 private:
     typename T::Command get_first_cmd(list<Request>::iterator req)
     {
@@ -780,18 +461,8 @@ private:
     {
         assert(is_ready(cmd, addr_vec));
 
-        if (with_drampower) {
-          int bank_id = addr_vec[int(T::Level::Bank)];
-          if (channel->spec->standard_name == "DDR4" || channel->spec->standard_name == "GDDR5" || channel->spec->standard_name == "HBM") {
-              // if has bankgroup
-              bank_id += addr_vec[int(T::Level::Bank) - 1] * channel->spec->org_entry.count[int(T::Level::Bank)];
-          }
-
-          update_counter++;
-          if (update_counter == 1000000) {
-              update_counter = 0;
-          }
-        }
+        if (energy)
+            energy->issue(cmd, addr_vec[int(T::Level::Rank)], clk);
 
         if (!no_DRAM_latency) {
           channel->update(cmd, addr_vec.data(), clk);
@@ -826,6 +497,72 @@ private:
     vector<int> get_addr_vec(typename T::Command cmd, list<Request>::iterator req){
         return req->addr_vec;
     }
+
+    DRAM<T>* get_bank(const vector<int>& addr_vec)
+    {
+        DRAM<T>* node = channel;
+        for (int lev = 1; lev <= int(T::Level::Bank); lev++)
+            node = node->children[addr_vec[lev]];
+        return node;
+    }
+
+    bool same_bank(const vector<int>& a, const vector<int>& b)
+    {
+        return equal(a.begin(), a.begin() + int(T::Level::Bank) + 1, b.begin());
+    }
+
+    // issue_cmd() that also remembers in-flight writes for write cancellation
+    void issue_tracked_cmd(typename T::Command cmd, list<Request>::iterator req)
+    {
+        if (!channel->spec->is_accessing(cmd)) {
+            issue_cmd(cmd, get_addr_vec(cmd, req));
+            return;
+        }
+        // undoing an earlier write would also undo the timing of this command
+        for (auto& w : inflight_writes)
+            if (same_bank(w.req.addr_vec, req->addr_vec))
+                w.cancellable = false;
+
+        DRAM<T>* bank = get_bank(req->addr_vec);
+        long next_pre = bank->get_local_next(T::Command::PRE);
+        long next_act = bank->get_local_next(T::Command::ACT);
+        issue_cmd(cmd, get_addr_vec(cmd, req));
+        if (req->type != Request::Type::WRITE)
+            return;
+
+        long done = max(bank->get_local_next(T::Command::PRE), bank->get_local_next(T::Command::ACT));
+        inflight_writes.push_back({*req, clk, done, next_pre, next_act, true});
+    }
+
+    void cancel_write(list<Request>::iterator req)
+    {
+        while (inflight_writes.size() && inflight_writes.front().done <= clk)
+            inflight_writes.pop_front();
+        if (writeq.size() >= writeq.max)
+            return;
+
+        for (auto w = inflight_writes.begin(); w != inflight_writes.end(); ++w) {
+            if (!same_bank(w->req.addr_vec, req->addr_vec) || !w->cancellable)
+                continue;
+            if (w->req.addr_vec[int(T::Level::Row)] == req->addr_vec[int(T::Level::Row)]
+                || clk - w->issued >= cancel_threshold * (w->done - w->issued)
+                || max(w->next_pre, w->next_act) > clk)  // an older write still holds the bank
+                return;
+
+            DRAM<T>* bank = get_bank(req->addr_vec);
+            bank->set_local_next(T::Command::PRE, max(clk, w->next_pre));
+            bank->set_local_next(T::Command::ACT, max(clk, w->next_act));
+
+            // the host was already acknowledged, so the retry completes silently
+            Request retry = w->req;
+            retry.is_first_command = true;
+            retry.callback = [](Request& req){};
+            writeq.q.push_front(retry);
+            inflight_writes.erase(w);
+            ++(*write_cancellations);
+            return;
+        }
+    }
 };
 
 template <>
@@ -52,6 +52,15 @@ void DDR4::set_rank_number(int rank) {
   org_entry.count[int(Level::Rank)] = rank;
 }
 
+void DDR4::set_refresh_mode(RefreshMode mode) {
+  refresh_mode = mode;
+  init_speed();
+  for (auto& level : timing)
+    for (auto& entries : level)
+      entries.clear();
+  init_timing();
+}
+
 void DDR4::init_speed()
 {
     const static int RRDS_TABLE[2][4] = {
@@ -171,6 +171,11 @@ public:
         MAX
     } refresh_mode = RefreshMode::Refresh_1X;
 
+    // Fine granularity refresh: 2x/4x refresh twice/four times as often with
+    // a shorter nRFC. Rebuilds the timing table, so call it before any
+    // DRAM<DDR4> node is created.
+    void set_refresh_mode(RefreshMode mode);
+
     int prefetch_size = 8; // 8n prefetch DDR
     int channel_width = 64;
 
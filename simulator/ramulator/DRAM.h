@@ -75,6 +75,11 @@ public:
     void update_state(typename T::Command cmd, const int* addr);
     void update_timing(typename T::Command cmd, const int* addr, long clk);
 
+    // Earliest issue time of a command at this node only (ignoring children),
+    // e.g. to roll back the recovery time of a cancelled write
+    long get_local_next(typename T::Command cmd) {return next[int(cmd)];}
+    void set_local_next(typename T::Command cmd, long clk) {next[int(cmd)] = clk;}
+
     // Update statistics:
 
     // Update the number of requests it serves currently
@@ -0,0 +1,410 @@
+/*
+ * Energy.h
+ *
+ * Command-based DRAM energy model, in the spirit of DRAMPower and Micron's
+ * TN-41-01 power calculator. It replaces the (never enabled) libDRAMPower hook
+ * in the controllers and needs no external library or memspec file.
+ *
+ * All per-command energies are computed once at construction from the IDD/VDD
+ * parameters and the timing of the standard, so observing an issued command is
+ * a single table lookup plus a counter increment. Background energy is tracked
+ * per rank by counting the cycles in which at least one bank is open, and the
+ * cycles spent in power-down and self-refresh (see LowPower.h).
+ *
+ * Currents are given in mA per device, VDD in V and tCK in ns, so every energy
+ * below is in pJ. Parameters can be overridden from the Ramulator config:
+ *
+ *   drampower = on
+ *   vdd = 1.2
+ *   idd0 = 60 / idd2n = 50 / idd3n = 55 / idd4r = 145 / idd4w = 145 / idd5b = 362
+ *   idd2p = 25 / idd3p = 37 / idd6 = 30   # power-down and self-refresh
+ *   io_energy_per_bit = 5.0     # off-chip I/O and termination (pJ/bit)
+ *   tsv_energy_per_bit = 0.0    # TSV traversal for 3D stacks (pJ/bit)
+ *   logic_energy_per_bit = 0.0  # logic layer (vault controller, switch) (pJ/bit)
+ *   act_energy_per_bit = 0.0    # NVM array read into the row buffer (pJ/bit)
+ *   write_energy_per_bit = 0.0  # NVM cell programming (pJ/bit)
+ *
+ * Non-volatile memories have no meaningful IDD0/IDD4W: their array energy is
+ * dominated by sensing and programming the cells, which the last two
+ * parameters charge per row bit on ACT and per written bit on WR.
+ */
+
+#ifndef __ENERGY_H
+#define __ENERGY_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "Config.h"
+#include "Statistics.h"
+#include "DSARP.h"
+#include "LPDDR3.h"
+#include "LPDDR4.h"
+#include "WideIO2.h"
+
+using namespace std;
+
+namespace ramulator
+{
+
+// Duration of an all-bank refresh. Most standards call it nRFC; the ones
+// that also support per-bank refresh call it nRFCab.
+template <typename T>
+inline int refresh_cycles(const T* spec) { return spec->speed_entry.nRFC; }
+template <>
+inline int refresh_cycles(const DSARP* spec) { return spec->speed_entry.nRFCab; }
+template <>
+inline int refresh_cycles(const LPDDR3* spec) { return spec->speed_entry.nRFCab; }
+template <>
+inline int refresh_cycles(const LPDDR4* spec) { return spec->speed_entry.nRFCab; }
+template <>
+inline int refresh_cycles(const WideIO2* spec) { return spec->speed_entry.nRFCab; }
+
+template <typename T>
+class EnergyModel
+{
+public:
+    enum class Component : int
+    {
+        Activation, Read, Write, IO, Refresh, Logic, MAX
+    };
+
+    struct PowerEntry {
+        const char* standard;
+        double vdd;
+        double idd0, idd2n, idd3n, idd4r, idd4w, idd5b;
+        double idd2p, idd3p, idd6;
+        double io_pj_per_bit, tsv_pj_per_bit, logic_pj_per_bit;
+        double act_pj_per_bit, write_pj_per_bit;
+    };
+
+    // Default per-device currents. DDR4 follows a Micron 8Gb x8 DDR4-2400
+    // part; HBM/HMC are per channel/vault and the per-bit logic-layer cost of
+    // HMC follows Jeddeloh and Keeth (VLSI 2012), split into SerDes I/O and
+    // vault controller/switch logic. PCM array energies follow Lee et al.
+    // (ISCA 2009) and STT-MRAM ones Kultursay et al. (ISPASS 2013); both
+    // only draw peripheral current in the background and never refresh.
+    // Other standards fall back to DDR4.
+    static const PowerEntry* default_power(const string& standard) {
+        static const PowerEntry table[] = {
+            {"DDR4",    1.2,  60, 50, 55, 145, 145, 362,  25, 37, 30,  5.0, 0.0, 0.0,   0.0,  0.0},
+            {"HBM",     1.2,  65, 33, 40, 155, 150, 215,  20, 24, 18,  0.8, 0.3, 0.0,   0.0,  0.0},
+            {"HMC",     1.2,  65, 33, 40, 155, 150, 215,  20, 24, 18,  3.0, 0.3, 3.78,  0.0,  0.0},
+            {"PCM",     1.8,  15, 15, 15, 100, 100,   0,   5,  5,  2,  5.0, 0.0, 0.0,  2.47, 16.82},
+            {"STTMRAM", 1.5,  30, 30, 30, 120, 120,   0,   5,  5,  2,  5.0, 0.0, 0.0,  1.0,  3.0},
+        };
+        for (auto& entry : table)
+            if (standard == entry.standard)
+                return &entry;
+        return &table[0];
+    }
+
+    PowerEntry power;
+
+    int devices;  // DRAM devices driven in lockstep by one command
+    int banks;  // banks per rank, used to scale per-bank refresh
+    bool charge_io;  // no off-chip I/O when the cores sit in the logic layer
+    double tCK;
+
+    // per-command energy (pJ) split by component, filled at construction
+    double cmd_energy[int(T::Command::MAX)][int(Component::MAX)];
+    // effect of each command on the number of open banks of its rank
+    enum class BankEffect : int { None, Open, Close, CloseAll };
+    BankEffect bank_effect[int(T::Command::MAX)];
+    // effect of each command on the power state of its rank
+    enum class PowerEffect : int { None, PowerDown, SelfRefresh, Exit };
+    PowerEffect power_effect[int(T::Command::MAX)];
+
+    // precharge half of an ACT-PRE pair, charged per closed bank
+    double e_pre = 0;
+
+    long cmd_count[int(T::Command::MAX)];
+    long implicit_pres = 0;  // banks closed by PREA
+
+    vector<int> open_banks;  // per rank
+    vector<long> active_since;  // per rank, valid while open_banks > 0
+    long active_cycles = 0;  // summed over ranks
+    long total_cycles = 0;  // summed over ranks
+
+    enum class PowerState : int { Up, ActPowerDown, PrePowerDown, SelfRefresh };
+    vector<PowerState> power_state;  // per rank
+    vector<long> power_since;  // per rank, valid while not Up
+    long act_pd_cycles = 0, pre_pd_cycles = 0, sr_cycles = 0;  // summed over ranks
+
+    ScalarStat act_energy;
+    ScalarStat pre_energy;
+    ScalarStat read_energy;
+    ScalarStat write_energy;
+    ScalarStat act_stdby_energy;
+    ScalarStat pre_stdby_energy;
+    ScalarStat read_io_energy;
+    ScalarStat write_term_energy;
+    ScalarStat ref_energy;
+    ScalarStat act_pd_energy;
+    ScalarStat pre_pd_energy;
+    ScalarStat sref_energy;
+    ScalarStat logic_energy;
+    ScalarStat total_energy;
+    ScalarStat average_power;
+
+    ScalarStat numberofacts_s;
+    ScalarStat numberofpres_s;
+    ScalarStat numberofreads_s;
+    ScalarStat numberofwrites_s;
+    ScalarStat numberofrefs_s;
+    ScalarStat actcycles_s;
+    ScalarStat precycles_s;
+    ScalarStat pdcycles_s;
+    ScalarStat srcycles_s;
+
+    EnergyModel(const Config& configs, const T* spec, int id, int ranks, int first_bank_level) :
+        power(*default_power(spec->standard_name)),
+        charge_io(!configs.pim_mode_enabled()),
+        tCK(spec->speed_entry.tCK),
+        open_banks(ranks, 0),
+        active_since(ranks, 0),
+        power_state(ranks, PowerState::Up),
+        power_since(ranks, 0)
+    {
+        read_param(configs, "vdd", power.vdd);
+        read_param(configs, "idd0", power.idd0);
+        read_param(configs, "idd2n", power.idd2n);
+        read_param(configs, "idd3n", power.idd3n);
+        read_param(configs, "idd4r", power.idd4r);
+        read_param(configs, "idd4w", power.idd4w);
+        read_param(configs, "idd5b", power.idd5b);
+        read_param(configs, "idd2p", power.idd2p);
+        read_param(configs, "idd3p", power.idd3p);
+        read_param(configs, "idd6", power.idd6);
+        read_param(configs, "io_energy_per_bit", power.io_pj_per_bit);
+        read_param(configs, "tsv_energy_per_bit", power.tsv_pj_per_bit);
+        read_param(configs, "logic_energy_per_bit", power.logic_pj_per_bit);
+        read_param(configs, "act_energy_per_bit", power.act_pj_per_bit);
+        read_param(configs, "write_energy_per_bit", power.write_pj_per_bit);
+
+        devices = max(1, spec->channel_width / spec->org_entry.dq);
+        banks = 1;
+        for (int lev = first_bank_level; lev < int(T::Level::Row); lev++)
+            banks *= max(1, spec->org_entry.count[lev]);
+
+        init_cmd_energy(spec);
+        reg_stats(id);
+    }
+
+    // Called by the controller for every issued command
+    void issue(typename T::Command cmd, int rank, long clk)
+    {
+        ++cmd_count[int(cmd)];
+        if (power_effect[int(cmd)] != PowerEffect::None) {
+            leave_power_state(rank, clk);
+            if (power_effect[int(cmd)] == PowerEffect::PowerDown)
+                power_state[rank] = open_banks[rank] ? PowerState::ActPowerDown : PowerState::PrePowerDown;
+            else if (power_effect[int(cmd)] == PowerEffect::SelfRefresh)
+                power_state[rank] = PowerState::SelfRefresh;
+            power_since[rank] = clk;
+            return;
+        }
+        switch (int(bank_effect[int(cmd)])) {
+            case int(BankEffect::None):
+                return;
+            case int(BankEffect::Open):
+                if (open_banks[rank]++ == 0)
+                    active_since[rank] = clk;
+                return;
+            case int(BankEffect::Close):
+                if (open_banks[rank] > 0 && --open_banks[rank] == 0)
+                    active_cycles += clk - active_since[rank];
+                return;
+            case int(BankEffect::CloseAll):
+                if (open_banks[rank] > 0) {
+                    implicit_pres += open_banks[rank];
+                    active_cycles += clk - active_since[rank];
+                    open_banks[rank] = 0;
+                }
+                return;
+        }
+    }
+
+    void finish(long clk)
+    {
+        for (unsigned int r = 0; r < open_banks.size(); r++)
+            if (open_banks[r] > 0) {
+                active_cycles += clk - active_since[r];
+                active_since[r] = clk;
+            }
+        for (unsigned int r = 0; r < power_state.size(); r++)
+            if (power_state[r] != PowerState::Up) {
+                PowerState state = power_state[r];
+                leave_power_state(r, clk);
+                power_state[r] = state;
+                power_since[r] = clk;
+            }
+        total_cycles = clk * open_banks.size();
+
+        double sum[int(Component::MAX)] = {0};
+        for (int c = 0; c < int(T::Command::MAX); c++)
+            for (int comp = 0; comp < int(Component::MAX); comp++)
+                sum[comp] += cmd_count[c] * cmd_energy[c][comp];
+
+        // PREA closes several banks at once; charge each like a PRE
+        long acts = 0, pres = implicit_pres, rd = 0, wr = 0, refs = 0;
+        for (int c = 0; c < int(T::Command::MAX); c++) {
+            if (bank_effect[c] == BankEffect::Open) acts += cmd_count[c];
+            if (bank_effect[c] == BankEffect::Close) pres += cmd_count[c];
+            if (cmd_energy[c][int(Component::Read)] > 0) rd += cmd_count[c];
+            if (cmd_energy[c][int(Component::Write)] > 0) wr += cmd_count[c];
+            if (cmd_energy[c][int(Component::Refresh)] > 0) refs += cmd_count[c];
+        }
+
+        long pre_cycles = total_cycles - active_cycles;
+        long act_stdby_cycles = active_cycles - act_pd_cycles;
+        long pre_stdby_cycles = pre_cycles - pre_pd_cycles - sr_cycles;
+        double bg_scale = devices * power.vdd * tCK;
+        double io = sum[int(Component::IO)];
+
+        act_energy = sum[int(Component::Activation)];
+        pre_energy = pres * e_pre;
+        read_energy = sum[int(Component::Read)];
+        write_energy = sum[int(Component::Write)];
+        act_stdby_energy = power.idd3n * act_stdby_cycles * bg_scale;
+        pre_stdby_energy = power.idd2n * pre_stdby_cycles * bg_scale;
+        act_pd_energy = power.idd3p * act_pd_cycles * bg_scale;
+        pre_pd_energy = power.idd2p * pre_pd_cycles * bg_scale;
+        sref_energy = power.idd6 * sr_cycles * bg_scale;
+        read_io_energy = rd + wr ? io * rd / (rd + wr) : 0;
+        write_term_energy = io - read_io_energy.value();
+        ref_energy = sum[int(Component::Refresh)];
+        logic_energy = sum[int(Component::Logic)];
+
+        total_energy = act_energy.value() + pre_energy.value()
+            + read_energy.value() + write_energy.value()
+            + act_stdby_energy.value() + pre_stdby_energy.value()
+            + act_pd_energy.value() + pre_pd_energy.value() + sref_energy.value()
+            + io + ref_energy.value() + logic_energy.value();
+        // pJ / ns = mW
+        average_power = clk ? total_energy.value() / (clk * tCK) : 0;
+
+        numberofacts_s = acts;
+        numberofpres_s = pres;
+        numberofreads_s = rd;
+        numberofwrites_s = wr;
+        numberofrefs_s = refs;
+        actcycles_s = active_cycles;
+        precycles_s = pre_cycles;
+        pdcycles_s = act_pd_cycles + pre_pd_cycles;
+        srcycles_s = sr_cycles;
+    }
+
+private:
+    void leave_power_state(int rank, long clk)
+    {
+        long cycles = clk - power_since[rank];
+        switch (int(power_state[rank])) {
+            case int(PowerState::ActPowerDown): act_pd_cycles += cycles; break;
+            case int(PowerState::PrePowerDown): pre_pd_cycles += cycles; break;
+            case int(PowerState::SelfRefresh): sr_cycles += cycles; break;
+        }
+        power_state[rank] = PowerState::Up;
+    }
+
+    static void read_param(const Config& configs, const string& name, double& value)
+    {
+        if (configs.contains(name))
+            value = atof(configs[name].c_str());
+    }
+
+    void init_cmd_energy(const T* spec)
+    {
+        const auto& s = spec->speed_entry;
+        double scale = devices * power.vdd * tCK;
+        int bits = spec->prefetch_size * spec->channel_width;
+        long row_bits = long(spec->org_entry.count[int(T::Level::Column)]) * spec->org_entry.dq * devices;
+
+        // IDD0 covers a full tRC ACT-PRE cycle; subtract the background that
+        // is accounted separately, and charge each half to its own command
+        double e_act = (power.idd0 - power.idd3n) * s.nRAS * scale
+            + power.act_pj_per_bit * row_bits;
+        e_pre = (power.idd0 - power.idd2n) * (s.nRC - s.nRAS) * scale;
+        double e_rd = (power.idd4r - power.idd3n) * s.nBL * scale;
+        double e_wr = (power.idd4w - power.idd3n) * s.nBL * scale
+            + power.write_pj_per_bit * bits;
+        double e_ref = (power.idd5b - power.idd3n) * refresh_cycles(spec) * scale;
+        double e_io = charge_io ? power.io_pj_per_bit * bits : 0;
+        double e_logic = (power.tsv_pj_per_bit + power.logic_pj_per_bit) * bits;
+
+        for (int c = 0; c < int(T::Command::MAX); c++) {
+            cmd_count[c] = 0;
+            bank_effect[c] = BankEffect::None;
+            power_effect[c] = PowerEffect::None;
+            for (int comp = 0; comp < int(Component::MAX); comp++)
+                cmd_energy[c][comp] = 0;
+
+            const string& name = spec->command_name[c];
+            double* e = cmd_energy[c];
+            if (name == "ACT" || name == "ACTF") {
+                e[int(Component::Activation)] = e_act;
+                bank_effect[c] = BankEffect::Open;
+            } else if (name == "PRE" || name == "PREF") {
+                bank_effect[c] = BankEffect::Close;
+            } else if (name == "PREA" || name == "PRA" || name == "PREAF") {
+                bank_effect[c] = BankEffect::CloseAll;
+            } else if (name == "RD" || name == "RDA") {
+                e[int(Component::Read)] = e_rd;
+                e[int(Component::IO)] = e_io;
+                e[int(Component::Logic)] = e_logic;
+                if (name == "RDA") bank_effect[c] = BankEffect::Close;
+            } else if (name == "WR" || name == "WRA") {
+                e[int(Component::Write)] = e_wr;
+                e[int(Component::IO)] = e_io;
+                e[int(Component::Logic)] = e_logic;
+                if (name == "WRA") bank_effect[c] = BankEffect::Close;
+            } else if (name == "REF") {
+                e[int(Component::Refresh)] = e_ref;
+            } else if (name == "REFPB" || name == "REFSB") {
+                e[int(Component::Refresh)] = e_ref / banks;
+            } else if (name == "PDE" || name == "PD") {
+                power_effect[c] = PowerEffect::PowerDown;
+            } else if (name == "SRE" || name == "SREF") {
+                power_effect[c] = PowerEffect::SelfRefresh;
+            } else if (name == "PDX" || name == "SRX" || name == "SREFX") {
+                power_effect[c] = PowerEffect::Exit;
+            }
+        }
+    }
+
+    void reg_stats(int id)
+    {
+        string suffix = "_" + to_string(id);
+        act_energy.name("act_energy" + suffix).desc("Activation energy (pJ)").precision(6);
+        pre_energy.name("pre_energy" + suffix).desc("Precharge energy (pJ)").precision(6);
+        read_energy.name("read_energy" + suffix).desc("Read array energy (pJ)").precision(6);
+        write_energy.name("write_energy" + suffix).desc("Write array energy (pJ)").precision(6);
+        act_stdby_energy.name("act_stdby_energy" + suffix).desc("Active standby energy (pJ)").precision(6);
+        pre_stdby_energy.name("pre_stdby_energy" + suffix).desc("Precharge standby energy (pJ)").precision(6);
+        read_io_energy.name("read_io_energy" + suffix).desc("Read I/O energy (pJ)").precision(6);
+        write_term_energy.name("write_term_energy" + suffix).desc("Write termination energy (pJ)").precision(6);
+        ref_energy.name("ref_energy" + suffix).desc("Refresh energy (pJ)").precision(6);
+        act_pd_energy.name("act_pd_energy" + suffix).desc("Active power-down energy (pJ)").precision(6);
+        pre_pd_energy.name("pre_pd_energy" + suffix).desc("Precharge power-down energy (pJ)").precision(6);
+        sref_energy.name("sref_energy" + suffix).desc("Self-refresh energy (pJ)").precision(6);
+        logic_energy.name("logic_energy" + suffix).desc("Logic layer and TSV energy (pJ)").precision(6);
+        total_energy.name("total_energy" + suffix).desc("Total DRAM energy (pJ)").precision(6);
+        average_power.name("average_power" + suffix).desc("Average DRAM power (mW)").precision(6);
+
+        numberofacts_s.name("numberofacts_s" + suffix).desc("Number of activate commands").precision(0);
+        numberofpres_s.name("numberofpres_s" + suffix).desc("Number of precharges (explicit and implicit)").precision(0);
+        numberofreads_s.name("numberofreads_s" + suffix).desc("Number of read commands").precision(0);
+        numberofwrites_s.name("numberofwrites_s" + suffix).desc("Number of write commands").precision(0);
+        numberofrefs_s.name("numberofrefs_s" + suffix).desc("Number of refresh commands").precision(0);
+        actcycles_s.name("actcycles_s" + suffix).desc("Rank-cycles with at least one bank open").precision(0);
+        precycles_s.name("precycles_s" + suffix).desc("Rank-cycles with all banks closed").precision(0);
+        pdcycles_s.name("pdcycles_s" + suffix).desc("Rank-cycles in power-down").precision(0);
+        srcycles_s.name("srcycles_s" + suffix).desc("Rank-cycles in self-refresh").precision(0);
+    }
+};
+
+} /*namespace ramulator*/
+
+#endif /*__ENERGY_H*/
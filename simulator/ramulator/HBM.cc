@@ -53,6 +53,11 @@ void HBM::set_rank_number(int rank) {
   org_entry.count[int(Level::Rank)] = rank;
 }
 
+void HBM::set_refresh_mode(RefreshMode mode) {
+  refresh_mode = mode;
+  translate[int(Request::Type::REFRESH)] = (mode == RefreshMode::Refresh_SB) ? Command::REFSB : Command::REF;
+}
+
 
 void HBM::init_speed()
 {
@@ -122,6 +127,8 @@ void HBM::init_prereq()
     prereq[int(Level::Bank)][int(Command::REFSB)] = [] (DRAM<HBM>* node, Command cmd, int id) {
         if (node->state == State::Closed) return Command::REFSB;
         return Command::PRE;};
+    // a rank in power-down or self-refresh has to wake up first
+    prereq[int(Level::Rank)][int(Command::REFSB)] = prereq[int(Level::Rank)][int(Command::RD)];
 
     // PD
     prereq[int(Level::Rank)][int(Command::PDE)] = [] (DRAM<HBM>* node, Command cmd, int id) {
@@ -304,6 +311,11 @@ void HBM::init_timing()
     // REF <-> SR
     t[int(Command::SRX)].push_back({Command::REF, 1, s.nXS});
 
+    // REFSB <-> PD / SR
+    t[int(Command::REFSB)].push_back({Command::PDE, 1, 1});
+    t[int(Command::PDX)].push_back({Command::REFSB, 1, s.nXP});
+    t[int(Command::SRX)].push_back({Command::REFSB, 1, s.nXS});
+
     // PD <-> PD
     t[int(Command::PDE)].push_back({Command::PDX, 1, s.nPD});
     t[int(Command::PDX)].push_back({Command::PDE, 1, s.nXP});
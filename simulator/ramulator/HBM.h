@@ -115,6 +115,17 @@ public:
         Command::REF, Command::PDE, Command::SRE
     };
 
+    /* Refresh */
+    // all-bank (REF) or single-bank (REFSB) refresh, see Refresh<HBM>::tick_ref
+    enum class RefreshMode : int
+    {
+        Refresh_AB,
+        Refresh_SB,
+        MAX
+    } refresh_mode = RefreshMode::Refresh_AB;
+
+    void set_refresh_mode(RefreshMode mode);
+
     /* Prereq */
     function<Command(DRAM<HBM>*, Command cmd, int)> prereq[int(Level::MAX)][int(Command::MAX)];
 
@@ -473,28 +473,10 @@ public:
 
     bool send(Request req)
     {
-        req.addr_vec.resize(addr_bits.size());
         req.burst_count = cacheline_size / (1 << tx_bits);
-        long addr = req.addr;
+        req.burst_count = req.compressed_bursts(req.burst_count, cacheline_size);
         int coreid = req.coreid;
-
-        // Each transaction size is 2^tx_bits, so first clear the lowest tx_bits bits
-        clear_lower_bits(addr, tx_bits);
-
-        switch(int(type)){
-            case int(Type::ChRaBaRoCo):
-                for (int i = addr_bits.size() - 1; i >= 0; i--)
-                    req.addr_vec[i] = slice_lower_bits(addr, addr_bits[i]);
-                break;
-            case int(Type::RoBaRaCoCh):
-                req.addr_vec[0] = slice_lower_bits(addr, addr_bits[0]);
-                req.addr_vec[addr_bits.size() - 1] = slice_lower_bits(addr, addr_bits[addr_bits.size() - 1]);
-                for (int i = 1; i <= int(HBM::Level::Row); i++)
-                    req.addr_vec[i] = slice_lower_bits(addr, addr_bits[i]);
-                break;
-            default:
-                assert(false);
-        }
+        map_address(req.addr, req.addr_vec);
 
 
         if(pim_mode_enabled )
@@ -541,6 +523,37 @@ public:
         return source_p == destination_p ? abs(source_c - destination_c) * bankgroup_change_latency : channel_change_latency; // * abs(source_p - destination_p)  ;
     }
 
+    void warm(long addr)
+    {
+        vector<int> addr_vec;
+        map_address(addr, addr_vec);
+        ctrls[addr_vec[0]]->warm(addr_vec);
+    }
+
+    void warm_row(const vector<int>& addr_vec)
+    {
+        ctrls[addr_vec[0]]->warm(addr_vec);
+    }
+
+    string geometry()
+    {
+        string g = spec->standard_name;
+        for (int l = 0; l < int(HBM::Level::MAX); l++)
+            g += " " + to_string(spec->org_entry.count[l]);
+        return g;
+    }
+
+    void open_rows(vector<vector<int>>& rows)
+    {
+        for (auto ctrl : ctrls)
+            for (auto& kv : ctrl->rowtable->table) {
+                vector<int> addr_vec(kv.first);
+                addr_vec.push_back(kv.second.row);
+                addr_vec.resize(int(HBM::Level::MAX), 0);
+                rows.push_back(addr_vec);
+            }
+    }
+
     int pending_requests()
     {
         int reqs = 0;
@@ -678,6 +691,28 @@ private:
             n ++;
         return n;
     }
+    void map_address(long addr, vector<int>& addr_vec)
+    {
+        addr_vec.resize(addr_bits.size());
+
+        // Each transaction size is 2^tx_bits, so first clear the lowest tx_bits bits
+        clear_lower_bits(addr, tx_bits);
+
+        switch(int(type)){
+            case int(Type::ChRaBaRoCo):
+                for (int i = addr_bits.size() - 1; i >= 0; i--)
+                    addr_vec[i] = slice_lower_bits(addr, addr_bits[i]);
+                break;
+            case int(Type::RoBaRaCoCh):
+                addr_vec[0] = slice_lower_bits(addr, addr_bits[0]);
+                addr_vec[addr_bits.size() - 1] = slice_lower_bits(addr, addr_bits[addr_bits.size() - 1]);
+                for (int i = 1; i <= int(HBM::Level::Row); i++)
+                    addr_vec[i] = slice_lower_bits(addr, addr_bits[i]);
+                break;
+            default:
+                assert(false);
+        }
+    }
     int slice_lower_bits(long& addr, int bits)
     {
         int lbits = addr & ((1<<bits) - 1);
@@ -17,8 +17,6 @@
 #include "HMC.h"
 #include "Packet.h"
 
-//#include "libdrampower/LibDRAMPower.h"
-//#include "xmlparser/MemSpecParser.h"
 
 using namespace std;
 
@@ -55,108 +53,13 @@ public:
     VectorStat* record_write_hits;
     VectorStat* record_write_misses;
     VectorStat* record_write_conflicts;
-    // DRAM power estimation statistics
-
-    ScalarStat act_energy;
-    ScalarStat pre_energy;
-    ScalarStat read_energy;
-    ScalarStat write_energy;
-
-    ScalarStat act_stdby_energy;
-    ScalarStat pre_stdby_energy;
-    ScalarStat idle_energy_act;
-    ScalarStat idle_energy_pre;
-
-    ScalarStat f_act_pd_energy;
-    ScalarStat f_pre_pd_energy;
-    ScalarStat s_act_pd_energy;
-    ScalarStat s_pre_pd_energy;
-    ScalarStat sref_energy;
-    ScalarStat sref_ref_energy;
-    ScalarStat sref_ref_act_energy;
-    ScalarStat sref_ref_pre_energy;
-
-    ScalarStat spup_energy;
-    ScalarStat spup_ref_energy;
-    ScalarStat spup_ref_act_energy;
-    ScalarStat spup_ref_pre_energy;
-    ScalarStat pup_act_energy;
-    ScalarStat pup_pre_energy;
-
-    ScalarStat IO_power;
-    ScalarStat WR_ODT_power;
-    ScalarStat TermRD_power;
-    ScalarStat TermWR_power;
-
-    ScalarStat read_io_energy;
-    ScalarStat write_term_energy;
-    ScalarStat read_oterm_energy;
-    ScalarStat write_oterm_energy;
-    ScalarStat io_term_energy;
-
-    ScalarStat ref_energy;
-
-    ScalarStat total_energy;
-    ScalarStat average_power;
-
-    // drampower counter
-
-    // Number of activate commands
-    ScalarStat numberofacts_s;
-    // Number of precharge commands
-    ScalarStat numberofpres_s;
-    // Number of reads commands
-    ScalarStat numberofreads_s;
-    // Number of writes commands
-    ScalarStat numberofwrites_s;
-    // Number of refresh commands
-    ScalarStat numberofrefs_s;
-    // Number of precharge cycles
-    ScalarStat precycles_s;
-    // Number of active cycles
-    ScalarStat actcycles_s;
-    // Number of Idle cycles in the active state
-    ScalarStat idlecycles_act_s;
-    // Number of Idle cycles in the precharge state
-    ScalarStat idlecycles_pre_s;
-    // Number of fast-exit activate power-downs
-    ScalarStat f_act_pdns_s;
-    // Number of slow-exit activate power-downs
-    ScalarStat s_act_pdns_s;
-    // Number of fast-exit precharged power-downs
-    ScalarStat f_pre_pdns_s;
-    // Number of slow-exit activate power-downs
-    ScalarStat s_pre_pdns_s;
-    // Number of self-refresh commands
-    ScalarStat numberofsrefs_s;
-    // Number of clock cycles in fast-exit activate power-down mode
-    ScalarStat f_act_pdcycles_s;
-    // Number of clock cycles in slow-exit activate power-down mode
-    ScalarStat s_act_pdcycles_s;
-    // Number of clock cycles in fast-exit precharged power-down mode
-    ScalarStat f_pre_pdcycles_s;
-    // Number of clock cycles in slow-exit precharged power-down mode
-    ScalarStat s_pre_pdcycles_s;
-    // Number of clock cycles in self-refresh mode
-    ScalarStat sref_cycles_s;
-    // Number of clock cycles in activate power-up mode
-    ScalarStat pup_act_cycles_s;
-    // Number of clock cycles in precharged power-up mode
-    ScalarStat pup_pre_cycles_s;
-    // Number of clock cycles in self-refresh power-up mode
-    ScalarStat spup_cycles_s;
-
-    // Number of active auto-refresh cycles in self-refresh mode
-    ScalarStat sref_ref_act_cycles_s;
-    // Number of precharged auto-refresh cycles in self-refresh mode
-    ScalarStat sref_ref_pre_cycles_s;
-    // Number of active auto-refresh cycles during self-refresh exit
-    ScalarStat spup_ref_act_cycles_s;
-    // Number of precharged auto-refresh cycles during self-refresh exit
-    ScalarStat spup_ref_pre_cycles_s;
-
-    //libDRAMPower* drampower;
-    long update_counter = 0;
+    // DRAM energy estimation (only allocated when drampower = on)
+    EnergyModel<HMC>* energy = nullptr;
+    // Vault power-down and self-refresh (only allocated when a timeout is set)
+    LowPower<HMC>* lowpower = nullptr;
+    // Distributions of this vault's latencies, for the tails that the totals hide
+    LatencyHistogramStat transfer_latency;
+    LatencyHistogramStat queueing_latency;
 
 public:
     /* Member Variables */
@@ -270,13 +173,7 @@ public:
                 cmd_trace_prefix + "chan-" + to_string(channel->id)
                 + ".cmdtrace");
         }
-        //if (configs["drampower_memspecs"] != "") {
-          with_drampower = false;
-          //drampower = new libDRAMPower(
-            //  Data::MemSpecParser::getMemSpecFromXML(
-              //    configs["drampower_memspecs"]),
-             // true);
-      //  }
+        with_drampower = configs.with_drampower();
         if (configs["no_DRAM_latency"] == "true") {
           no_DRAM_latency = true;
           scheduler->type = Scheduler<HMC>::Type::FRFCFS;
@@ -298,320 +195,18 @@ public:
         }
 
         pim_mode_enabled = configs.pim_mode_enabled();
-        if (with_drampower) {
-          // init DRAMPower stats
-          act_energy
-              .name("act_energy_" + to_string(channel->id))
-              .desc("act_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          pre_energy
-              .name("pre_energy_" + to_string(channel->id))
-              .desc("pre_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          read_energy
-              .name("read_energy_" + to_string(channel->id))
-              .desc("read_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          write_energy
-              .name("write_energy_" + to_string(channel->id))
-              .desc("write_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-
-          act_stdby_energy
-              .name("act_stdby_energy_" + to_string(channel->id))
-              .desc("act_stdby_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-
-          pre_stdby_energy
-              .name("pre_stdby_energy_" + to_string(channel->id))
-              .desc("pre_stdby_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-
-          idle_energy_act
-              .name("idle_energy_act_" + to_string(channel->id))
-              .desc("idle_energy_act_" + to_string(channel->id))
-              .precision(6)
-              ;
-
-          idle_energy_pre
-              .name("idle_energy_pre_" + to_string(channel->id))
-              .desc("idle_energy_pre_" + to_string(channel->id))
-              .precision(6)
-              ;
-
-          f_act_pd_energy
-              .name("f_act_pd_energy_" + to_string(channel->id))
-              .desc("f_act_pd_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          f_pre_pd_energy
-              .name("f_pre_pd_energy_" + to_string(channel->id))
-              .desc("f_pre_pd_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          s_act_pd_energy
-              .name("s_act_pd_energy_" + to_string(channel->id))
-              .desc("s_act_pd_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          s_pre_pd_energy
-              .name("s_pre_pd_energy_" + to_string(channel->id))
-              .desc("s_pre_pd_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          sref_energy
-              .name("sref_energy_" + to_string(channel->id))
-              .desc("sref_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          sref_ref_energy
-              .name("sref_ref_energy_" + to_string(channel->id))
-              .desc("sref_ref_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          sref_ref_act_energy
-              .name("sref_ref_act_energy_" + to_string(channel->id))
-              .desc("sref_ref_act_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          sref_ref_pre_energy
-              .name("sref_ref_pre_energy_" + to_string(channel->id))
-              .desc("sref_ref_pre_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-
-          spup_energy
-              .name("spup_energy_" + to_string(channel->id))
-              .desc("spup_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          spup_ref_energy
-              .name("spup_ref_energy_" + to_string(channel->id))
-              .desc("spup_ref_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          spup_ref_act_energy
-              .name("spup_ref_act_energy_" + to_string(channel->id))
-              .desc("spup_ref_act_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          spup_ref_pre_energy
-              .name("spup_ref_pre_energy_" + to_string(channel->id))
-              .desc("spup_ref_pre_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          pup_act_energy
-              .name("pup_act_energy_" + to_string(channel->id))
-              .desc("pup_act_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          pup_pre_energy
-              .name("pup_pre_energy_" + to_string(channel->id))
-              .desc("pup_pre_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-
-          IO_power
-              .name("IO_power_" + to_string(channel->id))
-              .desc("IO_power_" + to_string(channel->id))
-              .precision(6)
-              ;
-          WR_ODT_power
-              .name("WR_ODT_power_" + to_string(channel->id))
-              .desc("WR_ODT_power_" + to_string(channel->id))
-              .precision(6)
-              ;
-          TermRD_power
-              .name("TermRD_power_" + to_string(channel->id))
-              .desc("TermRD_power_" + to_string(channel->id))
-              .precision(6)
-              ;
-          TermWR_power
-              .name("TermWR_power_" + to_string(channel->id))
-              .desc("TermWR_power_" + to_string(channel->id))
-              .precision(6)
-              ;
-
-          read_io_energy
-              .name("read_io_energy_" + to_string(channel->id))
-              .desc("read_io_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          write_term_energy
-              .name("write_term_energy_" + to_string(channel->id))
-              .desc("write_term_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          read_oterm_energy
-              .name("read_oterm_energy_" + to_string(channel->id))
-              .desc("read_oterm_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          write_oterm_energy
-              .name("write_oterm_energy_" + to_string(channel->id))
-              .desc("write_oterm_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          io_term_energy
-              .name("io_term_energy_" + to_string(channel->id))
-              .desc("io_term_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-
-          ref_energy
-              .name("ref_energy_" + to_string(channel->id))
-              .desc("ref_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-
-          total_energy
-              .name("total_energy_" + to_string(channel->id))
-              .desc("total_energy_" + to_string(channel->id))
-              .precision(6)
-              ;
-          average_power
-              .name("average_power_" + to_string(channel->id))
-              .desc("average_power_" + to_string(channel->id))
-              .precision(6)
-              ;
-
-          numberofacts_s
-              .name("numberofacts_s_" + to_string(channel->id))
-              .desc("Number of activate commands_" + to_string(channel->id))
-              .precision(0)
-              ;
-          numberofpres_s
-              .name("numberofpres_s_" + to_string(channel->id))
-              .desc("Number of precharge commands_" + to_string(channel->id))
-              .precision(0)
-              ;
-          numberofreads_s
-              .name("numberofreads_s_" + to_string(channel->id))
-              .desc("Number of reads commands_" + to_string(channel->id))
-              .precision(0)
-              ;
-          numberofwrites_s
-              .name("numberofwrites_s_" + to_string(channel->id))
-              .desc("Number of writes commands_" + to_string(channel->id))
-              .precision(0)
-              ;
-          numberofrefs_s
-              .name("numberofrefs_s_" + to_string(channel->id))
-              .desc("Number of refresh commands_" + to_string(channel->id))
-              .precision(0)
-              ;
-          precycles_s
-              .name("precycles_s_" + to_string(channel->id))
-              .desc("Number of precharge cycles_" + to_string(channel->id))
-              .precision(0)
-              ;
-          actcycles_s
-              .name("actcycles_s_" + to_string(channel->id))
-              .desc("Number of active cycles_" + to_string(channel->id))
-              .precision(0)
-              ;
-          idlecycles_act_s
-              .name("idlecycles_act_s_" + to_string(channel->id))
-              .desc("Number of Idle cycles in the active state_" + to_string(channel->id))
-              .precision(0)
-              ;
-          idlecycles_pre_s
-              .name("idlecycles_pre_s_" + to_string(channel->id))
-              .desc("Number of Idle cycles in the precharge state_" + to_string(channel->id))
-              .precision(0)
-              ;
-          f_act_pdns_s
-              .name("f_act_pdns_s_" + to_string(channel->id))
-              .desc("Number of fast-exit activate power-downs_" + to_string(channel->id))
-              .precision(0)
-              ;
-          s_act_pdns_s
-              .name("s_act_pdns_s_" + to_string(channel->id))
-              .desc("Number of slow-exit activate power-downs_" + to_string(channel->id))
-              .precision(0)
-              ;
-          f_pre_pdns_s
-              .name("f_pre_pdns_s_" + to_string(channel->id))
-              .desc("Number of fast-exit precharged power-downs_" + to_string(channel->id))
-              .precision(0)
-              ;
-          s_pre_pdns_s
-              .name("s_pre_pdns_s_" + to_string(channel->id))
-              .desc("Number of slow-exit activate power-downs_" + to_string(channel->id))
-              .precision(0)
-              ;
-          numberofsrefs_s
-              .name("numberofsrefs_s_" + to_string(channel->id))
-              .desc("Number of self-refresh commands_" + to_string(channel->id))
-              .precision(0)
-              ;
-          f_act_pdcycles_s
-              .name("f_act_pdcycles_s_" + to_string(channel->id))
-              .desc("Number of clock cycles in fast-exit activate power-down mode_" + to_string(channel->id))
-              .precision(0)
-              ;
-          s_act_pdcycles_s
-              .name("s_act_pdcycles_s_" + to_string(channel->id))
-              .desc("Number of clock cycles in slow-exit activate power-down mode_" + to_string(channel->id))
-              .precision(0)
-              ;
-          f_pre_pdcycles_s
-              .name("f_pre_pdcycles_s_" + to_string(channel->id))
-              .desc("Number of clock cycles in fast-exit precharged power-down mode_" + to_string(channel->id))
-              .precision(0)
-              ;
-          s_pre_pdcycles_s
-              .name("s_pre_pdcycles_s_" + to_string(channel->id))
-              .desc("Number of clock cycles in slow-exit precharged power-down mode_" + to_string(channel->id))
-              .precision(0)
-              ;
-          sref_cycles_s
-              .name("sref_cycles_s_" + to_string(channel->id))
-              .desc("Number of clock cycles in self-refresh mode_" + to_string(channel->id))
-              .precision(0)
-              ;
-          pup_act_cycles_s
-              .name("pup_act_cycles_s_" + to_string(channel->id))
-              .desc("Number of clock cycles in activate power-up mode_" + to_string(channel->id))
-              .precision(0)
-              ;
-          pup_pre_cycles_s
-              .name("pup_pre_cycles_s_" + to_string(channel->id))
-              .desc("Number of clock cycles in precharged power-up mode_" + to_string(channel->id))
-              .precision(0)
-              ;
-          spup_cycles_s
-              .name("spup_cycles_s_" + to_string(channel->id))
-              .desc("Number of clock cycles in self-refresh power-up mode_" + to_string(channel->id))
-              .precision(0)
-              ;
-          sref_ref_act_cycles_s
-              .name("sref_ref_act_cycles_s_" + to_string(channel->id))
-              .desc("Number of active auto-refresh cycles in self-refresh mode_" + to_string(channel->id))
-              .precision(0)
-              ;
-          sref_ref_pre_cycles_s
-              .name("sref_ref_pre_cycles_s_" + to_string(channel->id))
-              .desc("Number of precharged auto-refresh cycles in self-refresh mode_" + to_string(channel->id))
-              .precision(0)
-              ;
-          spup_ref_act_cycles_s
-              .name("spup_ref_act_cycles_s_" + to_string(channel->id))
-              .desc("Number of active auto-refresh cycles during self-refresh exit_" + to_string(channel->id))
-              .precision(0)
-              ;
-          spup_ref_pre_cycles_s
-              .name("spup_ref_pre_cycles_s_" + to_string(channel->id))
-              .desc("Number of precharged auto-refresh cycles during self-refresh exit_" + to_string(channel->id))
-              .precision(0)
-              ;
-        }
+        // a vault has no ranks: track it as a single one whose banks span all bank groups
+        if (with_drampower)
+            energy = new EnergyModel<HMC>(configs, channel->spec, channel->id,
+                                          1, int(HMC::Level::BankGroup));
+        if (LowPower<HMC>::enabled(configs))
+            lowpower = new LowPower<HMC>(configs, this);
+
+        string suffix = "_" + to_string(channel->id);
+        transfer_latency.name("vault_transfer_latency" + suffix)
+            .desc("Cycles from arrival to reaching the vault queue").precision(0);
+        queueing_latency.name("vault_queueing_latency" + suffix)
+            .desc("Cycles waiting in the vault queue").precision(0);
     }
 
     ~Controller(){
@@ -620,6 +215,8 @@ public:
         delete rowtable;
         delete channel;
         delete refresh;
+        delete energy;
+        delete lowpower;
         cmd_trace_file.close();
     }
 
@@ -633,6 +230,10 @@ public:
         req.burst_count = 2; //TSV = 32 bytes, request = 64 bytes -> 2 bursts
 
       req.transaction_bytes = channel->spec->payload_flits * 16;
+      if (req.data_bytes > 0 && req.data_bytes < req.transaction_bytes) {
+        req.burst_count = req.compressed_bursts(req.burst_count, req.transaction_bytes);
+        req.transaction_bytes = req.data_bytes;
+      }
       //printf("req.burst_count %d", req.burst_count);
       debug_hmc("req.reqid %d, req.coreid %d", req.reqid, req.coreid);
       // buffer packet, for future response packet
@@ -645,6 +246,10 @@ public:
       req.burst_count = 2; //TSV = 32 bytes, request = 64 bytes -> 2 bursts
 
       req.transaction_bytes = channel->spec->payload_flits * 16;
+      if (req.data_bytes > 0 && req.data_bytes < req.transaction_bytes) {
+        req.burst_count = req.compressed_bursts(req.burst_count, req.transaction_bytes);
+        req.transaction_bytes = req.data_bytes;
+      }
       //printf("req.burst_count %d", req.burst_count);
       debug_hmc("req.reqid %d, req.coreid %d", req.reqid, req.coreid);
       // buffer packet, for future response packet
@@ -653,7 +258,8 @@ public:
     }
 
     void finish(long dram_cycles) {
-      // finalize DRAMPower
+      if (energy)
+        energy->finish(clk);
 
       // finalize DRAM status
       channel->finish(dram_cycles);
@@ -729,6 +335,13 @@ public:
     {
         // FIXME back to back command (add back-to-back buffer)
         clk++;
+
+        /*** 0. The vault sleeps and nothing is outstanding: only keep refresh going ***/
+        if (lowpower && lowpower->all_asleep() && !readq.size() && !writeq.size()
+                && !otherq.size() && pending.empty()) {
+            refresh->tick_ref();
+            return;
+        }
         (*req_queue_length_sum) += readq.size() + writeq.size() + pending.size();
         (*read_req_queue_length_sum) += readq.size() + pending.size();
         (*write_req_queue_length_sum) += writeq.size();
@@ -766,6 +379,8 @@ public:
                 total_process_latency += (req.depart - req.finish_queuing);
                 total_incoming_queuing_latency += (req.finish_queuing - req.finish_transfer);
                 total_outgoing_queuing_latency += (req.depart_hmc - req.depart);
+                transfer_latency.sample(req.finish_transfer - req.arrive);
+                queueing_latency.sample(req.finish_queuing - req.finish_transfer);
                 assert(total_hmc_latency >= 0);
                 assert(total_latency >= 0);
                 assert(total_transfer_latency >= 0);
@@ -793,6 +408,16 @@ public:
         /*** 2. Refresh scheduler ***/
         refresh->tick_ref();
 
+        /*** 2.1. Power-down, self-refresh and wake-up of the vault ***/
+        if (lowpower) {
+            HMC::Command cmd;
+            vector<int> addr_vec;
+            if (lowpower->tick(cmd, addr_vec)) {
+                issue_cmd(cmd, addr_vec);
+                return;
+            }
+        }
+
         /*** 3. Should we schedule writes? ***/
         if (!write_mode) {
             // yes -- write queue is almost full or read queue is empty
@@ -987,6 +612,23 @@ public:
         update_parent_with_latency = partent_function;
     }
 
+    // Functional warming: leaves the row of addr_vec open as a read would,
+    // with state-only updates (no timing, energy or statistics)
+    void warm(const vector<int>& addr_vec)
+    {
+        if (no_DRAM_latency)
+            return;
+        typename HMC::Command access = channel->spec->translate[int(Request::Type::READ)];
+        // at most a precharge and an activate; sleeping ranks are left alone
+        for (int i = 0; i < 2; i++) {
+            typename HMC::Command cmd = channel->decode(access, addr_vec.data());
+            if (!channel->spec->is_opening(cmd) && !channel->spec->is_closing(cmd))
+                return;
+            channel->update_state(cmd, addr_vec.data());
+            rowtable->update(cmd, addr_vec, clk);
+        }
+    }
+
 private:
     typename HMC::Command get_first_cmd(list<Request>::iterator req)
     {
@@ -1000,21 +642,9 @@ private:
 
     void issue_cmd(typename HMC::Command cmd, const vector<int>& addr_vec)
     {
-        // update power estimation
-        if (with_drampower) {
-
-          const string& cmd_name = channel->spec->command_name[int(cmd)];
-          int bank_id = addr_vec[int(HMC::Level::Bank)];
-          bank_id += addr_vec[int(HMC::Level::Bank) - 1] * channel->spec->org_entry.count[int(HMC::Level::Bank)];
-          printf("%ld %d\n", clk, bank_id);
-          //drampower->doCommand(Data::MemCommand::getTypeFromName(cmd_name), bank_id, clk);
-
-          update_counter++;
-          if (update_counter == 1000000) {
-            //  drampower->updateCounters(false); // not the last update
-              update_counter = 0;
-          }
-        }
+        // update energy estimation
+        if (energy)
+            energy->issue(cmd, 0, clk);
 
         if (print_cmd_trace){
             printf("%5s %10ld:", channel->spec->command_name[int(cmd)].c_str(), clk);
@@ -3408,6 +3408,39 @@ public:
         return true;
     }
 
+    void warm(long addr)
+    {
+        // warms the home vault; subscriptions only move data on demand requests
+        clear_higher_bits(addr, max_address-1ll);
+        clear_lower_bits(addr, tx_bits);
+        vector<int> addr_vec = address_to_address_vector(addr);
+        ctrls[addr_vec[int(HMC::Level::Vault)]]->warm(addr_vec);
+    }
+
+    void warm_row(const vector<int>& addr_vec)
+    {
+        ctrls[addr_vec[0]]->warm(addr_vec);
+    }
+
+    string geometry()
+    {
+        string g = spec->standard_name;
+        for (int l = 0; l < int(HMC::Level::MAX); l++)
+            g += " " + to_string(spec->org_entry.count[l]);
+        return g;
+    }
+
+    void open_rows(vector<vector<int>>& rows)
+    {
+        for (auto ctrl : ctrls)
+            for (auto& kv : ctrl->rowtable->table) {
+                vector<int> addr_vec(kv.first);
+                addr_vec.push_back(kv.second.row);
+                addr_vec.resize(int(HMC::Level::MAX), 0);
+                rows.push_back(addr_vec);
+            }
+    }
+
     int pending_requests()
     {
         int reqs = 0;
@@ -0,0 +1,185 @@
+/*
+ * LowPower.h
+ *
+ * Idle-driven power-down and self-refresh of ranks (vaults for HMC). A rank
+ * without reads or writes for powerdown_timeout cycles enters power-down;
+ * after selfrefresh_timeout cycles it closes its rows and enters self-refresh,
+ * where it refreshes itself and the refresh scheduler leaves it alone. Any
+ * queued request wakes the rank up, paying the exit latency (nXP / nXS). Both
+ * timeouts are in memory cycles and 0 (the default) disables the state:
+ *
+ *   powerdown_timeout = 64
+ *   selfrefresh_timeout = 8192
+ *
+ * While every rank of a channel sleeps and nothing is queued or in flight,
+ * the controller only advances its clock and the refresh scheduler.
+ */
+
+#ifndef __LOWPOWER_H
+#define __LOWPOWER_H
+
+#include <algorithm>
+#include <list>
+#include <string>
+#include <vector>
+#include "Config.h"
+#include "DRAM.h"
+#include "Request.h"
+#include "Statistics.h"
+#include "HMC.h"
+
+using namespace std;
+
+namespace ramulator
+{
+
+template <typename T>
+class Controller;
+
+// Level whose nodes have their own clock enable
+template <typename T>
+inline int power_level() { return int(T::Level::Rank); }
+template <>
+inline int power_level<HMC>() { return int(HMC::Level::Vault); }
+
+template <typename T>
+class LowPower
+{
+public:
+    Controller<T>* ctrl;
+    long powerdown_timeout = 0;
+    long selfrefresh_timeout = 0;
+
+    ScalarStat powerdown_cycles;
+    ScalarStat selfrefresh_cycles;
+    ScalarStat lowpower_exits;
+
+    static bool enabled(const Config& configs) {
+        return configs.contains("powerdown_timeout") || configs.contains("selfrefresh_timeout");
+    }
+
+    LowPower(const Config& configs, Controller<T>* ctrl) :
+        ctrl(ctrl), level(power_level<T>())
+    {
+        if (configs.contains("powerdown_timeout"))
+            powerdown_timeout = configs.get_int_value("powerdown_timeout");
+        if (configs.contains("selfrefresh_timeout"))
+            selfrefresh_timeout = configs.get_int_value("selfrefresh_timeout");
+
+        if (level == 0)
+            nodes.push_back(ctrl->channel);
+        else
+            nodes = ctrl->channel->children;
+        idle_since.assign(nodes.size(), 0);
+        busy.assign(nodes.size(), false);
+
+        string suffix = "_" + to_string(ctrl->channel->id);
+        powerdown_cycles.name("powerdown_cycles" + suffix)
+            .desc("Rank-cycles spent in power-down").precision(0);
+        selfrefresh_cycles.name("selfrefresh_cycles" + suffix)
+            .desc("Rank-cycles spent in self-refresh").precision(0);
+        lowpower_exits.name("lowpower_exits" + suffix)
+            .desc("Number of ranks woken up by a request").precision(0);
+    }
+
+    // Accounts this cycle to the sleeping ranks; true if none of them is
+    // awake or about to move on from power-down to self-refresh
+    bool all_asleep()
+    {
+        int pd = 0, sr = 0;
+        bool settled = true;
+        for (unsigned int r = 0; r < nodes.size(); r++) {
+            if (nodes[r]->state == T::State::ActPowerDown || nodes[r]->state == T::State::PrePowerDown) {
+                pd++;
+                if (selfrefresh_timeout && ctrl->clk - idle_since[r] >= selfrefresh_timeout)
+                    settled = false;
+            } else if (nodes[r]->state == T::State::SelfRefresh)
+                sr++;
+        }
+        powerdown_cycles += pd;
+        selfrefresh_cycles += sr;
+        return settled && pd + sr == int(nodes.size());
+    }
+
+    // Picks the power-state command to issue this cycle, if any
+    bool tick(typename T::Command& cmd, vector<int>& addr_vec)
+    {
+        // refreshes wake a rank up but do not keep it from self-refresh
+        fill(busy.begin(), busy.end(), false);
+        mark_busy(ctrl->readq.q, true);
+        mark_busy(ctrl->writeq.q, true);
+        mark_busy(ctrl->otherq.q, false);
+
+        for (unsigned int r = 0; r < nodes.size(); r++) {
+            if (next_cmd(r, cmd, addr_vec))
+                return true;
+        }
+        return false;
+    }
+
+private:
+    int level;
+    vector<DRAM<T>*> nodes;
+    vector<long> idle_since;  // per rank, last cycle with a queued read or write
+    vector<bool> busy;  // per rank, any request queued
+
+    void mark_busy(const list<Request>& q, bool access)
+    {
+        for (auto& req : q) {
+            int r = level == 0 ? 0 : req.addr_vec[level];
+            busy[r] = true;
+            if (access)
+                idle_since[r] = ctrl->clk;
+        }
+    }
+
+    bool next_cmd(int r, typename T::Command& cmd, vector<int>& addr_vec)
+    {
+        DRAM<T>* node = nodes[r];
+        bool pd = node->state == T::State::ActPowerDown || node->state == T::State::PrePowerDown;
+        bool sr = node->state == T::State::SelfRefresh;
+        long idle = ctrl->clk - idle_since[r];
+
+        addr_vec.assign(int(T::Level::MAX), -1);
+        addr_vec[0] = ctrl->channel->id;
+        if (level > 0)
+            addr_vec[level] = r;
+
+        if (busy[r]) {
+            if (!pd && !sr)
+                return false;
+            // the rank-level prerequisite of a read is the matching exit command
+            fill(addr_vec.begin() + level + 1, addr_vec.end(), 0);
+            cmd = ctrl->channel->decode(ctrl->channel->spec->translate[int(Request::Type::READ)], addr_vec.data());
+            if (!ctrl->is_ready(cmd, addr_vec))
+                return false;
+            ++lowpower_exits;
+            return true;
+        }
+
+        if (selfrefresh_timeout && idle >= selfrefresh_timeout) {
+            if (sr)
+                return false;
+            // self-refresh needs all banks of the rank precharged
+            if (!pd)
+                for (auto& kv : ctrl->rowtable->table)
+                    if (level == 0 || kv.first[level] == r) {
+                        cmd = T::Command::PRE;
+                        addr_vec = kv.first;
+                        return ctrl->is_ready(cmd, addr_vec);
+                    }
+            cmd = ctrl->channel->decode(ctrl->channel->spec->translate[int(Request::Type::SELFREFRESH)], addr_vec.data());
+            return ctrl->is_ready(cmd, addr_vec);
+        }
+
+        if (powerdown_timeout && idle >= powerdown_timeout && !pd && !sr) {
+            cmd = ctrl->channel->decode(ctrl->channel->spec->translate[int(Request::Type::POWERDOWN)], addr_vec.data());
+            return ctrl->is_ready(cmd, addr_vec);
+        }
+        return false;
+    }
+};
+
+} /*namespace ramulator*/
+
+#endif /*__LOWPOWER_H*/
@@ -34,6 +34,13 @@ public:
     virtual double clk_ns() = 0;
     virtual void tick() = 0;
     virtual bool send(Request req) = 0;
+    // Functional warming: opens the row addr maps to, with no timing or stats
+    virtual void warm(long addr) = 0;
+    // Checkpointing: the organization, the open rows as address vectors
+    // (column 0), and reopening one of them
+    virtual string geometry() = 0;
+    virtual void open_rows(vector<vector<int>>& rows) = 0;
+    virtual void warm_row(const vector<int>& addr_vec) = 0;
     virtual int pending_requests() = 0;
     virtual void finish()=0;
     virtual long page_allocator(long addr, int coreid) = 0;
@@ -424,28 +431,10 @@ public:
 
     bool send(Request req)
     {
-        req.addr_vec.resize(addr_bits.size());
         req.burst_count = cacheline_size / (1 << tx_bits);
-        long addr = req.addr;
+        req.burst_count = req.compressed_bursts(req.burst_count, cacheline_size);
         int coreid = req.coreid;
-
-        // Each transaction size is 2^tx_bits, so first clear the lowest tx_bits bits
-        clear_lower_bits(addr, tx_bits);
-
-        switch(int(type)){
-            case int(Type::ChRaBaRoCo):
-                for (int i = addr_bits.size() - 1; i >= 0; i--)
-                    req.addr_vec[i] = slice_lower_bits(addr, addr_bits[i]);
-                break;
-            case int(Type::RoBaRaCoCh):
-                req.addr_vec[0] = slice_lower_bits(addr, addr_bits[0]);
-                req.addr_vec[addr_bits.size() - 1] = slice_lower_bits(addr, addr_bits[addr_bits.size() - 1]);
-                for (int i = 1; i <= int(T::Level::Row); i++)
-                    req.addr_vec[i] = slice_lower_bits(addr, addr_bits[i]);
-                break;
-            default:
-                assert(false);
-        }
+        map_address(req.addr, req.addr_vec);
 	if(ctrls[req.addr_vec[0]]->enqueue(req)) {
             // tally stats here to avoid double counting for requests that aren't enqueued
             ++num_incoming_requests;
@@ -464,6 +453,37 @@ public:
         return false;
     }
 
+    void warm(long addr)
+    {
+        vector<int> addr_vec;
+        map_address(addr, addr_vec);
+        ctrls[addr_vec[0]]->warm(addr_vec);
+    }
+
+    void warm_row(const vector<int>& addr_vec)
+    {
+        ctrls[addr_vec[0]]->warm(addr_vec);
+    }
+
+    string geometry()
+    {
+        string g = spec->standard_name;
+        for (int l = 0; l < int(T::Level::MAX); l++)
+            g += " " + to_string(spec->org_entry.count[l]);
+        return g;
+    }
+
+    void open_rows(vector<vector<int>>& rows)
+    {
+        for (auto ctrl : ctrls)
+            for (auto& kv : ctrl->rowtable->table) {
+                vector<int> addr_vec(kv.first);
+                addr_vec.push_back(kv.second.row);
+                addr_vec.resize(int(T::Level::MAX), 0);
+                rows.push_back(addr_vec);
+            }
+    }
+
     int pending_requests()
     {
         int reqs = 0;
@@ -560,6 +580,28 @@ private:
             n ++;
         return n;
     }
+    void map_address(long addr, vector<int>& addr_vec)
+    {
+        addr_vec.resize(addr_bits.size());
+
+        // Each transaction size is 2^tx_bits, so first clear the lowest tx_bits bits
+        clear_lower_bits(addr, tx_bits);
+
+        switch(int(type)){
+            case int(Type::ChRaBaRoCo):
+                for (int i = addr_bits.size() - 1; i >= 0; i--)
+                    addr_vec[i] = slice_lower_bits(addr, addr_bits[i]);
+                break;
+            case int(Type::RoBaRaCoCh):
+                addr_vec[0] = slice_lower_bits(addr, addr_bits[0]);
+                addr_vec[addr_bits.size() - 1] = slice_lower_bits(addr, addr_bits[addr_bits.size() - 1]);
+                for (int i = 1; i <= int(T::Level::Row); i++)
+                    addr_vec[i] = slice_lower_bits(addr, addr_bits[i]);
+                break;
+            default:
+                assert(false);
+        }
+    }
     int slice_lower_bits(long& addr, int bits)
     {
         int lbits = addr & ((1<<bits) - 1);
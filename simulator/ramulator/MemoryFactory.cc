@@ -4,6 +4,8 @@
 #include "WideIO2.h"
 #include "HBM.h"
 #include "SALP.h"
+#include "TLDRAM.h"
+#include "DSARP.h"
 
 using namespace ramulator;
 
@@ -66,6 +68,63 @@ MemoryBase *MemoryFactory<SALP>::create(const Config& configs, int cacheline) {
     return (MemoryBase *)populate_memory(configs, spec, channels, ranks);
 }
 
+template <>
+MemoryBase *MemoryFactory<TLDRAM>::create(const Config& configs, int cacheline) {
+    int channels = stoi(configs["channels"], NULL, 0);
+    int ranks = stoi(configs["ranks"], NULL, 0);
+    validate(channels, ranks, configs);
+
+    const string& org_name = configs["org"];
+    const string& speed_name = configs["speed"];
+
+    // "subarrays" is the number of rows per near-segment row (segment ratio)
+    TLDRAM *spec = new TLDRAM(org_name, speed_name, configs.get_subarrays());
+
+    extend_channel_width(spec, cacheline);
+
+    return (MemoryBase *)populate_memory(configs, spec, channels, ranks);
+}
+
+template <>
+MemoryBase *MemoryFactory<DSARP>::create(const Config& configs, int cacheline) {
+    int channels = stoi(configs["channels"], NULL, 0);
+    int ranks = stoi(configs["ranks"], NULL, 0);
+    validate(channels, ranks, configs);
+
+    const string& org_name = configs["org"];
+    const string& speed_name = configs["speed"];
+
+    DSARP *spec = new DSARP(org_name, speed_name, DSARP::Type::DSARP, configs.get_subarrays());
+
+    extend_channel_width(spec, cacheline);
+
+    return (MemoryBase *)populate_memory(configs, spec, channels, ranks);
+}
+
+template <>
+MemoryBase *MemoryFactory<DDR4>::create(const Config& configs, int cacheline) {
+    int channels = stoi(configs["channels"], NULL, 0);
+    int ranks = stoi(configs["ranks"], NULL, 0);
+    validate(channels, ranks, configs);
+
+    const string& org_name = configs["org"];
+    const string& speed_name = configs["speed"];
+
+    DDR4 *spec = new DDR4(org_name, speed_name);
+
+    const string& mode = configs["refresh_mode"];
+    if (mode == "2x")
+        spec->set_refresh_mode(DDR4::RefreshMode::Refresh_2X);
+    else if (mode == "4x")
+        spec->set_refresh_mode(DDR4::RefreshMode::Refresh_4X);
+    else
+        assert((mode == "" || mode == "1x") && "DDR4 refresh_mode is 1x, 2x or 4x");
+
+    extend_channel_width(spec, cacheline);
+
+    return (MemoryBase *)populate_memory(configs, spec, channels, ranks);
+}
+
 template <>
 MemoryBase *MemoryFactory<HMC>::create(const Config& configs, int cacheline) {
     HMC* hmc = new HMC(configs["org"], configs["speed"], configs["maxblock"],
@@ -105,6 +164,11 @@ MemoryBase *MemoryFactory<HBM>::create(const Config& configs, int cacheline) {
     const string& speed_name = configs["speed"];
 
     HBM *spec = new HBM(org_name, speed_name);
+    if (configs["refresh_mode"] == "per_bank")
+        spec->set_refresh_mode(HBM::RefreshMode::Refresh_SB);
+    else
+        assert((configs["refresh_mode"] == "" || configs["refresh_mode"] == "all_bank")
+            && "HBM refresh_mode is all_bank or per_bank");
 
     extend_channel_width(spec, cacheline);
 
@@ -11,6 +11,8 @@
 #include "HMC_Memory.h"
 #include "WideIO2.h"
 #include "SALP.h"
+#include "TLDRAM.h"
+#include "DSARP.h"
 #include "HMC.h"
 #include "HBM.h"
 #include <iostream>
@@ -86,6 +88,12 @@ template <>
 MemoryBase *MemoryFactory<SALP>::create(const Config& configs, int cacheline);
 template <>
 MemoryBase *MemoryFactory<HBM>::create(const Config& configs, int cacheline);
+template <>
+MemoryBase *MemoryFactory<DDR4>::create(const Config& configs, int cacheline);
+template <>
+MemoryBase *MemoryFactory<TLDRAM>::create(const Config& configs, int cacheline);
+template <>
+MemoryBase *MemoryFactory<DSARP>::create(const Config& configs, int cacheline);
 
 
 } /*namespace ramulator*/
@@ -0,0 +1,212 @@
+/*
+ * PCM.h
+ *
+ * Phase-change memory with a DDR3-like command interface, following the
+ * row-buffer organization of Lee et al., "Architecting Phase Change Memory
+ * as a Scalable DRAM Alternative", ISCA 2009.
+ *
+ * Reads are non-destructive, so an activation only senses the row (nRAS ==
+ * nRCD, no restore) and a precharge is cheap. Writes are asymmetric: the SET
+ * pulse of the cells is modeled by a long write recovery (nWR), which keeps
+ * the bank from precharging until the array has been programmed. The cells
+ * are non-volatile, so no refresh is ever scheduled (see Refresh.cc).
+ */
+
+#ifndef __PCM_H
+#define __PCM_H
+
+#include "DRAM.h"
+#include "Request.h"
+#include <vector>
+#include <map>
+#include <string>
+#include <functional>
+
+using namespace std;
+
+namespace ramulator
+{
+
+class PCM
+{
+public:
+    static string standard_name;
+    enum class Org;
+    enum class Speed;
+    PCM(Org org, Speed speed);
+    PCM(const string& org_str, const string& speed_str);
+
+    static map<string, enum Org> org_map;
+    static map<string, enum Speed> speed_map;
+    /*** Level ***/
+    enum class Level : int
+    {
+        Channel, Rank, Bank, Row, Column, MAX
+    };
+
+    /*** Command ***/
+    // REF is kept so that refresh requests still translate, but it is never issued
+    enum class Command : int
+    {
+        ACT, PRE, PREA,
+        RD,  WR,  RDA,  WRA,
+        REF, PDE, PDX,  SRE, SRX,
+        MAX
+    };
+
+    string command_name[int(Command::MAX)] = {
+        "ACT", "PRE", "PREA",
+        "RD",  "WR",  "RDA",  "WRA",
+        "REF", "PDE", "PDX",  "SRE", "SRX"
+    };
+
+    Level scope[int(Command::MAX)] = {
+        Level::Row,    Level::Bank,   Level::Rank,
+        Level::Column, Level::Column, Level::Column, Level::Column,
+        Level::Rank,   Level::Rank,   Level::Rank,   Level::Rank,   Level::Rank
+    };
+
+    bool is_opening(Command cmd)
+    {
+        switch(int(cmd)) {
+            case int(Command::ACT):
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool is_accessing(Command cmd)
+    {
+        switch(int(cmd)) {
+            case int(Command::RD):
+            case int(Command::WR):
+            case int(Command::RDA):
+            case int(Command::WRA):
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool is_closing(Command cmd)
+    {
+        switch(int(cmd)) {
+            case int(Command::RDA):
+            case int(Command::WRA):
+            case int(Command::PRE):
+            case int(Command::PREA):
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool is_refreshing(Command cmd)
+    {
+        switch(int(cmd)) {
+            case int(Command::REF):
+                return true;
+            default:
+                return false;
+        }
+    }
+
+
+    /* State */
+    enum class State : int
+    {
+        Opened, Closed, PowerUp, ActPowerDown, PrePowerDown, SelfRefresh, MAX
+    } start[int(Level::MAX)] = {
+        State::MAX, State::PowerUp, State::Closed, State::Closed, State::MAX
+    };
+
+    /* Translate */
+    Command translate[int(Request::Type::MAX)] = {
+        Command::RD,  Command::WR,
+        Command::REF, Command::PDE, Command::SRE
+    };
+
+    /* Prerequisite */
+    function<Command(DRAM<PCM>*, Command cmd, int)> prereq[int(Level::MAX)][int(Command::MAX)];
+
+    /* Row hit */
+    function<bool(DRAM<PCM>*, Command cmd, int)> rowhit[int(Level::MAX)][int(Command::MAX)];
+    function<bool(DRAM<PCM>*, Command cmd, int)> rowopen[int(Level::MAX)][int(Command::MAX)];
+
+    /* Timing */
+    struct TimingEntry
+    {
+        Command cmd;
+        int dist;
+        int val;
+        bool sibling;
+    };
+    vector<TimingEntry> timing[int(Level::MAX)][int(Command::MAX)];
+
+    /* Lambda */
+    function<void(DRAM<PCM>*, int)> lambda[int(Level::MAX)][int(Command::MAX)];
+
+    /* Organization */
+    enum class Org : int
+    {
+        PCM_2Gb_x8, PCM_2Gb_x16,
+        PCM_4Gb_x8, PCM_4Gb_x16,
+        PCM_8Gb_x8, PCM_8Gb_x16,
+        MAX
+    };
+
+    struct OrgEntry {
+        int size;
+        int dq;
+        int count[int(Level::MAX)];
+    } org_table[int(Org::MAX)] = {
+        {2<<10,  8, {0, 0, 8, 1<<15, 1<<10}}, {2<<10, 16, {0, 0, 8, 1<<14, 1<<10}},
+        {4<<10,  8, {0, 0, 8, 1<<16, 1<<10}}, {4<<10, 16, {0, 0, 8, 1<<15, 1<<10}},
+        {8<<10,  8, {0, 0, 8, 1<<16, 1<<11}}, {8<<10, 16, {0, 0, 8, 1<<16, 1<<10}},
+    }, org_entry;
+
+    void set_channel_number(int channel);
+    void set_rank_number(int rank);
+
+    /* Speed */
+    enum class Speed : int
+    {
+        PCM_800D, PCM_1066G,
+        MAX
+    };
+
+    int prefetch_size = 8; // 8n prefetch DDR
+    int channel_width = 64;
+
+    // Array timings from Lee et al.: 55ns sensing (tRCD), 150ns SET pulse
+    // (tWR). nRFC/nREFI are zero since PCM needs no refresh.
+    struct SpeedEntry {
+        int rate;
+        double freq, tCK;
+        int nBL, nCCD, nRTRS;
+        int nCL, nRCD, nRP, nCWL;
+        int nRAS, nRC;
+        int nRTP, nWTR, nWR;
+        int nRRD, nFAW;
+        int nRFC, nREFI;
+        int nPD, nXP, nXPDLL;
+        int nCKESR, nXS, nXSDLL;
+    } speed_table[int(Speed::MAX)] = {
+        {800,  (400.0/3)*3, (3/0.4)/3, 4, 4, 2, 5, 22, 1, 5, 22, 23, 3, 3, 60, 4, 20, 0, 0, 3, 3, 10, 4, 5, 512},
+        {1066, (400.0/3)*4, (3/0.4)/4, 4, 4, 2, 7, 30, 1, 6, 30, 31, 4, 4, 80, 6, 27, 0, 0, 3, 4, 13, 4, 6, 512},
+    }, speed_entry;
+
+    int read_latency;
+    int write_latency;
+private:
+    void init_lambda();
+    void init_prereq();
+    void init_rowhit();
+    void init_rowopen();
+    void init_timing();
+};
+
+} /*namespace ramulator*/
+
+#endif /*__PCM_H*/
@@ -14,6 +14,11 @@
 #include "WideIO2.h"
 #include "HBM.h"
 #include "SALP.h"
+#include "ALDRAM.h"
+#include "TLDRAM.h"
+#include "DSARP.h"
+#include "PCM.h"
+#include "STTMRAM.h"
 
 using namespace ramulator;
 
@@ -25,6 +30,9 @@ static map<string, function<MemoryBase *(const Config&, int)> > name_to_func = {
     {"HBM", &MemoryFactory<HBM>::create},
     {"SALP-1", &MemoryFactory<SALP>::create}, {"SALP-2", &MemoryFactory<SALP>::create},
     {"SALP-MASA", &MemoryFactory<SALP>::create},{"HMC", &MemoryFactory<HMC>::create},
+    {"ALDRAM", &MemoryFactory<ALDRAM>::create}, {"TLDRAM", &MemoryFactory<TLDRAM>::create},
+    {"DSARP", &MemoryFactory<DSARP>::create},
+    {"PCM", &MemoryFactory<PCM>::create}, {"STTMRAM", &MemoryFactory<STTMRAM>::create},
 };
 
 RamulatorWrapper::RamulatorWrapper(const char* config_path, unsigned num_cpus, int cacheline, bool pim_mode, bool record_memory_trace, const char* application_name, bool networkOverhead)
@@ -43,7 +51,11 @@ RamulatorWrapper::RamulatorWrapper(const char* config_path, unsigned num_cpus, i
 
     const string& std_name = configs["standard"];
     assert(name_to_func.find(std_name) != name_to_func.end() && "unrecognized standard name");
+    // collect the stats of this memory in our own list
+    Stats_ramulator::StatList* prev_statlist = Stats_ramulator::active_statlist;
+    Stats_ramulator::active_statlist = &stats;
     mem = name_to_func[std_name](configs, cacheline);
+    Stats_ramulator::active_statlist = prev_statlist;
     tCK = mem->clk_ns();
     //mem -> set_application_name(application_name);
     //if(_record_memory_trace) mem->set_address_recorder();
@@ -65,6 +77,22 @@ bool RamulatorWrapper::send(Request req) {
     return mem->send(req);
 }
 
+void RamulatorWrapper::warm(long addr) {
+    mem->warm(addr);
+}
+
+string RamulatorWrapper::geometry() {
+    return mem->geometry();
+}
+
+void RamulatorWrapper::open_rows(vector<vector<int>>& rows) {
+    mem->open_rows(rows);
+}
+
+void RamulatorWrapper::warm_row(const vector<int>& addr_vec) {
+    mem->warm_row(addr_vec);
+}
+
 void RamulatorWrapper::finish() {
   std::cout << "[RAMULATOR] Finished Ramulator" << std::endl;
   mem->finish();
@@ -72,4 +100,12 @@ void RamulatorWrapper::finish() {
 
 double RamulatorWrapper::get_tCK() {
     return tCK;
+}
+
+void RamulatorWrapper::output_stats(const string& filename) {
+    stats.output(filename);
+}
+
+void RamulatorWrapper::print_stats() {
+    stats.printall();
 }
\ No newline at end of file
@@ -2,8 +2,10 @@
 #define __RAMULATOR_WRAPPER_H
 
 #include <string>
+#include <vector>
 
 #include "Config.h"
+#include "StatType.h"
 
 using namespace std;
 
@@ -18,13 +20,20 @@ class RamulatorWrapper
 public:
     MemoryBase *mem;
     double tCK;
+    Stats_ramulator::StatList stats;  // statistics of this instance only
 
     RamulatorWrapper(const char* config_path, unsigned num_cpus, int cacheline, bool pim_mode, bool record_memory_trace, const char* application_name, bool networkOverhead);
     ~RamulatorWrapper();
     void tick();
     bool send(Request req);
+    void warm(long addr);
+    string geometry();
+    void open_rows(vector<vector<int>>& rows);
+    void warm_row(const vector<int>& addr_vec);
     void finish();
     double get_tCK();
+    void output_stats(const string& filename);
+    void print_stats();
 };
 
 } /*namespace ramulator*/
@@ -11,9 +11,12 @@
 
 #include "Refresh.h"
 #include "Controller.h"
+#include "HBM_Controller.h"
 #include "HMC_Controller.h"
 #include "DRAM.h"
 #include "DSARP.h"
+#include "PCM.h"
+#include "STTMRAM.h"
 
 using namespace std;
 using namespace ramulator;
@@ -283,11 +286,58 @@ void Refresh<HMC>::refresh_target(Controller<HMC>* ctrl, int vault) {
 template<>
 void Refresh<HMC>::inject_refresh(bool b_ref_rank) {
   assert(b_ref_rank && "Only Vault-level refresh for HMC now");
-  if (b_ref_rank) {
+  if (b_ref_rank && ctrl->channel->state != HMC::State::SelfRefresh) {
     refresh_target(ctrl, ctrl->channel->id);
   }
   // TODO Bank-level refresh.
   refreshed = clk;
 }
 
+/**** HBM specialization ****/
+// With per-bank refresh, REFSB goes to one bank of every rank each nREFI /
+// banks cycles, so every bank is still refreshed once per nREFI while the
+// other banks keep serving requests.
+template<>
+void Refresh<HBM>::tick_ref() {
+  clk++;
+
+  HBM* spec = ctrl->channel->spec;
+  if (spec->refresh_mode == HBM::RefreshMode::Refresh_AB) {
+    if ((clk - refreshed) >= spec->speed_entry.nREFI)
+      inject_refresh(true);
+    return;
+  }
+
+  int banks = max_bank_count * spec->org_entry.count[int(HBM::Level::BankGroup)];
+  if ((clk - refreshed) < spec->speed_entry.nREFI / banks)
+    return;
+
+  for (auto rank : ctrl->channel->children) {
+    if (rank->state == HBM::State::SelfRefresh)
+      continue;
+    int b = bank_ref_counters[rank->id];
+    vector<int> addr_vec(int(HBM::Level::MAX), -1);
+    addr_vec[int(HBM::Level::Channel)] = ctrl->channel->id;
+    addr_vec[int(HBM::Level::Rank)] = rank->id;
+    addr_vec[int(HBM::Level::BankGroup)] = b / max_bank_count;
+    addr_vec[int(HBM::Level::Bank)] = b % max_bank_count;
+    Request req(addr_vec, Request::Type::REFRESH, NULL, -1);
+    bool res = ctrl->enqueue(req);
+    assert(res);
+    bank_ref_counters[rank->id] = (b + 1) % banks;
+  }
+  refreshed = clk;
+}
+
+/**** Non-volatile memories: nothing to refresh ****/
+template<>
+void Refresh<PCM>::tick_ref() {
+  clk++;
+}
+
+template<>
+void Refresh<STTMRAM>::tick_ref() {
+  clk++;
+}
+
 } /* namespace ramulator */
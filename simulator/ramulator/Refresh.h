@@ -4,8 +4,9 @@
  * This is a refresh scheduler. A list of refresh policies implemented:
  *
  * 1. All-bank refresh
- * 2. Per-bank refresh (only DSARP memory module has been completed to work with REFpb).
+ * 2. Per-bank refresh (DSARP with REFpb, and HBM with REFSB when refresh_mode = per_bank).
  *     The other modules (LPDDRx) have not been updated to pass a knob to turn on/off REFpb.
+ *     Ranks in self-refresh refresh themselves and are skipped.
  * 3. A re-implementation of DSARP from the refresh mechanisms proposed in Chang et al.,
  * "Improving DRAM Performance by Parallelizing Refreshes with Accesses", HPCA 2014.
  *
@@ -24,7 +25,10 @@
 #include "Request.h"
 #include "DSARP.h"
 #include "ALDRAM.h"
+#include "HBM.h"
 #include "HMC.h"
+#include "PCM.h"
+#include "STTMRAM.h"
 
 using namespace std;
 using namespace ramulator;
@@ -117,12 +121,14 @@ private:
     // Rank-level refresh
     if (b_ref_rank) {
       for (auto rank : ctrl->channel->children)
-        refresh_target(ctrl, rank->id, -1, -1);
+        if (rank->state != T::State::SelfRefresh)
+          refresh_target(ctrl, rank->id, -1, -1);
     }
     // Bank-level refresh. Simultaneously issue to all ranks (better performance than staggered refreshes).
     else {
       for (auto rank : ctrl->channel->children)
-        refresh_target(ctrl, rank->id, bank_ref_counters[rank->id], -1);
+        if (rank->state != T::State::SelfRefresh)
+          refresh_target(ctrl, rank->id, bank_ref_counters[rank->id], -1);
     }
     refreshed = clk;
   }
@@ -139,6 +145,9 @@ template<> void Refresh<DSARP>::tick_ref();
 template<> Refresh<HMC>::Refresh(Controller<HMC>* ctrl);
 template<> void Refresh<HMC>::refresh_target(Controller<HMC>* ctrl, int vault);
 template<> void Refresh<HMC>::inject_refresh(bool b_ref_rank);
+template<> void Refresh<HBM>::tick_ref();
+template<> void Refresh<PCM>::tick_ref();
+template<> void Refresh<STTMRAM>::tick_ref();
 
 } /* namespace ramulator */
 
@@ -44,6 +44,7 @@ public:
     int served_without_hops = 0;	
     int burst_count = 0;
     int transaction_bytes = 0;
+    int data_bytes = 0; // bytes actually transferred if the line is compressed, 0 if it is not
     function<void(Request&)> callback; // call back with more info
 
 
@@ -59,6 +60,13 @@ public:
 
     Request() {_addr = addr;}
 
+    // Bursts left of full_bursts (which move line_bytes) once the line is compressed to data_bytes
+    int compressed_bursts(int full_bursts, int line_bytes) const {
+        if (data_bytes <= 0 || data_bytes >= line_bytes) return full_bursts;
+        int bursts = (full_bursts * data_bytes + line_bytes - 1) / line_bytes;
+        return bursts ? bursts : 1;
+    }
+
 
 };
 
@@ -0,0 +1,213 @@
+/*
+ * STTMRAM.h
+ *
+ * Spin-transfer torque MRAM as a DRAM replacement, following Kultursay et
+ * al., "Evaluating STT-RAM as an Energy-Efficient Main Memory Alternative",
+ * ISPASS 2013. The device keeps the DDR3 interface and row buffer.
+ *
+ * Sensing does not destroy the cell contents, so rows need no restore before
+ * a precharge. Writing an MTJ takes longer than a DRAM write-back; this is
+ * modeled by a longer write recovery (nWR). The cells are non-volatile, so
+ * no refresh is ever scheduled (see Refresh.cc).
+ */
+
+#ifndef __STTMRAM_H
+#define __STTMRAM_H
+
+#include "DRAM.h"
+#include "Request.h"
+#include <vector>
+#include <map>
+#include <string>
+#include <functional>
+
+using namespace std;
+
+namespace ramulator
+{
+
+class STTMRAM
+{
+public:
+    static string standard_name;
+    enum class Org;
+    enum class Speed;
+    STTMRAM(Org org, Speed speed);
+    STTMRAM(const string& org_str, const string& speed_str);
+
+    static map<string, enum Org> org_map;
+    static map<string, enum Speed> speed_map;
+    /*** Level ***/
+    enum class Level : int
+    {
+        Channel, Rank, Bank, Row, Column, MAX
+    };
+
+    /*** Command ***/
+    // REF is kept so that refresh requests still translate, but it is never issued
+    enum class Command : int
+    {
+        ACT, PRE, PREA,
+        RD,  WR,  RDA,  WRA,
+        REF, PDE, PDX,  SRE, SRX,
+        MAX
+    };
+
+    string command_name[int(Command::MAX)] = {
+        "ACT", "PRE", "PREA",
+        "RD",  "WR",  "RDA",  "WRA",
+        "REF", "PDE", "PDX",  "SRE", "SRX"
+    };
+
+    Level scope[int(Command::MAX)] = {
+        Level::Row,    Level::Bank,   Level::Rank,
+        Level::Column, Level::Column, Level::Column, Level::Column,
+        Level::Rank,   Level::Rank,   Level::Rank,   Level::Rank,   Level::Rank
+    };
+
+    bool is_opening(Command cmd)
+    {
+        switch(int(cmd)) {
+            case int(Command::ACT):
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool is_accessing(Command cmd)
+    {
+        switch(int(cmd)) {
+            case int(Command::RD):
+            case int(Command::WR):
+            case int(Command::RDA):
+            case int(Command::WRA):
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool is_closing(Command cmd)
+    {
+        switch(int(cmd)) {
+            case int(Command::RDA):
+            case int(Command::WRA):
+            case int(Command::PRE):
+            case int(Command::PREA):
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool is_refreshing(Command cmd)
+    {
+        switch(int(cmd)) {
+            case int(Command::REF):
+                return true;
+            default:
+                return false;
+        }
+    }
+
+
+    /* State */
+    enum class State : int
+    {
+        Opened, Closed, PowerUp, ActPowerDown, PrePowerDown, SelfRefresh, MAX
+    } start[int(Level::MAX)] = {
+        State::MAX, State::PowerUp, State::Closed, State::Closed, State::MAX
+    };
+
+    /* Translate */
+    Command translate[int(Request::Type::MAX)] = {
+        Command::RD,  Command::WR,
+        Command::REF, Command::PDE, Command::SRE
+    };
+
+    /* Prerequisite */
+    function<Command(DRAM<STTMRAM>*, Command cmd, int)> prereq[int(Level::MAX)][int(Command::MAX)];
+
+    /* Row hit */
+    function<bool(DRAM<STTMRAM>*, Command cmd, int)> rowhit[int(Level::MAX)][int(Command::MAX)];
+    function<bool(DRAM<STTMRAM>*, Command cmd, int)> rowopen[int(Level::MAX)][int(Command::MAX)];
+
+    /* Timing */
+    struct TimingEntry
+    {
+        Command cmd;
+        int dist;
+        int val;
+        bool sibling;
+    };
+    vector<TimingEntry> timing[int(Level::MAX)][int(Command::MAX)];
+
+    /* Lambda */
+    function<void(DRAM<STTMRAM>*, int)> lambda[int(Level::MAX)][int(Command::MAX)];
+
+    /* Organization */
+    enum class Org : int
+    {
+        STTMRAM_2Gb_x8, STTMRAM_2Gb_x16,
+        STTMRAM_4Gb_x8, STTMRAM_4Gb_x16,
+        STTMRAM_8Gb_x8, STTMRAM_8Gb_x16,
+        MAX
+    };
+
+    struct OrgEntry {
+        int size;
+        int dq;
+        int count[int(Level::MAX)];
+    } org_table[int(Org::MAX)] = {
+        {2<<10,  8, {0, 0, 8, 1<<15, 1<<10}}, {2<<10, 16, {0, 0, 8, 1<<14, 1<<10}},
+        {4<<10,  8, {0, 0, 8, 1<<16, 1<<10}}, {4<<10, 16, {0, 0, 8, 1<<15, 1<<10}},
+        {8<<10,  8, {0, 0, 8, 1<<16, 1<<11}}, {8<<10, 16, {0, 0, 8, 1<<16, 1<<10}},
+    }, org_entry;
+
+    void set_channel_number(int channel);
+    void set_rank_number(int rank);
+
+    /* Speed */
+    enum class Speed : int
+    {
+        STT_1600_1_2, STT_1600_1_5, STT_1600_2_0,
+        MAX
+    };
+
+    int prefetch_size = 8; // 8n prefetch DDR
+    int channel_width = 64;
+
+    // DDR3-1600 interface with the array timings of Kultursay et al.: no
+    // restore after sensing (nRAS == nRCD) and a write pulse that is 1.2x,
+    // 1.5x or 2x the DDR3-1600 write recovery, as named by the speed bin.
+    struct SpeedEntry {
+        int rate;
+        double freq, tCK;
+        int nBL, nCCD, nRTRS;
+        int nCL, nRCD, nRP, nCWL;
+        int nRAS, nRC;
+        int nRTP, nWTR, nWR;
+        int nRRD, nFAW;
+        int nRFC, nREFI;
+        int nPD, nXP, nXPDLL;
+        int nCKESR, nXS, nXSDLL;
+    } speed_table[int(Speed::MAX)] = {
+        {1600, (400.0/3)*6, (3/0.4)/6, 4, 4, 2, 11, 14, 11, 8, 14, 25, 6, 6, 14, 5, 24, 0, 0, 4, 5, 20, 5, 8, 512},
+        {1600, (400.0/3)*6, (3/0.4)/6, 4, 4, 2, 11, 14, 11, 8, 14, 25, 6, 6, 18, 5, 24, 0, 0, 4, 5, 20, 5, 8, 512},
+        {1600, (400.0/3)*6, (3/0.4)/6, 4, 4, 2, 11, 14, 11, 8, 14, 25, 6, 6, 24, 5, 24, 0, 0, 4, 5, 20, 5, 8, 512},
+    }, speed_entry;
+
+    int read_latency;
+    int write_latency;
+private:
+    void init_lambda();
+    void init_prereq();
+    void init_rowhit();
+    void init_rowopen();
+    void init_timing();
+};
+
+} /*namespace ramulator*/
+
+#endif /*__STTMRAM_H*/
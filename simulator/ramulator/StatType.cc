@@ -1,9 +1,11 @@
 #include "StatType.h"
+#include <algorithm>
 
 namespace Stats_ramulator {
 
 // Statistics list
 StatList statlist;
+StatList* active_statlist = &statlist;
 
 // The smallest timing granularity.
 Tick curTick = 0;
@@ -144,4 +146,44 @@ Histogram::sample(Counter val, int number)
     samples += number;
 }
 
+Counter
+LatencyHistogram::percentile(double fraction) const
+{
+    if (samples < eps)
+        return Counter();
+    Counter target = std::max(std::floor(fraction * samples + 0.5), 1.0);
+    Counter seen = 0;
+    for (off_type i = 0; i < cvec.size(); i++) {
+        seen += cvec[i];
+        if (seen >= target)
+            return std::min((Counter)(lower_bound(i + 1) - 1), max_val);
+    }
+    return max_val;
+}
+
+void
+LatencyHistogram::print(std::ofstream& file)
+{
+    auto line = [&](const std::string& name, Counter value, const std::string& desc) {
+        file.width(40);
+        file << name;
+        file.precision(0);
+        file.width(20);
+        file << std::fixed << value;
+        file.width(40);
+        file << "# " << desc << std::endl;
+    };
+    line(_name, samples, _desc);
+    line(_name + ".max", max_val, "Largest sample");
+    line(_name + ".p50", percentile(0.50), "Median (bucket upper bound)");
+    line(_name + ".p95", percentile(0.95), "95th percentile (bucket upper bound)");
+    line(_name + ".p99", percentile(0.99), "99th percentile (bucket upper bound)");
+    for (off_type i = 0; i < cvec.size(); i++) {
+        if (cvec[i] < eps)
+            continue;
+        line(_name + "[" + std::to_string(lower_bound(i)) + "-" + std::to_string(lower_bound(i + 1) - 1) + "]",
+             cvec[i], "Samples in bucket");
+    }
+}
+
 } /* namespace Stats */
@@ -72,6 +72,11 @@ class StatBase {
 
   virtual bool is_display() const  = 0;
   virtual bool is_nozero() const = 0;
+
+  // For exporting into another stats tree (e.g., zsim's)
+  virtual const std::string& get_name() const = 0;
+  virtual const std::string& get_desc() const = 0;
+  virtual int get_precision() const = 0;
 };
 
 class StatList {
@@ -90,6 +95,10 @@ class StatList {
     }
   }
 
+  const std::vector<StatBase*>& get_list() const {
+    return list;
+  }
+
   void printall() {
     for(off_type i = 0 ; i < list.size() ; ++i) {
       if (!list[i]) {
@@ -113,6 +122,11 @@ class StatList {
 
 extern StatList statlist;
 
+// Registry that newly constructed stats are added to. It is statlist unless
+// a RamulatorWrapper is building its memory, in which case it is the
+// wrapper's own list, so that several instances can report separately.
+extern StatList* active_statlist;
+
 template<class Derived>
 class Stat : public StatBase {
  protected:
@@ -123,7 +137,7 @@ class Stat : public StatBase {
   std::string separatorString;
  public:
   Stat() {
-    statlist.add(selfptr());
+    active_statlist->add(selfptr());
   }
   Derived &self() {return *static_cast<Derived*>(this);}
   Derived *selfptr() {return static_cast<Derived*>(this);}
@@ -177,6 +191,10 @@ class Stat : public StatBase {
   virtual bool is_nozero() const {
     return _flags.is_nozero();
   }
+
+  virtual const std::string& get_name() const {return _name;}
+  virtual const std::string& get_desc() const {return _desc;}
+  virtual int get_precision() const {return _precision;}
 };
 
 template <class ScalarType>
@@ -355,7 +373,7 @@ class VectorBase: public Stat<Derived> {
   }
 
   VResult vresult() const {
-    VResult vres;
+    VResult vres(size());
     for (off_type i = 0 ; i < size() ; ++i) {
       vres[i] = data[i].result();
     }
@@ -576,6 +594,74 @@ class Histogram: public Stat<Histogram> {
   size_type size() const {return param_buckets;}
 };
 
+// Log-linear (HDR-style) histogram, e.g., of latencies: values below
+// 2^SUB_BITS have a bucket each, and each higher power of two is split in
+// 2^SUB_BITS buckets, so a bucket spans at most 1/2^SUB_BITS of its values.
+// Values of 2^max_bits or more share the last bucket. sample() is a
+// constant-time bucket increment. Percentiles are the upper bounds of the
+// buckets that hold them; vresult() has the bucket counts.
+class LatencyHistogram: public Stat<LatencyHistogram> {
+ public:
+  static const size_type SUB_BITS = 3;
+  static const size_type SUB_BUCKETS = 1 << SUB_BITS;
+
+ private:
+  size_type max_bits;
+  VCounter cvec;
+  Counter samples;
+  Counter max_val;
+
+ public:
+  LatencyHistogram() { init(24); }
+  void init(size_type __max_bits) {
+    assert(__max_bits > SUB_BITS && __max_bits < 64);
+    max_bits = __max_bits;
+    cvec.resize((max_bits - SUB_BITS + 1) << SUB_BITS);
+    reset();
+  }
+
+  off_type bucket(uint64_t val) const {
+    if (val < SUB_BUCKETS) return val;
+    size_type msb = 63 - __builtin_clzll(val);
+    if (msb >= max_bits) return cvec.size() - 1;
+    size_type shift = msb - SUB_BITS;
+    return ((shift + 1) << SUB_BITS) + ((val >> shift) & (SUB_BUCKETS - 1));
+  }
+
+  static uint64_t lower_bound(off_type idx) {
+    if (idx < SUB_BUCKETS) return idx;
+    size_type shift = (idx >> SUB_BITS) - 1;
+    return (uint64_t)(SUB_BUCKETS + (idx & (SUB_BUCKETS - 1))) << shift;
+  }
+
+  void sample(Counter val, int number = 1) {
+    uint64_t v = (val > 0)? (uint64_t)val : 0;
+    cvec[bucket(v)] += number;
+    samples += number;
+    if (val > max_val) max_val = val;
+  }
+
+  Counter count() const {return samples;}
+  Counter bucket_count(off_type idx) const {return cvec[idx];}
+  Counter max() const {return max_val;}
+  Counter percentile(double fraction) const;
+
+  bool zero() const {
+    return (fabs(samples) < eps);
+  }
+  void prepare() {}
+  void reset() {
+    for (auto& c : cvec) c = Counter();
+    samples = Counter();
+    max_val = Counter();
+  }
+
+  size_type size() const {return cvec.size();}
+  VResult vresult() const {return VResult(cvec.begin(), cvec.end());}
+  Result total() const {return samples;}
+  void print(std::ofstream& file);
+};
+
 class StandardDeviation: public Stat<StandardDeviation> {
  private:
   Counter sum;
@@ -24,6 +24,7 @@
   Stats::Histogram --> HistogramStat
   Stats::StandardDeviation --> StandardDeviationStat
   Stats::AverageDeviation --> AverageDeviationStat
+  (log-linear histogram, no gem5 class) --> LatencyHistogramStat
 
   All of the stats that you create will be named "ramulator.<your name>"
   automatically, and will be dumped at the end of simulation into the gem5
@@ -210,6 +211,17 @@ class HistogramStat : public DistStatBase<Stats_ramulator::Histogram> {
     }
 };
 
+class LatencyHistogramStat : public DistStatBase<Stats_ramulator::LatencyHistogram> {
+  protected:
+    LatencyHistogramStat & self() { return *this; }
+
+  public:
+    LatencyHistogramStat & init(Stats_ramulator::size_type max_bits) {
+      StatBase<Stats_ramulator::LatencyHistogram>::stat.init(max_bits);
+      return self();
+    }
+};
+
 class StandardDeviationStat : public DistStatBase<Stats_ramulator::StandardDeviation> {
 };
 
@@ -0,0 +1,328 @@
+#!/usr/bin/env python3
+"""Runs a batch of zsim simulations in parallel and collects their stats.
+
+Run from the simulator folder, like ./build/opt/zsim:
+
+    python3 scripts/batch_run.py config_files/pim_ooo config_files/host_ooo/no_prefetch
+    python3 scripts/batch_run.py run_workloads_64.sh -j 16 --mem-mb 200000
+
+Inputs are configuration files, folders searched for *.cfg, or shell files
+with ./build/opt/zsim lines (as written by run.py).
+
+Jobs are admitted while both a core and enough memory are free. Each zsim
+reserves its sim.gmMBytes of shared memory plus --overhead-mb for the
+application and Pin. Pending jobs start longest-first, using the runtimes of
+earlier batches (or of the same function on other systems) as estimates.
+
+Progress goes to a state file (--state) after every job, so an interrupted
+batch resumes where it stopped when run again with the same inputs. Finished
+jobs are skipped, and so are failed ones unless --retry-failed is given.
+Each job's output goes to <sim.stats>.log.
+
+At the end, the zsim.out and ramulator.stats of every finished job are
+flattened into one CSV table (--results), with a row per job and a column
+per stat. --columns restricts the stats to those matching a regex.
+"""
+
+import argparse
+import csv
+import glob
+import json
+import os
+import re
+import signal
+import subprocess
+import sys
+import time
+
+DEFAULT_GM_MBYTES = 1024  # zsim_harness.cpp default for sim.gmMBytes
+
+
+# ====================== Jobs ======================
+
+class Job(object):
+    def __init__(self, cfg):
+        self.cfg = os.path.normpath(cfg)
+        with open(cfg, "r") as f:
+            text = re.sub(r"//[^\n]*|#[^\n]*|/\*.*?\*/", "", f.read(), flags=re.S)
+        m = re.search(r"\bstats\s*=\s*\"([^\"]*)\"", text)
+        self.stats = m.group(1) if m else None
+        m = re.search(r"\bgmMBytes\s*=\s*(\d+)", text)
+        self.gm_mbytes = int(m.group(1)) if m else DEFAULT_GM_MBYTES
+
+        # config_files/<system>/<suite>/<cores>/<application>_<function>.cfg
+        parts = self.cfg.split(os.sep)
+        if "config_files" in parts:
+            parts = parts[parts.index("config_files") + 1:]
+        self.workload = os.path.splitext(parts[-1])[0]
+        self.cores = parts[-2] if len(parts) >= 2 else ""
+        self.suite = parts[-3] if len(parts) >= 3 else ""
+        self.system = "/".join(parts[:-3])
+
+        self.mem_mbytes = 0  # set by the scheduler
+        self.estimate = 0.0
+        self.proc = None
+        self.log = None
+        self.start = 0.0
+
+
+def find_configs(inputs):
+    cfgs = []
+    for path in inputs:
+        if os.path.isdir(path):
+            for root, _, files in os.walk(path):
+                cfgs += [os.path.join(root, f) for f in sorted(files) if f.endswith(".cfg")]
+        elif path.endswith(".cfg"):
+            cfgs.append(path)
+        else:
+            with open(path, "r") as f:
+                for line in f:
+                    words = line.split()
+                    if len(words) >= 2 and words[0].endswith("zsim"):
+                        cfgs.append(words[1])
+    seen = set()
+    return [c for c in cfgs if not (os.path.normpath(c) in seen or seen.add(os.path.normpath(c)))]
+
+
+# ====================== State ======================
+
+def load_state(path):
+    if not os.path.exists(path):
+        return {}
+    with open(path, "r") as f:
+        return json.load(f)
+
+
+def save_state(path, state):
+    tmp = path + ".tmp"
+    with open(tmp, "w") as f:
+        json.dump(state, f, indent=1, sort_keys=True)
+    os.rename(tmp, path)
+
+
+def estimate_runtimes(jobs, state):
+    """Own runtime if known, else the mean over the same function, else the longest known"""
+    by_workload = {}
+    known = []
+    for cfg, entry in state.items():
+        if "runtime" in entry:
+            w = os.path.splitext(os.path.basename(cfg))[0]
+            by_workload.setdefault(w, []).append(entry["runtime"])
+            known.append(entry["runtime"])
+    longest = max(known) if known else 0.0
+    for job in jobs:
+        entry = state.get(job.cfg, {})
+        if "runtime" in entry:
+            job.estimate = entry["runtime"]
+        elif job.workload in by_workload:
+            times = by_workload[job.workload]
+            job.estimate = sum(times) / len(times)
+        else:
+            job.estimate = longest  # unknown jobs may be long, start them early
+
+
+def available_mbytes():
+    with open("/proc/meminfo", "r") as f:
+        for line in f:
+            if line.startswith("MemAvailable:"):
+                return int(line.split()[1]) // 1024
+    return 0
+
+
+# ====================== Scheduling ======================
+
+def start_job(job, zsim):
+    job.log = open(job.stats + ".log" if job.stats else job.cfg + ".log", "w")
+    # Own process group, so that interrupting the batch also stops the harness's children
+    job.proc = subprocess.Popen([zsim, job.cfg], stdout=job.log, stderr=subprocess.STDOUT,
+                                preexec_fn=os.setsid)
+    job.start = time.time()
+
+
+def stop_job(job):
+    try:
+        os.killpg(job.proc.pid, signal.SIGTERM)
+        for _ in range(50):
+            if job.proc.poll() is not None:
+                break
+            time.sleep(0.1)
+        else:
+            os.killpg(job.proc.pid, signal.SIGKILL)
+            job.proc.wait()
+    except OSError:
+        pass
+    job.log.close()
+
+
+def run(jobs, args, state):
+    pending = sorted(jobs, key=lambda j: -j.estimate)
+    running = []
+    mem_budget = args.mem_mb
+    mem_used = 0
+    done = 0
+
+    def handle_term(signum, frame):
+        raise KeyboardInterrupt()
+    signal.signal(signal.SIGTERM, handle_term)
+
+    try:
+        while pending or running:
+            # Longest-first, backfilling with shorter jobs that fit
+            i = 0
+            while i < len(pending) and len(running) < args.jobs:
+                job = pending[i]
+                if running and mem_used + job.mem_mbytes > mem_budget:
+                    i += 1
+                    continue
+                if job.mem_mbytes > mem_budget:
+                    print("WARNING: %s needs %d MB, more than the %d MB budget; running it alone" %
+                          (job.cfg, job.mem_mbytes, mem_budget))
+                start_job(job, args.zsim)
+                pending.pop(i)
+                running.append(job)
+                mem_used += job.mem_mbytes
+
+            time.sleep(args.poll)
+            for job in [j for j in running if j.proc.poll() is not None]:
+                running.remove(job)
+                mem_used -= job.mem_mbytes
+                job.log.close()
+                runtime = time.time() - job.start
+                rc = job.proc.returncode
+                ok = rc == 0 and job.stats and os.path.exists(job.stats + ".zsim.out")
+                entry = state.setdefault(job.cfg, {})
+                entry["status"] = "done" if ok else "failed"
+                entry["returncode"] = rc
+                if ok:
+                    entry["runtime"] = runtime
+                save_state(args.state, state)
+                done += 1
+                print("[%d/%d] %s %s in %.0f s (%d running, %d pending)" %
+                      (done, len(jobs), "finished" if ok else "FAILED", job.cfg, runtime, len(running), len(pending)))
+                sys.stdout.flush()
+    except KeyboardInterrupt:
+        print("Interrupted, stopping %d running jobs; run again to resume" % len(running))
+        for job in running:
+            stop_job(job)
+        save_state(args.state, state)
+        sys.exit(1)
+
+
+# ====================== Results ======================
+
+def read_zsim_out(path, stats):
+    """Flattens the last dump of a zsim.out (TextBackend) into root.a.b: value"""
+    with open(path, "r") as f:
+        lines = f.read().split("\n")
+    marks = [i for i, l in enumerate(lines) if l == "==="]
+    if len(marks) >= 2:
+        lines = lines[marks[-2] + 1:marks[-1]]
+    stack = []  # (indent, name)
+    for line in lines:
+        if not line.strip() or line.startswith("#"):
+            continue
+        indent = len(line) - len(line.lstrip(" "))
+        name, _, rest = line.strip().partition(": ")
+        if not _:
+            name = name.rstrip(":")
+        while stack and stack[-1][0] >= indent:
+            stack.pop()
+        value = rest.split("#")[0].strip()
+        if value:
+            stats["zsim." + ".".join([s[1] for s in stack] + [name])] = value
+        else:
+            stack.append((indent, name))
+
+
+def read_ramulator_stats(path, prefix, stats):
+    vector = None
+    with open(path, "r") as f:
+        for line in f:
+            words = line.split("#")[0].split()
+            if len(words) != 2:
+                continue
+            name, value = words
+            if name.startswith("["):
+                if vector:
+                    stats[prefix + vector + name] = value
+            else:
+                vector = name
+                stats[prefix + name] = value
+
+
+def collect(jobs, state, args):
+    meta = ["cfg", "system", "suite", "cores", "workload", "status", "runtime_s"]
+    columns = []
+    seen = set()
+    rows = []
+    keep = re.compile(args.columns) if args.columns else None
+    for job in jobs:
+        entry = state.get(job.cfg, {})
+        row = {"cfg": job.cfg, "system": job.system, "suite": job.suite, "cores": job.cores,
+               "workload": job.workload, "status": entry.get("status", "pending"),
+               "runtime_s": "%.1f" % entry["runtime"] if "runtime" in entry else ""}
+        stats = {}
+        if entry.get("status") == "done":
+            read_zsim_out(job.stats + ".zsim.out", stats)
+            # <stats>.ramulator.stats, or <stats>.<mem>.ramulator.stats with several controllers
+            for path in sorted(glob.glob(glob.escape(job.stats) + "*.ramulator.stats")):
+                mem = path[len(job.stats):-len(".ramulator.stats")].strip(".")
+                read_ramulator_stats(path, mem + "." if mem else "", stats)
+        for k, v in stats.items():
+            if keep and not keep.search(k):
+                continue
+            if k not in seen:
+                seen.add(k)
+                columns.append(k)
+            row[k] = v
+        rows.append(row)
+
+    with open(args.results, "w") as f:
+        writer = csv.DictWriter(f, fieldnames=meta + columns, restval="")
+        writer.writeheader()
+        writer.writerows(rows)
+    print("Wrote %d jobs x %d stats to %s" % (len(rows), len(columns), args.results))
+
+
+# ====================== Main ======================
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("inputs", nargs="+", help="configuration files, folders of them, or run scripts")
+    parser.add_argument("-j", "--jobs", type=int, default=os.cpu_count(), help="concurrent simulations (default: all cores)")
+    parser.add_argument("--mem-mb", type=int, default=0, help="memory budget in MB (default: MemAvailable)")
+    parser.add_argument("--overhead-mb", type=int, default=512, help="memory per job on top of sim.gmMBytes")
+    parser.add_argument("--zsim", default="./build/opt/zsim", help="zsim binary")
+    parser.add_argument("--state", default="batch_state.json", help="job state file, for resuming")
+    parser.add_argument("--results", default="batch_results.csv", help="results table")
+    parser.add_argument("--columns", default=None, help="only collect stats whose name matches this regex")
+    parser.add_argument("--retry-failed", action="store_true", help="rerun jobs that failed before")
+    parser.add_argument("--rerun", action="store_true", help="rerun finished jobs too")
+    parser.add_argument("--collect-only", action="store_true", help="only build the results table")
+    parser.add_argument("--poll", type=float, default=1.0, help="seconds between completion checks")
+    args = parser.parse_args()
+
+    jobs = [Job(c) for c in find_configs(args.inputs)]
+    for job in jobs:
+        if not job.stats:
+            print("WARNING: %s has no sim.stats, its results cannot be collected" % job.cfg)
+        job.mem_mbytes = job.gm_mbytes + args.overhead_mb
+    state = load_state(args.state)
+
+    if not args.collect_only:
+        if not args.mem_mb:
+            args.mem_mb = available_mbytes()
+        todo = []
+        for job in jobs:
+            status = state.get(job.cfg, {}).get("status")
+            if args.rerun or status is None or (status == "failed" and args.retry_failed):
+                todo.append(job)
+        estimate_runtimes(todo, state)
+        print("%d jobs, %d to run, %d at a time within %d MB" % (len(jobs), len(todo), args.jobs, args.mem_mb))
+        run(todo, args, state)
+
+    collect(jobs, state, args)
+
+
+if __name__ == "__main__":
+    main()
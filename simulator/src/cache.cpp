@@ -58,6 +58,10 @@ void Cache::initCacheStats(AggregateStat* cacheStat) {
     rp->initStats(cacheStat);
 }
 
+bool Cache::serialize(Checkpoint& ckpt) {
+    return array->serialize(ckpt) && cc->serialize(ckpt) && rp->serialize(ckpt);
+}
+
 uint64_t Cache::access(MemReq& req) {
     uint64_t respCycle = req.cycle;
     bool skipAccess = cc->startAccess(req); //may need to skip access due to races (NOTE: may change req.type!)
@@ -78,15 +82,19 @@ uint64_t Cache::access(MemReq& req) {
 
             array->postinsert(req.lineAddr, &req, lineId); //do the actual insertion. NOTE: Now we must split insert into a 2-phase thing because cc unlocks us.
         }
+        cc->processDirEviction(req, lineId, respCycle); //off the critical path too; a no-op except in CCs with a separate directory
+
         // Enforce single-record invariant: Writeback access may have a timing
-        // record. If so, read it.
-        EventRecorder* evRec = zinfo->eventRecorders[req.srcId];
+        // record. If so, read it. Warming accesses never have records.
+        EventRecorder* evRec = req.is(MemReq::WARM)? nullptr : zinfo->eventRecorders[req.srcId];
         TimingRecord wbAcc;
         wbAcc.clear();
         if (unlikely(evRec && evRec->hasRecord())) {
             wbAcc = evRec->popRecord();
         }
 
+        if (unlikely(array->isOverflowing())) evictOverflow(req, respCycle, evRec, wbAcc); //compressed arrays, off the critical path too
+
         respCycle = cc->processAccess(req, lineId, respCycle);
 
         // Access may have generated another timing record. If *both* access
@@ -125,6 +133,38 @@ uint64_t Cache::access(MemReq& req) {
     return respCycle;
 }
 
+uint64_t Cache::evictOverflow(const MemReq& req, uint64_t startCycle, EventRecorder* evRec, TimingRecord& wbRec) {
+    uint64_t evDoneCycle = startCycle;
+    Address wbLineAddr;
+    int32_t lineId;
+    while ((lineId = array->overflowVictim(&wbLineAddr)) != -1) {
+        trace(Cache, "[%s] Evicting 0x%lx (overflow)", name.c_str(), wbLineAddr);
+        evDoneCycle = MAX(evDoneCycle, cc->processEviction(req, wbLineAddr, lineId, startCycle));
+        if (!evRec || !evRec->hasRecord()) continue;
+
+        TimingRecord evAcc = evRec->popRecord();
+        if (!wbRec.isValid()) {
+            wbRec = evAcc;
+        } else {
+            // Start both writebacks in parallel; as with a writeback and an access, only the first one's end stays connected
+            uint64_t reqCycle = MIN(wbRec.reqCycle, evAcc.reqCycle);
+            DelayEvent* startEv = new (evRec) DelayEvent(0);
+            DelayEvent* dWbEv = new (evRec) DelayEvent(wbRec.reqCycle - reqCycle);
+            DelayEvent* dEvEv = new (evRec) DelayEvent(evAcc.reqCycle - reqCycle);
+            startEv->setMinStartCycle(reqCycle);
+            dWbEv->setMinStartCycle(reqCycle);
+            dEvEv->setMinStartCycle(reqCycle);
+            startEv->addChild(dWbEv, evRec)->addChild(wbRec.startEvent, evRec);
+            startEv->addChild(dEvEv, evRec)->addChild(evAcc.startEvent, evRec);
+
+            wbRec.reqCycle = reqCycle;
+            wbRec.startEvent = startEv;
+            if (evAcc.type == PUTX) wbRec.type = PUTX; //dirty if any of them is
+        }
+    }
+    return evDoneCycle;
+}
+
 void Cache::startInvalidate() {
     cc->startInv(); //note we don't grab tcc; tcc serializes multiple up accesses, down accesses don't see it
 }
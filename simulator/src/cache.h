@@ -34,7 +34,9 @@
 #include "repl_policies.h"
 #include "stats.h"
 
+class EventRecorder;
 class Network;
+struct TimingRecord;
 
 /* General coherent modular cache. The replacement policy and cache array are
  * pretty much mix and match. The coherence controller interfaces are general
@@ -66,6 +68,10 @@ class Cache : public BaseCache {
 
         virtual uint64_t access(MemReq& req);
 
+        //Saves or restores the array, coherence and replacement state (see checkpoint.h);
+        //returns false if some of them do not support checkpoints
+        virtual bool serialize(Checkpoint& ckpt);
+
         //NOTE: reqWriteback is pulled up to true, but not pulled down to false.
         virtual uint64_t invalidate(const InvReq& req) {
             startInvalidate();
@@ -77,6 +83,11 @@ class Cache : public BaseCache {
 
         void startInvalidate(); // grabs cc's downLock
         uint64_t finishInvalidate(const InvReq& req); // performs inv and releases downLock
+
+        // Evicts the lines a compressed array must drop after an insertion or a growing writeback (see
+        // CacheArray::overflowVictim()). Their writeback records are merged into wbRec, which may be empty.
+        // Returns the cycle the last eviction finishes
+        uint64_t evictOverflow(const MemReq& req, uint64_t startCycle, EventRecorder* evRec, TimingRecord& wbRec);
 };
 
 #endif  // CACHE_H_
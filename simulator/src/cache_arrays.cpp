@@ -24,13 +24,17 @@
  */
 
 #include "cache_arrays.h"
+#include <string.h>
+#include "checkpoint.h"
 #include "hash.h"
+#include "pad.h"
 #include "repl_policies.h"
 
 /* Set-associative array implementation */
 
 SetAssocArray::SetAssocArray(uint32_t _numLines, uint32_t _assoc, ReplPolicy* _rp, HashFamily* _hf) : rp(_rp), hf(_hf), numLines(_numLines), assoc(_assoc)  {
-    array = gm_calloc<Address>(numLines);
+    array = gm_memalign<Address>(CACHE_LINE_BYTES, numLines); //sets start at line boundaries, for SIMD tag compares (see specialized_arrays.h)
+    memset(array, 0, numLines*sizeof(Address));
     numSets = numLines/assoc;
     setMask = numSets - 1;
     assert_msg(isPow2(numSets), "must have a power of 2 # sets, but you specified %d", numSets);
@@ -64,6 +68,11 @@ void SetAssocArray::postinsert(const Address lineAddr, const MemReq* req, uint32
     rp->update(candidate, req);
 }
 
+bool SetAssocArray::serialize(Checkpoint& ckpt) {
+    ckpt.io(array, numLines);
+    return true;
+}
+
 
 /* ZCache implementation */
 
@@ -103,8 +112,10 @@ int32_t ZArray::lookup(const Address lineAddr, const MemReq* req, bool updateRep
      */
     if (unlikely(!lineAddr)) panic("ZArray::lookup called with lineAddr==0 -- your app just segfaulted");
 
+    uint64_t hashes[ways];
+    hf->hashAll(lineAddr, hashes, ways);
     for (uint32_t w = 0; w < ways; w++) {
-        uint32_t lineId = lookupArray[w*numSets + (hf->hash(w, lineAddr) & setMask)];
+        uint32_t lineId = lookupArray[w*numSets + (hashes[w] & setMask)];
         if (array[lineId] == lineAddr) {
             if (updateReplacement) {
                 rp->update(lineId, req);
@@ -125,39 +136,55 @@ uint32_t ZArray::preinsert(const Address lineAddr, const MemReq* req, Address* w
     //info("Replacement for incoming 0x%lx", lineAddr);
 
     //Seeds
+    uint64_t hashes[(cands + ways)*ways];
+    hf->hashAll(lineAddr, hashes, ways);
     for (uint32_t w = 0; w < ways; w++) {
-        uint32_t pos = w*numSets + (hf->hash(w, lineAddr) & setMask);
+        uint32_t pos = w*numSets + (hashes[w] & setMask);
         uint32_t lineId = lookupArray[pos];
         candidates[w].set(pos, lineId, -1);
         all_valid &= (array[lineId] != 0);
         //info("Seed Candidate %d addr 0x%lx pos %d lineId %d", w, array[lineId], pos, lineId);
     }
 
-    //Expand fringe in BFS fashion
+    //Expand fringe in BFS fashion, a level at a time. First, hash the addresses of the whole level and gather the lineIds at
+    //their positions; these loops have no dependences across iterations, so they overlap their hashes and cache misses. Then,
+    //walk the level one fringe line at a time, exactly as a one-by-one expansion would, so candidates are the same; a level
+    //may be hashed past the point where the walk stops, which costs a few hashes but changes nothing
+    uint32_t levelPos[(cands + ways)*ways];
+    uint32_t levelIds[(cands + ways)*ways];
     while (numCandidates < cands && all_valid) {
-        uint32_t fringeId = candidates[fringeStart].lineId;
-        Address fringeAddr = array[fringeId];
-        assert(fringeAddr);
-        for (uint32_t w = 0; w < ways; w++) {
-            uint32_t hval = hf->hash(w, fringeAddr) & setMask;
-            uint32_t pos = w*numSets + hval;
-            uint32_t lineId = lookupArray[pos];
-
-            // Logically, you want to do this...
+        uint32_t levelSize = numCandidates - fringeStart;
+        for (uint32_t i = 0; i < levelSize; i++) {
+            hf->hashAll(array[candidates[fringeStart + i].lineId], &hashes[i*ways], ways);
+        }
+        for (uint32_t j = 0; j < levelSize*ways; j++) {
+            levelPos[j] = (j % ways)*numSets + (hashes[j] & setMask);
+            levelIds[j] = lookupArray[levelPos[j]];
+        }
+
+        for (uint32_t i = 0; i < levelSize && numCandidates < cands && all_valid; i++) {
+            uint32_t fringeId = candidates[fringeStart].lineId;
+            assert(array[fringeId]);
+            for (uint32_t w = 0; w < ways; w++) {
+                uint32_t pos = levelPos[i*ways + w];
+                uint32_t lineId = levelIds[i*ways + w];
+
+                // Logically, you want to do this...
 #if 0
-            if (lineId != fringeId) {
-                //info("Candidate %d way %d addr 0x%lx pos %d lineId %d parent %d", numCandidates, w, array[lineId], pos, lineId, fringeStart);
-                candidates[numCandidates++].set(pos, lineId, (int32_t)fringeStart);
-                all_valid &= (array[lineId] != 0);
-            }
+                if (lineId != fringeId) {
+                    //info("Candidate %d way %d addr 0x%lx pos %d lineId %d parent %d", numCandidates, w, array[lineId], pos, lineId, fringeStart);
+                    candidates[numCandidates++].set(pos, lineId, (int32_t)fringeStart);
+                    all_valid &= (array[lineId] != 0);
+                }
 #endif
-            // But this compiles as a branch and ILP sucks (this data-dependent branch is long-latency and mispredicted often)
-            // Logically though, this is just checking for whether we're revisiting ourselves, so we can eliminate the branch as follows:
-            candidates[numCandidates].set(pos, lineId, (int32_t)fringeStart);
-            all_valid &= (array[lineId] != 0);  // no problem, if lineId == fringeId the line's already valid, so no harm done
-            numCandidates += (lineId != fringeId); // if lineId == fringeId, the cand we just wrote will be overwritten
+                // But this compiles as a branch and ILP sucks (this data-dependent branch is long-latency and mispredicted often)
+                // Logically though, this is just checking for whether we're revisiting ourselves, so we can eliminate the branch as follows:
+                candidates[numCandidates].set(pos, lineId, (int32_t)fringeStart);
+                all_valid &= (array[lineId] != 0);  // no problem, if lineId == fringeId the line's already valid, so no harm done
+                numCandidates += (lineId != fringeId); // if lineId == fringeId, the cand we just wrote will be overwritten
+            }
+            fringeStart++;
         }
-        fringeStart++;
     }
 
     //Get best candidate (NOTE: This could be folded in the code above, but it's messy since we can expand more than zassoc elements)
@@ -216,3 +243,8 @@ void ZArray::postinsert(const Address lineAddr, const MemReq* req, uint32_t cand
     statSwaps.inc(swapArrayLen-1);
 }
 
+bool ZArray::serialize(Checkpoint& ckpt) {
+    ckpt.io(array, numLines);
+    ckpt.io(lookupArray, numLines);
+    return true;
+}
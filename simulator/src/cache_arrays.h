@@ -29,12 +29,19 @@
 #include "memory_hierarchy.h"
 #include "stats.h"
 
+class Checkpoint;
+
 /* General interface of a cache array. The array is a fixed-size associative container that
  * translates addresses to line IDs. A line ID represents the position of the tag. The other
  * cache components store tag data in non-associative arrays indexed by line ID.
  */
 class CacheArray : public GlobAlloc {
+    protected:
+        bool overflowing; //see overflowVictim()
+
     public:
+        CacheArray() : overflowing(false) {}
+
         /* Returns tag's ID if present, -1 otherwise. If updateReplacement is set, call the replacement policy's update() on the line accessed*/
         virtual int32_t lookup(const Address lineAddr, const MemReq* req, bool updateReplacement) = 0;
 
@@ -48,7 +55,17 @@ class CacheArray : public GlobAlloc {
          */
         virtual void postinsert(const Address lineAddr, const MemReq* req, uint32_t lineId) = 0;
 
+        /* Arrays that store lines in less space than a full line (see compressed_array.h) may run out of room in
+         * postinsert(), or in a lookup() that grows a line. Then isOverflowing() is set, and the cache must evict
+         * (through its CC) every line overflowVictim() returns, until it returns -1 and clears the flag.
+         */
+        inline bool isOverflowing() const {return overflowing;}
+        virtual int32_t overflowVictim(Address* wbLineAddr) {return -1;}
+
         virtual void initStats(AggregateStat* parent) {}
+
+        /* Saves or restores the tags; returns false if the array does not support checkpoints */
+        virtual bool serialize(Checkpoint& ckpt) {return false;}
 };
 
 class ReplPolicy;
@@ -71,6 +88,8 @@ class SetAssocArray : public CacheArray {
         int32_t lookup(const Address lineAddr, const MemReq* req, bool updateReplacement);
         uint32_t preinsert(const Address lineAddr, const MemReq* req, Address* wbLineAddr);
         void postinsert(const Address lineAddr, const MemReq* req, uint32_t candidate);
+
+        bool serialize(Checkpoint& ckpt);
 };
 
 /* The cache array that started this simulator :) */
@@ -106,6 +125,7 @@ class ZArray : public CacheArray {
         uint32_t getLastCandIdx() const {return lastCandIdx;}
 
         void initStats(AggregateStat* parentStat);
+        bool serialize(Checkpoint& ckpt);
 };
 
 // Simple wrapper classes and iterators for candidates in each case; simplifies replacement policy interface without sacrificing performance
@@ -0,0 +1,230 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "checkpoint.h"
+#include <sstream>
+#include "cache.h"
+#include "prefetcher.h"
+#include "ramulator_mem_ctrl.h"
+#include "zsim.h"
+
+/* File format: magic and version, then sections, each with its name, geometry, and the size of its data */
+
+static const char CKPT_MAGIC[8] = {'Z', 'S', 'I', 'M', 'C', 'K', 'P', 'T'};
+static const uint32_t CKPT_VERSION = 2; //2: sharers sized to the number of children (MESITopCC)
+
+Checkpoint::Checkpoint(const char* _path, bool _saving) : saving(_saving), path(_path), pos(0) {
+    f = fopen(_path, saving? "wb" : "rb");
+    if (!f) panic("Could not open checkpoint %s for %s", _path, saving? "writing" : "reading");
+
+    char magic[8];
+    uint32_t version = CKPT_VERSION;
+    if (saving) {
+        if (fwrite(CKPT_MAGIC, sizeof(magic), 1, f) != 1 || fwrite(&version, sizeof(version), 1, f) != 1) {
+            panic("Could not write checkpoint %s", _path);
+        }
+        return;
+    }
+
+    if (fread(magic, sizeof(magic), 1, f) != 1 || memcmp(magic, CKPT_MAGIC, sizeof(magic)) != 0) {
+        panic("%s is not a zsim checkpoint", _path);
+    }
+    if (fread(&version, sizeof(version), 1, f) != 1 || version != CKPT_VERSION) {
+        panic("Checkpoint %s has version %d, expected %d", _path, version, CKPT_VERSION);
+    }
+
+    //Index the sections; data is read on demand
+    while (true) {
+        uint32_t len;
+        if (fread(&len, sizeof(len), 1, f) != 1) break;  // EOF
+        std::string name(len, '\0');
+        Section s;
+        bool ok = fread(&name[0], 1, len, f) == len && fread(&len, sizeof(len), 1, f) == 1;
+        if (ok) {
+            s.geometry.resize(len);
+            ok = fread(&s.geometry[0], 1, len, f) == len && fread(&s.size, sizeof(s.size), 1, f) == 1;
+        }
+        if (!ok) panic("Checkpoint %s is truncated", _path);
+        s.offset = ftell(f);
+        sections[name] = s;
+        if (fseek(f, s.size, SEEK_CUR) != 0) panic("Checkpoint %s is truncated", _path);
+    }
+}
+
+Checkpoint::~Checkpoint() {
+    assert(curName.empty());
+    if (fclose(f) != 0) panic("Could not close checkpoint %s", path.c_str());
+}
+
+const char* Checkpoint::geometry(const std::string& name) const {
+    assert(!saving);
+    auto it = sections.find(name);
+    return (it == sections.end())? nullptr : it->second.geometry.c_str();
+}
+
+bool Checkpoint::beginSection(const std::string& name, const std::string& geometry) {
+    assert_msg(curName.empty(), "Checkpoint section %s not ended", curName.c_str());
+    buf.clear();
+    pos = 0;
+
+    if (saving) {
+        uint32_t len = name.size();
+        buf.insert(buf.end(), (const char*)&len, (const char*)&len + sizeof(len));
+        buf.insert(buf.end(), name.begin(), name.end());
+        len = geometry.size();
+        buf.insert(buf.end(), (const char*)&len, (const char*)&len + sizeof(len));
+        buf.insert(buf.end(), geometry.begin(), geometry.end());
+        uint64_t size = 0;  // filled in endSection()
+        buf.insert(buf.end(), (const char*)&size, (const char*)&size + sizeof(size));
+        pos = buf.size();
+        curName = name;
+        return true;
+    }
+
+    auto it = sections.find(name);
+    if (it == sections.end()) {
+        warn("Checkpoint %s has no %s, starting it cold", path.c_str(), name.c_str());
+        return false;
+    }
+    const Section& s = it->second;
+    if (s.geometry != geometry) {
+        warn("Checkpoint %s: %s was saved as [%s], now [%s]; starting it cold",
+                path.c_str(), name.c_str(), s.geometry.c_str(), geometry.c_str());
+        return false;
+    }
+    buf.resize(s.size);
+    if (fseek(f, s.offset, SEEK_SET) != 0 || (s.size && fread(&buf[0], s.size, 1, f) != 1)) {
+        panic("Could not read %s from checkpoint %s", name.c_str(), path.c_str());
+    }
+    curName = name;
+    return true;
+}
+
+void Checkpoint::endSection(bool commit) {
+    assert(!curName.empty());
+    if (saving) {
+        if (commit) {
+            uint64_t size = buf.size() - pos;
+            memcpy(&buf[pos - sizeof(size)], &size, sizeof(size));
+            if (fwrite(&buf[0], buf.size(), 1, f) != 1) panic("Could not write %s to checkpoint %s", curName.c_str(), path.c_str());
+        }
+    } else {
+        if (pos != buf.size()) panic("Checkpoint %s: %s has %ld bytes left over", path.c_str(), curName.c_str(), buf.size() - pos);
+    }
+    curName.clear();
+    buf.clear();
+}
+
+void Checkpoint::rawIO(void* data, size_t bytes) {
+    assert_msg(!curName.empty(), "Checkpoint I/O outside a section");
+    if (saving) {
+        buf.insert(buf.end(), (const char*)data, (const char*)data + bytes);
+    } else {
+        if (pos + bytes > buf.size()) panic("Checkpoint %s: %s is shorter than expected", path.c_str(), curName.c_str());
+        memcpy(data, &buf[pos], bytes);
+        pos += bytes;
+    }
+}
+
+/* CheckpointManager */
+
+CheckpointManager::CheckpointManager(const g_string& _savePath, const g_string& _restorePath, bool _exitAfterSave)
+    : savePath(_savePath), restorePath(_restorePath), exitAfterSave(_exitAfterSave), done(false) {}
+
+void CheckpointManager::addCache(Cache* cache, const g_string& geometry) {
+    caches.push_back(cache);
+    cacheGeometries.push_back(geometry);
+}
+
+void CheckpointManager::addPrefetcher(Prefetcher* pf) {
+    prefetchers.push_back(pf);
+}
+
+static std::string systemGeometry() {
+    std::stringstream ss;
+    ss << "lineSize " << zinfo->lineSize;
+    return ss.str();
+}
+
+static std::string cacheSection(Cache* cache) {
+    return std::string("cache ") + cache->getName();
+}
+
+void CheckpointManager::save() {
+    Checkpoint ckpt(savePath.c_str(), true);
+    ckpt.beginSection("system", systemGeometry());
+    ckpt.endSection();
+
+    for (uint32_t i = 0; i < caches.size(); i++) {
+        ckpt.beginSection(cacheSection(caches[i]), cacheGeometries[i].c_str());
+        bool ok = caches[i]->serialize(ckpt);
+        if (!ok) warn("Cache %s does not support checkpoints, not saved", caches[i]->getName());
+        ckpt.endSection(ok);
+    }
+    for (Prefetcher* pf : prefetchers) pf->serialize(ckpt);
+    for (Ramulator* r : *zinfo->ramulators) r->serialize(ckpt);
+    info("Saved checkpoint %s (%ld caches, %ld prefetchers, %ld memory controllers)",
+            savePath.c_str(), caches.size(), prefetchers.size(), zinfo->ramulators->size());
+}
+
+void CheckpointManager::restore() {
+    Checkpoint ckpt(restorePath.c_str(), false);
+    if (!ckpt.beginSection("system", systemGeometry())) {
+        warn("Checkpoint %s is incompatible, not restoring it", restorePath.c_str());
+        return;
+    }
+    ckpt.endSection();
+
+    //Caches are all-or-nothing: a partial hierarchy would break inclusion
+    bool cachesMatch = true;
+    for (uint32_t i = 0; i < caches.size(); i++) {
+        const char* geometry = ckpt.geometry(cacheSection(caches[i]));
+        if (!geometry || cacheGeometries[i] != geometry) {
+            warn("Checkpoint %s: %s is missing or was saved with a different geometry", restorePath.c_str(), caches[i]->getName());
+            cachesMatch = false;
+        }
+    }
+    if (cachesMatch) {
+        for (uint32_t i = 0; i < caches.size(); i++) {
+            ckpt.beginSection(cacheSection(caches[i]), cacheGeometries[i].c_str());
+            if (!caches[i]->serialize(ckpt)) panic("Cache %s does not support checkpoints, but one was saved", caches[i]->getName());
+            ckpt.endSection();
+        }
+    } else {
+        warn("Checkpoint %s: cache hierarchy does not match, caches start cold", restorePath.c_str());
+    }
+
+    for (Prefetcher* pf : prefetchers) pf->serialize(ckpt);
+    for (Ramulator* r : *zinfo->ramulators) r->serialize(ckpt);
+    info("Restored checkpoint %s", restorePath.c_str());
+}
+
+bool CheckpointManager::roiBegin() {
+    if (done) return false;
+    done = true;
+    if (!restorePath.empty()) restore();
+    if (!savePath.empty()) save();
+    return exitAfterSave;
+}
@@ -0,0 +1,128 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include <map>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <string.h>
+#include <vector>
+#include "g_std/g_string.h"
+#include "g_std/g_vector.h"
+#include "galloc.h"
+#include "log.h"
+
+/* Checkpoints of the warmed microarchitectural state at ROI begin.
+ *
+ * zsim cannot serialize a native process running under Pin, so a run that
+ * restores a checkpoint still fast-forwards through initialization (natively,
+ * which is cheap without sim.ffWarming), and loads the memory hierarchy state
+ * an earlier run saved when the ROI begins: cache tags, coherence and
+ * replacement state, prefetcher tables, and Ramulator's open rows.
+ * Nothing is in flight while the process is fast-forwarded, so there are no
+ * queues or events to save.
+ *
+ * A checkpoint file is a list of named sections, each tagged with a geometry
+ * string that covers everything its layout depends on. On restore, a section
+ * that is missing or whose geometry changed is skipped with a warning, and
+ * that structure starts cold. Caches are restored all-or-nothing, as inclusion
+ * and sharer lists tie the levels together; prefetchers and memory
+ * controllers are independent. Core models do not matter, so a checkpoint
+ * taken with one core type (or DRAM timing) can seed runs with another.
+ */
+class Checkpoint {
+    private:
+        struct Section {
+            std::string geometry;
+            long offset;
+            uint64_t size;
+        };
+
+        const bool saving;
+        const std::string path;
+        FILE* f;
+        std::map<std::string, Section> sections; //restoring
+        std::string curName;
+        std::vector<char> buf; //current section
+        size_t pos; //restoring, read position in buf
+
+        void rawIO(void* data, size_t bytes);
+
+    public:
+        Checkpoint(const char* _path, bool _saving);
+        ~Checkpoint();
+
+        bool isSaving() const {return saving;}
+
+        //Restoring: returns the geometry saved for name, or nullptr if there is no such section
+        const char* geometry(const std::string& name) const;
+
+        //Saving starts a new section. Restoring moves to an existing one, and returns false
+        //(with a warning) if it is missing or was saved with a different geometry.
+        bool beginSection(const std::string& name, const std::string& geometry);
+
+        //Saving writes the section out, unless commit is false (structure not checkpointable)
+        void endSection(bool commit = true);
+
+        //Saves or restores count objects, which must be trivially copyable and hold no pointers
+        template <typename T> void io(T* data, size_t count) {rawIO(data, count*sizeof(T));}
+
+        template <typename T> void io(T& v) {io(&v, 1);}
+};
+
+class Cache;
+class Prefetcher;
+
+/* Saves and restores checkpoints on the first ROI begin (sim.checkpoint.*) */
+class CheckpointManager : public GlobAlloc {
+    private:
+        g_string savePath; //empty if not saving
+        g_string restorePath; //empty if not restoring
+        bool exitAfterSave;
+        bool done;
+
+        g_vector<Cache*> caches;
+        g_vector<g_string> cacheGeometries;
+        g_vector<Prefetcher*> prefetchers;
+
+        void save();
+        void restore();
+
+    public:
+        CheckpointManager(const g_string& _savePath, const g_string& _restorePath, bool _exitAfterSave);
+
+        void addCache(Cache* cache, const g_string& geometry);
+        void addPrefetcher(Prefetcher* pf);
+
+        //Called with the ffLock held when a process reaches ROI begin in fast-forward, before
+        //it starts simulating. Only the first call does anything. Returns true if the
+        //simulation should end (sim.checkpoint.exitAfterSave).
+        bool roiBegin();
+};
+
+#endif  // CHECKPOINT_H_
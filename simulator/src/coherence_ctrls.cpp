@@ -27,19 +27,8 @@
 #include "cache.h"
 #include "network.h"
 
-/* Do a simple XOR block hash on address to determine its bank. Hacky for now,
- * should probably have a class that deals with this with a real hash function
- * (TODO)
- */
 uint32_t MESIBottomCC::getParentId(Address lineAddr) {
-    //Hash things a bit
-    uint32_t res = 0;
-    uint64_t tmp = lineAddr;
-    for (uint32_t i = 0; i < 4; i++) {
-        res ^= (uint32_t) ( ((uint64_t)0xffff) & tmp);
-        tmp = tmp >> 16;
-    }
-    return (res % parents.size());
+    return ParentBankId(lineAddr, parents.size());
 }
 
 
@@ -53,7 +42,7 @@ void MESIBottomCC::init(const g_vector<MemObject*>& _parents, Network* network,
 }
 
 
-uint64_t MESIBottomCC::processEviction(Address wbLineAddr, uint32_t lineId, bool lowerLevelWriteback, uint64_t cycle, uint32_t srcId) {
+uint64_t MESIBottomCC::processEviction(Address wbLineAddr, uint32_t lineId, bool lowerLevelWriteback, uint64_t cycle, uint32_t srcId, uint32_t flags) {
     MESIState* state = &array[lineId];
     if (lowerLevelWriteback) {
         //If this happens, when tcc issued the invalidations, it got a writeback. This means we have to do a PUTX, i.e. we have to transition to M if we are in E
@@ -67,13 +56,13 @@ uint64_t MESIBottomCC::processEviction(Address wbLineAddr, uint32_t lineId, bool
         case S:
         case E:
             {
-                MemReq req = {wbLineAddr, PUTS, selfId, state, cycle, &ccLock, *state, srcId, 0 /*no flags*/};
+                MemReq req = {wbLineAddr, PUTS, selfId, state, cycle, &ccLock, *state, srcId, flags};
                 respCycle = parents[getParentId(wbLineAddr)]->access(req);
             }
             break;
         case M:
             {
-                MemReq req = {wbLineAddr, PUTX, selfId, state, cycle, &ccLock, *state, srcId, 0 /*no flags*/};
+                MemReq req = {wbLineAddr, PUTX, selfId, state, cycle, &ccLock, *state, srcId, flags};
                 respCycle = parents[getParentId(wbLineAddr)]->access(req);
             }
             break;
@@ -84,16 +73,27 @@ uint64_t MESIBottomCC::processEviction(Address wbLineAddr, uint32_t lineId, bool
     return respCycle;
 }
 
-uint64_t MESIBottomCC::processAccess(Address lineAddr, uint32_t lineId, AccessType type, uint64_t cycle, uint32_t srcId, uint32_t flags) {
+uint64_t MESIBottomCC::processAccess(Address lineAddr, uint32_t lineId, AccessType type, uint64_t cycle, uint32_t srcId, uint32_t flags, Address pc) {
     uint64_t respCycle = cycle;
     MESIState* state = &array[lineId];
 
     if(bypass){
         uint32_t parentId = getParentId(lineAddr);
-        MemReq req = {lineAddr, type, selfId, state , cycle, &ccLock, *state, srcId, flags};
+        MemReq req = {lineAddr, type, selfId, state , cycle, &ccLock, *state, srcId, flags, pc};
         return parents[parentId]->access(req); // We send the request to the next level
     }
 
+    if (unlikely(flags & MemReq::WARM)) {
+        //Functional warming: same state transitions as below, but no profiling or network latency
+        if ((type == GETS && *state == I) || (type == GETX && (*state == I || *state == S))) {
+            MemReq req = {lineAddr, type, selfId, state, cycle, &ccLock, *state, srcId, flags, pc};
+            parents[getParentId(lineAddr)]->access(req);
+        } else if (type == PUTX || (type == GETX && *state == E)) {
+            *state = M;
+        }
+        return cycle;
+    }
+
     if(*state == S){
       sharedRequests.inc();
     }
@@ -115,7 +115,7 @@ uint64_t MESIBottomCC::processAccess(Address lineAddr, uint32_t lineId, AccessTy
         case GETS:
             if (*state == I) {
                 uint32_t parentId = getParentId(lineAddr);
-                MemReq req = {lineAddr, GETS, selfId, state, cycle, &ccLock, *state, srcId, flags};
+                MemReq req = {lineAddr, GETS, selfId, state, cycle, &ccLock, *state, srcId, flags, pc};
                 uint32_t nextLevelLat = parents[parentId]->access(req) - cycle;
                 uint32_t netLat = (network)? network->getRTT(cycle, nextLevelLat, name.c_str(), parents[parentId]->getName()) : 0;
                 profGETNextLevelLat.inc(nextLevelLat);
@@ -133,7 +133,7 @@ uint64_t MESIBottomCC::processAccess(Address lineAddr, uint32_t lineId, AccessTy
                 if (*state == I) profGETXMissIM.inc();
                 else profGETXMissSM.inc();
                 uint32_t parentId = getParentId(lineAddr);
-                MemReq req = {lineAddr, GETX, selfId, state, cycle, &ccLock, *state, srcId, flags};
+                MemReq req = {lineAddr, GETX, selfId, state, cycle, &ccLock, *state, srcId, flags, pc};
                 uint32_t nextLevelLat = parents[parentId]->access(req) - cycle;
                 uint32_t netLat = (network)? network->getRTT(cycle, nextLevelLat, name.c_str(), parents[parentId]->getName()) : 0;
                 profGETNextLevelLat.inc(nextLevelLat);
@@ -206,6 +206,26 @@ uint64_t MESIBottomCC::processNonInclusiveWriteback(Address lineAddr, AccessType
     return respCycle;
 }
 
+uint64_t MESIBottomCC::processNonTemporalWrite(Address lineAddr, int32_t lineId, bool lowerLevelWriteback, uint64_t cycle, uint32_t srcId, uint32_t flags) {
+    //A full-line write supersedes a copy we hold, even a dirty one. A partial write is merged at the memory controller
+    //with what memory holds, so dirty data must get there first
+    if ((flags & MemReq::NTPARTIAL) && lineId != -1 && (array[lineId] == M || (lowerLevelWriteback && array[lineId] != I))) {
+        cycle = processEviction(lineAddr, lineId, lowerLevelWriteback, cycle, srcId, flags & MemReq::WARM);
+        profNTWrWB.inc();
+    }
+
+    MESIState dummyState = I;
+    uint32_t parentId = getParentId(lineAddr);
+    MemReq req = {lineAddr, PUTX, selfId, &dummyState, cycle, &ccLock, dummyState, srcId, flags};
+    uint32_t nextLevelLat = parents[parentId]->access(req) - cycle;
+    uint32_t netLat = (network)? network->getRTT(cycle, nextLevelLat, name.c_str(), parents[parentId]->getName()) : 0;
+    profNTWr.inc();
+
+    //Check the state now: the parent unlocked us while it handled the write, so we may have been invalidated already
+    if (lineId != -1 && array[lineId] != I) array[lineId] = I;
+    return cycle + nextLevelLat + netLat;
+}
+
 
 /* MESITopCC implementation */
 
@@ -219,6 +239,10 @@ void MESITopCC::init(const g_vector<BaseCache*>& _children, Network* network, co
     for (uint32_t c = 0; c < children.size(); c++) {
         children[c] = _children[c];
     }
+    if (children.size() > 64) {
+        extraWords = (children.size() - 1)/64;
+        extraSharers = gm_calloc<uint64_t>((size_t)numLines*extraWords);
+    }
 }
 
 uint64_t MESITopCC::sendInvalidates(Address lineAddr, uint32_t lineId, InvType type, bool* reqWriteback, uint64_t cycle, uint32_t srcId) {
@@ -232,18 +256,22 @@ uint64_t MESITopCC::sendInvalidates(Address lineAddr, uint32_t lineId, InvType t
 
     uint64_t maxCycle = cycle; //keep maximum cycle only, we assume all invals are sent in parallel
     if (!e->isEmpty()) {
-        uint32_t numChildren = children.size();
         uint32_t sentInvs = 0;
-        for (uint32_t c = 0; c < numChildren; c++) {
-            if (e->sharers[c]) {
+        //Walk the set bits only, in child order
+        for (uint32_t w = 0; w <= extraWords; w++) {
+            uint64_t& word = (w == 0)? e->sharers : extraSharers[lineId*extraWords + w - 1];
+            uint64_t bits = word;
+            while (bits) {
+                uint32_t c = w*64 + __builtin_ctzll(bits);
+                bits &= bits - 1;
                 InvReq req = {lineAddr, type, reqWriteback, cycle, srcId};
                 uint64_t respCycle = children[c]->invalidate(req);
                 int32_t latency = MAX((int64_t)respCycle - (int64_t)cycle, 0);
                 respCycle += (network)? network->getRTT(cycle, latency, name.c_str(), children[c]->getName()) : 0;
                 maxCycle = MAX(respCycle, maxCycle);
-                if (type == INV) e->sharers[c] = false;
                 sentInvs++;
             }
+            if (type == INV) word = 0;
         }
         assert(sentInvs == e->numSharers);
         if (type == INV) {
@@ -262,7 +290,7 @@ uint64_t MESITopCC::sendInvalidates(Address lineAddr, uint32_t lineId, InvType t
 uint64_t MESITopCC::processEviction(Address wbLineAddr, uint32_t lineId, bool* reqWriteback, uint64_t cycle, uint32_t srcId) {
     if (nonInclusiveHack) {
         // Don't invalidate anything, just clear our entry
-        array[lineId].clear();
+        clearEntry(lineId);
         return cycle;
     } else {
         //Send down invalidates
@@ -278,15 +306,15 @@ uint64_t MESITopCC::processAccess(Address lineAddr, uint32_t lineId, AccessType
         case PUTX:
             assert(e->isExclusive());
             if (flags & MemReq::PUTX_KEEPEXCL) {
-                assert(e->sharers[childId]);
+                assert(isSharer(lineId, childId));
                 assert(*childState == M);
                 *childState = E; //they don't hold dirty data anymore
                 break; //don't remove from sharer set. It'll keep exclusive perms.
             }
             //note NO break in general
         case PUTS:
-            assert(e->sharers[childId]);
-            e->sharers[childId] = false;
+            assert(isSharer(lineId, childId));
+            setSharer(lineId, childId, false);
             e->numSharers--;
             *childState = I;
             break;
@@ -294,12 +322,12 @@ uint64_t MESITopCC::processAccess(Address lineAddr, uint32_t lineId, AccessType
             if (e->isEmpty() && haveExclusive && !(flags & MemReq::NOEXCL)) {
                 //Give in E state
                 e->exclusive = true;
-                e->sharers[childId] = true;
+                setSharer(lineId, childId, true);
                 e->numSharers = 1;
                 *childState = E;
             } else {
                 //Give in S state
-                assert(e->sharers[childId] == false);
+                assert(!isSharer(lineId, childId));
 
                 if (e->isExclusive()) {
                     //Downgrade the exclusive sharer
@@ -308,7 +336,7 @@ uint64_t MESITopCC::processAccess(Address lineAddr, uint32_t lineId, AccessType
 
                 assert_msg(!e->isExclusive(), "Can't have exclusivity here. isExcl=%d excl=%d numSharers=%d", e->isExclusive(), e->exclusive, e->numSharers);
 
-                e->sharers[childId] = true;
+                setSharer(lineId, childId, true);
                 e->numSharers++;
                 e->exclusive = false; //dsm: Must set, we're explicitly non-exclusive
                 *childState = S;
@@ -318,9 +346,9 @@ uint64_t MESITopCC::processAccess(Address lineAddr, uint32_t lineId, AccessType
             assert(haveExclusive); //the current cache better have exclusive access to this line
 
             // If child is in sharers list (this is an upgrade miss), take it out
-            if (e->sharers[childId]) {
+            if (isSharer(lineId, childId)) {
                 assert_msg(!e->isExclusive(), "Spurious GETX, childId=%d numSharers=%d isExcl=%d excl=%d", childId, e->numSharers, e->isExclusive(), e->exclusive);
-                e->sharers[childId] = false;
+                setSharer(lineId, childId, false);
                 e->numSharers--;
             }
 
@@ -328,7 +356,7 @@ uint64_t MESITopCC::processAccess(Address lineAddr, uint32_t lineId, AccessType
             respCycle = sendInvalidates(lineAddr, lineId, INV, inducedWriteback, cycle, srcId);
 
             // Set current sharer, mark exclusive
-            e->sharers[childId] = true;
+            setSharer(lineId, childId, true);
             e->numSharers++;
             e->exclusive = true;
 
@@ -343,6 +371,17 @@ uint64_t MESITopCC::processAccess(Address lineAddr, uint32_t lineId, AccessType
     return respCycle;
 }
 
+uint64_t MESITopCC::processNonTemporalWrite(Address lineAddr, uint32_t lineId, uint32_t childId, uint64_t cycle, uint32_t srcId, bool* reqWriteback) {
+    Entry* e = &array[lineId];
+    if (isSharer(lineId, childId)) {
+        setSharer(lineId, childId, false);
+        e->numSharers--;
+    }
+    uint64_t respCycle = sendInvalidates(lineAddr, lineId, INV, reqWriteback, cycle, srcId);
+    clearEntry(lineId);
+    return respCycle;
+}
+
 uint64_t MESITopCC::processInval(Address lineAddr, uint32_t lineId, InvType type, bool* reqWriteback, uint64_t cycle, uint32_t srcId) {
     if (type == FWD) {//if it's a FWD, we should be inclusive for now, so we must have the line, just invLat works
         assert(!nonInclusiveHack); //dsm: ask me if you see this failing and don't know why
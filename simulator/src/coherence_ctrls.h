@@ -26,8 +26,10 @@
 #ifndef COHERENCE_CTRLS_H_
 #define COHERENCE_CTRLS_H_
 
-#include <bitset>
 #include <string>
+#include <string.h>
+#include "bithacks.h"
+#include "checkpoint.h"
 #include "constants.h"
 #include "g_std/g_string.h"
 #include "g_std/g_vector.h"
@@ -51,6 +53,9 @@ class CC : public GlobAlloc {
         virtual bool startAccess(MemReq& req) = 0; //initial locking, address races; returns true if access should be skipped; may change req!
         virtual bool shouldAllocate(const MemReq& req) = 0; //called when we don't find req's lineAddr in the array
         virtual uint64_t processEviction(const MemReq& triggerReq, Address wbLineAddr, int32_t lineId, uint64_t startCycle) = 0; //called iff shouldAllocate returns true
+        //Called on every access, after the array eviction: makes room for req's line in state kept outside the array (e.g., a sparse
+        //directory), and returns when that finished, or 0 if nothing had to be done. Never coincides with an array eviction.
+        virtual uint64_t processDirEviction(const MemReq& req, int32_t lineId, uint64_t startCycle) {return 0;}
         virtual uint64_t processAccess(const MemReq& req, int32_t lineId, uint64_t startCycle, uint64_t* getDoneCycle = nullptr) = 0;
         virtual void endAccess(const MemReq& req) = 0;
 
@@ -61,6 +66,9 @@ class CC : public GlobAlloc {
         //Repl policy interface
         virtual uint32_t numSharers(uint32_t lineId) = 0;
         virtual bool isValid(uint32_t lineId) = 0;
+
+        //Checkpoints: saves or restores the per-line state; returns false if unsupported
+        virtual bool serialize(Checkpoint& ckpt) {return false;}
 };
 
 
@@ -78,6 +86,21 @@ class CC : public GlobAlloc {
 class Cache;
 class Network;
 
+/* Do a simple XOR block hash on address to determine its bank. Hacky for now,
+ * should probably have a class that deals with this with a real hash function
+ * (TODO)
+ */
+static inline uint32_t ParentBankId(Address lineAddr, uint32_t numParents) {
+    //Hash things a bit
+    uint32_t res = 0;
+    uint64_t tmp = lineAddr;
+    for (uint32_t i = 0; i < 4; i++) {
+        res ^= (uint32_t) ( ((uint64_t)0xffff) & tmp);
+        tmp = tmp >> 16;
+    }
+    return (res % numParents);
+}
+
 /* NOTE: To avoid virtual function overheads, there is no BottomCC interface, since we only have a MESI controller for now */
 
 class MESIBottomCC : public GlobAlloc {
@@ -97,6 +120,7 @@ class MESIBottomCC : public GlobAlloc {
         //Counter profWBIncl, profWBCoh /* writebacks due to inclusion or coherence, received from downstream, does not include PUTS */;
         // TODO: Measuring writebacks is messy, do if needed
         Counter profGETNextLevelLat, profGETNetLat;
+        Counter profNTWr, profNTWrWB;
 
         bool nonInclusiveHack;
         bool bypass;
@@ -136,6 +160,8 @@ class MESIBottomCC : public GlobAlloc {
             profGETNextLevelLat.init("latGETnl", "GET request latency on next level");
             profGETNetLat.init("latGETnet", "GET request latency on network to next level");
             sharedRequests.init("sharedRequests", "Shared Requests");
+            profNTWr.init("ntWr", "Non-temporal writes forwarded to the next level");
+            profNTWrWB.init("ntWrWB", "Dirty lines written back ahead of partial non-temporal writes");
             
             parentStat->append(&profGETSHit);
             parentStat->append(&profGETXHit);
@@ -150,11 +176,13 @@ class MESIBottomCC : public GlobAlloc {
             parentStat->append(&profGETNextLevelLat);
             parentStat->append(&profGETNetLat);
             parentStat->append(&sharedRequests);
+            parentStat->append(&profNTWr);
+            parentStat->append(&profNTWrWB);
         }
 
-        uint64_t processEviction(Address wbLineAddr, uint32_t lineId, bool lowerLevelWriteback, uint64_t cycle, uint32_t srcId);
+        uint64_t processEviction(Address wbLineAddr, uint32_t lineId, bool lowerLevelWriteback, uint64_t cycle, uint32_t srcId, uint32_t flags);
 
-        uint64_t processAccess(Address lineAddr, uint32_t lineId, AccessType type, uint64_t cycle, uint32_t srcId, uint32_t flags);
+        uint64_t processAccess(Address lineAddr, uint32_t lineId, AccessType type, uint64_t cycle, uint32_t srcId, uint32_t flags, Address pc);
 
         void processWritebackOnAccess(Address lineAddr, uint32_t lineId, AccessType type);
 
@@ -162,6 +190,10 @@ class MESIBottomCC : public GlobAlloc {
 
         uint64_t processNonInclusiveWriteback(Address lineAddr, AccessType type, uint64_t cycle, MESIState* state, uint32_t srcId, uint32_t flags);
 
+        //Non-temporal write (MemReq::NONTEMPORAL): forwarded to the parent first, then our copy (if lineId != -1) is dropped.
+        //Partial writes (MemReq::NTPARTIAL) first write back dirty data, ours or our children's (lowerLevelWriteback)
+        uint64_t processNonTemporalWrite(Address lineAddr, int32_t lineId, bool lowerLevelWriteback, uint64_t cycle, uint32_t srcId, uint32_t flags);
+
         inline void lock() {
             futex_lock(&ccLock);
         }
@@ -177,6 +209,10 @@ class MESIBottomCC : public GlobAlloc {
 
         //Could extend with isExclusive, isDirty, etc, but not needed for now.
 
+        inline void serialize(Checkpoint& ckpt) {
+            ckpt.io(array, numLines);
+        }
+
     private:
         uint32_t getParentId(Address lineAddr);
 };
@@ -185,15 +221,20 @@ class MESIBottomCC : public GlobAlloc {
 //Implements the "top" part: Keeps directory information, handles downgrades and invalidates
 class MESITopCC : public GlobAlloc {
     private:
+        /* Sharers are a bit vector sized to the actual number of children: the
+         * first 64 children are tracked inline, and any others in extraSharers,
+         * extraWords words per line. Most caches have at most 64 children, so
+         * an entry is 16 bytes instead of MAX_CACHE_CHILDREN bits.
+         */
         struct Entry {
+            uint64_t sharers; //children 0-63
             uint32_t numSharers;
-            std::bitset<MAX_CACHE_CHILDREN> sharers;
             bool exclusive;
 
             void clear() {
                 exclusive = false;
                 numSharers = 0;
-                sharers.reset();
+                sharers = 0;
             }
 
             bool isEmpty() {
@@ -206,6 +247,8 @@ class MESITopCC : public GlobAlloc {
         };
 
         Entry* array;
+        uint64_t* extraSharers; //children 64 and up, numLines*extraWords; nullptr if there are at most 64 children
+        uint32_t extraWords;
         g_vector<BaseCache*> children;
         uint32_t numLines;
         std::string name;
@@ -219,8 +262,9 @@ class MESITopCC : public GlobAlloc {
         PAD();
 
     public:
-        MESITopCC(uint32_t _numLines, bool _nonInclusiveHack, bool _bypass) : numLines(_numLines), nonInclusiveHack(_nonInclusiveHack), bypass(_bypass) {
-            array = gm_calloc<Entry>(numLines);
+        MESITopCC(uint32_t _numLines, bool _nonInclusiveHack, bool _bypass) : extraSharers(nullptr), extraWords(0),
+                numLines(_numLines), nonInclusiveHack(_nonInclusiveHack), bypass(_bypass) {
+            array = gm_calloc<Entry>(numLines); //extraSharers is allocated in init(), once we know the children
             for (uint32_t i = 0; i < numLines; i++) {
                 array[i].clear();
             }
@@ -237,6 +281,10 @@ class MESITopCC : public GlobAlloc {
 
         uint64_t processInval(Address lineAddr, uint32_t lineId, InvType type, bool* reqWriteback, uint64_t cycle, uint32_t srcId);
 
+        //Non-temporal write from childId: invalidates all other sharers and clears the entry (the requester drops its own copy).
+        //Sets *reqWriteback if a sharer had dirty data
+        uint64_t processNonTemporalWrite(Address lineAddr, uint32_t lineId, uint32_t childId, uint64_t cycle, uint32_t srcId, bool* reqWriteback);
+
         inline void lock() {
             futex_lock(&ccLock);
         }
@@ -250,7 +298,32 @@ class MESITopCC : public GlobAlloc {
             return array[lineId].numSharers;
         }
 
+        inline void serialize(Checkpoint& ckpt) {
+            ckpt.io(array, numLines);
+            if (extraSharers) ckpt.io(extraSharers, numLines*extraWords);
+        }
+
     private:
+        inline uint64_t& sharerWord(uint32_t lineId, uint32_t childId) {
+            if (likely(childId < 64)) return array[lineId].sharers;
+            return extraSharers[lineId*extraWords + childId/64 - 1];
+        }
+
+        inline bool isSharer(uint32_t lineId, uint32_t childId) {
+            return (sharerWord(lineId, childId) >> (childId % 64)) & 1;
+        }
+
+        inline void setSharer(uint32_t lineId, uint32_t childId, bool sharer) {
+            uint64_t bit = 1ul << (childId % 64);
+            uint64_t& word = sharerWord(lineId, childId);
+            word = sharer? (word | bit) : (word & ~bit);
+        }
+
+        inline void clearEntry(uint32_t lineId) {
+            array[lineId].clear();
+            if (extraSharers) memset(&extraSharers[lineId*extraWords], 0, extraWords*sizeof(uint64_t));
+        }
+
         uint64_t sendInvalidates(Address lineAddr, uint32_t lineId, InvType type, bool* reqWriteback, uint64_t cycle, uint32_t srcId);
 };
 
@@ -338,6 +411,8 @@ class MESICC : public CC {
         bool shouldAllocate(const MemReq& req) {
             if ((req.type == GETS) || (req.type == GETX)) {
                 return true;
+            } else if (req.is(MemReq::NONTEMPORAL)) {
+                return false; //streaming writes never allocate
             } else {
                 assert((req.type == PUTS) || (req.type == PUTX));
                 if (!nonInclusiveHack) {
@@ -351,12 +426,28 @@ class MESICC : public CC {
         uint64_t processEviction(const MemReq& triggerReq, Address wbLineAddr, int32_t lineId, uint64_t startCycle) {
             bool lowerLevelWriteback = false;
             uint64_t evCycle = tcc->processEviction(wbLineAddr, lineId, &lowerLevelWriteback, startCycle, triggerReq.srcId); //1. if needed, send invalidates/downgrades to lower level
-            evCycle = bcc->processEviction(wbLineAddr, lineId, lowerLevelWriteback, evCycle, triggerReq.srcId); //2. if needed, write back line to upper level
+            evCycle = bcc->processEviction(wbLineAddr, lineId, lowerLevelWriteback, evCycle, triggerReq.srcId, triggerReq.flags & MemReq::WARM); //2. if needed, write back line to upper level
             return evCycle;
         }
 
         uint64_t processAccess(const MemReq& req, int32_t lineId, uint64_t startCycle, uint64_t* getDoneCycle = nullptr) {
             uint64_t respCycle = startCycle;
+            //Full-line non-temporal writes go to memory before any level drops its copy, so no level can refetch stale data in
+            //between; dirty data below is superseded by the write. Partial ones merge with memory, so they first recall dirty
+            //data from the children, which goes to memory ahead of the write
+            if (unlikely(req.is(MemReq::NONTEMPORAL))) {
+                assert(req.type == PUTX);
+                bool lowerLevelWriteback = false;
+                if (req.is(MemReq::NTPARTIAL)) {
+                    if (lineId != -1) respCycle = tcc->processNonTemporalWrite(req.lineAddr, lineId, req.childId, startCycle, req.srcId, &lowerLevelWriteback);
+                    respCycle = bcc->processNonTemporalWrite(req.lineAddr, lineId, lowerLevelWriteback, respCycle, req.srcId, req.flags);
+                } else {
+                    respCycle = bcc->processNonTemporalWrite(req.lineAddr, lineId, false, startCycle, req.srcId, req.flags);
+                    if (lineId != -1) respCycle = MAX(respCycle, tcc->processNonTemporalWrite(req.lineAddr, lineId, req.childId, startCycle, req.srcId, &lowerLevelWriteback));
+                }
+                if (getDoneCycle) *getDoneCycle = respCycle;
+                return respCycle;
+            }
             //Handle non-inclusive writebacks by bypassing
             //NOTE: Most of the time, these are due to evictions, so the line is not there. But the second condition can trigger in NUCA-initiated
             //invalidations. The alternative with this would be to capture these blocks, since we have space anyway. This is so rare is doesn't matter,
@@ -373,7 +464,7 @@ class MESICC : public CC {
                 uint32_t flags = req.flags & ~MemReq::PREFETCH; //always clear PREFETCH, this flag cannot propagate up
 
                 //if needed, fetch line or upgrade miss from upper level
-                respCycle = bcc->processAccess(req.lineAddr, lineId, req.type, startCycle, req.srcId, flags);
+                respCycle = bcc->processAccess(req.lineAddr, lineId, req.type, startCycle, req.srcId, flags, req.pc);
                 if (getDoneCycle) *getDoneCycle = respCycle;
                 if (!isPrefetch) { //prefetches only touch bcc; the demand request from the core will pull the line to lower level
                     //At this point, the line is in a good state w.r.t. upper levels
@@ -416,6 +507,12 @@ class MESICC : public CC {
         //Repl policy interface
         uint32_t numSharers(uint32_t lineId) {return tcc->numSharers(lineId);}
         bool isValid(uint32_t lineId) {return bcc->isValid(lineId);}
+
+        bool serialize(Checkpoint& ckpt) {
+            tcc->serialize(ckpt);
+            bcc->serialize(ckpt);
+            return true;
+        }
 };
 
 // Terminal CC, i.e., without children --- accepts GETS/X, but not PUTS/X
@@ -444,7 +541,7 @@ class MESITerminalCC : public CC {
 
         //Access methods
         bool startAccess(MemReq& req) {
-            assert((req.type == GETS) || (req.type == GETX)); //no puts!
+            assert((req.type == GETS) || (req.type == GETX) || (req.type == PUTX && req.is(MemReq::NONTEMPORAL))); //no puts, except write-combining flushes
 
             /* Child should be locked when called. We do hand-over-hand locking when going
              * down (which is why we require the lock), but not when going up, opening the
@@ -464,20 +561,23 @@ class MESITerminalCC : public CC {
         }
 
         bool shouldAllocate(const MemReq& req) {
-            return true;
+            return !req.is(MemReq::NONTEMPORAL);
         }
 
         uint64_t processEviction(const MemReq& triggerReq, Address wbLineAddr, int32_t lineId, uint64_t startCycle) {
             bool lowerLevelWriteback = false;
-            uint64_t endCycle = bcc->processEviction(wbLineAddr, lineId, lowerLevelWriteback, startCycle, triggerReq.srcId); //2. if needed, write back line to upper level
+            uint64_t endCycle = bcc->processEviction(wbLineAddr, lineId, lowerLevelWriteback, startCycle, triggerReq.srcId, triggerReq.flags & MemReq::WARM); //2. if needed, write back line to upper level
             return endCycle;  // critical path unaffected, but TimingCache needs it
         }
 
         uint64_t processAccess(const MemReq& req, int32_t lineId, uint64_t startCycle,  uint64_t* getDoneCycle = nullptr) {
+            if (unlikely(req.is(MemReq::NONTEMPORAL))) {
+                return bcc->processNonTemporalWrite(req.lineAddr, lineId, false, startCycle, req.srcId, req.flags);
+            }
             assert(lineId != -1);
             assert(!getDoneCycle);
             //if needed, fetch line or upgrade miss from upper level
-            uint64_t respCycle = bcc->processAccess(req.lineAddr, lineId, req.type, startCycle, req.srcId, req.flags);
+            uint64_t respCycle = bcc->processAccess(req.lineAddr, lineId, req.type, startCycle, req.srcId, req.flags, req.pc);
             //at this point, the line is in a good state w.r.t. upper levels
             return respCycle;
         }
@@ -504,6 +604,11 @@ class MESITerminalCC : public CC {
         //Repl policy interface
         uint32_t numSharers(uint32_t lineId) {return 0;} //no sharers
         bool isValid(uint32_t lineId) {return bcc->isValid(lineId);}
+
+        bool serialize(Checkpoint& ckpt) {
+            bcc->serialize(ckpt);
+            return true;
+        }
 };
 
 #endif  // COHERENCE_CTRLS_H_
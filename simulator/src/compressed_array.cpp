@@ -0,0 +1,139 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "compressed_array.h"
+#include <string.h>
+#include "bithacks.h"
+#include "checkpoint.h"
+#include "coherence_ctrls.h"
+#include "compressors.h"
+#include "constants.h"
+#include "data_shadow.h"
+
+CompressedSetAssocArray::CompressedSetAssocArray(uint32_t _numLines, uint32_t _assoc, uint32_t _dataWays, ReplPolicy* _rp, HashFamily* _hf,
+        Compressor* _compressor, DataShadow* _shadow, uint32_t _lineSize)
+    : SetAssocArray(_numLines, _assoc, _rp, _hf), compressor(_compressor), shadow(_shadow), cc(nullptr), lineSize(_lineSize),
+      setSegments(_dataWays*(_lineSize/SEGMENT_BYTES)), useClock(0), overflowLine(-1)
+{
+    assert_msg(lineSize % SEGMENT_BYTES == 0, "line size must be a multiple of %d bytes", SEGMENT_BYTES);
+    assert_msg(_dataWays && _dataWays <= assoc, "compressed arrays need 1 to %d data ways, but you specified %d", assoc, _dataWays);
+    lineSegs = gm_calloc<uint16_t>(numLines);
+    lastUse = gm_calloc<uint64_t>(numLines);
+}
+
+int32_t CompressedSetAssocArray::lookup(const Address lineAddr, const MemReq* req, bool updateReplacement) {
+    int32_t lineId = SetAssocArray::lookup(lineAddr, req, updateReplacement);
+    if (lineId != -1 && req) {
+        if (updateReplacement) lastUse[lineId] = ++useClock;
+        bool valid = cc->isValid(lineId);
+        if (req->type == PUTX && valid && !req->is(MemReq::NONTEMPORAL)) {
+            resize(lineId, true); //takes the written-back values
+        } else if ((req->type == GETS || req->type == GETX) && !valid) {
+            resize(lineId, false); //refetched into a tag that kept its address
+        }
+    }
+    return lineId;
+}
+
+void CompressedSetAssocArray::postinsert(const Address lineAddr, const MemReq* req, uint32_t candidate) {
+    SetAssocArray::postinsert(lineAddr, req, candidate);
+    lastUse[candidate] = ++useClock;
+    resize(candidate, false);
+}
+
+void CompressedSetAssocArray::resize(uint32_t lineId, bool capture) {
+    uint8_t line[MAX_LINE_SIZE];
+    assert(lineSize <= MAX_LINE_SIZE);
+    bool known = capture? shadow->capture(array[lineId], line) : shadow->read(array[lineId], line);
+    uint32_t bytes = known? compressor->compress(line, lineSize) : lineSize;
+    uint32_t segs = MAX(1u, (bytes + SEGMENT_BYTES - 1)/SEGMENT_BYTES);
+    lineSegs[lineId] = segs;
+    profSized.inc();
+    profSizedSegments.inc(segs);
+
+    //The line is not valid yet on fills, so usedSegments() counts it explicitly
+    overflowLine = lineId;
+    uint32_t first = lineId - lineId % assoc;
+    if (usedSegments(first) > setSegments) {
+        overflowing = true;
+    } else {
+        overflowLine = -1;
+    }
+}
+
+uint32_t CompressedSetAssocArray::usedSegments(uint32_t first) const {
+    uint32_t used = 0;
+    for (uint32_t id = first; id < first + assoc; id++) {
+        if ((int32_t)id == overflowLine || cc->isValid(id)) used += lineSegs[id];
+    }
+    return used;
+}
+
+int32_t CompressedSetAssocArray::overflowVictim(Address* wbLineAddr) {
+    if (!overflowing) return -1;
+    assert(overflowLine != -1);
+    uint32_t first = overflowLine - overflowLine % assoc;
+    int32_t victim = -1;
+    if (usedSegments(first) > setSegments) {
+        for (uint32_t id = first; id < first + assoc; id++) {
+            if ((int32_t)id == overflowLine || !lineSegs[id] || !cc->isValid(id)) continue;
+            if (victim == -1 || lastUse[id] < lastUse[victim]) victim = id;
+        }
+    }
+
+    if (victim == -1) { //fits now (a line alone always fits)
+        overflowing = false;
+        overflowLine = -1;
+        return -1;
+    }
+    lineSegs[victim] = 0; //the cache invalidates it, but the tag stays
+    *wbLineAddr = array[victim];
+    profOverflowEvictions.inc();
+    return victim;
+}
+
+void CompressedSetAssocArray::initStats(AggregateStat* parentStat) {
+    AggregateStat* arrayStat = new AggregateStat();
+    arrayStat->init("array", "Compressed array stats");
+    profSized.init("sized", "Lines sized from their values (fills and dirty writebacks)"); arrayStat->append(&profSized);
+    profSizedSegments.init("sizedSegs", "Segments of the sized lines"); arrayStat->append(&profSizedSegments);
+    profOverflowEvictions.init("ovEvictions", "Lines evicted because their set ran out of data space"); arrayStat->append(&profOverflowEvictions);
+    auto validStat = makeLambdaStat([this]() {
+        uint64_t valid = 0;
+        for (uint32_t id = 0; id < numLines; id++) valid += cc->isValid(id);
+        return valid;
+    });
+    validStat->init("validLines", "Valid lines at dump time (effective capacity)");
+    arrayStat->append(validStat);
+    parentStat->append(arrayStat);
+}
+
+bool CompressedSetAssocArray::serialize(Checkpoint& ckpt) {
+    SetAssocArray::serialize(ckpt);
+    ckpt.io(lineSegs, numLines);
+    ckpt.io(lastUse, numLines);
+    ckpt.io(useClock);
+    return true;
+}
@@ -0,0 +1,80 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef COMPRESSED_ARRAY_H_
+#define COMPRESSED_ARRAY_H_
+
+#include "cache_arrays.h"
+
+class CC;
+class Compressor;
+class DataShadow;
+
+/* Set-associative array that stores lines compressed, like the decoupled
+ * variable-segment caches of Alameldeen and Wood (ISCA 2004). Each set has
+ * more tags than its data space holds uncompressed lines, and lines take
+ * 8-byte segments of that space. A line is sized from its values (see
+ * data_shadow.h) when it is inserted, refetched into an invalidated tag, or
+ * written back dirty. When the valid lines of a set need more segments than
+ * it has, the cache evicts its least recently used lines until they fit (see
+ * CacheArray::overflowVictim()). Decompression latency is not modeled; fold
+ * it into the cache's latency.
+ */
+class CompressedSetAssocArray : public SetAssocArray {
+    private:
+        static const uint32_t SEGMENT_BYTES = 8;
+
+        Compressor* compressor;
+        DataShadow* shadow;
+        CC* cc; //to know which lines are valid
+        const uint32_t lineSize;
+        const uint32_t setSegments; //data space of each set
+        uint16_t* lineSegs; //segments used by each line
+        uint64_t* lastUse; //orders overflow evictions
+        uint64_t useClock;
+        int32_t overflowLine; //line that grew or was inserted, which must stay while overflowing
+
+        Counter profSized;
+        Counter profSizedSegments;
+        Counter profOverflowEvictions;
+
+    public:
+        CompressedSetAssocArray(uint32_t _numLines, uint32_t _assoc, uint32_t _dataWays, ReplPolicy* _rp, HashFamily* _hf,
+                Compressor* _compressor, DataShadow* _shadow, uint32_t _lineSize);
+        void setCC(CC* _cc) {cc = _cc;}
+
+        int32_t lookup(const Address lineAddr, const MemReq* req, bool updateReplacement);
+        void postinsert(const Address lineAddr, const MemReq* req, uint32_t candidate);
+        int32_t overflowVictim(Address* wbLineAddr);
+
+        void initStats(AggregateStat* parentStat);
+        bool serialize(Checkpoint& ckpt);
+
+    private:
+        void resize(uint32_t lineId, bool capture);
+        uint32_t usedSegments(uint32_t first) const; //valid lines of the set starting at first, plus overflowLine
+};
+
+#endif  // COMPRESSED_ARRAY_H_
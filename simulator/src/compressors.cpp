@@ -0,0 +1,176 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "compressors.h"
+#include <string.h>
+#include "log.h"
+
+/* BDI */
+
+static inline uint64_t loadValue(const uint8_t* p, uint32_t bytes) {
+    uint64_t v = 0;
+    memcpy(&v, p, bytes); //little-endian, like the values
+    return v;
+}
+
+//Interprets the low bits of v as a signed value
+static inline int64_t signExtend(uint64_t v, uint32_t bits) {
+    if (bits == 64) return (int64_t)v;
+    uint64_t m = 1ul << (bits - 1);
+    v &= (1ul << bits) - 1;
+    return (int64_t)((v ^ m) - m);
+}
+
+static inline bool fitsSigned(int64_t v, uint32_t bits) {
+    return signExtend(v, bits) == v;
+}
+
+//True if every baseBytes value of the line is a deltaBytes delta from zero or from a single base
+static bool fitsBaseDelta(const uint8_t* line, uint32_t lineSize, uint32_t baseBytes, uint32_t deltaBytes) {
+    uint32_t bits = 8*baseBytes;
+    uint32_t deltaBits = 8*deltaBytes;
+    bool haveBase = false;
+    uint64_t base = 0;
+    for (uint32_t i = 0; i < lineSize; i += baseBytes) {
+        uint64_t v = loadValue(line + i, baseBytes);
+        if (fitsSigned(signExtend(v, bits), deltaBits)) continue; //immediate, delta from zero
+        if (!haveBase) {
+            base = v;
+            haveBase = true;
+        }
+        if (!fitsSigned(signExtend(v - base, bits), deltaBits)) return false; //deltas wrap around like baseBytes values
+    }
+    return true;
+}
+
+uint32_t BDICompressor::compress(const uint8_t* line, uint32_t lineSize) {
+    assert(lineSize % 8 == 0);
+    uint64_t first = loadValue(line, 8);
+    bool repeated = true;
+    for (uint32_t i = 8; i < lineSize && repeated; i += 8) repeated = (loadValue(line + i, 8) == first);
+    if (repeated) return first? 8 : 1;
+
+    //base bytes, delta bytes
+    static const uint32_t encodings[][2] = {{8, 1}, {8, 2}, {8, 4}, {4, 1}, {4, 2}, {2, 1}};
+    uint32_t best = lineSize;
+    for (auto& enc : encodings) {
+        uint32_t size = enc[0] + (lineSize/enc[0])*enc[1];
+        if (size < best && fitsBaseDelta(line, lineSize, enc[0], enc[1])) best = size;
+    }
+    return best;
+}
+
+/* FPC */
+
+uint32_t FPCCompressor::compress(const uint8_t* line, uint32_t lineSize) {
+    assert(lineSize % 4 == 0);
+    uint32_t words = lineSize/4;
+    uint32_t bits = 0;
+    uint32_t i = 0;
+    while (i < words) {
+        uint32_t w = (uint32_t)loadValue(line + 4*i, 4);
+        bits += 3; //prefix
+        if (w == 0) {
+            uint32_t run = 1;
+            while (run < 8 && i + run < words && loadValue(line + 4*(i + run), 4) == 0) run++;
+            bits += 3; //run length
+            i += run;
+            continue;
+        }
+        int64_t sw = signExtend(w, 32);
+        uint32_t lo = w & 0xffff;
+        uint32_t hi = w >> 16;
+        if (fitsSigned(sw, 4)) {
+            bits += 4;
+        } else if (fitsSigned(sw, 8)) {
+            bits += 8;
+        } else if (fitsSigned(sw, 16)) {
+            bits += 16;
+        } else if (lo == 0) {
+            bits += 16; //halfword padded with a zero halfword
+        } else if (fitsSigned(signExtend(lo, 16), 8) && fitsSigned(signExtend(hi, 16), 8)) {
+            bits += 16; //two sign-extended bytes
+        } else if (w == (w & 0xff)*0x01010101u) {
+            bits += 8; //repeated bytes
+        } else {
+            bits += 32;
+        }
+        i++;
+    }
+    uint32_t bytes = (bits + 7)/8;
+    return (bytes < lineSize)? bytes : lineSize;
+}
+
+/* C-Pack */
+
+uint32_t CPackCompressor::compress(const uint8_t* line, uint32_t lineSize) {
+    assert(lineSize % 4 == 0);
+    const uint32_t dictSize = 16;
+    uint32_t dict[dictSize];
+    uint32_t dictEntries = 0;
+    uint32_t dictNext = 0; //FIFO
+    uint32_t bits = 0;
+    for (uint32_t i = 0; i < lineSize; i += 4) {
+        uint32_t w = (uint32_t)loadValue(line + i, 4);
+        if (w == 0) {
+            bits += 2; //zzzz
+            continue;
+        }
+
+        //Longest match in the dictionary, in upper bytes
+        uint32_t matchBytes = 0;
+        for (uint32_t d = 0; d < dictEntries && matchBytes < 4; d++) {
+            uint32_t x = w ^ dict[d];
+            uint32_t m = (x == 0)? 4 : (x >> 8 == 0)? 3 : (x >> 16 == 0)? 2 : 0;
+            if (m > matchBytes) matchBytes = m;
+        }
+
+        bool push;
+        if (matchBytes == 4) {
+            bits += 2 + 4; //mmmm
+            push = false;
+        } else if (w >> 8 == 0) {
+            bits += 4 + 8; //zzzx
+            push = false;
+        } else if (matchBytes == 3) {
+            bits += 4 + 4 + 8; //mmmx
+            push = true;
+        } else if (matchBytes == 2) {
+            bits += 4 + 4 + 16; //mmxx
+            push = true;
+        } else {
+            bits += 2 + 32; //xxxx
+            push = true;
+        }
+
+        if (push) {
+            dict[dictNext] = w;
+            dictNext = (dictNext + 1) % dictSize;
+            if (dictEntries < dictSize) dictEntries++;
+        }
+    }
+    uint32_t bytes = (bits + 7)/8;
+    return (bytes < lineSize)? bytes : lineSize;
+}
@@ -0,0 +1,76 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef COMPRESSORS_H_
+#define COMPRESSORS_H_
+
+#include <stdint.h>
+#include "galloc.h"
+
+/* Cache-line compression algorithms. Each one computes the size a line
+ * compresses to from its values (see data_shadow.h); nothing is actually
+ * stored compressed. Sizes count the compressed data and the per-word
+ * encodings, but not the per-line metadata (e.g., the encoding type), which
+ * hardware keeps with the tag. Lines must be a multiple of 8 bytes.
+ */
+class Compressor : public GlobAlloc {
+    public:
+        virtual ~Compressor() {}
+
+        //Bytes the line compresses to, lineSize if it does not compress. Must be thread-safe
+        virtual uint32_t compress(const uint8_t* line, uint32_t lineSize) = 0;
+};
+
+/* Base-Delta-Immediate (Pekhimenko et al., PACT 2012). The line is split in
+ * 8, 4 or 2-byte values, each stored as a 1, 2 or 4-byte delta from a base
+ * (the first value that is not a small immediate) or from zero. Zero and
+ * repeated-value lines are special-cased. Takes the smallest encoding that fits.
+ */
+class BDICompressor : public Compressor {
+    public:
+        uint32_t compress(const uint8_t* line, uint32_t lineSize);
+};
+
+/* Frequent Pattern Compression (Alameldeen and Wood, ISCA 2004). Each 32-bit
+ * word gets a 3-bit prefix and 0-32 data bits: zero runs of up to 8 words,
+ * 4, 8 and 16-bit sign-extended values, halfwords padded with zeros, two
+ * sign-extended bytes, repeated bytes, or the uncompressed word.
+ */
+class FPCCompressor : public Compressor {
+    public:
+        uint32_t compress(const uint8_t* line, uint32_t lineSize);
+};
+
+/* C-Pack (Chen et al., IEEE TVLSI 2010). Each 32-bit word is a zero word, a
+ * full or partial (upper 2 or 3 bytes) match against a 16-entry FIFO
+ * dictionary of earlier words in the line, a word with 3 zero upper bytes,
+ * or uncompressed. Unmatched and partially-matched words enter the dictionary.
+ */
+class CPackCompressor : public Compressor {
+    public:
+        uint32_t compress(const uint8_t* line, uint32_t lineSize);
+};
+
+#endif  // COMPRESSORS_H_
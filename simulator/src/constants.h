@@ -32,7 +32,7 @@
 // PIN 2.9 (rev39599) can't do more than 2048 threads...
 #define MAX_THREADS (2048)
 
-// How many children caches can each cache track? Note each bank is a separate child. This impacts sharer bit-vector sizes.
+// How many children caches can each cache track? Note each bank is a separate child. Sharer bit-vectors are sized to the actual number of children (see MESITopCC), so this is only a sanity limit.
 #define MAX_CACHE_CHILDREN (2048)
 //#define MAX_CACHE_CHILDREN (1024)
 
@@ -44,4 +44,7 @@
 //If you use it, make sure it does not fail silently if violated.
 #define MAX_IPC (4)
 
+//Largest line whose values the data shadow keeps (see data_shadow.h); its users copy a line to the stack to compress it
+#define MAX_LINE_SIZE (256)
+
 #endif  // CONSTANTS_H_
@@ -69,20 +69,23 @@ ContentionSim::ContentionSim(uint32_t _numDomains, uint32_t _numSimThreads) {
 
     domains = gm_calloc<DomainData>(numDomains);
     simThreads = gm_calloc<SimThreadData>(numSimThreads);
+    schedDomains = gm_calloc<uint32_t>(numDomains);
 
     for (uint32_t i = 0; i < numDomains; i++) {
-        new (&domains[i].pq) PrioQueue<TimingEvent, PQ_BLOCKS>();
+        new (&domains[i].pq) DomainQueue();
         domains[i].curCycle = 0;
         futex_init(&domains[i].pqLock);
     }
 
-    if ((numDomains % numSimThreads) != 0) panic("numDomains(%d) must be a multiple of numSimThreads(%d) for now", numDomains, numSimThreads);
+    //Until there is load information, split domains evenly, as contiguous ranges
+    for (uint32_t i = 0; i < numDomains; i++) schedDomains[i] = i;
 
     for (uint32_t i = 0; i < numSimThreads; i++) {
         futex_init(&simThreads[i].wakeLock);
         futex_lock(&simThreads[i].wakeLock); //starts locked, so first actual call to lock blocks
         simThreads[i].firstDomain = i*numDomains/numSimThreads;
         simThreads[i].supDomain = (i+1)*numDomains/numSimThreads;
+        simThreads[i].nextDomain = simThreads[i].firstDomain;
     }
 
     futex_init(&waitLock);
@@ -144,6 +147,12 @@ void ContentionSim::initStats(AggregateStat* parentStat) {
         new (&domains[i].profTime) ClockStat();
         domains[i].profTime.init("time", "Weave simulation time");
         domStat->append(&domains[i].profTime);
+        new (&domains[i].profEvents) Counter();
+        domains[i].profEvents.init("events", "Weave events simulated, including stalled crossing retries");
+        domStat->append(&domains[i].profEvents);
+        new (&domains[i].profSteals) Counter();
+        domains[i].profSteals.init("steals", "Phases simulated by a thread other than the one it was assigned to");
+        domStat->append(&domains[i].profSteals);
         objStat->append(domStat);
     }
     parentStat->append(objStat);
@@ -165,6 +174,8 @@ void ContentionSim::simulatePhase(uint64_t limit) {
         if (acore) acore->cSimStart();
     }
 
+    balanceDomains();
+
     inCSim = true;
     __sync_synchronize();
 
@@ -200,7 +211,6 @@ void ContentionSim::enqueue(TimingEvent* ev, uint64_t cycle) {
     assert_msg(cycle < lastLimit+10*zinfo->phaseLength+1000000, "Queued event too far into the future, cycle %ld lastLimit %ld", cycle, lastLimit);
 
     assert_msg(cycle >= domains[ev->domain].curCycle, "Queued event goes back in time, cycle %ld curCycle %ld", cycle, domains[ev->domain].curCycle);
-    ev->privCycle = cycle;
     assert(ev->numParents == 0);
     assert(ev->domain != -1);
     assert(ev->domain < (int32_t)numDomains);
@@ -219,7 +229,6 @@ void ContentionSim::enqueueSynced(TimingEvent* ev, uint64_t cycle) {
     assert_msg(cycle >= lastLimit, "Enqueued (synced) event before last limit! cycle %ld min %ld", cycle, lastLimit);
     //Hacky, but helpful to chase events scheduled too far ahead due to bugs (e.g., cycle -1). We should probably formalize this a bit more
     assert_msg(cycle < lastLimit+10*zinfo->phaseLength+10000, "Queued  (synced) event too far into the future, cycle %ld lastLimit %ld", cycle, lastLimit);
-    ev->privCycle = cycle;
     assert(ev->numParents == 0);
     domains[ev->domain].pq.enqueue(ev, cycle);
 
@@ -264,6 +273,74 @@ void ContentionSim::enqueueCrossing(CrossingEvent* ev, uint64_t cycle, uint32_t
     }
 }
 
+/* Longest-processing-time-first assignment: each domain, heaviest first, goes
+ * to the least loaded thread. Load is the number of events a domain simulated
+ * in recent phases, which tracks weave time much better than the domain count.
+ * Called between phases, when sim threads are asleep.
+ */
+void ContentionSim::balanceDomains() {
+    for (uint32_t i = 0; i < numDomains; i++) {
+        DomainData& d = domains[i];
+        uint64_t events = d.profEvents.get();
+        d.load = (3*d.load + (events - d.lastEvents))/4;
+        d.lastEvents = events;
+    }
+
+    if (numSimThreads == 1 || numSimThreads == numDomains) {
+        //Nothing to balance; threads just start at their own domains
+        for (uint32_t t = 0; t < numSimThreads; t++) simThreads[t].nextDomain = simThreads[t].firstDomain;
+        return;
+    }
+
+    std::vector<uint32_t> order(numDomains);
+    for (uint32_t i = 0; i < numDomains; i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) { return domains[a].load > domains[b].load; });
+
+    std::vector<uint64_t> threadLoad(numSimThreads, 0);
+    std::vector<uint32_t> threadDomains(numSimThreads, 0);
+    std::vector<uint32_t> owner(numDomains);
+    for (uint32_t d : order) {
+        uint32_t best = 0;
+        for (uint32_t t = 1; t < numSimThreads; t++) {
+            //Ties go to the thread with fewer domains, so idle domains still spread out
+            if (threadLoad[t] < threadLoad[best] || (threadLoad[t] == threadLoad[best] && threadDomains[t] < threadDomains[best])) best = t;
+        }
+        owner[d] = best;
+        threadLoad[best] += domains[d].load + 1;
+        threadDomains[best]++;
+    }
+
+    uint32_t pos = 0;
+    for (uint32_t t = 0; t < numSimThreads; t++) {
+        simThreads[t].firstDomain = pos;
+        for (uint32_t d : order) {
+            if (owner[d] == t) schedDomains[pos++] = d;
+        }
+        simThreads[t].supDomain = pos;
+        simThreads[t].nextDomain = simThreads[t].firstDomain;
+    }
+    assert(pos == numDomains);
+}
+
+/* Claims an unstarted domain, from this thread's range or, once that is
+ * exhausted, from another thread's. Returns nullptr if every domain has started.
+ */
+ContentionSim::DomainData* ContentionSim::claimDomain(uint32_t thid) {
+    for (uint32_t i = 0; i < numSimThreads; i++) {
+        uint32_t victim = (thid + i) % numSimThreads;
+        SimThreadData& st = simThreads[victim];
+        if (st.nextDomain >= st.supDomain) continue; //avoid the atomic when the range is clearly exhausted
+        uint32_t idx = __sync_fetch_and_add(&st.nextDomain, 1);
+        if (idx >= st.supDomain) continue;
+        DomainData* domain = &domains[schedDomains[idx]];
+        if (victim != thid) domain->profSteals.inc();
+        domain->queuePrio = domain->curCycle;
+        domain->profTime.start();
+        return domain;
+    }
+    return nullptr;
+}
+
 void ContentionSim::simThreadLoop(uint32_t thid) {
     info("Started contention simulation thread %d", thid);
 #if 0
@@ -299,13 +376,11 @@ void ContentionSim::simThreadLoop(uint32_t thid) {
 }
 
 void ContentionSim::simulatePhaseThread(uint32_t thid) {
-    uint32_t thDomains = simThreads[thid].supDomain - simThreads[thid].firstDomain;
-    uint32_t numFinished = 0;
-
-    if (thDomains == 1) {
-        DomainData& domain = domains[simThreads[thid].firstDomain];
+    if (numSimThreads == numDomains) {
+        //One domain per thread, nothing to steal
+        DomainData& domain = domains[schedDomains[simThreads[thid].firstDomain]];
         domain.profTime.start();
-        PrioQueue<TimingEvent, PQ_BLOCKS>& pq = domain.pq;
+        DomainQueue& pq = domain.pq;
         while (pq.size() && pq.firstCycle() < limit) {
             uint64_t domCycle = domain.curCycle;
             uint64_t cycle;
@@ -316,6 +391,7 @@ void ContentionSim::simulatePhaseThread(uint32_t thid) {
                 domain.curCycle = cycle;
             }
             te->run(cycle);
+            domain.profEvents.inc();
             uint64_t newCycle = pq.size()? pq.firstCycle() : limit;
             assert(newCycle >= domCycle);
             if (newCycle != domCycle) domain.curCycle = newCycle;
@@ -356,12 +432,7 @@ void ContentionSim::simulatePhaseThread(uint32_t thid) {
 #endif
 
     } else {
-        //info("XXX %d / %d %d %d", thid, thDomains, simThreads[thid].supDomain, simThreads[thid].firstDomain);
-
         std::priority_queue<DomainData*, std::vector<DomainData*>, CompareDomains> domPq;
-        for (uint32_t i = simThreads[thid].firstDomain; i < simThreads[thid].supDomain; i++) {
-            domPq.push(&domains[i]);
-        }
 
         std::vector<DomainData*> sq1;
         std::vector<DomainData*> sq2;
@@ -369,21 +440,33 @@ void ContentionSim::simulatePhaseThread(uint32_t thid) {
         std::vector<DomainData*>& stalledQueue = sq1;
         std::vector<DomainData*>& nextStalledQueue = sq2;
 
-        while (numFinished < thDomains) {
+        auto finishDomain = [this](DomainData* domain) {
+            domain->curCycle = limit;
+            domain->profTime.end();
+        };
+
+        while (true) {
+            //Start domains lazily, when all the ones we hold are done or stalled, so idle threads can steal the rest
+            if (!domPq.size()) {
+                DomainData* domain = claimDomain(thid);
+                if (domain) domPq.push(domain);
+                else if (!stalledQueue.size() && !nextStalledQueue.size()) break;
+            }
+
             while (domPq.size()) {
                 DomainData* domain = domPq.top();
                 domPq.pop();
-                PrioQueue<TimingEvent, PQ_BLOCKS>& pq = domain->pq;
+                DomainQueue& pq = domain->pq;
                 if (!pq.size() || pq.firstCycle() > limit) {
-                    numFinished++;
-                    domain->curCycle = limit;
+                    finishDomain(domain);
                 } else {
-                    //info("YYY %d %ld %ld %d", numFinished, domPq.size(), domain->curCycle, domain->prio);
+                    //info("YYY %ld %ld %d", domPq.size(), domain->curCycle, domain->prio);
                     uint64_t cycle;
                     TimingEvent* te = pq.dequeue(cycle);
                     //uint64_t nextCycle = pq.size()? pq.firstCycle() : cycle;
                     if (cycle != domain->curCycle) domain->curCycle = cycle;
                     te->run(cycle);
+                    domain->profEvents.inc();
                     domain->curCycle = pq.size()? pq.firstCycle() : limit;
                     domain->queuePrio = domain->curCycle;
                     if (domain->prio == 0) domPq.push(domain);
@@ -394,17 +477,17 @@ void ContentionSim::simulatePhaseThread(uint32_t thid) {
             while (stalledQueue.size()) {
                 DomainData* domain = stalledQueue.back();
                 stalledQueue.pop_back();
-                PrioQueue<TimingEvent, PQ_BLOCKS>& pq = domain->pq;
+                DomainQueue& pq = domain->pq;
                 if (!pq.size() || pq.firstCycle() > limit) {
-                    numFinished++;
-                    domain->curCycle = limit;
+                    finishDomain(domain);
                 } else {
-                    //info("SSS %d %ld %ld", numFinished, stalledQueue.size(), domain->curCycle);
+                    //info("SSS %ld %ld", stalledQueue.size(), domain->curCycle);
                     uint64_t cycle;
                     TimingEvent* te = pq.dequeue(cycle);
                     if (cycle != domain->curCycle) domain->curCycle = cycle;
                     te->state = EV_RUNNING;
                     te->simulate(cycle);
+                    domain->profEvents.inc();
                     domain->curCycle = pq.size()? pq.firstCycle() : limit;
                     domain->queuePrio = domain->curCycle;
                     if (domain->prio == 0) domPq.push(domain);
@@ -420,6 +503,12 @@ void ContentionSim::simulatePhaseThread(uint32_t thid) {
     __sync_synchronize();
 }
 
+uint64_t ContentionSim::getEvents() const {
+    uint64_t events = 0;
+    for (uint32_t i = 0; i < numDomains; i++) events += domains[i].profEvents.get();
+    return events;
+}
+
 void ContentionSim::finish() {
     assert(!terminate);
     terminate = true;
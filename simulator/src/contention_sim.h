@@ -49,6 +49,9 @@ class CrossingEvent;
 
 #define PQ_BLOCKS 1024
 
+//Far events (e.g., long memory latencies) go to a timing wheel; PrioQueue<TimingEvent, PQ_BLOCKS> keeps them in a tree
+typedef WheelPrioQueue<TimingEvent, PQ_BLOCKS> DomainQueue;
+
 class ContentionSim : public GlobAlloc {
     private:
         struct CompareEvents : public std::binary_function<TimingEvent*, TimingEvent*, bool> {
@@ -63,7 +66,7 @@ class ContentionSim : public GlobAlloc {
         CrossingEventInfo* lastCrossing; //indexed by [srcId*doms*doms + srcDom*doms + dstDom]
 
         struct DomainData : public GlobAlloc {
-            PrioQueue<TimingEvent, PQ_BLOCKS> pq;
+            DomainQueue pq;
 
             PAD();
 
@@ -77,6 +80,10 @@ class ContentionSim : public GlobAlloc {
             PAD();
 
             ClockStat profTime;
+            Counter profEvents;
+            Counter profSteals;
+            uint64_t lastEvents; //profEvents at the start of the phase
+            uint64_t load; //smoothed events per phase, drives the domain-to-thread assignment
 
 #if PROFILE_CROSSINGS
             VectorCounter profIncomingCrossingSims;
@@ -89,10 +96,17 @@ class ContentionSim : public GlobAlloc {
              bool operator()(DomainData* d1, DomainData* d2) const;
         };
 
+        /* Each phase, domains are assigned to threads by load, and each thread
+         * gets a contiguous range of schedDomains, heaviest first. Threads claim
+         * domains from their range as they need more work, and once it is
+         * exhausted steal domains that have not started from other threads'
+         * ranges. A claimed domain stays with its thread until the phase ends.
+         */
         struct SimThreadData {
             lock_t wakeLock; //used to sleep/wake up simulation thread
-            uint32_t firstDomain;
+            uint32_t firstDomain; //indexes schedDomains
             uint32_t supDomain; //supreme, ie first not included
+            volatile uint32_t nextDomain; //next unclaimed; fetch-and-add, may overshoot supDomain
 
             std::vector<std::pair<uint64_t, TimingEvent*> > logVec;
         };
@@ -100,6 +114,7 @@ class ContentionSim : public GlobAlloc {
         //RO
         DomainData* domains;
         SimThreadData* simThreads;
+        uint32_t* schedDomains; //domain ids, grouped by thread; rewritten between phases
 
         PAD();
 
@@ -142,6 +157,9 @@ class ContentionSim : public GlobAlloc {
 
         uint64_t getLastLimit() {return lastLimit;}
 
+        //Weave events simulated so far, across all domains
+        uint64_t getEvents() const;
+
         uint64_t getCurCycle(uint32_t domain) {
             assert(domain < numDomains);
             uint64_t c = domains[domain].curCycle;
@@ -163,6 +181,9 @@ class ContentionSim : public GlobAlloc {
         void simThreadLoop(uint32_t thid);
         void simulatePhaseThread(uint32_t thid);
 
+        void balanceDomains();
+        DomainData* claimDomain(uint32_t thid);
+
         static void SimThreadTrampoline(void* arg);
 };
 
@@ -0,0 +1,102 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "data_shadow.h"
+#include <string.h>
+#include "constants.h"
+#include "pin.H"
+#include "zsim.h"
+
+DataShadow::DataShadow(uint32_t _maxLines, uint32_t _lineSize) : lineSize(_lineSize), maxLines(_maxLines), usedSlots(0), nextSlot(0) {
+    if (!maxLines) panic("The data shadow needs at least one line");
+    if (lineSize > MAX_LINE_SIZE) panic("The data shadow supports lines of up to %d bytes, not %d", MAX_LINE_SIZE, lineSize);
+    data = gm_calloc<uint8_t>(((size_t)maxLines)*lineSize);
+    slotLines = gm_calloc<Address>(maxLines);
+    futex_init(&lock);
+}
+
+void DataShadow::initStats(AggregateStat* parentStat) {
+    AggregateStat* shadowStat = new AggregateStat();
+    shadowStat->init("shadow", "Line values shadowed for compression");
+    profCaptures.init("captures", "Line snapshots taken"); shadowStat->append(&profCaptures);
+    profDropped.init("dropped", "Snapshots replaced to make room"); shadowStat->append(&profDropped);
+    profReads.init("reads", "Line value reads"); shadowStat->append(&profReads);
+    profReadHits.init("readHits", "Reads served by a snapshot"); shadowStat->append(&profReadHits);
+    profUnreadable.init("unreadable", "Lines whose values could not be read (other processes)"); shadowStat->append(&profUnreadable);
+    parentStat->append(shadowStat);
+}
+
+bool DataShadow::capture(Address lineAddr, uint8_t* buf) {
+    if (!readProcess(lineAddr, buf)) return false;
+
+    futex_lock(&lock);
+    profCaptures.inc();
+    uint32_t slot;
+    g_unordered_map<Address, uint32_t>::iterator it = slots.find(lineAddr);
+    if (it != slots.end()) {
+        slot = it->second;
+    } else {
+        if (usedSlots < maxLines) {
+            slot = usedSlots++;
+        } else {
+            slot = nextSlot;
+            nextSlot = (nextSlot + 1) % maxLines;
+            slots.erase(slotLines[slot]);
+            profDropped.inc();
+        }
+        slotLines[slot] = lineAddr;
+        slots[lineAddr] = slot;
+    }
+    memcpy(data + ((size_t)slot)*lineSize, buf, lineSize);
+    futex_unlock(&lock);
+    return true;
+}
+
+bool DataShadow::read(Address lineAddr, uint8_t* buf) {
+    futex_lock(&lock);
+    profReads.inc();
+    g_unordered_map<Address, uint32_t>::iterator it = slots.find(lineAddr);
+    if (it != slots.end()) {
+        memcpy(buf, data + ((size_t)it->second)*lineSize, lineSize);
+        profReadHits.inc();
+        futex_unlock(&lock);
+        return true;
+    }
+    futex_unlock(&lock);
+    return readProcess(lineAddr, buf);
+}
+
+bool DataShadow::readProcess(Address lineAddr, uint8_t* buf) {
+    //Line addresses carry their process in the top bits (see procMask), and we can only read our own
+    Address vLineMask = (1ul << (64 - lineBits)) - 1;
+    if (zinfo->traceDriven || (lineAddr & ~vLineMask) != procMask) {
+        profUnreadable.atomicInc();
+        return false;
+    }
+    Address vAddr = (lineAddr & vLineMask) << lineBits;
+    size_t bytes = PIN_SafeCopy(buf, (const void*)vAddr, lineSize);
+    if (bytes < lineSize) memset(buf + bytes, 0, lineSize - bytes); //unmapped memory reads as zeros
+    return true;
+}
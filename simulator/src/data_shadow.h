@@ -0,0 +1,78 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DATA_SHADOW_H_
+#define DATA_SHADOW_H_
+
+#include "g_std/g_unordered_map.h"
+#include "galloc.h"
+#include "locks.h"
+#include "memory_hierarchy.h"
+#include "stats.h"
+
+/* Line values, for the models that depend on them (cache and memory-link
+ * compression, see compressors.h). zsim only simulates tags; values come from
+ * the simulated process's own memory, which the simulator shares.
+ *
+ * The memory holds the latest values, while a writeback to a compressed level
+ * carries the values the line had when it left the private caches. capture()
+ * snapshots those, and read() returns the last snapshot of a line, which is
+ * what the levels below the capture hold, or the current values if there is
+ * none. Snapshots are bounded (FIFO replacement), so a line that loses its
+ * snapshot reads its current values. Lines of other processes (and all lines
+ * in trace-driven runs) cannot be read; they are treated as incompressible.
+ */
+class DataShadow : public GlobAlloc {
+    private:
+        const uint32_t lineSize;
+        const uint32_t maxLines;
+        uint8_t* data; //maxLines snapshots of lineSize bytes
+        Address* slotLines; //line of each snapshot
+        uint32_t usedSlots;
+        uint32_t nextSlot; //FIFO replacement, once all slots are used
+        g_unordered_map<Address, uint32_t> slots; //line -> snapshot
+        lock_t lock;
+
+        Counter profCaptures;
+        Counter profDropped;
+        Counter profReads;
+        Counter profReadHits;
+        Counter profUnreadable;
+
+    public:
+        DataShadow(uint32_t _maxLines, uint32_t _lineSize);
+        void initStats(AggregateStat* parentStat);
+
+        //Snapshots the current values of the line into buf; returns false if they cannot be read
+        bool capture(Address lineAddr, uint8_t* buf);
+
+        //Copies the line's last snapshot, or its current values, into buf; returns false if there are neither
+        bool read(Address lineAddr, uint8_t* buf);
+
+    private:
+        bool readProcess(Address lineAddr, uint8_t* buf);
+};
+
+#endif  // DATA_SHADOW_H_
@@ -256,7 +256,7 @@ uint64_t DDRMemory::access(MemReq& req) {
         default: panic("!?");
     }
 
-    if (req.type == PUTS) {
+    if (req.type == PUTS || unlikely(req.is(MemReq::WARM))) {
         return req.cycle; //must return an absolute value, 0 latency
     } else {
         bool isWrite = (req.type == PUTX);
@@ -576,6 +576,24 @@ void Decoder::dropStackRegister(Instr& instr) {
 }
 
 
+bool Decoder::isNonTemporalStore(xed_iclass_enum_t opcode) {
+    switch (opcode) {
+        case XO(MOVNTI):
+        case XO(MOVNTQ):
+        case XO(MOVNTDQ):
+        case XO(MOVNTPS):
+        case XO(MOVNTPD):
+        case XO(MOVNTSS):
+        case XO(MOVNTSD):
+        case XO(VMOVNTDQ):
+        case XO(VMOVNTPS):
+        case XO(VMOVNTPD):
+            return true;
+        default:
+            return false; //MOVNTDQA/VMOVNTDQA are loads
+    }
+}
+
 bool Decoder::decodeInstr(INS ins, DynUopVec& uops) {
     uint32_t initialUops = uops.size();
     bool inaccurate = false;
@@ -649,8 +667,19 @@ bool Decoder::decodeInstr(INS ins, DynUopVec& uops) {
                 case XO(XCHG):
                     emitXchg(instr, uops);
                     break;
+                case XO(MOVNTI):
+                    emitBasicMove(instr, uops, 1, PORTS_015); //like mov; store uops marked non-temporal below
+                    break;
+                case XO(MOVNTQ):
+                case XO(MOVNTDQ):
+                case XO(MOVNTPS):
+                case XO(MOVNTPD):
+                case XO(MOVNTSS):
+                case XO(MOVNTSD):
+                    emitBasicMove(instr, uops, 1, PORT_5); //like movaps
+                    break;
                 default:
-                    //TODO: MASKMOVQ, MASKMOVDQ, MOVBE (Atom only), MOVNTxx variants (nontemporal), MOV_CR and MOV_DR (privileged?), VMOVxxxx variants (AVX)
+                    //TODO: MASKMOVQ, MASKMOVDQ, MOVBE (Atom only), MOVNTDQA (a load, no different from a normal one here), MOV_CR and MOV_DR (privileged?), VMOVxxxx variants (AVX)
                     inaccurate = true;
                     emitBasicMove(instr, uops, 1, PORTS_015);
             }
@@ -1245,6 +1274,13 @@ bool Decoder::decodeInstr(INS ins, DynUopVec& uops) {
         inaccurate = true;
     }
 
+    //Non-temporal stores bypass the caches through the write-combining buffers (see FilterCache::storeNT)
+    if (isNonTemporalStore(opcode)) {
+        for (uint32_t i = initialUops; i < uops.size(); i++) {
+            if (uops[i].type == UOP_STORE) uops[i].flags |= UOP_NONTEMPORAL;
+        }
+    }
+
     //NOTE: REP instructions are unrolled by PIN, so they are accurately simulated (they are treated as predicated in Pin)
     //See section "Optimizing Instrumentation of REP Prefixed Instructions" on the Pin manual
 
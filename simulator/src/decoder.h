@@ -47,6 +47,9 @@
  */
 enum UopType : uint8_t {UOP_GENERAL, UOP_LOAD, UOP_STORE, UOP_STORE_ADDR, UOP_FENCE};
 
+// DynUop flags
+#define UOP_NONTEMPORAL (1<<0) //store data uop of a MOVNT* (non-temporal, write-combining) store
+
 struct DynUop {
     uint16_t rs[MAX_UOP_SRC_REGS];
     uint16_t rd[MAX_UOP_DST_REGS];
@@ -55,7 +58,7 @@ struct DynUop {
     UopType type; //1 byte
     uint8_t portMask;
     uint8_t extraSlots; //FU exec slots
-    uint8_t pad; //pad to 4-byte multiple
+    uint8_t flags; //UOP_* flags above; also pads to 4-byte multiple
 
     void clear();
 };  // 16 bytes. TODO(dsm): check performance with wider operands
@@ -148,6 +151,9 @@ class Decoder {
         //Return true if inaccurate decoding, false if accurate
         static bool decodeInstr(INS ins, DynUopVec& uops);
 
+        //MOVNT* stores, whose store uops get UOP_NONTEMPORAL
+        static bool isNonTemporalStore(xed_iclass_enum_t opcode);
+
         /* Every emit function can produce 0 or more uops; it returns the number of uops. These are basic templates to make our life easier */
 
         //By default, these emit to temporary registers that depend on the index; this can be overriden, e.g. for moves
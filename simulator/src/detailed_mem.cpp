@@ -1115,7 +1115,7 @@ uint64_t MemControllerBase::access(MemReq& req) {
         default: panic("!?");
     }
 
-    if (req.type == PUTS)
+    if (req.type == PUTS || unlikely(req.is(MemReq::WARM)))
         return req.cycle;
 
     MemAccessType accessType = (req.type == PUTS || req.type == PUTX) ? WRITE : READ;
@@ -108,6 +108,8 @@ uint64_t DRAMSimMemory::access(MemReq& req) {
         default: panic("!?");
     }
 
+    if (unlikely(req.is(MemReq::WARM))) return req.cycle; //functional warming, no timing
+
     uint64_t respCycle = req.cycle + minLatency;
     assert(respCycle > req.cycle);
 
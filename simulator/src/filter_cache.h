@@ -39,6 +39,14 @@
  * holds the most recently used line in each set. Accesses check the filter array,
  * and then go through the normal access path. Because there is one line per set,
  * it is fine to do this without grabbing a lock.
+ *
+ * Non-temporal stores (storeNT) that miss in the filter array go to a small
+ * set of write-combining buffers instead, which collect a line's bytes and
+ * write it to memory as a single non-allocating PUTX (MemReq::NONTEMPORAL)
+ * once it is full, when the buffer is needed for another line, or on a fence.
+ * A flushed buffer stays busy until the write is accepted, so a core that
+ * streams stores is limited by buffers/latency, as in real cores where these
+ * are the line fill buffers.
  */
 
 class FilterCache : public Cache {
@@ -51,6 +59,13 @@ class FilterCache : public Cache {
             void clear() {wrAddr = 0; rdAddr = 0; availCycle = 0;}
         };
 
+        struct WCEntry {
+            Address lineAddr; //physical, 0 if free
+            uint64_t mask; //bytes written
+            uint64_t allocSeq; //flush order, oldest first
+            uint64_t availCycle; //busy until the last write from this buffer is accepted
+        };
+
         //Replicates the most accessed line of each set in the cache
         FilterEntry* filterArray;
         Address setMask;
@@ -61,6 +76,14 @@ class FilterCache : public Cache {
         lock_t filterLock;
         uint64_t fGETSHit, fGETXHit;
 
+        //Write-combining buffers; only accessed by the core's thread
+        WCEntry* wcArray;
+        uint32_t wcEntries;
+        uint32_t wcUsed;
+        uint64_t wcSeq;
+        uint64_t wcFullMask;
+        uint64_t ntStores, wcFullWrites, wcPartialWrites, wcStallCycles;
+
     public:
         FilterCache(uint32_t _numSets, uint32_t _numLines, CC* _cc, CacheArray* _array,
                     ReplPolicy* _rp, uint32_t _accLat, uint32_t _invLat, bool bypass, g_string& _name)
@@ -76,6 +99,11 @@ class FilterCache : public Cache {
             fGETSHit = fGETXHit = 0;
             srcId = -1;
             reqFlags = 0;
+            wcArray = nullptr;
+            wcEntries = wcUsed = 0;
+            wcSeq = 0;
+            wcFullMask = 0;
+            ntStores = wcFullWrites = wcPartialWrites = wcStallCycles = 0;
         }
 
         void setSourceId(uint32_t id) {
@@ -86,6 +114,14 @@ class FilterCache : public Cache {
             reqFlags = flags;
         }
 
+        //0 buffers makes non-temporal stores ordinary stores
+        void setWriteCombining(uint32_t entries) {
+            if (zinfo->lineSize > 64) panic("[%s] Write-combining buffers need lines of at most 64 bytes, not %d", name.c_str(), zinfo->lineSize);
+            wcEntries = entries;
+            wcArray = wcEntries? gm_calloc<WCEntry>(wcEntries) : nullptr;
+            wcFullMask = (zinfo->lineSize == 64)? -1L : ((1ul << zinfo->lineSize) - 1);
+        }
+
         void initStats(AggregateStat* parentStat) {
             AggregateStat* cacheStat = new AggregateStat();
             cacheStat->init(name.c_str(), "Filter cache stats");
@@ -97,11 +133,27 @@ class FilterCache : public Cache {
             cacheStat->append(fgetsStat);
             cacheStat->append(fgetxStat);
 
+            if (wcEntries) {
+                ProxyStat* ntStat = new ProxyStat();
+                ntStat->init("ntStores", "Non-temporal stores written to the write-combining buffers", &ntStores);
+                ProxyStat* wcFullStat = new ProxyStat();
+                wcFullStat->init("wcFull", "Full-line writes from the write-combining buffers", &wcFullWrites);
+                ProxyStat* wcPartialStat = new ProxyStat();
+                wcPartialStat->init("wcPartial", "Partial-line writes from the write-combining buffers (evictions and fences)", &wcPartialWrites);
+                ProxyStat* wcStallStat = new ProxyStat();
+                wcStallStat->init("wcStall", "Cycles non-temporal stores waited for a free write-combining buffer", &wcStallCycles);
+                cacheStat->append(ntStat);
+                cacheStat->append(wcFullStat);
+                cacheStat->append(wcPartialStat);
+                cacheStat->append(wcStallStat);
+            }
+
             initCacheStats(cacheStat);
             parentStat->append(cacheStat);
         }
 
-        inline uint64_t load(Address vAddr, uint64_t curCycle) {
+        //pc is optional, and only used by PC-based replacement policies down the hierarchy
+        inline uint64_t load(Address vAddr, uint64_t curCycle, Address pc = 0) {
             Address vLineAddr = vAddr >> lineBits;
             uint32_t idx = vLineAddr & setMask;
             uint64_t availCycle = filterArray[idx].availCycle; //read before, careful with ordering to avoid timing races
@@ -109,11 +161,11 @@ class FilterCache : public Cache {
                 fGETSHit++;
                 return MAX(curCycle, availCycle);
             } else {
-                return replace(vLineAddr, idx, true, curCycle);
+                return replace(vLineAddr, idx, true, curCycle, pc);
             }
         }
 
-        inline uint64_t store(Address vAddr, uint64_t curCycle) {
+        inline uint64_t store(Address vAddr, uint64_t curCycle, Address pc = 0) {
             Address vLineAddr = vAddr >> lineBits;
             uint32_t idx = vLineAddr & setMask;
             uint64_t availCycle = filterArray[idx].availCycle; //read before, careful with ordering to avoid timing races
@@ -123,15 +175,47 @@ class FilterCache : public Cache {
                 //filterArray[idx].availCycle = curCycle; //do optimistic store-load forwarding
                 return MAX(curCycle, availCycle);
             } else {
-                return replace(vLineAddr, idx, false, curCycle);
+                return replace(vLineAddr, idx, false, curCycle, pc);
             }
         }
 
-        uint64_t replace(Address vLineAddr, uint32_t idx, bool isLoad, uint64_t curCycle) {
+        //Non-temporal store of size bytes; returns the cycle the store is accepted. Stores to lines the filter array
+        //holds writable update them in place, like ordinary stores; the rest go to the write-combining buffers
+        inline uint64_t storeNT(Address vAddr, uint32_t size, uint64_t curCycle, Address pc = 0) {
+            Address vLineAddr = vAddr >> lineBits;
+            uint32_t idx = vLineAddr & setMask;
+            if (!wcEntries || vLineAddr == filterArray[idx].wrAddr) return store(vAddr, curCycle, pc);
+            else return writeCombine(vAddr, size, curCycle);
+        }
+
+        //Fences flush every buffered line
+        inline bool hasWriteCombining() const {
+            return wcUsed;
+        }
+
+        //Loads and ordinary stores to a buffered line must flush it first (see OOOCore)
+        inline bool inWriteCombining(Address vAddr) const {
+            if (likely(!wcUsed)) return false;
+            return findWC(procMask | (vAddr >> lineBits)) != nullptr;
+        }
+
+        //Each flush is a single access, so callers that record timing can record one at a time. Both return the
+        //cycle the write is accepted, or curCycle if there was nothing to flush
+        uint64_t flushWriteCombining(Address vAddr, uint64_t curCycle) {
+            WCEntry* e = findWC(procMask | (vAddr >> lineBits));
+            return e? flushWC(e, curCycle) : curCycle;
+        }
+
+        uint64_t flushWriteCombining(uint64_t curCycle) { //oldest buffer
+            WCEntry* e = oldestWC();
+            return e? flushWC(e, curCycle) : curCycle;
+        }
+
+        uint64_t replace(Address vLineAddr, uint32_t idx, bool isLoad, uint64_t curCycle, Address pc) {
             Address pLineAddr = procMask | vLineAddr;
             MESIState dummyState = MESIState::I;
             futex_lock(&filterLock);
-            MemReq req = {pLineAddr, isLoad? GETS : GETX, 0, &dummyState, curCycle, &filterLock, dummyState, srcId, reqFlags};
+            MemReq req = {pLineAddr, isLoad? GETS : GETX, 0, &dummyState, curCycle, &filterLock, dummyState, srcId, reqFlags, pc};
             uint64_t respCycle  = access(req);
 
             //Due to the way we do the locking, at this point the old address might be invalidated, but we have the new address guaranteed until we release the lock
@@ -150,6 +234,25 @@ class FilterCache : public Cache {
             return respCycle;
         }
 
+        // Functional warming access from a fast-forwarded thread (see MemReq::WARM).
+        // The filter array is not filled, since the core may be running another
+        // thread; the entry of the set is dropped instead, in case warming evicted
+        // the line it replicates.
+        void warm(Address vAddr, bool isLoad, uint64_t curCycle) {
+            Address vLineAddr = vAddr >> lineBits;
+            uint32_t idx = vLineAddr & setMask;
+            Address pLineAddr = procMask | vLineAddr;
+            MESIState dummyState = MESIState::I;
+            futex_lock(&filterLock);
+            MemReq req = {pLineAddr, isLoad? GETS : GETX, 0, &dummyState, curCycle, &filterLock, dummyState, srcId, reqFlags | MemReq::WARM};
+            access(req);
+            if (filterArray[idx].rdAddr != vLineAddr) {
+                filterArray[idx].wrAddr = -1L;
+                filterArray[idx].rdAddr = -1L;
+            }
+            futex_unlock(&filterLock);
+        }
+
         uint64_t invalidate(const InvReq& req) {
             Cache::startInvalidate();  // grabs cache's downLock
             futex_lock(&filterLock);
@@ -163,11 +266,110 @@ class FilterCache : public Cache {
             return respCycle;
         }
 
+        //Write-combining buffers hold physical lines, so they survive context switches; the next thread's
+        //non-temporal stores or fences flush them
         void contextSwitch() {
             futex_lock(&filterLock);
             for (uint32_t i = 0; i < numSets; i++) filterArray[i].clear();
             futex_unlock(&filterLock);
         }
+
+        bool serialize(Checkpoint& ckpt) {
+            bool res = Cache::serialize(ckpt);
+            if (!ckpt.isSaving()) {
+                contextSwitch(); //filters may cache lines the restored array lacks
+                for (uint32_t i = 0; i < wcEntries; i++) wcArray[i].lineAddr = 0; //buffered writes are not checkpointed
+                wcUsed = 0;
+            }
+            return res;
+        }
+
+    private:
+        WCEntry* findWC(Address pLineAddr) const {
+            for (uint32_t i = 0; i < wcEntries; i++) {
+                if (wcArray[i].lineAddr == pLineAddr) return &wcArray[i];
+            }
+            return nullptr;
+        }
+
+        WCEntry* oldestWC() const {
+            WCEntry* oldest = nullptr;
+            for (uint32_t i = 0; i < wcEntries; i++) {
+                WCEntry* e = &wcArray[i];
+                if (e->lineAddr && (!oldest || e->allocSeq < oldest->allocSeq)) oldest = e;
+            }
+            return oldest;
+        }
+
+        uint64_t writeCombine(Address vAddr, uint32_t size, uint64_t curCycle) {
+            Address vLineAddr = vAddr >> lineBits;
+            Address pLineAddr = procMask | vLineAddr;
+            uint32_t idx = vLineAddr & setMask;
+            uint64_t respCycle = curCycle;
+            bool flushed = false;
+            ntStores++;
+
+            //Loads must not hit a stale copy in the filter array, so they find the line here (the flush drops the cached copies)
+            futex_lock(&filterLock);
+            if (filterArray[idx].rdAddr == vLineAddr) {
+                filterArray[idx].wrAddr = -1L;
+                filterArray[idx].rdAddr = -1L;
+            }
+            futex_unlock(&filterLock);
+
+            WCEntry* e = findWC(pLineAddr);
+            if (!e) {
+                //Take the free buffer that frees up first; if all hold lines, flush the oldest
+                for (uint32_t i = 0; i < wcEntries; i++) {
+                    WCEntry* c = &wcArray[i];
+                    if (!c->lineAddr && (!e || c->availCycle < e->availCycle)) e = c;
+                }
+                if (!e) {
+                    e = oldestWC();
+                    flushWC(e, curCycle);
+                    flushed = true;
+                }
+                if (e->availCycle > curCycle) {
+                    wcStallCycles += e->availCycle - curCycle;
+                    respCycle = e->availCycle;
+                }
+                e->lineAddr = pLineAddr;
+                e->mask = 0;
+                e->allocSeq = wcSeq++;
+                wcUsed++;
+            }
+
+            uint32_t offset = vAddr & (zinfo->lineSize - 1);
+            uint32_t bytes = MIN(size, zinfo->lineSize - offset); //a line-crossing store only counts its bytes in the first line
+            e->mask |= (((bytes >= 64)? -1L : ((1ul << bytes) - 1)) << offset) & wcFullMask;
+            //A full line is written right away, unless this store already flushed a buffer (one access per call)
+            if (e->mask == wcFullMask && !flushed) flushWC(e, respCycle);
+            return respCycle;
+        }
+
+        uint64_t flushWC(WCEntry* e, uint64_t curCycle) {
+            Address pLineAddr = e->lineAddr;
+            if (e->mask == wcFullMask) wcFullWrites++;
+            else wcPartialWrites++;
+
+            MESIState dummyState = MESIState::I;
+            futex_lock(&filterLock);
+            uint32_t flags = reqFlags | MemReq::NONTEMPORAL | ((e->mask == wcFullMask)? 0 : MemReq::NTPARTIAL);
+            MemReq req = {pLineAddr, PUTX, 0, &dummyState, curCycle, &filterLock, dummyState, srcId, flags};
+            uint64_t respCycle = access(req);
+            //The write dropped the line from the cache, which does not invalidate us (we are the requester)
+            uint32_t idx = pLineAddr & setMask;
+            if ((filterArray[idx].rdAddr | procMask) == pLineAddr) {
+                filterArray[idx].wrAddr = -1L;
+                filterArray[idx].rdAddr = -1L;
+            }
+            futex_unlock(&filterLock);
+
+            e->lineAddr = 0;
+            e->availCycle = respCycle;
+            wcUsed--;
+            return respCycle;
+        }
 };
 
 #endif  // FILTER_CACHE_H_
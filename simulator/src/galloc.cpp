@@ -33,6 +33,7 @@
 
 #include "log.h"  // NOLINT must precede dlmalloc, which defines assert if undefined
 #include "g_heap/dlmalloc.h.c"
+#include "constants.h"
 #include "locks.h"
 #include "pad.h"
 
@@ -50,10 +51,79 @@
  */
 #define GM_BASE_ADDR ((const void*)0x00ABBA000000)
 
+/* Thread caches. Small allocations are served from per-thread free lists of
+ * size-classed blocks, refilled from the mspace in batches, so the common
+ * case never touches GM->lock. Caches live in the shared segment and every
+ * block carries a header naming the cache that owns it, so a block can be
+ * freed by any thread of any process: the owner pushes it back to its free
+ * list, everyone else pushes it on the owner's lock-free remote list, which
+ * the owner drains when it runs out of blocks. Large allocations go straight
+ * to the mspace, behind the same header.
+ *
+ * Aligned allocations have no header, so they cost what the mspace charges.
+ * The header's last word is a tag that overlays the upper half of dlmalloc's
+ * chunk size word, which is 0 for chunks under 4GB and can never be the tag; gm_free uses it to
+ * tell headed blocks from aligned ones, which it returns to the mspace as is.
+ *
+ * Caches are indexed by thread id (see gm_set_thread_id_func), like the rest
+ * of zsim's per-thread state. When a thread exits, gm_thread_fini returns its
+ * blocks to the mspace and retires its cache, so later frees of its blocks
+ * go to the mspace too. The next thread that needs a cache takes it over.
+ */
+#define GM_NUM_CLASSES 14
+#define GM_RAW_CLASS ((uint32_t)-1)
+#define GM_REFILL_BYTES (16*1024) //bytes moved from the mspace per refill
+#define GM_MAX_CACHED_BYTES (64*1024) //per class, beyond this half the list is returned to the mspace
+
+static const size_t gm_class_sizes[GM_NUM_CLASSES] = {16, 32, 48, 64, 80, 96, 112, 128, 192, 256, 384, 512, 768, 1024};
+
+struct gm_tcache;
+
+#define GM_HEADER_TAG 0x9a110c00u //never the upper half of a chunk size
+
+//Precedes every block handed out, except aligned ones; 16 bytes, so the user pointer keeps the mspace's alignment
+struct gm_header {
+    union {
+        gm_tcache* owner; //size-classed blocks
+        void* base; //raw mspace allocations (GM_RAW_CLASS)
+    };
+    uint32_t cls;
+    uint32_t tag; //GM_HEADER_TAG; aligned blocks have dlmalloc's chunk size word here instead
+};
+
+struct gm_block {
+    gm_block* next;
+};
+
+struct gm_tcache {
+    gm_block* freeList[GM_NUM_CLASSES];
+    uint32_t freeCount[GM_NUM_CLASSES];
+    gm_tcache* next; //all caches, for gm_stats
+    gm_tcache* nextRetired;
+    volatile bool retired; //no thread owns it, frees go to the mspace
+    uint32_t id;
+
+    //Stats, only written by the owning thread
+    uint64_t allocs;
+    uint64_t hits;
+    uint64_t refills;
+    uint64_t localFrees;
+    uint64_t remoteFrees; //blocks returned by other threads
+    uint64_t flushes;
+
+    PAD();
+    gm_block* volatile remoteList; //pushed with CAS by other threads, taken whole by the owner
+    PAD();
+};
+
 struct gm_segment {
     volatile void* base_regp; //common data structure, accessible with glob_ptr; threads poll on gm_isready to determine when everything has been initialized
     volatile void* secondary_regp; //secondary data structure, used to exchange information between harness and initializing process
     mspace mspace_ptr;
+    gm_tcache* caches; //protected by lock
+    gm_tcache* retiredCaches; //protected by lock
+    uint32_t numCaches;
+    uint32_t numRetired;
 
     PAD();
     lock_t lock;
@@ -63,6 +133,14 @@ struct gm_segment {
 static gm_segment* GM = nullptr;
 static int gm_shmid = 0;
 
+//Process-local, indexed by thread id
+static gm_tcache* gm_caches[MAX_THREADS];
+static uint32_t (*gm_thread_id_func)() = nullptr; //without one, the process is single-threaded and uses slot 0
+
+static inline uint32_t gm_thread_id() {
+    return gm_thread_id_func? gm_thread_id_func() : 0;
+}
+
 /* Heap segment size, in bytes. Can't grow for now, so choose something sensible, and within the machine's limits (see sysctl vars kernel.shmmax and kernel.shmall) */
 int gm_init(size_t segmentSize) {
     /* Create a SysV IPC shared memory segment, attach to it, and mark the segment to
@@ -103,6 +181,10 @@ int gm_init(size_t segmentSize) {
     GM->base_regp = nullptr;
 
     GM->mspace_ptr = create_mspace_with_base(alloc_start, alloc_size, 1 /*locked*/);
+    GM->caches = nullptr;
+    GM->retiredCaches = nullptr;
+    GM->numCaches = 0;
+    GM->numRetired = 0;
     futex_init(&GM->lock);
     assert(GM->mspace_ptr);
 
@@ -120,34 +202,187 @@ void gm_attach(int shmid) {
     }
 }
 
+void gm_set_thread_id_func(uint32_t (*func)()) {
+    gm_thread_id_func = func;
+}
 
-void* gm_malloc(size_t size) {
+void gm_forget_thread_caches() {
+    for (uint32_t i = 0; i < MAX_THREADS; i++) gm_caches[i] = nullptr;
+}
+
+static inline uint32_t gm_size_class(size_t size) {
+    if (size <= 128) return (size == 0)? 0 : (size - 1)/16;
+    for (uint32_t c = 8; c < GM_NUM_CLASSES; c++) {
+        if (size <= gm_class_sizes[c]) return c;
+    }
+    return GM_RAW_CLASS;
+}
+
+static inline gm_header* gm_get_header(void* ptr) {
+    return reinterpret_cast<gm_header*>(static_cast<char*>(ptr) - sizeof(gm_header));
+}
+
+static void* gm_raw_alloc(void* base, const char* fn) {
+    if (!base) panic("%s: Out of global heap memory, use a larger GM segment", fn);
+    gm_header* hdr = static_cast<gm_header*>(base);
+    hdr->base = base;
+    hdr->cls = GM_RAW_CLASS;
+    hdr->tag = GM_HEADER_TAG;
+    return hdr + 1;
+}
+
+//nullptr if the calling thread has no valid id; it then allocates from the mspace directly
+static gm_tcache* gm_get_cache() {
+    uint32_t tid = gm_thread_id();
+    if (unlikely(tid >= MAX_THREADS)) return nullptr;
+    if (likely(gm_caches[tid] != nullptr)) return gm_caches[tid];
+    futex_lock(&GM->lock);
+    gm_tcache* tc = GM->retiredCaches;
+    if (tc) {
+        GM->retiredCaches = tc->nextRetired;
+        GM->numRetired--;
+        tc->nextRetired = nullptr;
+        tc->retired = false;
+    } else {
+        tc = static_cast<gm_tcache*>(mspace_calloc(GM->mspace_ptr, 1, sizeof(gm_tcache)));
+        if (!tc) panic("gm_malloc(): Out of global heap memory, use a larger GM segment");
+        tc->id = GM->numCaches++;
+        tc->next = GM->caches;
+        GM->caches = tc;
+    }
+    futex_unlock(&GM->lock);
+    gm_caches[tid] = tc;
+    return tc;
+}
+
+//Takes back the blocks other threads have freed; false if there were none
+static bool gm_drain_remote(gm_tcache* tc) {
+    gm_block* b = __sync_lock_test_and_set(&tc->remoteList, nullptr); //atomic exchange
+    if (!b) return false;
+    while (b) {
+        gm_block* next = b->next;
+        uint32_t cls = gm_get_header(b)->cls;
+        b->next = tc->freeList[cls];
+        tc->freeList[cls] = b;
+        tc->freeCount[cls]++;
+        tc->remoteFrees++;
+        b = next;
+    }
+    return true;
+}
+
+static void gm_refill(gm_tcache* tc, uint32_t cls) {
+    tc->refills++;
+    if (gm_drain_remote(tc) && tc->freeList[cls]) return;
+
+    size_t blockSize = sizeof(gm_header) + gm_class_sizes[cls];
+    uint32_t batch = GM_REFILL_BYTES/blockSize;
+    futex_lock(&GM->lock);
+    for (uint32_t i = 0; i < batch; i++) {
+        gm_header* hdr = static_cast<gm_header*>(mspace_malloc(GM->mspace_ptr, blockSize));
+        if (!hdr) break;  // take what we got, we only need one
+        hdr->owner = tc;
+        hdr->cls = cls;
+        hdr->tag = GM_HEADER_TAG;
+        gm_block* b = reinterpret_cast<gm_block*>(hdr + 1);
+        b->next = tc->freeList[cls];
+        tc->freeList[cls] = b;
+        tc->freeCount[cls]++;
+    }
+    futex_unlock(&GM->lock);
+    if (!tc->freeList[cls]) panic("gm_malloc(): Out of global heap memory, use a larger GM segment");
+}
+
+//Returns half of an overgrown free list to the mspace
+static void gm_flush(gm_tcache* tc, uint32_t cls) {
+    tc->flushes++;
+    uint32_t n = tc->freeCount[cls]/2;
+    futex_lock(&GM->lock);
+    for (uint32_t i = 0; i < n; i++) {
+        gm_block* b = tc->freeList[cls];
+        tc->freeList[cls] = b->next;
+        mspace_free(GM->mspace_ptr, gm_get_header(b));
+    }
+    futex_unlock(&GM->lock);
+    tc->freeCount[cls] -= n;
+}
+
+
+void gm_thread_fini(uint32_t tid) {
     assert(GM);
-    assert(GM->mspace_ptr);
+    if (tid >= MAX_THREADS || !gm_caches[tid]) return;
+    gm_tcache* tc = gm_caches[tid];
+    gm_caches[tid] = nullptr;
+    tc->retired = true;
+    __sync_synchronize();
+    gm_drain_remote(tc); //frees that raced with retiring stay on the remote list until the cache is reused
+
     futex_lock(&GM->lock);
-    void* ptr = mspace_malloc(GM->mspace_ptr, size);
+    for (uint32_t cls = 0; cls < GM_NUM_CLASSES; cls++) {
+        while (tc->freeList[cls]) {
+            gm_block* b = tc->freeList[cls];
+            tc->freeList[cls] = b->next;
+            mspace_free(GM->mspace_ptr, gm_get_header(b));
+        }
+        tc->freeCount[cls] = 0;
+    }
+    tc->nextRetired = GM->retiredCaches;
+    GM->retiredCaches = tc;
+    GM->numRetired++;
     futex_unlock(&GM->lock);
-    if (!ptr) panic("gm_malloc(): Out of global heap memory, use a larger GM segment");
-    return ptr;
+}
+
+
+void* gm_malloc(size_t size) {
+    assert(GM);
+    assert(GM->mspace_ptr);
+    uint32_t cls = gm_size_class(size);
+    gm_tcache* tc = (cls == GM_RAW_CLASS)? nullptr : gm_get_cache();
+    if (!tc) {
+        futex_lock(&GM->lock);
+        void* base = mspace_malloc(GM->mspace_ptr, sizeof(gm_header) + size);
+        futex_unlock(&GM->lock);
+        return gm_raw_alloc(base, "gm_malloc()");
+    }
+
+    tc->allocs++;
+    if (likely(tc->freeList[cls] != nullptr)) {
+        tc->hits++;
+    } else {
+        gm_refill(tc, cls);
+    }
+    gm_block* b = tc->freeList[cls];
+    tc->freeList[cls] = b->next;
+    tc->freeCount[cls]--;
+    return b;
 }
 
 void* __gm_calloc(size_t num, size_t size) {
     assert(GM);
     assert(GM->mspace_ptr);
+    size_t bytes = num*size;
+    if (size && bytes/size != num) panic("gm_calloc(): Allocation size overflow (%ld x %ld)", num, size);
+    if (gm_size_class(bytes) != GM_RAW_CLASS) {
+        void* ptr = gm_malloc(bytes);
+        memset(ptr, 0, bytes);
+        return ptr;
+    }
     futex_lock(&GM->lock);
-    void* ptr = mspace_calloc(GM->mspace_ptr, num, size);
+    void* base = mspace_calloc(GM->mspace_ptr, 1, sizeof(gm_header) + bytes);
     futex_unlock(&GM->lock);
-    if (!ptr) panic("gm_calloc(): Out of global heap memory, use a larger GM segment");
-    return ptr;
+    return gm_raw_alloc(base, "gm_calloc()");
 }
 
 void* __gm_memalign(size_t blocksize, size_t bytes) {
     assert(GM);
     assert(GM->mspace_ptr);
+    if (blocksize <= sizeof(gm_header)) return gm_malloc(bytes);  // headers keep 16B alignment
+    // No header, gm_free recognizes the chunk by its size word (see GM_HEADER_TAG)
     futex_lock(&GM->lock);
     void* ptr = mspace_memalign(GM->mspace_ptr, blocksize, bytes);
     futex_unlock(&GM->lock);
     if (!ptr) panic("gm_memalign(): Out of global heap memory, use a larger GM segment");
+    assert(gm_get_header(ptr)->tag != GM_HEADER_TAG);
     return ptr;
 }
 
@@ -155,9 +390,44 @@ void* __gm_memalign(size_t blocksize, size_t bytes) {
 void gm_free(void* ptr) {
     assert(GM);
     assert(GM->mspace_ptr);
-    futex_lock(&GM->lock);
-    mspace_free(GM->mspace_ptr, ptr);
-    futex_unlock(&GM->lock);
+    if (!ptr) return;
+    gm_header* hdr = gm_get_header(ptr);
+    if (hdr->tag != GM_HEADER_TAG) { //aligned, straight from the mspace
+        futex_lock(&GM->lock);
+        mspace_free(GM->mspace_ptr, ptr);
+        futex_unlock(&GM->lock);
+        return;
+    }
+    if (hdr->cls == GM_RAW_CLASS) {
+        futex_lock(&GM->lock);
+        mspace_free(GM->mspace_ptr, hdr->base);
+        futex_unlock(&GM->lock);
+        return;
+    }
+
+    assert(hdr->cls < GM_NUM_CLASSES);
+    gm_block* b = static_cast<gm_block*>(ptr);
+    gm_tcache* owner = hdr->owner;
+    uint32_t tid = gm_thread_id();
+    if (tid < MAX_THREADS && owner == gm_caches[tid]) {
+        uint32_t cls = hdr->cls;
+        b->next = owner->freeList[cls];
+        owner->freeList[cls] = b;
+        owner->localFrees++;
+        if (++owner->freeCount[cls]*(sizeof(gm_header) + gm_class_sizes[cls]) > GM_MAX_CACHED_BYTES) {
+            gm_flush(owner, cls);
+        }
+    } else if (owner->retired) {
+        futex_lock(&GM->lock);
+        mspace_free(GM->mspace_ptr, hdr);
+        futex_unlock(&GM->lock);
+    } else {
+        gm_block* head;
+        do {
+            head = owner->remoteList;
+            b->next = head;
+        } while (!__sync_bool_compare_and_swap(&owner->remoteList, head, b));
+    }
 }
 
 
@@ -196,6 +466,18 @@ void* gm_get_secondary_ptr() {
 void gm_stats() {
     assert(GM);
     mspace_malloc_stats(GM->mspace_ptr);
+
+    //Cache stats are read racily; they are only approximate while threads run
+    futex_lock(&GM->lock);
+    fprintf(stderr, "thread caches = %10u (%u retired)\n", GM->numCaches, GM->numRetired);
+    for (gm_tcache* tc = GM->caches; tc; tc = tc->next) {
+        uint64_t cached = 0;
+        for (uint32_t c = 0; c < GM_NUM_CLASSES; c++) cached += tc->freeCount[c]*(sizeof(gm_header) + gm_class_sizes[c]);
+        double hitRate = tc->allocs? 100.0*tc->hits/tc->allocs : 0.0;
+        fprintf(stderr, "cache %4u: allocs %10lu  hits %6.2f%%  refills %8lu  local frees %10lu  remote frees %10lu  flushes %6lu  cached bytes %8lu\n",
+                tc->id, tc->allocs, hitRate, tc->refills, tc->localFrees, tc->remoteFrees, tc->flushes, cached);
+    }
+    futex_unlock(&GM->lock);
 }
 
 bool gm_isready() {
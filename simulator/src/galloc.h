@@ -26,6 +26,7 @@
 #ifndef GALLOC_H_
 #define GALLOC_H_
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -33,6 +34,12 @@ int gm_init(size_t segmentSize);
 
 void gm_attach(int shmid);
 
+// Thread caches: small allocations come from a cache per thread, indexed by the id func returns (less than MAX_THREADS,
+// or an invalid id for threads that should not use one). Without an id function, the process must be single-threaded.
+void gm_set_thread_id_func(uint32_t (*func)());
+void gm_thread_fini(uint32_t tid);  // call when a thread exits, returns its cached blocks
+void gm_forget_thread_caches();  // call in a forked child, the caches it inherited belong to its parent's threads
+
 // C-style interface
 void* gm_malloc(size_t size);
 void* __gm_calloc(size_t num, size_t size);  //deprecated, only used internally
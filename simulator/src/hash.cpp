@@ -24,8 +24,14 @@
  */
 
 #include "hash.h"
+#ifdef __AVX2__
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "log.h"
 #include "mtrand.h"
 
@@ -59,68 +65,87 @@ H3HashFamily::H3HashFamily(uint32_t numFunctions, uint32_t outputBits, uint64_t
             hMatrix[ii*words + jj] = val;
         }
     }
+
+    paddedFuncs = (numFuncs + 3) & ~3;
+    hMatrixT = gm_memalign<uint64_t>(32, words*paddedFuncs);
+    memset(hMatrixT, 0, words*paddedFuncs*sizeof(uint64_t));
+    for (uint32_t ii = 0; ii < numFuncs; ii++) {
+        for (uint32_t jj = 0; jj < words; jj++) {
+            hMatrixT[jj*paddedFuncs + ii] = hMatrix[ii*words + jj];
+        }
+    }
 }
 
 H3HashFamily::~H3HashFamily() {
     gm_free(hMatrix);
+    gm_free(hMatrixT);
 }
 
-/* NOTE: This is fairly well hand-optimized. Go to the commit logs to see the speedup of this function. Main things:
- * 1. resShift indicates how many bits of output are computed (64, 32, 16, or 8). With less than 64 bits, several rounds are folded at the end.
- * 2. The output folding does not mask, the output is expected to be masked by caller.
- * 3. The main loop is hand-unrolled and optimized for ILP.
- * 4. Pre-computing shifted versions of the input does not help, as it increases register pressure.
- *
- * For reference, here is the original, simpler code (computes a 64-bit hash):
- * for (uint32_t x = 0; x < 64; x++) {
- *     res ^= val & hMatrix[id*64 + x];
- *     res = (res << 1) | (res >> 63);
- * }
+/* Vectorized hash(), across functions: each lane computes one function, with
+ * the same operations as hash(), so results are identical. 4 lanes with AVX2
+ * (if the build enables it), else 2 with SSE2; neither has 64-bit rotates, so
+ * they are two shifts and an OR.
  */
-uint64_t H3HashFamily::hash(uint32_t id, uint64_t val) {
-    uint64_t res = 0;
-    assert(id >= 0 && id < numFuncs);
-
-    // 8-way unrolled loop
+#if defined(__AVX2__)
+typedef __m256i H3Vec;
+static const uint32_t H3_LANES = 4;
+static inline H3Vec h3Set1(uint64_t v) {return _mm256_set1_epi64x(v);}
+static inline H3Vec h3Load(const uint64_t* p) {return _mm256_load_si256((const __m256i*)p);}
+static inline void h3Store(uint64_t* p, H3Vec v) {_mm256_storeu_si256((__m256i*)p, v);}
+static inline H3Vec h3And(H3Vec a, H3Vec b) {return _mm256_and_si256(a, b);}
+static inline H3Vec h3Xor(H3Vec a, H3Vec b) {return _mm256_xor_si256(a, b);}
+static inline H3Vec h3Shr(H3Vec a, int k) {return _mm256_srli_epi64(a, k);}
+static inline H3Vec h3Rotl(H3Vec a, int k) {return _mm256_or_si256(_mm256_slli_epi64(a, k), _mm256_srli_epi64(a, 64 - k));}
+#define H3_VECTOR 1
+#elif defined(__SSE2__)
+typedef __m128i H3Vec;
+static const uint32_t H3_LANES = 2;
+static inline H3Vec h3Set1(uint64_t v) {return _mm_set1_epi64x(v);}
+static inline H3Vec h3Load(const uint64_t* p) {return _mm_load_si128((const __m128i*)p);}
+static inline void h3Store(uint64_t* p, H3Vec v) {_mm_storeu_si128((__m128i*)p, v);}
+static inline H3Vec h3And(H3Vec a, H3Vec b) {return _mm_and_si128(a, b);}
+static inline H3Vec h3Xor(H3Vec a, H3Vec b) {return _mm_xor_si128(a, b);}
+static inline H3Vec h3Shr(H3Vec a, int k) {return _mm_srli_epi64(a, k);}
+static inline H3Vec h3Rotl(H3Vec a, int k) {return _mm_or_si128(_mm_slli_epi64(a, k), _mm_srli_epi64(a, 64 - k));}
+#define H3_VECTOR 1
+#endif
+
+void H3HashFamily::hashAll(uint64_t val, uint64_t* out, uint32_t n) {
+    assert(n <= numFuncs);
+#ifdef H3_VECTOR
     uint32_t maxBits = 64 >> resShift;
-    for (uint32_t x = 0; x < maxBits; x+=8) {
-        uint32_t base = (id << (6 - resShift)) + x;
-        uint64_t res0 = val & hMatrix[base];
-        uint64_t res1 = val & hMatrix[base+1];
-        uint64_t res2 = val & hMatrix[base+2];
-        uint64_t res3 = val & hMatrix[base+3];
-
-        uint64_t res4 = val & hMatrix[base+4];
-        uint64_t res5 = val & hMatrix[base+5];
-        uint64_t res6 = val & hMatrix[base+6];
-        uint64_t res7 = val & hMatrix[base+7];
-
-        res ^= res0 ^ ((res1 << 1) | (res1 >> 63)) ^ ((res2 << 2) | (res2 >> 62)) ^ ((res3 << 3) | (res3 >> 61));
-        res ^= ((res4 << 4) | (res4 >> 60)) ^ ((res5 << 5) | (res5 >> 59)) ^ ((res6 << 6) | (res6 >> 58)) ^ ((res7 << 7) | (res7 >> 57));
-        res = (res << 8) | (res >> 56);
-    }
-
-    // Fold bits to match output
-    switch (resShift) {
-        case 0: //64-bit output
-            break;
-        case 1: //32-bit output
-            res = (res >> 32) ^ res;
-            break;
-        case 2: //16-bit output
-            res = (res >> 32) ^ res;
-            res = (res >> 16) ^ res;
-            break;
-        case 3: //8-bit output
-            res = (res >> 32) ^ res;
-            res = (res >> 16) ^ res;
-            res = (res >> 8) ^ res;
-            break;
-    }
+    H3Vec v = h3Set1(val);
+    for (uint32_t id = 0; id < n; id += H3_LANES) {
+        H3Vec res = h3Set1(0);
+        for (uint32_t x = 0; x < maxBits; x+=8) {
+            const uint64_t* m = &hMatrixT[x*paddedFuncs + id];
+            H3Vec res0 = h3And(v, h3Load(m));
+            H3Vec res1 = h3And(v, h3Load(m + paddedFuncs));
+            H3Vec res2 = h3And(v, h3Load(m + 2*paddedFuncs));
+            H3Vec res3 = h3And(v, h3Load(m + 3*paddedFuncs));
+
+            H3Vec res4 = h3And(v, h3Load(m + 4*paddedFuncs));
+            H3Vec res5 = h3And(v, h3Load(m + 5*paddedFuncs));
+            H3Vec res6 = h3And(v, h3Load(m + 6*paddedFuncs));
+            H3Vec res7 = h3And(v, h3Load(m + 7*paddedFuncs));
+
+            res = h3Xor(res, h3Xor(h3Xor(res0, h3Rotl(res1, 1)), h3Xor(h3Rotl(res2, 2), h3Rotl(res3, 3))));
+            res = h3Xor(res, h3Xor(h3Xor(h3Rotl(res4, 4), h3Rotl(res5, 5)), h3Xor(h3Rotl(res6, 6), h3Rotl(res7, 7))));
+            res = h3Rotl(res, 8);
+        }
 
-    //info("0x%lx", res);
+        // Fold bits to match output (same cases as hash())
+        if (resShift >= 1) res = h3Xor(h3Shr(res, 32), res);
+        if (resShift >= 2) res = h3Xor(h3Shr(res, 16), res);
+        if (resShift >= 3) res = h3Xor(h3Shr(res, 8), res);
 
-    return res;
+        uint64_t lanes[H3_LANES];
+        h3Store(lanes, res);
+        for (uint32_t l = 0; l < H3_LANES && id + l < n; l++) out[id + l] = lanes[l];
+    }
+#else
+    for (uint32_t id = 0; id < n; id++) out[id] = hash(id, val);
+#endif
 }
 
 #if _WITH_POLARSSL_
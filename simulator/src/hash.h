@@ -28,6 +28,7 @@
 
 #include <stdint.h>
 #include "galloc.h"
+#include "log.h"
 
 class HashFamily : public GlobAlloc {
     public:
@@ -35,6 +36,11 @@ class HashFamily : public GlobAlloc {
         virtual ~HashFamily() {}
 
         virtual uint64_t hash(uint32_t id, uint64_t val) = 0;
+
+        //Hashes val with functions 0..n-1, into out[0..n-1]; families that can do them together (e.g., with SIMD) override it
+        virtual void hashAll(uint64_t val, uint64_t* out, uint32_t n) {
+            for (uint32_t id = 0; id < n; id++) out[id] = hash(id, val);
+        }
 };
 
 class H3HashFamily : public HashFamily {
@@ -42,10 +48,13 @@ class H3HashFamily : public HashFamily {
         const uint32_t numFuncs;
         uint32_t resShift;
         uint64_t* hMatrix;
+        uint64_t* hMatrixT; //transposed, [word][function], with functions padded to a multiple of 4, for hashAll()
+        uint32_t paddedFuncs;
     public:
         H3HashFamily(uint32_t numFunctions, uint32_t outputBits, uint64_t randSeed = 123132127);
         virtual ~H3HashFamily();
         uint64_t hash(uint32_t id, uint64_t val);
+        void hashAll(uint64_t val, uint64_t* out, uint32_t n);
 };
 
 class SHA1HashFamily : public HashFamily {
@@ -61,6 +70,66 @@ class SHA1HashFamily : public HashFamily {
         uint64_t hash(uint32_t id, uint64_t val);
 };
 
+/* Defined here so that callers that know the hash family (see SpecializedSetAssocArray) can inline it.
+ *
+ * NOTE: This is fairly well hand-optimized. Go to the commit logs to see the speedup of this function. Main things:
+ * 1. resShift indicates how many bits of output are computed (64, 32, 16, or 8). With less than 64 bits, several rounds are folded at the end.
+ * 2. The output folding does not mask, the output is expected to be masked by caller.
+ * 3. The main loop is hand-unrolled and optimized for ILP.
+ * 4. Pre-computing shifted versions of the input does not help, as it increases register pressure.
+ *
+ * For reference, here is the original, simpler code (computes a 64-bit hash):
+ * for (uint32_t x = 0; x < 64; x++) {
+ *     res ^= val & hMatrix[id*64 + x];
+ *     res = (res << 1) | (res >> 63);
+ * }
+ */
+inline uint64_t H3HashFamily::hash(uint32_t id, uint64_t val) {
+    uint64_t res = 0;
+    assert(id >= 0 && id < numFuncs);
+
+    // 8-way unrolled loop
+    uint32_t maxBits = 64 >> resShift;
+    for (uint32_t x = 0; x < maxBits; x+=8) {
+        uint32_t base = (id << (6 - resShift)) + x;
+        uint64_t res0 = val & hMatrix[base];
+        uint64_t res1 = val & hMatrix[base+1];
+        uint64_t res2 = val & hMatrix[base+2];
+        uint64_t res3 = val & hMatrix[base+3];
+
+        uint64_t res4 = val & hMatrix[base+4];
+        uint64_t res5 = val & hMatrix[base+5];
+        uint64_t res6 = val & hMatrix[base+6];
+        uint64_t res7 = val & hMatrix[base+7];
+
+        res ^= res0 ^ ((res1 << 1) | (res1 >> 63)) ^ ((res2 << 2) | (res2 >> 62)) ^ ((res3 << 3) | (res3 >> 61));
+        res ^= ((res4 << 4) | (res4 >> 60)) ^ ((res5 << 5) | (res5 >> 59)) ^ ((res6 << 6) | (res6 >> 58)) ^ ((res7 << 7) | (res7 >> 57));
+        res = (res << 8) | (res >> 56);
+    }
+
+    // Fold bits to match output
+    switch (resShift) {
+        case 0: //64-bit output
+            break;
+        case 1: //32-bit output
+            res = (res >> 32) ^ res;
+            break;
+        case 2: //16-bit output
+            res = (res >> 32) ^ res;
+            res = (res >> 16) ^ res;
+            break;
+        case 3: //8-bit output
+            res = (res >> 32) ^ res;
+            res = (res >> 16) ^ res;
+            res = (res >> 8) ^ res;
+            break;
+    }
+
+    //info("0x%lx", res);
+
+    return res;
+}
+
 /* Used when we don't want hashing, just return the value */
 class IdHashFamily : public HashFamily {
     public:
@@ -0,0 +1,265 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hybrid_mem_ctrl.h"
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include "bithacks.h"
+#include "ramulator_mem_ctrl.h"
+#include "zsim.h"
+
+HybridMemory::HybridMemory(Ramulator* fast, Ramulator* slow, uint32_t lineSize, uint32_t pageSize, uint64_t fastCapacity,
+        uint32_t _epochPhases, uint32_t _migrationsPerEpoch, uint32_t _hotThreshold, const g_string& _name)
+    : name(_name), epochPhases(_epochPhases), epoch(0), migrationsPerEpoch(_migrationsPerEpoch), hotThreshold(_hotThreshold)
+{
+    if (pageSize < lineSize || !isPow2(pageSize)) panic("%s: page size (%d) must be a power of 2 >= the line size", name.c_str(), pageSize);
+    if (!epochPhases) panic("%s: epochPhases must be > 0", name.c_str());
+    tiers[FAST] = fast;
+    tiers[SLOW] = slow;
+    pageBits = ilog2(pageSize/lineSize);
+    fastFrames = fastCapacity/pageSize;
+    if (!fastFrames) panic("%s: fast tier must hold at least one page", name.c_str());
+    nextFrame[FAST] = nextFrame[SLOW] = 0;
+    fastPages.resize(fastFrames);
+
+    hotListSize = MAX(2*migrationsPerEpoch, 1u);
+    hotList.reserve(hotListSize);
+    coldHand = 0;
+    coldScan = MAX(8*migrationsPerEpoch, 1u);
+    migrations = gm_calloc<Migration>(MAX(migrationsPerEpoch, 1u));
+    finishedMigrations = 0;
+
+    futex_init(&lock);
+    zinfo->eventQueue->insert(new EpochEvent(this, epochPhases));
+    info("%s: %ld fast pages of %d bytes, epoch %d phases, up to %d migrations/epoch", name.c_str(), fastFrames, pageSize, epochPhases, migrationsPerEpoch);
+}
+
+void HybridMemory::initStats(AggregateStat* parentStat) {
+    AggregateStat* memStats = new AggregateStat();
+    memStats->init(name.c_str(), "Hybrid memory stats");
+    profFastAccesses.init("fastAcc", "Accesses served by the fast tier"); memStats->append(&profFastAccesses);
+    profSlowAccesses.init("slowAcc", "Accesses served by the slow tier"); memStats->append(&profSlowAccesses);
+    profEpochs.init("epochs", "Migration epochs"); memStats->append(&profEpochs);
+    profMigrations.init("migrations", "Pages moved between tiers"); memStats->append(&profMigrations);
+    profMigrationLines.init("migrationLines", "Lines copied by migrations (each is one read and one write)"); memStats->append(&profMigrationLines);
+    parentStat->append(memStats);
+    tiers[FAST]->initStats(parentStat);
+    tiers[SLOW]->initStats(parentStat);
+}
+
+HybridMemory::Page& HybridMemory::lookup(Address pageAddr) {
+    g_unordered_map<Address, Page>::iterator it = pages.find(pageAddr);
+    if (it != pages.end()) return it->second;
+
+    // First touch: fill the fast tier, then spill to the slow one
+    Page page;
+    page.addr = pageAddr;
+    page.epoch = epoch;
+    page.hotness = 0;
+    page.migrating = false;
+    page.hotListed = false;
+    if (nextFrame[FAST] < fastFrames) {
+        page.tier = FAST;
+        page.frame = nextFrame[FAST]++;
+        fastPages[page.frame] = pageAddr;
+    } else if (!freeSlowFrames.empty()) {
+        page.tier = SLOW;
+        page.frame = freeSlowFrames.back();
+        freeSlowFrames.pop_back();
+    } else {
+        page.tier = SLOW;
+        page.frame = nextFrame[SLOW]++;
+    }
+    return pages.insert(std::make_pair(pageAddr, page)).first->second;
+}
+
+// Halves the counter once per epoch since the page was last looked at
+inline uint32_t HybridMemory::hotness(Page& page) {
+    if (page.epoch != epoch) {
+        uint64_t shift = epoch - page.epoch;
+        page.hotness = (shift < 32)? page.hotness >> shift : 0;
+        page.epoch = epoch;
+    }
+    return page.hotness;
+}
+
+// Lists a hot slow page, replacing the coldest listed one if the list is full
+void HybridMemory::trackHot(Page& page) {
+    if (hotList.size() < hotListSize) {
+        hotList.push_back(&page);
+        page.hotListed = true;
+        return;
+    }
+    uint32_t coldest = 0;
+    for (uint32_t i = 1; i < hotList.size(); i++) {
+        if (hotness(*hotList[i]) < hotness(*hotList[coldest])) coldest = i;
+    }
+    if (hotness(*hotList[coldest]) < page.hotness) {
+        hotList[coldest]->hotListed = false;
+        hotList[coldest] = &page;
+        page.hotListed = true;
+    }
+}
+
+uint64_t HybridMemory::access(MemReq& req) {
+    Address lineAddr = req.lineAddr;
+
+    futex_lock(&lock);
+    if (unlikely(finishedMigrations)) applyMigrations();
+    Page& page = lookup(lineAddr >> pageBits);
+    if (hotness(page) < MAX_HOTNESS) page.hotness++;
+    if (page.tier == SLOW && page.hotness >= hotThreshold && !page.hotListed && !page.migrating) trackHot(page);
+    Ramulator* mem = tiers[page.tier];
+    Address tierAddr = (page.frame << pageBits) | (lineAddr & ((1 << pageBits) - 1));
+    if (!req.is(MemReq::WARM)) { //warming accesses update hotness, but are not profiled
+        if (page.tier == FAST) profFastAccesses.inc();
+        else profSlowAccesses.inc();
+    }
+    futex_unlock(&lock);
+
+    req.lineAddr = tierAddr;
+    uint64_t respCycle = mem->access(req);
+    req.lineAddr = lineAddr;
+    return respCycle;
+}
+
+void HybridMemory::transferPage(uint32_t tier, uint64_t frame, bool isWrite, Migration* m) {
+    for (Address line = 0; line < (1ul << pageBits); line++) {
+        tiers[tier]->enqueueBackground((frame << pageBits) | line, isWrite, [this, m]() {lineCopied(m);});
+    }
+}
+
+// Called from the weave phase as each background request completes
+void HybridMemory::lineCopied(Migration* m) {
+    assert(m->pendingLines);
+    if (__sync_sub_and_fetch(&m->pendingLines, 1) == 0) __sync_fetch_and_add(&finishedMigrations, 1);
+}
+
+// Called with the lock held. Pages switch tiers only now that all of their lines are in the new one
+void HybridMemory::applyMigrations() {
+    for (uint32_t i = 0; i < migrationsPerEpoch && finishedMigrations; i++) {
+        Migration* m = &migrations[i];
+        if (!m->active || m->pendingLines) continue;
+        m->toFast->tier = FAST;
+        m->toFast->frame = m->fastFrame;
+        m->toFast->migrating = false;
+        if (m->toSlow) {
+            m->toSlow->tier = SLOW;
+            m->toSlow->frame = m->slowFrame;
+            m->toSlow->migrating = false;
+        } else {
+            freeSlowFrames.push_back(m->slowFrame);  // plain move, its old frame is no longer read
+        }
+        m->active = false;
+        __sync_fetch_and_sub(&finishedMigrations, 1);
+    }
+}
+
+void HybridMemory::startMigration(Migration* m) {
+    m->active = true;
+    m->toFast->migrating = true;
+    if (m->toSlow) m->toSlow->migrating = true;
+    fastPages[m->fastFrame] = m->toFast->addr;
+
+    uint32_t lines = 1 << pageBits;
+    if (m->toSlow) {
+        // Swap: both pages are read before either is written
+        m->pendingLines = 4*lines;
+        transferPage(FAST, m->fastFrame, false, m);
+        transferPage(SLOW, m->slowFrame, false, m);
+        transferPage(FAST, m->fastFrame, true, m);
+        transferPage(SLOW, m->slowFrame, true, m);
+        profMigrations.inc(2);
+        profMigrationLines.inc(2*lines);
+    } else {
+        m->pendingLines = 2*lines;
+        transferPage(SLOW, m->slowFrame, false, m);
+        transferPage(FAST, m->fastFrame, true, m);
+        profMigrations.inc();
+        profMigrationLines.inc(lines);
+    }
+}
+
+// Phase-end event; work is bounded by the hot list, the cold sample and the migration slots
+void HybridMemory::endEpoch() {
+    futex_lock(&lock);
+    profEpochs.inc();
+    if (finishedMigrations) applyMigrations();
+
+    // Hottest listed slow pages, hottest first
+    g_vector<std::pair<uint32_t, Page*>> hot;
+    for (Page* p : hotList) {
+        p->hotListed = false;
+        if (p->tier == SLOW && !p->migrating && hotness(*p) >= hotThreshold) hot.push_back(std::make_pair(p->hotness, p));
+    }
+    hotList.clear();
+    uint32_t freeSlots = 0;
+    for (uint32_t i = 0; i < migrationsPerEpoch; i++) freeSlots += !migrations[i].active;
+    size_t moves = std::min(hot.size(), (size_t)freeSlots);
+    // Ties go to the lower address, so the order does not depend on where pages were allocated
+    std::partial_sort(hot.begin(), hot.begin() + moves, hot.end(), [](const std::pair<uint32_t, Page*>& a, const std::pair<uint32_t, Page*>& b) {
+        return (a.first != b.first)? a.first > b.first : a.second->addr < b.second->addr;
+    });
+
+    // Coldest fast pages among the next coldScan frames, coldest first
+    g_vector<std::pair<uint32_t, uint64_t>> cold;
+    if (moves && nextFrame[FAST] == fastFrames) {
+        uint64_t scan = std::min((uint64_t)coldScan, fastFrames);
+        for (uint64_t i = 0; i < scan; i++) {
+            uint64_t f = coldHand;
+            coldHand = (coldHand + 1) % fastFrames;
+            Page& p = pages[fastPages[f]];
+            if (!p.migrating) cold.push_back(std::make_pair(hotness(p), f));
+        }
+    }
+    size_t victims = std::min(cold.size(), moves);
+    std::partial_sort(cold.begin(), cold.begin() + victims, cold.end());
+
+    uint32_t slot = 0;
+    size_t v = 0;
+    for (size_t h = 0; h < moves; h++) {
+        while (migrations[slot].active) slot++;
+        Migration* m = &migrations[slot];
+        m->toFast = hot[h].second;
+        m->slowFrame = m->toFast->frame;
+
+        if (nextFrame[FAST] < fastFrames) {
+            // Free fast frame, plain move
+            m->toSlow = nullptr;
+            m->fastFrame = nextFrame[FAST]++;
+        } else {
+            // Swap with a colder fast page
+            if (v == victims || cold[v].first >= hot[h].first) break;
+            m->fastFrame = cold[v++].second;
+            m->toSlow = &pages[fastPages[m->fastFrame]];
+        }
+        startMigration(m);
+    }
+
+    // Age all counters (lazily, see hotness()) so that hotness reflects recent epochs
+    epoch++;
+    futex_unlock(&lock);
+}
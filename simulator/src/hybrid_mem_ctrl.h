@@ -0,0 +1,144 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HYBRID_MEM_CTRL_H_
+#define HYBRID_MEM_CTRL_H_
+
+#include "event_queue.h"
+#include "g_std/g_string.h"
+#include "g_std/g_unordered_map.h"
+#include "g_std/g_vector.h"
+#include "locks.h"
+#include "memory_hierarchy.h"
+#include "pad.h"
+#include "stats.h"
+
+class Ramulator;
+
+/* Two-tier memory made of two Ramulator instances, e.g., HBM as a small fast
+ * tier in front of DDR4 or PCM as the capacity tier.
+ *
+ * Placement is hardware-managed at page granularity. Pages are allocated on
+ * first touch, in the fast tier until it fills up and in the slow tier after
+ * that, reusing the slow frames that migrated pages left behind. Every page
+ * keeps a saturating access counter that is halved at the end of each epoch
+ * (lazily, when the page is next looked at). Slow pages
+ * that reach hotThreshold enter a bounded hot list as they are accessed, and
+ * a clock hand samples a bounded window of fast frames for cold pages, so
+ * epochs never scan all pages. At the end of each epoch (a phase-end event,
+ * off the access path), the hottest listed pages are swapped with the
+ * coldest sampled ones (if they are hotter). The lines of both pages are
+ * read from their old tier and written to the new one as background traffic,
+ * so migrations contend with demand accesses in both tiers, and pages keep
+ * their old location until all of their lines have been copied.
+ */
+class HybridMemory : public MemObject {
+    private:
+        enum Tier {FAST = 0, SLOW = 1};
+
+        struct Page {
+            Address addr;
+            uint64_t frame;
+            uint64_t epoch;  // hotness is aged up to this epoch
+            uint32_t tier;
+            uint32_t hotness;
+            bool migrating;
+            bool hotListed;
+        };
+
+        // A page moving to the fast tier and, on swaps, the one it evicts to the slow tier
+        struct Migration {
+            Page* toFast;
+            Page* toSlow;
+            uint64_t fastFrame;
+            uint64_t slowFrame;
+            volatile uint32_t pendingLines;  // background requests that have not completed
+            bool active;
+        };
+
+        class EpochEvent : public Event {
+            private:
+                HybridMemory* mem;
+            public:
+                EpochEvent(HybridMemory* _mem, uint64_t _period) : Event(_period), mem(_mem) {}
+                void callback() { mem->endEpoch(); }
+        };
+
+        static const uint32_t MAX_HOTNESS = (1 << 16) - 1;
+
+        Ramulator* tiers[2];
+        g_string name;
+
+        uint32_t pageBits;  // log2 of lines per page
+        uint64_t fastFrames;  // pages that fit in the fast tier
+        uint64_t nextFrame[2];  // first-touch allocation pointers
+        g_vector<uint64_t> freeSlowFrames;  // vacated by pages that moved to a free fast frame, reused before nextFrame[SLOW]
+
+        g_unordered_map<Address, Page> pages;  // never erased, so Page pointers stay valid
+        g_vector<Address> fastPages;  // fast frame -> page
+
+        uint32_t epochPhases;
+        uint64_t epoch;
+        uint32_t migrationsPerEpoch;
+        uint32_t hotThreshold;
+
+        g_vector<Page*> hotList;  // up to hotListSize slow pages at or above hotThreshold, unordered
+        uint32_t hotListSize;
+        uint64_t coldHand;  // next fast frame to sample
+        uint32_t coldScan;  // fast frames sampled per epoch
+
+        Migration* migrations;  // migrationsPerEpoch slots, so at most that many are in flight
+        volatile uint32_t finishedMigrations;  // completed but not applied yet
+
+        PAD();
+        lock_t lock;
+        Counter profFastAccesses;
+        Counter profSlowAccesses;
+        Counter profEpochs;
+        Counter profMigrations;
+        Counter profMigrationLines;
+        PAD();
+
+    public:
+        HybridMemory(Ramulator* fast, Ramulator* slow, uint32_t lineSize, uint32_t pageSize, uint64_t fastCapacity,
+                uint32_t _epochPhases, uint32_t _migrationsPerEpoch, uint32_t _hotThreshold, const g_string& _name);
+
+        uint64_t access(MemReq& req);
+
+        const char* getName() {return name.c_str();}
+        void initStats(AggregateStat* parentStat);
+
+    private:
+        Page& lookup(Address pageAddr);
+        inline uint32_t hotness(Page& page);
+        void trackHot(Page& page);
+        void endEpoch();
+        void startMigration(Migration* m);
+        void lineCopied(Migration* m);
+        void applyMigrations();
+        void transferPage(uint32_t tier, uint64_t frame, bool isWrite, Migration* m);
+};
+
+#endif  // HYBRID_MEM_CTRL_H_
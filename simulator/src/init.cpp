@@ -34,16 +34,21 @@
 #include "accelerator_core.h"
 #include "cache.h"
 #include "cache_arrays.h"
+#include "checkpoint.h"
+#include "compressed_array.h"
+#include "compressors.h"
 #include "config.h"
 #include "constants.h"
 #include "contention_sim.h"
 #include "core.h"
+#include "data_shadow.h"
 #include "decoder.h"
 #include "detailed_mem.h"
 #include "detailed_mem_params.h"
 #include "ddr_mem.h"
 #include "debug_zsim.h"
 #include "dramsim_mem_ctrl.h"
+#include "hybrid_mem_ctrl.h"
 #include "ramulator_mem_ctrl.h"
 #include "event_queue.h"
 #include "filter_cache.h"
@@ -59,15 +64,21 @@
 #include "null_core.h"
 #include "ooo_core.h"
 #include "part_repl_policies.h"
+#include "phase_controller.h"
 #include "pin_cmd.h"
+#include "prefetch_engines.h"
 #include "prefetcher.h"
 #include "proc_stats.h"
 #include "process_stats.h"
 #include "process_tree.h"
+#include "sampling.h"
+#include "sparse_dir_cc.h"
 #include "profile_stats.h"
 #include "repl_policies.h"
+#include "rrip_repl_policies.h"
 #include "scheduler.h"
 #include "simple_core.h"
+#include "specialized_arrays.h"
 #include "stats.h"
 #include "stats_filter.h"
 #include "str.h"
@@ -88,6 +99,24 @@ extern void EndOfPhaseActions(); //in zsim.cpp
  * follow the layout of zinfo, top-down.
  */
 
+// Compression algorithms (see compressors.h); nullptr for None
+static Compressor* BuildCompressor(const string& type, const char* owner) {
+    if (type == "None") return nullptr;
+    else if (type == "BDI") return new BDICompressor();
+    else if (type == "FPC") return new FPCCompressor();
+    else if (type == "CPack") return new CPackCompressor();
+    panic("%s: Invalid compression type %s", owner, type.c_str());
+}
+
+// The line values every compressor reads, created by the first one
+static DataShadow* GetDataShadow(Config& config) {
+    if (!zinfo->dataShadow) {
+        if (zinfo->traceDriven) warn("Trace-driven runs have no line values, compression will find every line incompressible");
+        zinfo->dataShadow = new DataShadow(config.get<uint32_t>("sys.compression.shadowLines", 256*1024), zinfo->lineSize);
+    }
+    return zinfo->dataShadow;
+}
+
 BaseCache* BuildCacheBank(Config& config, const string& prefix, g_string& name, uint32_t bankSize, bool isTerminal, uint32_t domain) {
     string type = config.get<const char*>(prefix + "type", "Simple");
     // Shortcut for TraceDriven type
@@ -122,6 +151,19 @@ BaseCache* BuildCacheBank(Config& config, const string& prefix, g_string& name,
         panic("%s: Invalid array type %s", name.c_str(), arrayType.c_str());
     }
 
+    // Compression: the array has tagFactor times more tags than uncompressed lines fit in its data space
+    string compressionType = config.get<const char*>(prefix + "compression.type", "None");
+    Compressor* compressor = BuildCompressor(compressionType, name.c_str());
+    uint32_t tagFactor = compressor? config.get<uint32_t>(prefix + "compression.tagFactor", 2) : 1;
+    uint32_t dataWays = ways;
+    if (compressor) {
+        if (isTerminal || arrayType != "SetAssoc") panic("%s: compression needs a non-terminal cache with a SetAssoc array", name.c_str());
+        if (!tagFactor) panic("%s: compression.tagFactor must be at least 1", name.c_str());
+        numLines *= tagFactor;
+        ways *= tagFactor;
+        candidates = ways;
+    }
+
     // Power of two sets check; also compute setBits, will be useful later
     uint32_t numSets = numLines/ways;
     uint32_t setBits = 31 - __builtin_clz(numSets);
@@ -169,6 +211,14 @@ BaseCache* BuildCacheBank(Config& config, const string& prefix, g_string& name,
         rp = new NRUReplPolicy(numLines, candidates);
     } else if (replType == "Rand") {
         rp = new RandReplPolicy(candidates);
+    } else if (replType == "SRRIP" || replType == "BRRIP" || replType == "DRRIP") {
+        uint32_t rrpvBits = config.get<uint32_t>(prefix + "repl.rrpvBits", 2);
+        RRIPReplPolicy::Mode mode = (replType == "SRRIP")? RRIPReplPolicy::SRRIP : (replType == "BRRIP")? RRIPReplPolicy::BRRIP : RRIPReplPolicy::DRRIP;
+        rp = new RRIPReplPolicy(numLines, rrpvBits, mode);
+    } else if (replType == "SHiP") {
+        rp = new SHiPReplPolicy(numLines, config.get<uint32_t>(prefix + "repl.rrpvBits", 2));
+    } else if (replType == "Hawkeye") {
+        rp = new HawkeyeReplPolicy(numLines, candidates); //OPTgen models the associativity the policy sees, which on Z arrays is the candidates
     } else if (replType == "WayPart" || replType == "Vantage" || replType == "IdealLRUPart") {
         if (replType == "WayPart" && arrayType != "SetAssoc") panic("WayPart replacement requires SetAssoc array");
 
@@ -236,8 +286,14 @@ BaseCache* BuildCacheBank(Config& config, const string& prefix, g_string& name,
 
     //Alright, build the array
     CacheArray* array = nullptr;
-    if (arrayType == "SetAssoc") {
-        array = new SetAssocArray(numLines, ways, rp, hf);
+    CompressedSetAssocArray* carray = nullptr;
+    if (compressor) {
+        carray = new CompressedSetAssocArray(numLines, ways, dataWays, rp, hf, compressor, GetDataShadow(config), lineSize);
+        array = carray;
+    } else if (arrayType == "SetAssoc") {
+        //Devirtualized hashing and replacement (and SIMD tag compares) for common combinations; same behavior
+        if (config.get<bool>(prefix + "array.specialized", true)) array = BuildSpecializedSetAssocArray(numLines, ways, rp, hf);
+        if (!array) array = new SetAssocArray(numLines, ways, rp, hf);
     } else if (arrayType == "Z") {
         array = new ZArray(numLines, ways, candidates, rp, hf);
     } else if (arrayType == "IdealLRU") {
@@ -272,15 +328,29 @@ BaseCache* BuildCacheBank(Config& config, const string& prefix, g_string& name,
     bool nonInclusiveHack = config.get<bool>(prefix + "nonInclusiveHack", false);
     if (nonInclusiveHack) assert(type == "Simple" && !isTerminal);
 
+    // Sparse directory? The cache becomes non-inclusive, and the directory bounds the lines its children can hold.
+    // Like size, entries are for the whole cache, split across banks
+    uint32_t dirEntries = config.get<uint32_t>(prefix + "directory.entries", 0);
+    uint32_t dirWays = config.get<uint32_t>(prefix + "directory.ways", 8);
+    if (dirEntries) {
+        if (isTerminal || nonInclusiveHack || bypass) panic("%s: a directory needs a non-terminal, non-bypassed cache without nonInclusiveHack", name.c_str());
+        uint32_t banks = config.get<uint32_t>(prefix + "banks", 1);
+        if (dirEntries % banks != 0) panic("%s: banks (%d) does not divide the directory entries (%d)", name.c_str(), banks, dirEntries);
+        dirEntries /= banks;
+    }
+
     // Finally, build the cache
     Cache* cache;
     CC* cc;
     if (isTerminal) {
         cc = new MESITerminalCC(numLines, bypass, name);
+    } else if (dirEntries) {
+        cc = new MESISparseDirCC(numLines, dirEntries, dirWays, name);
     } else {
         cc = new MESICC(numLines, nonInclusiveHack, bypass, name);
     }
     rp->setCC(cc);
+    if (carray) carray->setCC(cc);
     if (!isTerminal) {
         if (type == "Simple") {
             cache = new Cache(numLines, cc, array, rp, accLat, invLat, bypass, name);
@@ -288,7 +358,14 @@ BaseCache* BuildCacheBank(Config& config, const string& prefix, g_string& name,
             uint32_t mshrs = config.get<uint32_t>(prefix + "mshrs", 16);
             uint32_t tagLat = config.get<uint32_t>(prefix + "tagLat", 5);
             uint32_t timingCandidates = config.get<uint32_t>(prefix + "timingCandidates", candidates);
-            cache = new TimingCache(numLines, cc, array, rp, accLat, invLat, mshrs, tagLat, ways, timingCandidates, domain, bypass, name);
+            TimingCacheBandwidth bw;
+            bw.tagPorts = config.get<uint32_t>(prefix + "tagPorts", 1);
+            bw.dataPorts = config.get<uint32_t>(prefix + "dataPorts", 0);
+            bw.dataCycles = config.get<uint32_t>(prefix + "dataCycles", 1);
+            bw.fillBuffers = config.get<uint32_t>(prefix + "fillBuffers", 0);
+            bw.wbBuffers = config.get<uint32_t>(prefix + "wbBuffers", 0);
+            bw.coalesce = config.get<bool>(prefix + "coalesce", false);
+            cache = new TimingCache(numLines, cc, array, rp, accLat, invLat, mshrs, tagLat, ways, timingCandidates, domain, bypass, name, bw);
         } else if (type == "Tracing") {
             g_string traceFile = config.get<const char*>(prefix + "traceFile","");
             if (traceFile.empty()) traceFile = g_string(zinfo->outputDir) + "/" + name + ".trace";
@@ -300,7 +377,19 @@ BaseCache* BuildCacheBank(Config& config, const string& prefix, g_string& name,
         //Filter cache optimization
         if (type != "Simple") panic("Terminal cache %s can only have type == Simple", name.c_str());
         if (arrayType != "SetAssoc" || hashType != "None" || replType != "LRU") panic("Invalid FilterCache config %s", name.c_str());
-        cache = new FilterCache(numSets, numLines, cc, array, rp, accLat, invLat, bypass, name);
+        FilterCache* fcache = new FilterCache(numSets, numLines, cc, array, rp, accLat, invLat, bypass, name);
+        fcache->setWriteCombining(config.get<uint32_t>(prefix + "wcBuffers", 10)); //for non-temporal stores; Nehalem-Haswell have 10 fill buffers
+        cache = fcache;
+    }
+
+    //Everything the layout of the checkpointed state depends on; latencies and cache type do not matter
+    if (zinfo->checkpoints) {
+        stringstream geometry;
+        geometry << arrayType << " " << numLines << " lines " << ways << " ways " << candidates << " candidates "
+            << hashType << " hash " << replType << " repl" << (isTerminal? " terminal" : "") << (nonInclusiveHack? " nonInclusive" : "");
+        if (dirEntries) geometry << " dir " << dirEntries << "x" << dirWays;
+        if (compressor) geometry << " " << compressionType << " compressed " << dataWays << " data ways";
+        zinfo->checkpoints->addCache(cache, g_string(geometry.str().c_str()));
     }
 
 #if 0
@@ -336,6 +425,26 @@ DDRMemory* BuildDDRMemory(Config& config, uint32_t lineSize, uint32_t frequency,
     return mem;
 }
 
+// sys.mem.controllers, or one controller per sys.mem.coresPerController cores if set
+static uint32_t NumMemControllers(Config& config) {
+    uint32_t coresPerController = config.get<uint32_t>("sys.mem.coresPerController", 0);
+    if (coresPerController) return (zinfo->numCores + coresPerController - 1)/coresPerController;
+    return config.get<uint32_t>("sys.mem.controllers", 1);
+}
+
+Ramulator* BuildRamulatorMemory(Config& config, uint32_t lineSize, uint32_t frequency, uint32_t domain, g_string name, const string& prefix, const string& application) {
+    string ramulatorConfig = config.get<const char*>(prefix + "ramulatorConfig");
+    uint32_t latency = config.get<uint32_t>(prefix + "latency", 100);
+    bool pimMode = config.get<bool>("sim.pimMode", false);
+    bool networkOverhead = config.get<bool>("sim.networkOverhead", false);
+    bool record_memory_trace = config.get<bool>("sim.recordMemoryTrace", false);
+    cout << "Application name at init: " << application << "\n";
+    Ramulator* mem = new Ramulator(ramulatorConfig, zinfo->numCores, lineSize, latency, domain, name, pimMode, application, frequency, record_memory_trace,networkOverhead);
+    zinfo -> ramulator_memory = true;
+    zinfo -> ramulators->push_back(mem);
+    return mem;
+}
+
 MemObject* BuildMemoryController(Config& config, uint32_t lineSize, uint32_t frequency, uint32_t domain, g_string& name) {
     //Type
     string type = config.get<const char*>("sys.mem.type", "Simple");
@@ -373,15 +482,27 @@ MemObject* BuildMemoryController(Config& config, uint32_t lineSize, uint32_t fre
         string traceName = config.get<const char*>("sys.mem.traceName");
         mem = new DRAMSimMemory(dramTechIni, dramSystemIni, outputDir, traceName, capacity, cpuFreqHz, latency, domain, name);
     } else if (type == "Ramulator") {
-        string ramulatorConfig = config.get<const char*>("sys.mem.ramulatorConfig");
-        bool pimMode = config.get<bool>("sim.pimMode", false);
-        bool networkOverhead = config.get<bool>("sim.networkOverhead", false);
-        bool record_memory_trace = config.get<bool>("sim.recordMemoryTrace", false);
+        // With several controllers, each one writes its own <stats>.<name>.ramulator.stats
         string application = config.get<const char*>("sim.stats");
-        cout << "Application name at init: " << application << "\n";
-        mem = new Ramulator(ramulatorConfig, zinfo->numCores, lineSize, latency, domain, name, pimMode, application, frequency, record_memory_trace,networkOverhead);
-        zinfo ->  ramulator_memory = true;
-        zinfo -> ramulator = static_cast<Ramulator*>(mem);
+        if (NumMemControllers(config) > 1) application += "." + string(name.c_str());
+        Ramulator* rmem = BuildRamulatorMemory(config, lineSize, frequency, domain, name, "sys.mem.", application);
+        Compressor* linkCompressor = BuildCompressor(config.get<const char*>("sys.mem.compression", "None"), name.c_str());
+        if (linkCompressor) rmem->setLinkCompression(linkCompressor, GetDataShadow(config));
+        mem = rmem;
+    } else if (type == "Hybrid") {
+        // Two Ramulator tiers (sys.mem.fast.* and sys.mem.slow.*) with page migration, see hybrid_mem_ctrl.h
+        string application = config.get<const char*>("sim.stats") + string(".") + name.c_str();
+        uint32_t slowDomain = (domain + 1) % zinfo->numDomains;
+        Ramulator* fast = BuildRamulatorMemory(config, lineSize, frequency, domain, name + "-fast", "sys.mem.fast.", application + "-fast");
+        Ramulator* slow = BuildRamulatorMemory(config, lineSize, frequency, slowDomain, name + "-slow", "sys.mem.slow.", application + "-slow");
+        uint32_t pageSize = config.get<uint32_t>("sys.mem.hybrid.pageSize", 4096);
+        uint64_t fastCapacity = ((uint64_t)config.get<uint32_t>("sys.mem.hybrid.fastCapacityMB", 1024)) << 20;
+        uint32_t epochPhases = config.get<uint32_t>("sys.mem.hybrid.epochPhases", 10);
+        uint32_t migrationsPerEpoch = config.get<uint32_t>("sys.mem.hybrid.migrationsPerEpoch", 16);
+        uint32_t hotThreshold = config.get<uint32_t>("sys.mem.hybrid.hotThreshold", 8);
+        mem = new HybridMemory(fast, slow, lineSize, pageSize, fastCapacity, epochPhases, migrationsPerEpoch, hotThreshold, name);
+        // The tiers see frame addresses, not the lines whose values the compressors read
+        if (string(config.get<const char*>("sys.mem.compression", "None")) != "None") panic("Memory-link compression needs the Ramulator memory type");
     } else if (type == "Detailed") {
         // FIXME(dsm): Don't use a separate config file... see DDRMemory
         g_string mcfg = config.get<const char*>("sys.mem.paramFile", "");
@@ -418,6 +539,22 @@ CacheGroup* BuildCacheGroup(Config& config, const string& name, bool isTerminal)
         uint32_t prefetchers = config.get<uint32_t>(prefix + "prefetchers", 1);
         uint32_t entrySize = config.get<uint32_t>(prefix + "entries", 16);
         assert(entrySize > 0);
+        string type = config.get<const char*>(prefix + "type", "Stream");
+
+        //QueuedPrefetcher knobs (see prefetcher.h)
+        uint32_t degree = 0, queueSize = 0, issueInterval = 0, issueBurst = 0, trackedLines = 0, zones = 0;
+        bool throttle = false;
+        if (type != "Stream") {
+            if (zinfo->lineSize < 64) panic("%s: %s prefetcher needs lines of 64 bytes or more", name.c_str(), type.c_str());
+            degree = config.get<uint32_t>(prefix + "degree", 4);
+            queueSize = config.get<uint32_t>(prefix + "queueSize", 32);
+            issueInterval = config.get<uint32_t>(prefix + "issueInterval", 0); //cycles per prefetch, 0 is unlimited
+            issueBurst = config.get<uint32_t>(prefix + "issueBurst", degree);
+            trackedLines = config.get<uint32_t>(prefix + "trackedLines", 256);
+            throttle = config.get<bool>(prefix + "throttle", true);
+            if (type == "IPStride") entrySize = config.get<uint32_t>(prefix + "entries", 64);
+            if (type == "AMPM") zones = config.get<uint32_t>(prefix + "zones", 64);
+        }
 
         cg.resize(prefetchers);
         for (vector<BaseCache*>& bg : cg) bg.resize(1);
@@ -425,7 +562,26 @@ CacheGroup* BuildCacheGroup(Config& config, const string& name, bool isTerminal)
             stringstream ss;
             ss << name << "-" << i;
             g_string pfName(ss.str().c_str());
-            cg[i][0] = new StreamPrefetcher(pfName,bankSize/zinfo->lineSize, entrySize);
+            Prefetcher* pf;
+            if (type == "Stream") {
+                pf = new StreamPrefetcher(pfName,bankSize/zinfo->lineSize, entrySize);
+            } else {
+                PrefetchEngine* engine;
+                if (type == "IPStride") {
+                    engine = new IPStrideEngine(entrySize);
+                } else if (type == "BOP") {
+                    engine = new BestOffsetEngine();
+                } else if (type == "SPP") {
+                    engine = new SPPEngine();
+                } else if (type == "AMPM") {
+                    engine = new AMPMEngine(zones);
+                } else {
+                    panic("%s: Invalid prefetcher type %s", name.c_str(), type.c_str());
+                }
+                pf = new QueuedPrefetcher(pfName, type.c_str(), engine, degree, queueSize, issueInterval, issueBurst, trackedLines, throttle);
+            }
+            if (zinfo->checkpoints) zinfo->checkpoints->addPrefetcher(pf);
+            cg[i][0] = pf;
         }
         return cgp;
     }
@@ -534,7 +690,7 @@ static void InitSystem(Config& config) {
      */
 
     //Build the memory controllers
-    uint32_t memControllers = config.get<uint32_t>("sys.mem.controllers", 1);
+    uint32_t memControllers = NumMemControllers(config);
     assert(memControllers > 0);
 
     g_vector<MemObject*> mems;
@@ -722,6 +878,7 @@ static void InitSystem(Config& config) {
                     FilterCache* dc = dynamic_cast<FilterCache*>(dgroup[assignedCaches[dcache]][0]);
                     assert(dc);
                     dc->setSourceId(coreIdx);
+                    if (zinfo->ffWarmCaches) zinfo->ffWarmCaches[coreIdx] = dc;
                     assignedCaches[dcache]++;
 
                     //Build the core
@@ -819,6 +976,7 @@ static void InitSystem(Config& config) {
     memStat->init("mem", "Memory controller stats");
     for (auto mem : mems) mem->initStats(memStat);
     zinfo->rootStat->append(memStat);
+    if (zinfo->dataShadow) zinfo->dataShadow->initStats(zinfo->rootStat);
 
     //Odds and ends: BuildCacheGroup new'd the cache groups, we need to delete them
     for (pair<string, CacheGroup*> kv : cMap) delete kv.second;
@@ -866,6 +1024,11 @@ static void PostInitStats(bool perProcessDir, Config& config) {
     // Convenience stats
     StatsBackend* textStats = new TextBackend(statsFile, zinfo->rootStat);
     zinfo->statsBackends->push_back(textStats);
+
+    // Final stats as a one-record HDF5 table too, for tools like zsimstats (see stats_reader.h)
+    if (config.get<bool>("sim.hdf5Stats", false)) {
+        zinfo->statsBackends->push_back(new HDF5Backend(pStatsFile, zinfo->rootStat, 0 /*just 1 record*/, zinfo->skipStatsVectors, false /*not compact*/));
+    }
 }
 
 static void InitGlobalStats() {
@@ -931,11 +1094,56 @@ void SimInit(const char* configFile, const char* outputDir, uint32_t shmid) {
     zinfo->eventRecorders = gm_calloc<EventRecorder*>(zinfo->numCores);
 
     zinfo->traceWriters = new g_vector<AccessTraceWriter*>();
+    zinfo->ramulators = new g_vector<Ramulator*>();
 
     // Global simulation values
     zinfo->numPhases = 0;
 
     zinfo->phaseLength = config.get<uint32_t>("sim.phaseLength", 10000);
+    zinfo->nextPhaseLength = zinfo->phaseLength;
+    if (config.get<bool>("sim.adaptivePhaseLength", false)) {
+        // Grow phases through memory-idle stretches and shrink them through memory-dense ones, see phase_controller.h
+        uint32_t minLength = config.get<uint32_t>("sim.minPhaseLength", MAX(zinfo->phaseLength/10, (uint32_t)1));
+        uint32_t maxLength = config.get<uint32_t>("sim.maxPhaseLength", 10*zinfo->phaseLength);
+        bool deterministic = config.get<bool>("sim.deterministicPhaseLength", false);
+        // Thresholds are per 1000 cycles
+        double highDramReqs = config.get<double>("sim.phaseCtrl.highDramReqs", 8.0);
+        double lowDramReqs = config.get<double>("sim.phaseCtrl.lowDramReqs", 1.0);
+        double highWeaveEvents = config.get<double>("sim.phaseCtrl.highWeaveEvents", 200.0);
+        double lowWeaveEvents = config.get<double>("sim.phaseCtrl.lowWeaveEvents", 20.0);
+        double maxBarrierFraction = config.get<double>("sim.phaseCtrl.maxBarrierFraction", 0.3);
+        zinfo->phaseController = new PhaseController(minLength, maxLength, deterministic, highDramReqs, lowDramReqs,
+                highWeaveEvents, lowWeaveEvents, maxBarrierFraction);
+        zinfo->phaseController->initStats(zinfo->rootStat);
+    } else {
+        zinfo->phaseController = nullptr;
+    }
+
+    string samplingMode = config.get<const char*>("sim.sampling.mode", "none");
+    if (samplingMode == "none") {
+        zinfo->sampler = nullptr;
+    } else {
+        // Alternates fast-forward and detailed windows over the ROI of one process, see sampling.h
+        uint32_t samplingProc = config.get<uint32_t>("sim.sampling.process", 0);
+        string samplingFile = string(outputDir) + "/zsim-sampling.txt";
+        uint64_t warmupInstrs = config.get<uint64_t>("sim.sampling.warmupInstrs", 1000000);
+        if (samplingMode == "periodic") {
+            zinfo->sampler = new SamplingController(SamplingController::PERIODIC, samplingProc, samplingFile.c_str());
+            zinfo->sampler->setPeriodic(config.get<uint64_t>("sim.sampling.period", 100000000), warmupInstrs,
+                    config.get<uint64_t>("sim.sampling.detailedInstrs", 1000000), config.get<uint64_t>("sim.sampling.samples", 0));
+        } else if (samplingMode == "simpoints") {
+            zinfo->sampler = new SamplingController(SamplingController::SIMPOINTS, samplingProc, samplingFile.c_str());
+            zinfo->sampler->setSimPoints(config.get<const char*>("sim.sampling.simpointsFile"), config.get<const char*>("sim.sampling.weightsFile"),
+                    config.get<uint64_t>("sim.sampling.intervalInstrs", 10000000), warmupInstrs);
+        } else if (samplingMode == "bbv") {
+            zinfo->sampler = new SamplingController(SamplingController::BBV, samplingProc, samplingFile.c_str());
+            zinfo->sampler->setBBV(config.get<uint64_t>("sim.sampling.intervalInstrs", 10000000));
+        } else {
+            panic("Invalid sim.sampling.mode %s (none, periodic, simpoints or bbv)", samplingMode.c_str());
+        }
+        zinfo->sampler->setConfidence(config.get<uint32_t>("sim.sampling.confidence", 95));
+        zinfo->sampler->initStats(zinfo->rootStat);
+    }
     zinfo->statsPhaseInterval = config.get<uint32_t>("sim.statsPhaseInterval", 100);
     zinfo->freqMHz = config.get<uint32_t>("sys.frequency", 2000);
 
@@ -956,6 +1164,7 @@ void SimInit(const char* configFile, const char* outputDir, uint32_t shmid) {
     zinfo->procEventualDumps = 0;
 
     zinfo->skipStatsVectors = config.get<bool>("sim.skipStatsVectors", false);
+    zinfo->latencyHistograms = config.get<bool>("sim.latencyHistograms", false);
     zinfo->compactPeriodicStats = config.get<bool>("sim.compactPeriodicStats", false);
 
     //Fast-forwarding and magic ops
@@ -963,6 +1172,26 @@ void SimInit(const char* configFile, const char* outputDir, uint32_t shmid) {
     zinfo->ffReinstrument = config.get<bool>("sim.ffReinstrument", false);
     if (zinfo->ffReinstrument) warn("sim.ffReinstrument = true, switching fast-forwarding on a multi-threaded process may be unstable");
 
+    //Functional warming of caches, prefetchers and DRAM rows while fast-forwarding (see MemReq::WARM)
+    zinfo->ffWarmCaches = nullptr;
+    if (config.get<bool>("sim.ffWarming", false)) {
+        if (zinfo->ffReinstrument) panic("sim.ffWarming needs the memory instrumentation that sim.ffReinstrument removes");
+        if (zinfo->traceDriven) panic("sim.ffWarming does not apply to trace-driven simulations");
+        zinfo->ffWarmCaches = gm_calloc<FilterCache*>(zinfo->numCores);
+    }
+
+    //Checkpoints of the warmed hierarchy at ROI begin (see checkpoint.h)
+    zinfo->checkpoints = nullptr;
+    g_string ckptSave = config.get<const char*>("sim.checkpoint.save", "");
+    g_string ckptRestore = config.get<const char*>("sim.checkpoint.restore", "");
+    bool ckptExit = config.get<bool>("sim.checkpoint.exitAfterSave", false);
+    if (!ckptSave.empty() || !ckptRestore.empty()) {
+        if (zinfo->ignoreHooks) panic("sim.checkpoint needs the ROI hooks that sim.ignoreHooks disables");
+        if (zinfo->traceDriven) panic("sim.checkpoint does not apply to trace-driven simulations");
+        if (ckptExit && ckptSave.empty()) panic("sim.checkpoint.exitAfterSave needs sim.checkpoint.save");
+        zinfo->checkpoints = new CheckpointManager(ckptSave, ckptRestore, ckptExit);
+    }
+
     zinfo->registerThreads = config.get<bool>("sim.registerThreads", false);
     zinfo->globalPauseFlag = config.get<bool>("sim.startInGlobalPause", false);
 
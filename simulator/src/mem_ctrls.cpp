@@ -44,6 +44,8 @@ uint64_t SimpleMemory::access(MemReq& req) {
         default: panic("!?");
     }
 
+    if (unlikely(req.is(MemReq::WARM))) return req.cycle; //functional warming, no latency or accounting
+
     uint64_t respCycle = req.cycle + latency;
     assert(respCycle > req.cycle);
 /*
@@ -65,6 +67,7 @@ MD1Memory::MD1Memory(uint32_t requestSize, uint32_t megacyclesPerSecond, uint32_
     : zeroLoadLatency(_zeroLoadLatency), name(_name)
 {
     lastPhase = 0;
+    lastPhaseCycle = 0;
 
     double bytesPerCycle = ((double)megabytesPerSecond)/((double)megacyclesPerSecond);
     maxRequestsPerCycle = bytesPerCycle/requestSize;
@@ -80,7 +83,7 @@ MD1Memory::MD1Memory(uint32_t requestSize, uint32_t megacyclesPerSecond, uint32_
 }
 
 void MD1Memory::updateLatency() {
-    uint32_t phaseCycles = (zinfo->numPhases - lastPhase)*(zinfo->phaseLength);
+    uint64_t phaseCycles = zinfo->globPhaseCycles - lastPhaseCycle;
     if (phaseCycles < 10000) return; //Skip with short phases
 
     smoothedPhaseAccesses =  (curPhaseAccesses*0.5) + (smoothedPhaseAccesses*0.5);
@@ -105,9 +108,16 @@ void MD1Memory::updateLatency() {
     curPhaseAccesses = 0;
     __sync_synchronize();
     lastPhase = zinfo->numPhases;
+    lastPhaseCycle = zinfo->globPhaseCycles;
 }
 
 uint64_t MD1Memory::access(MemReq& req) {
+    if (unlikely(req.is(MemReq::WARM))) {
+        //Functional warming: grant permissions without load or latency accounting
+        *req.state = (req.type == GETX)? M : (req.type == GETS)? (req.is(MemReq::NOEXCL)? S : E) : I;
+        return req.cycle;
+    }
+
     if (zinfo->numPhases > lastPhase) {
         futex_lock(&updateLock);
         //Recheck, someone may have updated already
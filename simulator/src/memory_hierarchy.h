@@ -89,7 +89,7 @@ struct MemReq {
     //Requester id --- used for contention simulation
     uint32_t srcId;
 
-    //Flags propagate across levels, though not to evictions
+    //Flags propagate across levels, though not to evictions (except WARM)
     //Some other things that can be indicated here: Demand vs prefetch accesses, TLB accesses, etc.
     enum Flag {
         IFETCH        = (1<<1), //For instruction fetches. Purely informative for now, does not imply NOEXCL (but ifetches should be marked NOEXCL)
@@ -97,9 +97,16 @@ struct MemReq {
         NONINCLWB     = (1<<3), //This is a non-inclusive writeback. Do not assume that the line was in the lower level. Used on NUCA (BankDir).
         PUTX_KEEPEXCL = (1<<4), //Non-relinquishing PUTX. On a PUTX, maintain the requestor's E state instead of removing the sharer (i.e., this is a pure writeback)
         PREFETCH      = (1<<5), //Prefetch GETS access. Only set at level where prefetch is issued; handled early in MESICC
+        WARM          = (1<<6), //Functional warming access (fast-forward). Updates tags, replacement and coherence state only: no timing records or profiling
+        NONTEMPORAL   = (1<<7), //Streaming write (PUTX from a write-combining buffer). Does not allocate: each level forwards it to its parent, then drops its own copy
+        NTPARTIAL     = (1<<8), //With NONTEMPORAL, the write covers only part of the line: dirty copies are written back before they are dropped, not superseded
     };
     uint32_t flags;
 
+    //Address of the instruction that issued the access, for PC-based replacement policies (see rrip_repl_policies.h). Propagates
+    //across levels like flags; 0 if unknown (e.g., ifetches, prefetches and evictions)
+    Address pc;
+
     inline void set(Flag f) {flags |= f;}
     inline bool is (Flag f) const {return flags & f;}
 };
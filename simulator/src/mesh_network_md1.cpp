@@ -141,7 +141,7 @@ uint32_t MeshNetworkMD1::getRTT(uint64_t curCycle, uint32_t latency, const char*
         futex_lock(&lock);
         // Recheck, someone may have updated already
         if(zinfo->numPhases > lastPhase) {
-            uint64_t phaseCycle = (zinfo->numPhases - 1) * zinfo->phaseLength;
+            uint64_t phaseCycle = zinfo->globPhaseCycles;
             if(lastUpdateCycle + (MESH_NETWORK_MD1_UPDATE_PHASES * zinfo->phaseLength) <= phaseCycle) {
                 for(uint64_t x = 0; x < xDim; x++) {
                     for(uint64_t y = 0; y < yDim; y++) {
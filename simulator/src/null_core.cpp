@@ -86,6 +86,7 @@ void NullCore::BblFunc(THREADID tid, ADDRINT bblAddr, BblInfo* bblInfo) {
         //we're not at risk of racing, even if we were switched out and then switched in.
         uint32_t newCid = TakeBarrier(tid, cid);
         if (newCid != cid) break; /*context-switch*/
+        core->phaseEndCycle = zinfo->globPhaseCycles + zinfo->phaseLength; //the phase length may change at the barrier
     }
 }
 
@@ -159,7 +159,7 @@ void OOOCore::initStats(AggregateStat* parentStat) {
 
 uint64_t OOOCore::getOffloadInstrs() const {return offload_instrs;}
 uint64_t OOOCore::getInstrs() const {return instrs;}
-uint64_t OOOCore::getPhaseCycles() const {return curCycle % zinfo->phaseLength;}
+uint64_t OOOCore::getPhaseCycles() const {return (curCycle > zinfo->globPhaseCycles)? curCycle - zinfo->globPhaseCycles : 0;}
 
 void OOOCore::contextSwitch(int32_t gid) {
     if (gid == -1) {
@@ -353,7 +353,14 @@ inline void OOOCore::bbl(Address bblAddr, BblInfo* bblInfo) {
 
                     uint64_t reqSatisfiedCycle = dispatchCycle;
                     if (addr != ((Address)-1L)) {
-                        reqSatisfiedCycle = l1d->load(addr, dispatchCycle) + L1D_LAT;
+                        //Write-combining buffers do not forward data; a load to a buffered line waits until it is written
+                        if (unlikely(l1d->inWriteCombining(addr))) {
+                            uint64_t wcCycle = l1d->flushWriteCombining(addr, dispatchCycle);
+                            cRec.record(curCycle, dispatchCycle, wcCycle);
+                            dispatchCycle = wcCycle;
+                        }
+                        //Uops don't keep their instruction's address; the bbl's plus the memory op's position in it identifies it as well
+                        reqSatisfiedCycle = l1d->load(addr, dispatchCycle, bbl->addr + loadIdx + storeIdx) + L1D_LAT;
                         cRec.record(curCycle, dispatchCycle, reqSatisfiedCycle);
                         if(zinfo->numCores == 1){
                             locality_monitor.push_address(addr,size);
@@ -401,7 +408,17 @@ inline void OOOCore::bbl(Address bblAddr, BblInfo* bblInfo) {
                         locality_monitor.push_address(addr, size);
                     }
 
-                    uint64_t reqSatisfiedCycle = l1d->store(addr, dispatchCycle) + L1D_LAT;
+                    uint64_t reqSatisfiedCycle;
+                    if (uop->flags & UOP_NONTEMPORAL) {
+                        reqSatisfiedCycle = l1d->storeNT(addr, size, dispatchCycle, bbl->addr + loadIdx + storeIdx) + L1D_LAT;
+                    } else {
+                        if (unlikely(l1d->inWriteCombining(addr))) {
+                            uint64_t wcCycle = l1d->flushWriteCombining(addr, dispatchCycle);
+                            cRec.record(curCycle, dispatchCycle, wcCycle);
+                            dispatchCycle = wcCycle;
+                        }
+                        reqSatisfiedCycle = l1d->store(addr, dispatchCycle, bbl->addr + loadIdx + storeIdx) + L1D_LAT;
+                    }
                     cRec.record(curCycle, dispatchCycle, reqSatisfiedCycle);
 
                     // Fill the forwarding table
@@ -421,6 +438,12 @@ inline void OOOCore::bbl(Address bblAddr, BblInfo* bblInfo) {
             //case UOP_FENCE:  //make gcc happy
             default:
                 assert((UopType) uop->type == UOP_FENCE);
+                //Fences (and locked instructions) drain the write-combining buffers; later loads wait for the writes
+                while (unlikely(l1d->hasWriteCombining())) {
+                    uint64_t wcCycle = l1d->flushWriteCombining(dispatchCycle);
+                    cRec.record(curCycle, dispatchCycle, wcCycle);
+                    lastStoreCommitCycle = MAX(lastStoreCommitCycle, wcCycle);
+                }
                 commitCycle = dispatchCycle + uop->lat;
                 // info("%d %ld %ld", uop->lat, lastStoreAddrCommitCycle, lastStoreCommitCycle);
                 // force future load serialization
@@ -637,6 +660,7 @@ void OOOCore::BblFunc(THREADID tid, ADDRINT bblAddr, BblInfo* bblInfo) {
         // This is fine, since the loop looks at core values directly and there are no locals involved,
         // so we should just advance as needed and move on.
         if (newCid != cid) break;  /*context-switch, we do not own this context anymore*/
+        core->phaseEndCycle = zinfo->globPhaseCycles + zinfo->phaseLength; //the phase length may change at the barrier
     }
 }
 
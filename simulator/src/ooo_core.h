@@ -396,7 +396,7 @@ class OOOCore : public Core {
         //and for ordering purposes should leave in program order. In reality they are associative
         //buffers, but we split the associative component from the limited-size modeling.
         //NOTE: We do not model the 10-entry fill buffer here; the weave model should take care
-        //to not overlap more than 10 misses.
+        //to not overlap more than 10 misses (e.g., a Timing l1d with mshrs = 10, see TimingCacheBandwidth).
         ReorderBuffer<32, 4> loadQueue;
         ReorderBuffer<32, 4> storeQueue;
 
@@ -0,0 +1,111 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "phase_controller.h"
+#include "contention_sim.h"
+#include "log.h"
+#include "profile_stats.h"
+#include "zsim.h"
+
+PhaseController::PhaseController(uint32_t _minLength, uint32_t _maxLength, bool _deterministic, double _highDramReqs, double _lowDramReqs,
+        double _highWeaveEvents, double _lowWeaveEvents, double _maxBarrierFraction)
+    : minLength(_minLength), maxLength(_maxLength), deterministic(_deterministic), highDramReqs(_highDramReqs), lowDramReqs(_lowDramReqs),
+      highWeaveEvents(_highWeaveEvents), lowWeaveEvents(_lowWeaveEvents), maxBarrierFraction(_maxBarrierFraction)
+{
+    if (minLength == 0 || minLength > maxLength) panic("Invalid phase length bounds [%d, %d]", minLength, maxLength);
+    if (zinfo->phaseLength < minLength || zinfo->phaseLength > maxLength) {
+        panic("sim.phaseLength (%d) must be within [sim.minPhaseLength, sim.maxPhaseLength] = [%d, %d]", zinfo->phaseLength, minLength, maxLength);
+    }
+    if (lowDramReqs > highDramReqs || lowWeaveEvents > highWeaveEvents) panic("Phase controller low thresholds must not exceed the high ones");
+    phaseDramReqs = 0;
+    lastEvents = 0;
+    boundStartNs = 0;
+    barrierStartNs = 0;
+    curLength = zinfo->phaseLength;
+}
+
+void PhaseController::initStats(AggregateStat* parentStat) {
+    AggregateStat* ctrlStat = new AggregateStat();
+    ctrlStat->init("phaseCtrl", "Adaptive phase length stats");
+    ProxyStat* lengthStat = new ProxyStat();
+    lengthStat->init("length", "Length of the upcoming phase (cycles)", &curLength);
+    ctrlStat->append(lengthStat);
+    profGrows.init("grows", "Phase length increases");
+    ctrlStat->append(&profGrows);
+    profShrinks.init("shrinks", "Phase length decreases");
+    ctrlStat->append(&profShrinks);
+    profBoundNs.init("boundNs", "Wall-clock time threads ran between barriers (ns)");
+    ctrlStat->append(&profBoundNs);
+    profBarrierNs.init("barrierNs", "Wall-clock time threads were stopped at phase barriers (ns)");
+    ctrlStat->append(&profBarrierNs);
+    parentStat->append(ctrlStat);
+}
+
+void PhaseController::phaseDone(uint64_t dramReqs) {
+    phaseDramReqs = dramReqs;
+    if (!deterministic) barrierStartNs = getNs();
+}
+
+void PhaseController::phaseResume() {
+    uint32_t length = zinfo->phaseLength;
+    double kCycles = length/1000.0;
+    double dramDensity = phaseDramReqs/kCycles;
+
+    bool dense = dramDensity > highDramReqs;
+    bool quiet = dramDensity < lowDramReqs;
+
+    if (!deterministic) {
+        uint64_t events = zinfo->contentionSim->getEvents();
+        double eventDensity = (events - lastEvents)/kCycles;
+        lastEvents = events;
+
+        uint64_t curNs = getNs();
+        uint64_t barrierNs = curNs - barrierStartNs;
+        //The first phase includes initialization, so it says nothing about barrier overheads
+        double barrierFraction = 0.0;
+        if (boundStartNs) {
+            uint64_t boundNs = barrierStartNs - boundStartNs;
+            profBoundNs.inc(boundNs);
+            profBarrierNs.inc(barrierNs);
+            barrierFraction = ((double)barrierNs)/(boundNs + barrierNs + 1);
+        }
+        boundStartNs = curNs;
+
+        dense = dense || eventDensity > highWeaveEvents;
+        quiet = quiet && (eventDensity < lowWeaveEvents || barrierFraction > maxBarrierFraction);
+    }
+
+    uint32_t next = length;
+    if (dense) {
+        next = MAX(minLength, length/2);
+    } else if (quiet) {
+        next = MIN(maxLength, (uint64_t)length*2);
+    }
+
+    if (next < length) profShrinks.inc();
+    else if (next > length) profGrows.inc();
+    zinfo->nextPhaseLength = next;
+    curLength = next;
+}
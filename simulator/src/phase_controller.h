@@ -0,0 +1,85 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PHASE_CONTROLLER_H_
+#define PHASE_CONTROLLER_H_
+
+#include <stdint.h>
+#include "galloc.h"
+#include "stats.h"
+
+/* Adapts the length of bound-weave phases to what the simulated system is
+ * doing. At the end of each phase, it looks at how many DRAM requests the
+ * phase issued and how many weave events it simulated, per 1000 cycles, and
+ * at how much of the phase's wall-clock time threads spent stopped at the
+ * barrier (weave simulation and phase-end bookkeeping) rather than running.
+ * Dense memory phases are halved, as long phases let bound-phase latencies
+ * drift from the contended ones; quiet compute stretches are doubled to
+ * amortize the barrier. The length always stays within [minLength, maxLength].
+ *
+ * Weave event counts and wall-clock times depend on how host threads
+ * interleave, so in deterministic mode decisions use DRAM requests only, and
+ * two runs of the same workload see the same sequence of phase lengths.
+ *
+ * The new length applies from the next phase on (see zinfo->nextPhaseLength).
+ */
+class PhaseController : public GlobAlloc {
+    private:
+        uint32_t minLength;
+        uint32_t maxLength;
+        bool deterministic;
+
+        //Thresholds, per 1000 cycles
+        double highDramReqs;
+        double lowDramReqs;
+        double highWeaveEvents;
+        double lowWeaveEvents;
+        double maxBarrierFraction; //grow quiet phases if barriers take more than this fraction of wall-clock time
+
+        uint64_t phaseDramReqs;
+        uint64_t lastEvents; //weave events simulated up to the last phase
+        uint64_t boundStartNs; //0 until the first phase ends
+        uint64_t barrierStartNs;
+        uint64_t curLength; //for stats
+
+        Counter profGrows;
+        Counter profShrinks;
+        Counter profBarrierNs;
+        Counter profBoundNs;
+
+    public:
+        PhaseController(uint32_t _minLength, uint32_t _maxLength, bool _deterministic, double _highDramReqs, double _lowDramReqs,
+                double _highWeaveEvents, double _lowWeaveEvents, double _maxBarrierFraction);
+
+        void initStats(AggregateStat* parentStat);
+
+        //Called at the start of EndOfPhaseActions, when the last thread reaches the barrier
+        void phaseDone(uint64_t dramReqs);
+
+        //Called when EndOfPhaseActions is done, right before threads resume. Sets the length of the next phase.
+        void phaseResume();
+};
+
+#endif  // PHASE_CONTROLLER_H_
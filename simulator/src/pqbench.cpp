@@ -0,0 +1,125 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Microbenchmark of the event queues of the weave phase (see prio_queue.h):
+ * PrioQueue, which keeps far events in a tree, against WheelPrioQueue, which
+ * keeps them in a timing wheel. Like a domain in ContentionSim, it dequeues
+ * the first event, asks for the next event's cycle, and enqueues a new event
+ * at some delay. A given fraction of the delays are far, i.e., past the
+ * blocks of both queues. Both queues must dequeue the same cycles.
+ *
+ * Usage: pqbench [<events in flight> [<millions of ops> [<max far delay>]]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+#include "galloc.h"
+#include "log.h"
+#include "prio_queue.h"
+
+#define PQ_BLOCKS 1024 //as in ContentionSim
+
+struct BenchEvent {
+    uint64_t pqCycle;
+    BenchEvent* next;
+};
+
+class DelayGen {
+    private:
+        uint64_t state;
+        uint64_t farPct;
+        uint64_t maxFarDelay;
+
+        inline uint64_t rand() { //xorshift64
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return state;
+        }
+
+    public:
+        DelayGen(uint64_t seed, uint64_t _farPct, uint64_t _maxFarDelay) : state(seed), farPct(_farPct), maxFarDelay(_maxFarDelay) {}
+
+        inline uint64_t next() {
+            const uint64_t farDelay = PQ_BLOCKS*64;
+            if (rand() % 100 < farPct) return farDelay + rand() % (maxFarDelay - farDelay);
+            return 1 + rand() % 2000; //cache and memory latencies
+        }
+};
+
+struct Result {
+    double nsPerOp;
+    uint64_t hash; //of the dequeued cycles
+};
+
+template <typename Q>
+static Result Run(uint32_t inFlight, uint64_t ops, uint64_t farPct, uint64_t maxFarDelay) {
+    Q* q = new Q();
+    std::vector<BenchEvent> events(inFlight);
+    DelayGen gen(0x9E3779B97F4A7C15ul, farPct, maxFarDelay);
+    for (BenchEvent& ev : events) {
+        ev.next = nullptr;
+        q->enqueue(&ev, gen.next());
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint64_t hash = 0;
+    uint64_t cycle = 0;
+    for (uint64_t i = 0; i < ops; i++) {
+        BenchEvent* ev = q->dequeue(cycle);
+        hash = hash*31 + cycle;
+        hash += q->firstCycle(); //what ContentionSim does after each event
+        q->enqueue(ev, cycle + gen.next());
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    while (q->size()) q->dequeue(cycle); //PrioQueue does not free its map otherwise
+    delete q;
+
+    double ns = (end.tv_sec - start.tv_sec)*1e9 + (end.tv_nsec - start.tv_nsec);
+    return {ns/ops, hash};
+}
+
+int main(int argc, char* argv[]) {
+    InitLog("[pqbench] ");
+    uint32_t inFlight = (argc > 1)? atoi(argv[1]) : 256;
+    uint64_t ops = ((argc > 2)? atol(argv[2]) : 10)*1000000ul;
+    uint64_t maxFarDelay = (argc > 3)? atol(argv[3]) : 10000000ul;
+    if (!inFlight || !ops || maxFarDelay <= PQ_BLOCKS*64) panic("Usage: %s [<events in flight> [<millions of ops> [<max far delay, > %d>]]]", argv[0], PQ_BLOCKS*64);
+    gm_init(1ul << 30); //PrioQueue's map lives in the global heap
+
+    info("%d events in flight, %ld ops, far delays up to %ld cycles", inFlight, ops, maxFarDelay);
+    info(" far%%   tree ns/op   wheel ns/op   speedup");
+    const uint64_t farPcts[] = {0, 1, 5, 20, 50, 100};
+    for (uint64_t farPct : farPcts) {
+        Result tree = Run<PrioQueue<BenchEvent, PQ_BLOCKS> >(inFlight, ops, farPct, maxFarDelay);
+        Result wheel = Run<WheelPrioQueue<BenchEvent, PQ_BLOCKS> >(inFlight, ops, farPct, maxFarDelay);
+        if (tree.hash != wheel.hash) panic("Queues dequeued different cycles with %ld%% far events", farPct);
+        info("%4ld %12.1f %13.1f %9.2fx", farPct, tree.nsPerOp, wheel.nsPerOp, tree.nsPerOp/wheel.nsPerOp);
+    }
+    return 0;
+}
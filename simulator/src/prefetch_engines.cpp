@@ -0,0 +1,324 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "prefetch_engines.h"
+#include <sstream>
+#include <string.h>
+#include "zsim.h"
+
+static inline uint32_t PageLines() {return 1 << (12 - lineBits);}
+static inline Address PageOf(Address lineAddr) {return lineAddr >> (12 - lineBits);}
+static inline uint32_t PageOffset(Address lineAddr) {return lineAddr & (PageLines() - 1);}
+
+/* IPStrideEngine */
+
+IPStrideEngine::IPStrideEngine(uint32_t _entries) : entries(_entries) {
+    if (!isPow2(entries)) panic("IP-stride prefetcher entries must be a power of 2, is %d", entries);
+    table = gm_calloc<Entry>(entries);
+    for (uint32_t i = 0; i < entries; i++) table[i].conf.reset();
+}
+
+void IPStrideEngine::train(Address lineAddr, Address pc, uint64_t cycle, bool pfHit, bool warm, PrefetchCandidates& cands) {
+    if (!pc) return;
+    if (!warm) profTrains.inc();
+    Entry& e = table[(pc ^ (pc >> 16)) & (entries-1)];
+    if (e.pc != pc) {
+        e.pc = pc;
+        e.lastLine = lineAddr;
+        e.stride = 0;
+        e.conf.reset();
+        return;
+    }
+
+    int64_t stride = lineAddr - e.lastLine;
+    if (!stride) return; //same line, e.g., a load after a store
+    e.lastLine = lineAddr;
+    if (stride == e.stride) {
+        e.conf.inc();
+    } else {
+        e.conf.dec();
+        if (!e.conf.counter()) e.stride = stride;
+        return;
+    }
+
+    if (e.conf.pred()) {
+        if (!warm) profConfident.inc();
+        for (uint32_t i = 1; !cands.full(); i++) cands.push(lineAddr + i*stride);
+    }
+}
+
+void IPStrideEngine::initStats(AggregateStat* parentStat) {
+    profTrains.init("ipTrains", "Accesses with a PC");
+    parentStat->append(&profTrains);
+    profConfident.init("ipConfident", "Accesses that matched a confident stride");
+    parentStat->append(&profConfident);
+}
+
+std::string IPStrideEngine::geometry() const {
+    std::stringstream ss;
+    ss << entries << " entries";
+    return ss.str();
+}
+
+void IPStrideEngine::serialize(Checkpoint& ckpt) {
+    ckpt.io(table, entries);
+}
+
+/* BestOffsetEngine */
+
+BestOffsetEngine::BestOffsetEngine() : testIdx(0), round(0), bestIdx(0), offset(1), prefetchOn(true) {
+    for (int32_t d = 1; d < (int32_t)PageLines(); d++) {
+        int32_t r = d;
+        for (int32_t f : {2, 3, 5}) while (r % f == 0) r /= f;
+        if (r == 1) offsets.push_back(d);
+    }
+    scores.resize(offsets.size(), 0);
+    memset(rr, 0, sizeof(rr));
+}
+
+void BestOffsetEngine::endPhase(bool warm) {
+    offset = offsets[bestIdx];
+    prefetchOn = scores[bestIdx] > BAD_SCORE;
+    if (!warm) {
+        profPhases.inc();
+        if (!prefetchOn) profOffPhases.inc();
+    }
+    for (uint32_t& s : scores) s = 0;
+    testIdx = 0;
+    round = 0;
+    bestIdx = 0;
+}
+
+void BestOffsetEngine::train(Address lineAddr, Address pc, uint64_t cycle, bool pfHit, bool warm, PrefetchCandidates& cands) {
+    // Learning: test one offset per access
+    int32_t d = offsets[testIdx];
+    bool phaseDone = false;
+    if (PageOffset(lineAddr) >= (uint32_t)d) { //the base must be in the same page
+        const RREntry& e = rr[rrIdx(lineAddr - d)];
+        if (e.lineAddr == lineAddr - d && e.readyCycle <= cycle) {
+            uint32_t s = ++scores[testIdx];
+            if (s > scores[bestIdx]) bestIdx = testIdx;
+            phaseDone = (s >= SCORE_MAX);
+        }
+    }
+    if (phaseDone) {
+        endPhase(warm);
+    } else if (++testIdx == offsets.size()) {
+        testIdx = 0;
+        if (++round == ROUND_MAX) endPhase(warm);
+    }
+
+    if (prefetchOn) cands.push(lineAddr + offset);
+}
+
+void BestOffsetEngine::fill(Address lineAddr, uint64_t cycle, bool isPrefetch) {
+    // Prefetched lines record their base, Y-D; demand lines only when not prefetching
+    Address base;
+    if (isPrefetch) {
+        if (PageOffset(lineAddr) < (uint32_t)offset) return;
+        base = lineAddr - offset;
+    } else if (!prefetchOn) {
+        base = lineAddr;
+    } else {
+        return;
+    }
+    rr[rrIdx(base)] = {base, cycle};
+}
+
+void BestOffsetEngine::initStats(AggregateStat* parentStat) {
+    profPhases.init("bopPhases", "Learning phases completed");
+    parentStat->append(&profPhases);
+    profOffPhases.init("bopOffPhases", "Learning phases that turned prefetching off");
+    parentStat->append(&profOffPhases);
+    auto offsetStat = makeLambdaStat([this]() {return (uint64_t)(prefetchOn? offset : 0);});
+    offsetStat->init("bopOffset", "Current best offset (0 if prefetching is off)");
+    parentStat->append(offsetStat);
+}
+
+std::string BestOffsetEngine::geometry() const {
+    std::stringstream ss;
+    ss << offsets.size() << " offsets, " << RR_ENTRIES << " RR entries";
+    return ss.str();
+}
+
+void BestOffsetEngine::serialize(Checkpoint& ckpt) {
+    ckpt.io(&scores[0], scores.size());
+    ckpt.io(rr, RR_ENTRIES);
+    ckpt.io(testIdx);
+    ckpt.io(round);
+    ckpt.io(bestIdx);
+    ckpt.io(offset);
+    ckpt.io(prefetchOn);
+    if (!ckpt.isSaving()) {
+        for (RREntry& e : rr) e.readyCycle = 0; //cycles are not comparable across runs
+    }
+}
+
+/* SPPEngine */
+
+SPPEngine::SPPEngine() {
+    memset(st, 0, sizeof(st));
+    memset(pt, 0, sizeof(pt));
+}
+
+void SPPEngine::updatePattern(uint32_t sig, int32_t delta) {
+    PTEntry& e = pt[sig % PT_ENTRIES];
+    if (e.sigCount == COUNTER_MAX) { //halve all counters to keep them relative
+        e.sigCount /= 2;
+        for (uint32_t i = 0; i < PT_DELTAS; i++) e.deltaCounts[i] /= 2;
+    }
+    e.sigCount++;
+
+    uint32_t victim = 0;
+    for (uint32_t i = 0; i < PT_DELTAS; i++) {
+        if (e.deltas[i] == delta && e.deltaCounts[i]) {
+            e.deltaCounts[i] = MIN(e.deltaCounts[i] + 1, COUNTER_MAX);
+            return;
+        }
+        if (e.deltaCounts[i] < e.deltaCounts[victim]) victim = i;
+    }
+    e.deltas[victim] = delta;
+    e.deltaCounts[victim] = 1;
+}
+
+void SPPEngine::train(Address lineAddr, Address pc, uint64_t cycle, bool pfHit, bool warm, PrefetchCandidates& cands) {
+    Address page = PageOf(lineAddr);
+    uint32_t pageOffset = PageOffset(lineAddr);
+    STEntry& s = st[(page ^ (page >> 8)) % ST_ENTRIES];
+    if (s.page != page) {
+        if (!warm) profSTMisses.inc();
+        s = {page, pageOffset, 0};
+        return;
+    }
+
+    int32_t delta = (int32_t)pageOffset - (int32_t)s.lastOffset;
+    if (!delta) return;
+    updatePattern(s.sig, delta);
+    s.sig = nextSig(s.sig, delta);
+    s.lastOffset = pageOffset;
+
+    // Lookahead along the most likely path
+    uint32_t sig = s.sig;
+    int32_t base = pageOffset;
+    uint32_t conf = 100; //path confidence, %
+    for (uint32_t depth = 0; !cands.full(); depth++) {
+        const PTEntry& e = pt[sig % PT_ENTRIES];
+        if (!e.sigCount) break;
+
+        uint32_t best = 0;
+        for (uint32_t i = 0; i < PT_DELTAS; i++) {
+            if (!e.deltaCounts[i]) continue;
+            uint32_t c = conf*e.deltaCounts[i]/e.sigCount;
+            int32_t target = base + e.deltas[i];
+            if (c >= PF_THRESHOLD && target >= 0 && target < (int32_t)PageLines()) {
+                cands.push(lineAddr - pageOffset + target);
+            }
+            if (e.deltaCounts[i] > e.deltaCounts[best]) best = i;
+        }
+
+        conf = conf*ALPHA/100*e.deltaCounts[best]/e.sigCount;
+        base += e.deltas[best];
+        if (conf < PF_THRESHOLD || base < 0 || base >= (int32_t)PageLines()) break;
+        sig = nextSig(sig, e.deltas[best]);
+        if (depth && !warm) profLookaheads.inc();
+    }
+}
+
+void SPPEngine::initStats(AggregateStat* parentStat) {
+    profSTMisses.init("sppSTMisses", "Signature table misses (first accesses to a page)");
+    parentStat->append(&profSTMisses);
+    profLookaheads.init("sppLookaheads", "Lookahead steps beyond the first");
+    parentStat->append(&profLookaheads);
+}
+
+std::string SPPEngine::geometry() const {
+    std::stringstream ss;
+    ss << ST_ENTRIES << " ST, " << PT_ENTRIES << "x" << PT_DELTAS << " PT entries, " << SIG_BITS << "-bit signatures";
+    return ss.str();
+}
+
+void SPPEngine::serialize(Checkpoint& ckpt) {
+    ckpt.io(st, ST_ENTRIES);
+    ckpt.io(pt, PT_ENTRIES);
+}
+
+/* AMPMEngine */
+
+AMPMEngine::AMPMEngine(uint32_t _numZones) : numZones(_numZones), timestamp(0) {
+    if (!numZones) panic("AMPM prefetcher needs at least one zone");
+    zones = gm_calloc<Zone>(numZones);
+}
+
+void AMPMEngine::train(Address lineAddr, Address pc, uint64_t cycle, bool pfHit, bool warm, PrefetchCandidates& cands) {
+    Address page = PageOf(lineAddr);
+    int32_t p = PageOffset(lineAddr);
+    int32_t n = PageLines();
+
+    Zone* z = &zones[0];
+    for (uint32_t i = 0; i < numZones; i++) {
+        if (zones[i].page == page) {
+            z = &zones[i];
+            break;
+        }
+        if (zones[i].ts < z->ts) z = &zones[i]; //LRU
+    }
+    if (z->page != page) {
+        if (!warm) profZoneMisses.inc();
+        z->page = page;
+        z->accessed.reset();
+        z->prefetched.reset();
+    }
+    z->ts = ++timestamp;
+    z->accessed[p] = true;
+
+    auto acc = [z, n](int32_t i) {return i >= 0 && i < n && z->accessed[i];};
+    auto idle = [z, n](int32_t i) {return i >= 0 && i < n && !z->accessed[i] && !z->prefetched[i];};
+    for (int32_t k = 1; k <= n/2 && !cands.full(); k++) {
+        if (acc(p - k) && acc(p - 2*k) && idle(p + k)) {
+            z->prefetched[p + k] = true;
+            cands.push(lineAddr + k);
+        }
+        if (acc(p + k) && acc(p + 2*k) && idle(p - k) && !cands.full()) {
+            z->prefetched[p - k] = true;
+            cands.push(lineAddr - k);
+        }
+    }
+}
+
+void AMPMEngine::initStats(AggregateStat* parentStat) {
+    profZoneMisses.init("ampmZoneMisses", "Accesses to pages without an access map");
+    parentStat->append(&profZoneMisses);
+}
+
+std::string AMPMEngine::geometry() const {
+    std::stringstream ss;
+    ss << numZones << " zones";
+    return ss.str();
+}
+
+void AMPMEngine::serialize(Checkpoint& ckpt) {
+    ckpt.io(zones, numZones);
+    ckpt.io(timestamp);
+}
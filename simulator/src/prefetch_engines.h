@@ -0,0 +1,187 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PREFETCH_ENGINES_H_
+#define PREFETCH_ENGINES_H_
+
+#include <bitset>
+#include <string>
+#include "prefetcher.h"
+
+/* Prefetch engines for QueuedPrefetcher. All work on line addresses, within 4KB
+ * pages (64 lines with 64-byte lines), and keep whole addresses rather than the
+ * partial tags a hardware implementation would use.
+ */
+
+/* Per-instruction stride prefetcher, as in the L1 IP prefetchers of Intel cores:
+ * a direct-mapped table indexed by PC learns each load/store's stride, and once
+ * confident, prefetches the next degree strides. Accesses with no PC are ignored.
+ */
+class IPStrideEngine : public PrefetchEngine {
+    private:
+        struct Entry {
+            Address pc;
+            Address lastLine;
+            int64_t stride;
+            SatCounter<3, 2, 0> conf;
+        };
+
+        Entry* table;
+        uint32_t entries;
+
+        Counter profTrains, profConfident;
+
+    public:
+        explicit IPStrideEngine(uint32_t _entries);
+        void train(Address lineAddr, Address pc, uint64_t cycle, bool pfHit, bool warm, PrefetchCandidates& cands);
+        void initStats(AggregateStat* parentStat);
+        std::string geometry() const;
+        void serialize(Checkpoint& ckpt);
+};
+
+/* Best-Offset prefetcher (Michaud, HPCA 2016): prefetches X+D on each access X, and
+ * learns D by scoring candidate offsets d on whether X-d arrived recently enough,
+ * using a recent-requests (RR) table of the base addresses of completed fills.
+ * Timeliness comes from fill cycles: an RR entry only counts once its fill is done.
+ * Each round tests every offset once; the phase ends after ROUND_MAX rounds or when
+ * an offset reaches SCORE_MAX, and prefetching turns off if the best score is low.
+ */
+class BestOffsetEngine : public PrefetchEngine {
+    private:
+        static const uint32_t RR_ENTRIES = 256;
+        static const uint32_t SCORE_MAX = 31;
+        static const uint32_t ROUND_MAX = 100;
+        static const uint32_t BAD_SCORE = 1;
+
+        struct RREntry {
+            Address lineAddr;
+            uint64_t readyCycle;
+        };
+
+        g_vector<int32_t> offsets; //offsets up to 63 whose prime factors are 2, 3 and 5
+        g_vector<uint32_t> scores;
+        RREntry rr[RR_ENTRIES];
+        uint32_t testIdx;
+        uint32_t round;
+        uint32_t bestIdx;
+        int32_t offset; //current prefetch offset, D
+        bool prefetchOn;
+
+        Counter profPhases, profOffPhases;
+
+        uint32_t rrIdx(Address lineAddr) const {return (lineAddr ^ (lineAddr >> 8)) & (RR_ENTRIES-1);}
+        void endPhase(bool warm);
+
+    public:
+        BestOffsetEngine();
+        void train(Address lineAddr, Address pc, uint64_t cycle, bool pfHit, bool warm, PrefetchCandidates& cands);
+        void fill(Address lineAddr, uint64_t cycle, bool isPrefetch);
+        void initStats(AggregateStat* parentStat);
+        std::string geometry() const;
+        void serialize(Checkpoint& ckpt);
+};
+
+/* Signature Path Prefetcher (Kim et al., MICRO 2016): a signature table keeps, per
+ * page, the last offset and a signature that compresses the page's recent deltas,
+ * and a pattern table maps signatures to the deltas that followed them. Prefetching
+ * walks the most likely path of deltas ahead, multiplying the confidence of each
+ * step, and prefetches every delta whose path confidence is above PF_THRESHOLD%,
+ * until confidence falls below that or the degree is reached. The per-step
+ * confidence is scaled by a fixed ALPHA% rather than SPP's global accuracy, since
+ * QueuedPrefetcher already throttles the degree on accuracy; and first accesses to
+ * a page do not use the global history register to cross page boundaries.
+ */
+class SPPEngine : public PrefetchEngine {
+    private:
+        static const uint32_t ST_ENTRIES = 256;
+        static const uint32_t PT_ENTRIES = 512;
+        static const uint32_t PT_DELTAS = 4;
+        static const uint32_t SIG_BITS = 12;
+        static const uint32_t SIG_SHIFT = 3;
+        static const uint32_t COUNTER_MAX = 15;
+        static const uint32_t PF_THRESHOLD = 25; //%
+        static const uint32_t ALPHA = 90; //%
+
+        struct STEntry {
+            Address page;
+            uint32_t lastOffset;
+            uint32_t sig;
+        };
+
+        struct PTEntry {
+            int32_t deltas[PT_DELTAS];
+            uint32_t deltaCounts[PT_DELTAS];
+            uint32_t sigCount;
+        };
+
+        STEntry st[ST_ENTRIES];
+        PTEntry pt[PT_ENTRIES];
+
+        Counter profSTMisses, profLookaheads;
+
+        static uint32_t nextSig(uint32_t sig, int32_t delta) {
+            uint32_t d = (delta < 0)? ((-delta) | 0x40) : delta; //7-bit sign-magnitude
+            return ((sig << SIG_SHIFT) ^ d) & ((1 << SIG_BITS) - 1);
+        }
+
+        void updatePattern(uint32_t sig, int32_t delta);
+
+    public:
+        SPPEngine();
+        void train(Address lineAddr, Address pc, uint64_t cycle, bool pfHit, bool warm, PrefetchCandidates& cands);
+        void initStats(AggregateStat* parentStat);
+        std::string geometry() const;
+        void serialize(Checkpoint& ckpt);
+};
+
+/* Access Map Pattern Matching (Ishii et al., ICS 2009): keeps, for recently used
+ * pages, a map of which lines were accessed and which were prefetched. On an access
+ * to line p, it prefetches p+k if p-k and p-2k were accessed (and p+k is neither),
+ * for k = 1, 2, ... up to half the page, and likewise backwards, closest first.
+ */
+class AMPMEngine : public PrefetchEngine {
+    private:
+        struct Zone {
+            Address page; //0 if invalid
+            uint64_t ts;
+            std::bitset<64> accessed;
+            std::bitset<64> prefetched;
+        };
+
+        Zone* zones;
+        uint32_t numZones;
+        uint64_t timestamp;
+
+        Counter profZoneMisses;
+
+    public:
+        explicit AMPMEngine(uint32_t _numZones);
+        void train(Address lineAddr, Address pc, uint64_t cycle, bool pfHit, bool warm, PrefetchCandidates& cands);
+        void initStats(AggregateStat* parentStat);
+        std::string geometry() const;
+        void serialize(Checkpoint& ckpt);
+};
+
+#endif  // PREFETCH_ENGINES_H_
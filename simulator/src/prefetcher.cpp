@@ -23,7 +23,9 @@
  * this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <sstream>
 #include "bithacks.h"
+#include "coherence_ctrls.h"
 #include "event_recorder.h"
 #include "prefetcher.h"
 #include "timing_event.h"
@@ -88,9 +90,10 @@ uint64_t StreamPrefetcher::access(MemReq & req)
         return respCycle;       		//other reqs ignored, including stores
     }
 
-    profAccesses.inc();
+    bool warm = req.is(MemReq::WARM); //warming trains the tables, no events or profiling
+    if (!warm) profAccesses.inc();
 
-    EventRecorder *evRec = zinfo->eventRecorders[req.srcId];
+    EventRecorder *evRec = warm? nullptr : zinfo->eventRecorders[req.srcId];
 
     StreamPrefetcherEvent *newEv;
     TimingRecord nla, wbAcc, FirstFetchRecord, SecondFetchRecord;
@@ -135,7 +138,7 @@ uint64_t StreamPrefetcher::access(MemReq & req)
             tag[idx] = pageAddr;
         }
     } else {  // entry hit
-        profPageHits.inc();
+        if (!warm) profPageHits.inc();
         Entry& e = array[idx];
         array[idx].ts = timestamp++;
 
@@ -147,8 +150,8 @@ uint64_t StreamPrefetcher::access(MemReq & req)
             e.valid[pos] = false;  // close, will help with long-lived transactions
             respCycle = MAX(pfRespCycle, respCycle);
             e.lastCycle = MAX(respCycle, e.lastCycle);
-            profHits.inc();
-            if (shortPrefetch) profShortHits.inc();
+            if (!warm) profHits.inc();
+            if (shortPrefetch && !warm) profShortHits.inc();
         }
 
         // 2. Update predictors, issue prefetches
@@ -167,7 +170,7 @@ uint64_t StreamPrefetcher::access(MemReq & req)
                     MESIState state = I;
                     MemReq pfReq =
                        { req.lineAddr + prefetchPos - pos, GETS, req.childId, &state, reqCycle, req.childLock,
-                            state, req.srcId, MemReq::PREFETCH
+                            state, req.srcId, MemReq::PREFETCH | (req.flags & MemReq::WARM)
                     };
                     pfRespCycle = parent->access(pfReq);
                     longerCycle = (wbAcc.reqCycle > pfRespCycle) ? wbAcc.reqCycle : pfRespCycle;
@@ -175,12 +178,12 @@ uint64_t StreamPrefetcher::access(MemReq & req)
 					          e.valid[prefetchPos] = true;
                     e.times[prefetchPos].fill(reqCycle, longerCycle);
 
-                    profPrefetches.inc();
+                    if (!warm) profPrefetches.inc();
 
-                    newEv = new(evRec) StreamPrefetcherEvent(0, longerCycle, evRec);
+                    newEv = evRec? new(evRec) StreamPrefetcherEvent(0, longerCycle, evRec) : nullptr;
                     nla = { pfReq.lineAddr, longerCycle, longerCycle, pfReq.type, newEv, newEv};
 
-                    if (wbAcc.isValid())
+                    if (newEv && wbAcc.isValid())
                          newEv->setAccessRecord(wbAcc, pfReq.cycle);
 
                     if (evRec && evRec->hasRecord()) {
@@ -196,8 +199,8 @@ uint64_t StreamPrefetcher::access(MemReq & req)
 
                         e.valid[prefetchPos] = true;
                         e.times[prefetchPos].fill(reqCycle, longerCycle);
-                        profPrefetches.inc();
-                        profDoublePrefetches.inc();
+                        if (!warm) profPrefetches.inc();
+                        if (!warm) profDoublePrefetches.inc();
                         if (likely(nla.respCycle < longerCycle)) {
                              nla.respCycle = longerCycle;
                         }
@@ -210,12 +213,12 @@ uint64_t StreamPrefetcher::access(MemReq & req)
                     e.lastPrefetchPos = prefetchPos;
                     assert(state == I);  // prefetch access should not give us any permissions
 
-                    evRec->pushRecord(nla);
+                    if (evRec) evRec->pushRecord(nla);
                     req.childId = origChildId;
                     return longerCycle;
                 }
             } else {
-                profLowConfAccs.inc();
+                if (!warm) profLowConfAccs.inc();
             }
         } else {
             e.conf.dec();
@@ -226,7 +229,7 @@ uint64_t StreamPrefetcher::access(MemReq & req)
                 if (stride && stride != e.stride && stride == lastStride) {
                     e.conf.reset();
                     e.stride = stride;
-                    profStrideSwitches.inc();
+                    if (!warm) profStrideSwitches.inc();
                 }
             }
             e.lastPrefetchPos = pos;
@@ -248,3 +251,288 @@ uint64_t StreamPrefetcher::access(MemReq & req)
 uint64_t StreamPrefetcher::invalidate(const InvReq& req) {
     return child->invalidate(req);
 }
+
+void StreamPrefetcher::serialize(Checkpoint& ckpt) {
+    std::stringstream geometry;
+    geometry << "StreamPrefetcher " << pfEntries << " entries";
+    if (!ckpt.beginSection(std::string("prefetcher ") + name.c_str(), geometry.str())) return;
+    ckpt.io(timestamp);
+    ckpt.io(tag, pfEntries);
+    ckpt.io(array, pfEntries);
+    if (!ckpt.isSaving()) {
+        //Cycles are not comparable across runs; treat restored prefetches as long done
+        for (uint32_t i = 0; i < pfEntries; i++) {
+            array[i].lastCycle = 0;
+            for (auto& t : array[i].times) t.fill(0, 0);
+        }
+    }
+    ckpt.endSection();
+}
+
+/* QueuedPrefetcher */
+
+QueuedPrefetcher::QueuedPrefetcher(const g_string& _name, const g_string& _type, PrefetchEngine* _engine, uint32_t _degree, uint32_t _queueSize,
+        uint32_t _issueInterval, uint32_t _issueBurst, uint32_t _trackedLines, bool _throttle)
+    : engine(_engine), type(_type), name(_name), child(nullptr), childId(0), queueSize(_queueSize), queueHead(0), queueLen(0),
+      issueInterval(_issueInterval), issueBurst(_issueBurst), tokens(_issueBurst), lastRefillCycle(0),
+      maxDegree(_degree), degree(_degree), throttle(_throttle), epochUseful(0), epochUseless(0)
+{
+    if (!maxDegree || maxDegree > PrefetchCandidates::MAX) panic("[%s] degree must be 1-%d, is %d", name.c_str(), PrefetchCandidates::MAX, maxDegree);
+    if (!queueSize) panic("[%s] needs a non-empty prefetch queue", name.c_str());
+    if (issueInterval && !issueBurst) panic("[%s] issueBurst must be >= 1 when issueInterval limits the bandwidth", name.c_str());
+    if (_trackedLines < TRACKED_WAYS || !isPow2(_trackedLines)) panic("[%s] trackedLines must be a power of 2 >= %d", name.c_str(), TRACKED_WAYS);
+    queue = gm_calloc<Address>(queueSize);
+    trackedSets = _trackedLines/TRACKED_WAYS;
+    tracked = gm_calloc<Tracked>(_trackedLines);
+    epochLen = MAX(_trackedLines/2, 64u);
+}
+
+void QueuedPrefetcher::setParents(uint32_t _childId, const g_vector<MemObject*>& _parents, Network* network) {
+    childId = _childId;
+    if (network) panic("[%s] Network not handled", name.c_str());
+    parents = _parents;
+    assert(parents.size());
+}
+
+void QueuedPrefetcher::setChildren(const g_vector<BaseCache*>& children, Network* network) {
+    if (children.size() != 1) panic("[%s] Must have one child, has %ld", name.c_str(), children.size());
+    if (network) panic("[%s] Network not handled", name.c_str());
+    child = children[0];
+}
+
+void QueuedPrefetcher::initStats(AggregateStat* parentStat) {
+    AggregateStat* s = new AggregateStat();
+    s->init(name.c_str(), "Prefetcher stats");
+    profAccesses.init("acc", "Demand accesses (GETS/GETX) trained on");
+    s->append(&profAccesses);
+    profUncovered.init("uncovered", "Demand accesses not covered by a prefetch");
+    s->append(&profUncovered);
+    profProposed.init("proposed", "Lines proposed by the engine");
+    s->append(&profProposed);
+    profQueued.init("queued", "Lines added to the prefetch queue");
+    s->append(&profQueued);
+    profDupes.init("dupes", "Proposed lines already queued or in flight");
+    s->append(&profDupes);
+    profCrossPage.init("crossPage", "Proposed lines outside the trigger's page");
+    s->append(&profCrossPage);
+    profQueueDrops.init("queueDrops", "Queued lines dropped because the queue was full");
+    s->append(&profQueueDrops);
+    profIssued.init("pf", "Issued prefetches");
+    s->append(&profIssued);
+    profUseful.init("useful", "Prefetches used by a demand access");
+    s->append(&profUseful);
+    profLate.init("late", "Useful prefetches still in flight when used");
+    s->append(&profLate);
+    profLateCycles.init("lateCycles", "Cumulative cycles demand accesses waited for late prefetches");
+    s->append(&profLateCycles);
+    profUseless.init("useless", "Prefetches dropped from tracking before being used");
+    s->append(&profUseless);
+    profDegreeUps.init("degreeUps", "Throttling epochs that increased the degree");
+    s->append(&profDegreeUps);
+    profDegreeDowns.init("degreeDowns", "Throttling epochs that decreased the degree");
+    s->append(&profDegreeDowns);
+    auto degreeStat = makeLambdaStat([this]() {return (uint64_t)degree;});
+    degreeStat->init("degree", "Current prefetch degree");
+    s->append(degreeStat);
+    engine->initStats(s);
+    parentStat->append(s);
+}
+
+QueuedPrefetcher::Tracked* QueuedPrefetcher::findTracked(Address lineAddr) {
+    Tracked* set = &tracked[(lineAddr & (trackedSets-1))*TRACKED_WAYS];
+    for (uint32_t w = 0; w < TRACKED_WAYS; w++) {
+        if (set[w].lineAddr == lineAddr) return &set[w];
+    }
+    return nullptr;
+}
+
+void QueuedPrefetcher::track(Address lineAddr, uint64_t issueCycle, uint64_t readyCycle, bool warm) {
+    Tracked* set = &tracked[(lineAddr & (trackedSets-1))*TRACKED_WAYS];
+    Tracked* victim = &set[0];
+    for (uint32_t w = 0; w < TRACKED_WAYS; w++) {
+        if (!set[w].lineAddr) {
+            victim = &set[w];
+            break;
+        }
+        if (set[w].issueCycle < victim->issueCycle) victim = &set[w];
+    }
+    if (victim->lineAddr) prefetchUsed(false, warm);
+    *victim = {lineAddr, issueCycle, readyCycle};
+}
+
+void QueuedPrefetcher::prefetchUsed(bool useful, bool warm) {
+    if (useful) {
+        if (!warm) profUseful.inc();
+        epochUseful++;
+    } else {
+        if (!warm) profUseless.inc();
+        epochUseless++;
+    }
+
+    if (epochUseful + epochUseless == epochLen) {
+        if (throttle) {
+            uint32_t accuracy = 100*epochUseful/epochLen;
+            if (accuracy < 40 && degree > 1) {
+                degree = MAX(degree/2, 1u);
+                if (!warm) profDegreeDowns.inc();
+            } else if (accuracy > 75 && degree < maxDegree) {
+                degree++;
+                if (!warm) profDegreeUps.inc();
+            }
+        }
+        epochUseful = epochUseless = 0;
+    }
+}
+
+void QueuedPrefetcher::enqueue(Address lineAddr, bool warm) {
+    for (uint32_t i = 0; i < queueLen; i++) {
+        if (queue[(queueHead + i) % queueSize] == lineAddr) {
+            if (!warm) profDupes.inc();
+            return;
+        }
+    }
+    if (findTracked(lineAddr)) {
+        if (!warm) profDupes.inc();
+        return;
+    }
+
+    if (queueLen == queueSize) { //drop the oldest, newer predictions are more relevant
+        queueHead = (queueHead + 1) % queueSize;
+        queueLen--;
+        if (!warm) profQueueDrops.inc();
+    }
+    queue[(queueHead + queueLen) % queueSize] = lineAddr;
+    queueLen++;
+    if (!warm) profQueued.inc();
+}
+
+uint64_t QueuedPrefetcher::access(MemReq& req) {
+    MemObject* parent = parents[ParentBankId(req.lineAddr, parents.size())];
+    uint32_t origChildId = req.childId;
+    req.childId = childId;
+
+    if ((req.type != GETS && req.type != GETX) || req.is(MemReq::PREFETCH)) {
+        uint64_t respCycle = parent->access(req);
+        req.childId = origChildId;
+        return respCycle; //writebacks and lower-level prefetches pass through
+    }
+
+    bool warm = req.is(MemReq::WARM); //warming trains the tables, no events or profiling
+    EventRecorder* evRec = warm? nullptr : zinfo->eventRecorders[req.srcId];
+    uint64_t reqCycle = req.cycle;
+    uint64_t respCycle = parent->access(req);
+
+    TimingRecord demandRec;
+    demandRec.clear();
+    if (evRec && evRec->hasRecord()) demandRec = evRec->popRecord();
+
+    // 1. Did a prefetch bring the line in?
+    if (!warm) profAccesses.inc();
+    Tracked* t = findTracked(req.lineAddr);
+    bool pfHit = t;
+    if (t) {
+        if (t->readyCycle > reqCycle && !warm) profLate.inc();
+        if (t->readyCycle > respCycle) { //bound phase fills lines right away, so charge the rest of the prefetch's latency
+            if (!warm) profLateCycles.inc(t->readyCycle - respCycle);
+            respCycle = t->readyCycle;
+        }
+        t->lineAddr = 0;
+        prefetchUsed(true, warm);
+    } else {
+        if (!warm) profUncovered.inc();
+        engine->fill(req.lineAddr, respCycle, false);
+    }
+
+    // 2. Train and queue the proposed lines
+    PrefetchCandidates cands;
+    cands.clear(degree);
+    engine->train(req.lineAddr, req.pc, reqCycle, pfHit, warm, cands);
+    Address page = req.lineAddr >> (12 - lineBits);
+    for (uint32_t i = 0; i < cands.num; i++) {
+        Address lineAddr = cands.lines[i];
+        if (!warm) profProposed.inc();
+        if (lineAddr == req.lineAddr) continue;
+        if ((lineAddr >> (12 - lineBits)) != page || !lineAddr) {
+            if (!warm) profCrossPage.inc();
+            continue;
+        }
+        enqueue(lineAddr, warm);
+    }
+
+    // 3. Issue queued prefetches, within the bandwidth limit
+    if (issueInterval && reqCycle > lastRefillCycle) {
+        uint64_t newTokens = (reqCycle - lastRefillCycle)/issueInterval;
+        tokens = MIN(tokens + newTokens, (uint64_t)issueBurst);
+        lastRefillCycle += newTokens*issueInterval;
+    }
+
+    TimingRecord pfRecs[PrefetchCandidates::MAX];
+    uint32_t numPfRecs = 0;
+    for (uint32_t issued = 0; queueLen && issued < degree && (!issueInterval || tokens); issued++) {
+        Address lineAddr = queue[queueHead];
+        queueHead = (queueHead + 1) % queueSize;
+        queueLen--;
+        if (issueInterval) tokens--;
+
+        MESIState state = I;
+        MemReq pfReq = {lineAddr, GETS, childId, &state, reqCycle, req.childLock, state, req.srcId,
+            MemReq::PREFETCH | (req.flags & MemReq::WARM), req.pc};
+        uint64_t pfRespCycle = parents[ParentBankId(lineAddr, parents.size())]->access(pfReq);
+        assert(state == I); //prefetch access should not give us any permissions
+        if (!warm) profIssued.inc();
+
+        track(lineAddr, reqCycle, pfRespCycle, warm);
+        engine->fill(lineAddr, pfRespCycle, true);
+        if (evRec && evRec->hasRecord()) pfRecs[numPfRecs++] = evRec->popRecord();
+    }
+
+    // 4. Start the prefetches' events in parallel with the demand access; their ends are not connected
+    if (numPfRecs) {
+        DelayEvent* startEv = new (evRec) DelayEvent(0);
+        startEv->setMinStartCycle(reqCycle);
+        for (uint32_t i = 0; i < numPfRecs; i++) {
+            TimingRecord& r = pfRecs[i];
+            assert(r.reqCycle >= reqCycle);
+            if (r.reqCycle > reqCycle) {
+                DelayEvent* dEv = new (evRec) DelayEvent(r.reqCycle - reqCycle);
+                dEv->setMinStartCycle(reqCycle);
+                startEv->addChild(dEv, evRec)->addChild(r.startEvent, evRec);
+            } else {
+                startEv->addChild(r.startEvent, evRec);
+            }
+        }
+
+        if (demandRec.isValid()) {
+            startEv->addChild(demandRec.startEvent, evRec);
+            demandRec.startEvent = startEv;
+        } else {
+            demandRec = {req.lineAddr << lineBits, reqCycle, reqCycle, req.type, startEv, startEv};
+        }
+    }
+    if (demandRec.isValid()) evRec->pushRecord(demandRec);
+
+    req.childId = origChildId;
+    return respCycle;
+}
+
+uint64_t QueuedPrefetcher::invalidate(const InvReq& req) {
+    //NOTE: We do not touch our own state, since the core may be accessing us concurrently. A prefetched line that is
+    //invalidated before being used stays tracked until it is replaced, and counts as useless then.
+    return child->invalidate(req);
+}
+
+void QueuedPrefetcher::serialize(Checkpoint& ckpt) {
+    std::stringstream geometry;
+    geometry << "QueuedPrefetcher " << type << " " << engine->geometry();
+    if (!ckpt.beginSection(std::string("prefetcher ") + name.c_str(), geometry.str())) return;
+    engine->serialize(ckpt);
+    ckpt.io(degree);
+    degree = MIN(MAX(degree, 1u), maxDegree);
+    //The queue and tracked prefetches are in flight, and there is nothing in flight at ROI begin
+    if (!ckpt.isSaving()) {
+        queueLen = 0;
+        for (uint32_t i = 0; i < trackedSets*TRACKED_WAYS; i++) tracked[i].lineAddr = 0;
+        epochUseful = epochUseless = 0;
+    }
+    ckpt.endSection();
+}
@@ -28,7 +28,9 @@
 
 #include <bitset>
 #include "bithacks.h"
+#include "checkpoint.h"
 #include "g_std/g_string.h"
+#include "g_std/g_vector.h"
 #include "memory_hierarchy.h"
 #include "stats.h"
 #include "timing_event.h"
@@ -141,6 +143,13 @@ class SatCounter {
         uint32_t counter() const { return count; }
 };
 
+/* Common base of the prefetchers, which checkpoints treat separately from caches */
+class Prefetcher : public BaseCache {
+    public:
+        //Saves or restores the prediction tables in their own section (see checkpoint.h)
+        virtual void serialize(Checkpoint& ckpt) = 0;
+};
+
 /* This is basically a souped-up version of the DLP L2 prefetcher in Nehalem: 16 stream buffers,
  * but (a) no up/down distinction, and (b) strided operation based on dominant stride detection
  * to try to subsume as much of the L1 IP/strided prefetcher as possible.
@@ -148,7 +157,7 @@ class SatCounter {
  * FIXME: For now, mostly hardcoded; 64-line entries (4KB w/64-byte lines), fixed granularities, etc.
  * TODO: Adapt to use weave models
  */
-class StreamPrefetcher : public BaseCache {
+class StreamPrefetcher : public Prefetcher {
     private:
         struct Entry {
             // Two competing strides; at most one active
@@ -220,6 +229,128 @@ class StreamPrefetcher : public BaseCache {
 
         uint64_t access(MemReq& req);
         uint64_t invalidate(const InvReq& req);
+
+        void serialize(Checkpoint& ckpt);
+};
+
+/* Prefetch algorithms for QueuedPrefetcher (see prefetch_engines.h). An engine only
+ * predicts: it trains on the demand accesses the prefetcher sees and proposes lines,
+ * and QueuedPrefetcher decides what to issue and when.
+ */
+struct PrefetchCandidates {
+    static const uint32_t MAX = 16;
+    Address lines[MAX];
+    uint32_t num;
+    uint32_t max; //current prefetch degree; engines should stop proposing lines beyond it
+
+    void clear(uint32_t _max) {num = 0; max = MIN(_max, MAX);}
+    bool full() const {return num >= max;}
+    void push(Address lineAddr) {if (num < max) lines[num++] = lineAddr;}
+};
+
+class PrefetchEngine : public GlobAlloc {
+    public:
+        virtual ~PrefetchEngine() {}
+
+        //Called on each demand access (GETS or GETX) the prefetcher sees, i.e., its children's misses, at the
+        //access's request cycle. pc is the requesting instruction (0 if unknown), and pfHit says whether a
+        //prefetch brought the line in, and warm that it is a functional warming access (MemReq::WARM), which trains
+        //the engine but is not profiled. Proposes lines to prefetch in cands, most urgent first.
+        virtual void train(Address lineAddr, Address pc, uint64_t cycle, bool pfHit, bool warm, PrefetchCandidates& cands) = 0;
+
+        //Called when a line arrives: issued prefetches at their (bound-phase) response cycle, and demand accesses that
+        //a prefetch did not cover at theirs. Cycles may be in the future w.r.t. later train() calls.
+        virtual void fill(Address lineAddr, uint64_t cycle, bool isPrefetch) {}
+
+        virtual void initStats(AggregateStat* parentStat) {}
+
+        //The tables the engine's serialize() saves, for the checkpoint section geometry
+        virtual std::string geometry() const = 0;
+        virtual void serialize(Checkpoint& ckpt) = 0;
+};
+
+/* Generic prefetcher: a pseudo-cache between a cache level and its parent, like
+ * StreamPrefetcher, that trains a PrefetchEngine on its children's misses and
+ * prefetches into its parent (so between l1d and l2 it prefetches L1D misses into
+ * the L2, and between l2 and l3 it prefetches L2 misses into the LLC). The parent
+ * may be banked, and prefetches go to the line's bank, as in MESIBottomCC.
+ *
+ * Proposed lines go through a FIFO prefetch queue, which drops duplicates, lines
+ * outside the trigger's 4KB page, and the oldest entries when full. Prefetches
+ * issue at the cycle of the access that drains them, limited by a token bucket
+ * (one token every issueInterval cycles, up to issueBurst), and their timing
+ * records are started in parallel with the demand access, so prefetch traffic
+ * contends in the weave phase (and in Ramulator) without delaying the demand.
+ *
+ * Issued prefetches are tracked in a small table to measure accuracy (useful vs
+ * useless, i.e., replaced in the table before a demand access used them),
+ * coverage (useful vs uncovered demand accesses), and lateness (useful ones that
+ * were still in flight, whose remaining latency the demand access pays, as with
+ * StreamPrefetcher). With throttle, the degree adapts to the accuracy of each
+ * epoch of tracked prefetches, halving below 40% and growing above 75%, as in
+ * feedback-directed prefetching.
+ */
+class QueuedPrefetcher : public Prefetcher {
+    private:
+        struct Tracked {
+            Address lineAddr; //0 if invalid
+            uint64_t issueCycle; //for replacement, oldest first
+            uint64_t readyCycle;
+        };
+
+        PrefetchEngine* engine;
+        g_string type;
+        g_string name;
+
+        g_vector<MemObject*> parents;
+        BaseCache* child;
+        uint32_t childId;
+
+        //Prefetch queue, a ring buffer
+        Address* queue;
+        uint32_t queueSize;
+        uint32_t queueHead;
+        uint32_t queueLen;
+
+        //Bandwidth throttling
+        uint32_t issueInterval; //0 means unlimited
+        uint32_t issueBurst;
+        uint32_t tokens;
+        uint64_t lastRefillCycle;
+
+        //Feedback
+        static const uint32_t TRACKED_WAYS = 4;
+        Tracked* tracked;
+        uint32_t trackedSets;
+        uint32_t maxDegree;
+        uint32_t degree;
+        bool throttle;
+        uint32_t epochLen;
+        uint32_t epochUseful, epochUseless;
+
+        Counter profAccesses, profUncovered, profProposed, profQueued, profDupes, profCrossPage, profQueueDrops;
+        Counter profIssued, profUseful, profLate, profUseless, profLateCycles, profDegreeUps, profDegreeDowns;
+
+        //Returns the tracked entry of a line, or nullptr
+        Tracked* findTracked(Address lineAddr);
+        //warm is set on functional warming accesses (MemReq::WARM), which train and throttle but are not profiled
+        void track(Address lineAddr, uint64_t issueCycle, uint64_t readyCycle, bool warm);
+        void prefetchUsed(bool useful, bool warm);
+        void enqueue(Address lineAddr, bool warm);
+
+    public:
+        QueuedPrefetcher(const g_string& _name, const g_string& _type, PrefetchEngine* _engine, uint32_t _degree, uint32_t _queueSize,
+                uint32_t _issueInterval, uint32_t _issueBurst, uint32_t _trackedLines, bool _throttle);
+
+        void initStats(AggregateStat* parentStat);
+        const char* getName() {return name.c_str();}
+        void setParents(uint32_t _childId, const g_vector<MemObject*>& parents, Network* network);
+        void setChildren(const g_vector<BaseCache*>& children, Network* network);
+
+        uint64_t access(MemReq& req);
+        uint64_t invalidate(const InvReq& req);
+
+        void serialize(Checkpoint& ckpt);
 };
 
 #endif  // PREFETCHER_H_
@@ -26,41 +26,49 @@
 #ifndef PRIO_QUEUE_H_
 #define PRIO_QUEUE_H_
 
+#include "bithacks.h"
 #include "g_std/g_multimap.h"
 
+/* 64 consecutive cycles of a calendar queue. Elements of the same cycle are
+ * chained through T::next.
+ */
+template <typename T>
+struct PQBlock {
+    T* array[64];
+    uint64_t occ; // bit i is 1 if array[i] is populated
+
+    PQBlock() {
+        for (uint32_t i = 0; i < 64; i++) array[i] = nullptr;
+        occ = 0;
+    }
+
+    inline T* dequeue(uint32_t& offset) {
+        assert(occ);
+        uint32_t pos = __builtin_ctzl(occ);
+        T* res = array[pos];
+        T* next = res->next;
+        array[pos] = next;
+        if (!next) occ ^= 1L << pos;
+        assert(res);
+        offset = pos;
+        res->next = nullptr;
+        return res;
+    }
+
+    inline void enqueue(T* obj, uint32_t pos) {
+        occ |= 1L << pos;
+        assert(!obj->next);
+        obj->next = array[pos];
+        array[pos] = obj;
+    }
+};
+
+/* Calendar queue of B blocks. Elements more than B blocks ahead go to an
+ * ordered map, and move to the blocks every B/2 blocks.
+ */
 template <typename T, uint32_t B>
 class PrioQueue {
-    struct PQBlock {
-        T* array[64];
-        uint64_t occ; // bit i is 1 if array[i] is populated
-
-        PQBlock() {
-            for (uint32_t i = 0; i < 64; i++) array[i] = nullptr;
-            occ = 0;
-        }
-
-        inline T* dequeue(uint32_t& offset) {
-            assert(occ);
-            uint32_t pos = __builtin_ctzl(occ);
-            T* res = array[pos];
-            T* next = res->next;
-            array[pos] = next;
-            if (!next) occ ^= 1L << pos;
-            assert(res);
-            offset = pos;
-            res->next = nullptr;
-            return res;
-        }
-
-        inline void enqueue(T* obj, uint32_t pos) {
-            occ |= 1L << pos;
-            assert(!obj->next);
-            obj->next = array[pos];
-            array[pos] = obj;
-        }
-    };
-
-    PQBlock blocks[B];
+    PQBlock<T> blocks[B];
 
     typedef g_multimap<uint64_t, T*> FEMap; //far element map
     typedef typename FEMap::iterator FEMapIterator;
@@ -150,5 +158,243 @@ class PrioQueue {
         }
 };
 
+/* Same interface as PrioQueue, but elements more than B blocks ahead go to a
+ * hierarchical timing wheel instead of a map: O(1) inserts with no
+ * allocation, chained through T::next, with their cycle in T::pqCycle.
+ *
+ * Time is split in epochs of B/2 blocks. The blocks always hold every element
+ * up to the end of loadedEpoch, the epoch after curBlock's, and each time
+ * curBlock enters a new epoch, the far elements of the next one move to the
+ * blocks in a batch. Far elements wait in L levels of 64 buckets: level k
+ * holds those whose epoch first differs from loadedEpoch in its k-th group
+ * of 6 bits (counting from the lowest), by the value of that group. So
+ * level 0 buckets are single epochs, level 1 ones 64 epochs, and so on; when
+ * loadedEpoch crosses into a bucket of a higher level, its elements cascade
+ * to the lower levels. Elements beyond the top level wait in an unordered
+ * list, revisited each time loadedEpoch crosses 64^L epochs.
+ *
+ * A bitmap of occupied blocks lets dequeue() and firstCycle() skip runs of
+ * empty blocks 64 at a time.
+ */
+template <typename T, uint32_t B, uint32_t L = 3>
+class WheelPrioQueue {
+    static_assert(B % 64 == 0 && B >= 128, "B must be a multiple of 64, 128 or more");
+    static_assert(L >= 1 && 6*L < 64, "L must be 1 to 10");
+    static const uint32_t H = B/2; //blocks per epoch
+
+    PQBlock<T> blocks[B];
+    uint64_t blockOcc[B/64]; //bit i is 1 if blocks[i] is populated
+
+    T* wheel[L][64];
+    uint64_t wheelOcc[L]; //bit i of level k is 1 if wheel[k][i] is populated
+    T* overflow; //beyond the top level
+
+    uint64_t curBlock;
+    uint64_t loadedEpoch;
+    uint64_t elems;
+    uint64_t farElems;
+
+    mutable uint64_t farMinCycle; //cached earliest far element, valid if farMinValid
+    mutable bool farMinValid;
+
+    public:
+        WheelPrioQueue() {
+            for (uint32_t i = 0; i < B/64; i++) blockOcc[i] = 0;
+            for (uint32_t k = 0; k < L; k++) {
+                for (uint32_t i = 0; i < 64; i++) wheel[k][i] = nullptr;
+                wheelOcc[k] = 0;
+            }
+            overflow = nullptr;
+            curBlock = 0;
+            loadedEpoch = 1;
+            elems = 0;
+            farElems = 0;
+            farMinValid = false;
+        }
+
+        void enqueue(T* obj, uint64_t cycle) {
+            uint64_t absBlock = cycle/64;
+            assert(absBlock >= curBlock);
+
+            if (absBlock < curBlock + B) {
+                enqueueNear(obj, cycle);
+            } else {
+                obj->pqCycle = cycle;
+                enqueueFar(obj);
+                farElems++;
+                if (farMinValid) farMinCycle = MIN(farMinCycle, cycle);
+            }
+            elems++;
+        }
+
+        T* dequeue(uint64_t& deqCycle) {
+            assert(elems);
+            while (!blocks[curBlock % B].occ) {
+                //Skip to the next populated block, but stop at each epoch to load its far elements
+                if (elems == farElems) skipEmptyEpochs();
+                curBlock++;
+                if (curBlock % H == 0) {
+                    loadEpoch(curBlock/H + 1);
+                } else if (!blocks[curBlock % B].occ) {
+                    uint64_t epochEnd = (curBlock/H + 1)*H;
+                    curBlock = nextPopulated(curBlock, epochEnd);
+                    if (curBlock == epochEnd) loadEpoch(curBlock/H + 1);
+                }
+            }
+
+            //We're now at the first populated block
+            uint32_t i = curBlock % B;
+            uint32_t offset;
+            T* obj = blocks[i].dequeue(offset);
+            if (!blocks[i].occ) blockOcc[i/64] &= ~(1ul << (i % 64));
+            elems--;
+
+            deqCycle = curBlock*64 + offset;
+            return obj;
+        }
+
+        inline uint64_t size() const {
+            return elems;
+        }
+
+        inline uint64_t firstCycle() const {
+            assert(elems);
+            uint64_t occ = blocks[curBlock % B].occ;
+            if (occ) return curBlock*64 + __builtin_ctzl(occ); //common case
+            uint64_t end = curBlock + B;
+            uint64_t b = curBlock + 1;
+            if (!blocks[b % B].occ) b = nextPopulated(b, end);
+            if (b < end) {
+                uint64_t cycle = b*64 + __builtin_ctzl(blocks[b % B].occ);
+                //Far elements are past loadedEpoch
+                if (!farElems || b < (loadedEpoch + 1)*H) return cycle;
+                return MIN(cycle, farFirstCycle());
+            }
+            return farFirstCycle();
+        }
+
+    private:
+        inline void enqueueNear(T* obj, uint64_t cycle) {
+            uint32_t i = (cycle/64) % B;
+            blocks[i].enqueue(obj, cycle % 64);
+            blockOcc[i/64] |= 1ul << (i % 64);
+        }
+
+        //Files obj by the highest 6-bit group where its epoch differs from loadedEpoch; cascades call this too
+        inline void enqueueFar(T* obj) {
+            assert(!obj->next);
+            uint64_t epoch = obj->pqCycle/64/H;
+            assert(epoch >= loadedEpoch);
+            uint64_t diff = epoch ^ loadedEpoch;
+            uint32_t level = diff? (63 - __builtin_clzl(diff))/6 : 0;
+            if (level >= L) {
+                obj->next = overflow;
+                overflow = obj;
+                return;
+            }
+            uint32_t idx = (epoch >> (6*level)) % 64;
+            obj->next = wheel[level][idx];
+            wheel[level][idx] = obj;
+            wheelOcc[level] |= 1ul << idx;
+        }
+
+        inline T* takeBucket(uint32_t level, uint32_t idx) {
+            T* list = wheel[level][idx];
+            wheel[level][idx] = nullptr;
+            wheelOcc[level] &= ~(1ul << idx);
+            return list;
+        }
+
+        void loadEpoch(uint64_t epoch) {
+            assert(epoch == loadedEpoch + 1);
+            loadedEpoch = epoch;
+            if (!farElems) return;
+            farMinValid = false;
+
+            //Cascade from the top, so elements that land in a lower bucket that also cascades now go down with it
+            if (overflow && (epoch % (1ul << (6*L))) == 0) {
+                T* list = overflow;
+                overflow = nullptr;
+                cascade(list);
+            }
+            for (uint32_t level = L - 1; level > 0; level--) {
+                if (epoch % (1ul << (6*level))) continue; //not a bucket boundary of this level
+                uint32_t idx = (epoch >> (6*level)) % 64;
+                if (wheel[level][idx]) cascade(takeBucket(level, idx));
+            }
+
+            uint32_t idx = epoch % 64;
+            if (!wheel[0][idx]) return;
+            T* list = takeBucket(0, idx);
+            while (list) {
+                T* obj = list;
+                list = obj->next;
+                obj->next = nullptr;
+                assert(obj->pqCycle/64/H == epoch);
+                enqueueNear(obj, obj->pqCycle);
+                farElems--;
+            }
+        }
+
+        //With no near elements, jump to just before the next epoch whose load has work to do (a level-0
+        //bucket or a cascade), so distant events don't walk every empty epoch. No bucket changes
+        //level in between, so the elements stay filed correctly. dequeue's increment then loads it.
+        void skipEmptyEpochs() {
+            uint64_t next;
+            uint32_t level = 0;
+            while (level < L && !wheelOcc[level]) level++;
+            if (level < L) {
+                uint32_t shift = 6*level;
+                next = ((loadedEpoch >> (shift + 6)) << (shift + 6)) | ((uint64_t)__builtin_ctzl(wheelOcc[level]) << shift);
+            } else {
+                next = ((loadedEpoch >> (6*L)) + 1) << (6*L);
+            }
+            assert(next > loadedEpoch);
+            if (next == loadedEpoch + 1) return;
+            loadedEpoch = next - 1;
+            curBlock = (next - 1)*H - 1;
+        }
+
+        inline void cascade(T* list) {
+            while (list) {
+                T* obj = list;
+                list = obj->next;
+                obj->next = nullptr;
+                enqueueFar(obj);
+            }
+        }
+
+        //First populated block in [from, to), or to; to - from must not exceed B
+        inline uint64_t nextPopulated(uint64_t from, uint64_t to) const {
+            uint64_t b = from;
+            while (b < to) {
+                uint32_t i = b % B;
+                uint64_t occ = blockOcc[i/64] >> (i % 64);
+                if (occ) return MIN(b + __builtin_ctzl(occ), to);
+                b += 64 - (i % 64);
+            }
+            return to;
+        }
+
+        uint64_t farFirstCycle() const {
+            assert(farElems);
+            if (farMinValid) return farMinCycle;
+            //All the elements of a level come before those of the levels above, and its buckets are in order
+            const T* list = overflow;
+            for (uint32_t level = 0; level < L; level++) {
+                if (wheelOcc[level]) {
+                    list = wheel[level][__builtin_ctzl(wheelOcc[level])];
+                    break;
+                }
+            }
+            assert(list);
+            uint64_t minCycle = list->pqCycle;
+            for (const T* obj = list->next; obj; obj = obj->next) minCycle = MIN(minCycle, obj->pqCycle);
+            farMinCycle = minCycle;
+            farMinValid = true;
+            return minCycle;
+        }
+};
+
 #endif  // PRIO_QUEUE_H_
 
@@ -26,6 +26,10 @@
 #include "ramulator_mem_ctrl.h"
 #include <map>
 #include <string>
+#include "checkpoint.h"
+#include "compressors.h"
+#include "constants.h"
+#include "data_shadow.h"
 #include "event_recorder.h"
 #include "tick_event.h"
 #include "timing_event.h"
@@ -42,10 +46,11 @@ class RamulatorAccEvent : public TimingEvent {
     Address addr;
     uint32_t coreid;
     uint32_t childid;
+    uint32_t dataBytes; //0 unless the link compresses
   public:
     uint64_t sCycle;
-    RamulatorAccEvent(Ramulator* _dram, bool _write, Address _addr, int32_t domain, uint32_t _coreid, uint32_t _childid) :
-            TimingEvent(0, 0, domain), dram(_dram), write(_write), addr(_addr), coreid(_coreid), childid(_childid) {}
+    RamulatorAccEvent(Ramulator* _dram, bool _write, Address _addr, int32_t domain, uint32_t _coreid, uint32_t _childid, uint32_t _dataBytes) :
+            TimingEvent(0, 0, domain), dram(_dram), write(_write), addr(_addr), coreid(_coreid), childid(_childid), dataBytes(_dataBytes) {}
 
     bool isWrite() const {
       return write;
@@ -63,6 +68,10 @@ class RamulatorAccEvent : public TimingEvent {
       return childid;
     }
 
+    uint32_t getDataBytes() const {
+      return dataBytes;
+    }
+
     void simulate(uint64_t startCycle) {
       sCycle = startCycle;
       dram->enqueue(this, startCycle);
@@ -76,11 +85,18 @@ Ramulator::Ramulator(std::string config_file, unsigned num_cpus, unsigned cache_
 	wrapper(NULL),
 	read_cb_func(std::bind(&Ramulator::DRAM_read_return_cb, this, std::placeholders::_1)),
 	write_cb_func(std::bind(&Ramulator::DRAM_write_return_cb, this, std::placeholders::_1)),
+	background_cb_func([](ramulator::Request&) {}),
 	resp_stall(false),
-	req_stall(false)
+	req_stall(false),
+	linkCompressor(nullptr),
+	dataShadow(nullptr)
 {
   minLatency = _minLatency;
   m_num_cores=num_cpus;
+  futex_init(&backgroundLock);
+  backgroundPending = 0;
+  futex_init(&stateLock);
+  externalUpdates = zinfo->ffWarmCaches || zinfo->checkpoints;
   const char* config_path = config_file.c_str();
   string pathStr = zinfo->outputDir;
   cout << pathStr << " " << application << endl;
@@ -107,7 +123,7 @@ Ramulator::Ramulator(std::string config_file, unsigned num_cpus, unsigned cache_
   freqRatio = ceil(cpuFreq/memFreq);
   info("[RAMILATOR] CPU/Mem frequency ratio %d", freqRatio);
 
-  Stats_ramulator::statlist.output(pathStr+"/"+application+".ramulator.stats");
+  wrapper->output_stats(pathStr+"/"+application+".ramulator.stats");
   curCycle = 0;
   domain = _domain;
   TickEvent<Ramulator>* tickEv = new TickEvent<Ramulator>(this, domain);
@@ -126,10 +142,101 @@ void Ramulator::initStats(AggregateStat* parentStat) {
   profWrites.init("wr", "Write requests"); memStats->append(&profWrites);
   profTotalRdLat.init("rdlat", "Total latency experienced by read requests"); memStats->append(&profTotalRdLat);
   profTotalWrLat.init("wrlat", "Total latency experienced by write requests"); memStats->append(&profTotalWrLat);
+  profRdLatHist.init("rdlatHist", "Latency experienced by read requests", zinfo->latencyHistograms); memStats->append(&profRdLatHist);
+  profWrLatHist.init("wrlatHist", "Latency experienced by write requests", zinfo->latencyHistograms); memStats->append(&profWrLatHist);
   reissuedAccesses.init("reissuedAccesses", "Number of accesses that were reissued due to full queue"); memStats->append(&reissuedAccesses);
+  profBackgroundReqs.init("bgReqs", "Background requests (e.g., page migrations) sent to DRAM"); memStats->append(&profBackgroundReqs);
+  if (linkCompressor) {
+    profLinkLines.init("linkLines", "Lines sent compressed over the memory link"); memStats->append(&profLinkLines);
+    profLinkBytes.init("linkBytes", "Bytes of those lines, compressed"); memStats->append(&profLinkBytes);
+  }
+  initRamulatorStats(memStats);
   parentStat->append(memStats);
 }
 
+// zsim stats are integers, so fractional Ramulator stats (precision > 0) are exported times 1000
+static uint64_t exportedValue(double v, bool scaled) {
+  if (scaled) v *= 1000.0;
+  return (v > 0.0)? (uint64_t)(v + 0.5) : 0; // also maps NaN averages (no samples) to 0
+}
+
+void Ramulator::initRamulatorStats(AggregateStat* memStats) {
+  // Ramulator's displayed stats, read at dump time like any other stat. Those
+  // computed in Memory::finish() (e.g., read_latency_avg) are only final in
+  // the termination dump, as finish() runs right before it.
+  AggregateStat* dramStats = new AggregateStat();
+  dramStats->init("ramulator", "Ramulator stats");
+  const std::string prefix = "ramulator.";
+  for (Stats_ramulator::StatBase* rs : wrapper->stats.get_list()) {
+    if (!rs->is_display() || rs->size() == 0) continue;
+    std::string rname = rs->get_name();
+    if (rname.compare(0, prefix.size(), prefix) == 0) rname = rname.substr(prefix.size());
+    bool scaled = rs->get_precision() > 0;
+    std::string rdesc = rs->get_desc() + (scaled? " (x1000)" : "");
+    const char* statName = gm_strdup(rname.c_str());
+    const char* statDesc = gm_strdup(rdesc.c_str());
+
+    const Stats_ramulator::LatencyHistogram* hist = dynamic_cast<const Stats_ramulator::LatencyHistogram*>(rs);
+    if (hist) {
+      // Same layout as zsim's LatencyHistogram
+      AggregateStat* histStat = new AggregateStat();
+      histStat->init(statName, statDesc);
+      const char* pctNames[] = {"max", "p50", "p95", "p99"};
+      const char* pctDescs[] = {"Largest sample", "Median (bucket upper bound)",
+          "95th percentile (bucket upper bound)", "99th percentile (bucket upper bound)"};
+      const double fractions[] = {1.0, 0.50, 0.95, 0.99};
+      for (uint32_t i = 0; i < 4; i++) {
+        double fraction = fractions[i];
+        auto f = [this, hist, fraction]() {
+          if (unlikely(externalUpdates)) futex_lock(&stateLock);
+          uint64_t v = exportedValue(hist->percentile(fraction), false);
+          if (unlikely(externalUpdates)) futex_unlock(&stateLock);
+          return v;
+        };
+        auto stat = makeLambdaStat(f);
+        stat->init(pctNames[i], pctDescs[i]);
+        histStat->append(stat);
+      }
+      if (zinfo->latencyHistograms) {
+        auto f = [this, hist](uint32_t idx) {
+          if (unlikely(externalUpdates)) futex_lock(&stateLock);
+          uint64_t v = exportedValue(hist->bucket_count(idx), false);
+          if (unlikely(externalUpdates)) futex_unlock(&stateLock);
+          return v;
+        };
+        auto stat = makeLambdaVectorStat(f, hist->size());
+        stat->init("hist", "Samples per bucket (log-linear)");
+        histStat->append(stat);
+      }
+      dramStats->append(histStat);
+    } else if (rs->size() == 1) {
+      auto f = [this, rs, scaled]() {
+        if (unlikely(externalUpdates)) futex_lock(&stateLock);
+        rs->prepare();
+        uint64_t v = exportedValue(rs->total(), scaled);
+        if (unlikely(externalUpdates)) futex_unlock(&stateLock);
+        return v;
+      };
+      auto stat = makeLambdaStat(f);
+      stat->init(statName, statDesc);
+      dramStats->append(stat);
+    } else {
+      auto f = [this, rs, scaled](uint32_t idx) {
+        if (unlikely(externalUpdates)) futex_lock(&stateLock);
+        rs->prepare();
+        Stats_ramulator::VResult vres = rs->vresult();
+        uint64_t v = (idx < vres.size())? exportedValue(vres[idx], scaled) : 0;
+        if (unlikely(externalUpdates)) futex_unlock(&stateLock);
+        return v;
+      };
+      auto stat = makeLambdaVectorStat(f, rs->size());
+      stat->init(statName, statDesc);
+      dramStats->append(stat);
+    }
+  }
+  memStats->append(dramStats);
+}
+
 uint64_t Ramulator::access(MemReq& req) {
   switch (req.type) {
     case PUTS:
@@ -148,22 +255,46 @@ uint64_t Ramulator::access(MemReq& req) {
   if(req.type == PUTS){
     return req.cycle; //must return an absolute value, 0 latency
   }
+  else if (unlikely(req.is(MemReq::WARM))) {
+    // Functional warming: only the open rows change
+    futex_lock(&stateLock);
+    wrapper->warm((long)(req.lineAddr << lineBits));
+    futex_unlock(&stateLock);
+    return req.cycle;
+  }
   else {
     bool isWrite = (req.type == PUTX);
     uint64_t respCycle = req.cycle + minLatency;
 
     if (zinfo->eventRecorders[req.srcId]) {
       Address addr = req.lineAddr <<lineBits;
-      RamulatorAccEvent* memEv = new (zinfo->eventRecorders[req.srcId]) RamulatorAccEvent(this, isWrite, addr, domain,req.srcId, req.childId);
+      uint32_t dataBytes = linkCompressor? linkBytes(req.lineAddr) : 0;
+      RamulatorAccEvent* memEv = new (zinfo->eventRecorders[req.srcId]) RamulatorAccEvent(this, isWrite, addr, domain,req.srcId, req.childId, dataBytes);
       memEv->setMinStartCycle(req.cycle);
       TimingRecord tr = {addr, req.cycle, respCycle, req.type, memEv, memEv};
       zinfo->eventRecorders[req.srcId]->pushRecord(tr);
     }
+    __sync_fetch_and_add(&zinfo->num_dram_requests, 1);
     return respCycle;
   }
 }
 
+// Writebacks carry what the levels above held, and reads what memory holds; the shadow has the
+// snapshot of the last writeback to a compressed cache if there is one, else the current values
+uint32_t Ramulator::linkBytes(Address lineAddr) {
+  uint32_t lineSize = zinfo->lineSize;
+  uint8_t line[MAX_LINE_SIZE];
+  assert(lineSize <= MAX_LINE_SIZE);
+  uint32_t bytes = dataShadow->read(lineAddr, line)? linkCompressor->compress(line, lineSize) : lineSize;
+  profLinkLines.atomicInc();
+  profLinkBytes.atomicInc(bytes);
+  return bytes;
+}
+
 uint32_t Ramulator::tick(uint64_t cycle) {
+  // Fast-forwarded threads and checkpoint restores may change the row buffers at any time
+  if (unlikely(externalUpdates)) futex_lock(&stateLock);
+
   // REMOVE comments for clock divider (i.e., memory clock is different from host clock)
   //if((tickCounter % freqRatio) == 0){
   wrapper->tick();
@@ -176,6 +307,7 @@ uint32_t Ramulator::tick(uint64_t cycle) {
       ramulator::Request req((long)ev->getAddr(), ramulator::Request::Type::WRITE, write_cb_func,ev->getCoreID());
       long addr_tmp = req._addr;
       req.childid = ev->getChildID();
+      req.data_bytes = ev->getDataBytes();
 
       if(wrapper->send(req)){
         overflowQueue.pop_front();
@@ -189,6 +321,7 @@ uint32_t Ramulator::tick(uint64_t cycle) {
       ramulator::Request req((long)ev->getAddr(), ramulator::Request::Type::READ, read_cb_func ,ev->getCoreID());
       long addr_tmp = req._addr;
       req.childid = ev->getChildID();
+      req.data_bytes = ev->getDataBytes();
 
 
       if(wrapper->send(req)){
@@ -201,13 +334,58 @@ uint32_t Ramulator::tick(uint64_t cycle) {
     }
   }
 
+  // Background traffic only uses slots that demand requests leave free
+  if (overflowQueue.empty() && backgroundPending) {
+    futex_lock(&backgroundLock);
+    if (!backgroundQueue.empty()) {
+      BackgroundReq& bg = backgroundQueue.front();
+      std::function<void()> done = bg.done;
+      ramulator::Request req((long)bg.addr, bg.isWrite? ramulator::Request::Type::WRITE : ramulator::Request::Type::READ,
+          done? std::function<void(ramulator::Request&)>([done](ramulator::Request&) {done();}) : background_cb_func, 0);
+      if (wrapper->send(req)) {
+        backgroundQueue.pop_front();
+        __sync_fetch_and_sub(&backgroundPending, 1);
+        profBackgroundReqs.inc();
+      }
+    }
+    futex_unlock(&backgroundLock);
+  }
+
   curCycle++;
+  if (unlikely(externalUpdates)) futex_unlock(&stateLock);
   return 1;
 }
 
+void Ramulator::enqueueBackground(Address lineAddr, bool isWrite, std::function<void()> done) {
+  BackgroundReq bg = {lineAddr << lineBits, isWrite, done};
+  futex_lock(&backgroundLock);
+  backgroundQueue.push_back(bg);
+  __sync_fetch_and_add(&backgroundPending, 1);
+  futex_unlock(&backgroundLock);
+}
+
+void Ramulator::serialize(Checkpoint& ckpt) {
+  if (!ckpt.beginSection(std::string("ramulator ") + name.c_str(), wrapper->geometry())) return;
+  futex_lock(&stateLock);
+  vector<vector<int>> rows;
+  if (ckpt.isSaving()) wrapper->open_rows(rows);
+  uint64_t numRows = rows.size();
+  ckpt.io(numRows);
+  rows.resize(numRows);
+  for (auto& row : rows) {
+    uint32_t levels = row.size();
+    ckpt.io(levels);
+    row.resize(levels);
+    ckpt.io(row.data(), levels);
+    if (!ckpt.isSaving()) wrapper->warm_row(row);
+  }
+  futex_unlock(&stateLock);
+  ckpt.endSection();
+}
+
 void Ramulator::finish(){
   wrapper->finish();
-  Stats_ramulator::statlist.printall();
+  wrapper->print_stats();
 }
 
 void Ramulator::enqueue(RamulatorAccEvent* ev, uint64_t cycle) {
@@ -217,6 +395,7 @@ void Ramulator::enqueue(RamulatorAccEvent* ev, uint64_t cycle) {
     ramulator::Request req((long)ev->getAddr(), ramulator::Request::Type::WRITE, write_cb_func,ev->getCoreID());
     addr_tmp = req._addr;
     req.childid = ev->getChildID();
+    req.data_bytes = ev->getDataBytes();
 
     if(!wrapper->send(req)){
       overflowQueue.push_back(ev);
@@ -229,6 +408,7 @@ void Ramulator::enqueue(RamulatorAccEvent* ev, uint64_t cycle) {
     ramulator::Request req((long)ev->getAddr(), ramulator::Request::Type::READ, read_cb_func, ev->getCoreID());
     long addr_tmp = req._addr;
     req.childid = ev->getChildID();
+    req.data_bytes = ev->getDataBytes();
 
     if(!wrapper->send(req)){
       overflowQueue.push_back(ev);
@@ -257,11 +437,13 @@ void Ramulator::DRAM_read_return_cb(ramulator::Request& req) {
   if (ev->isWrite()) {
     profWrites.inc();
     profTotalWrLat.inc(lat);
+    profWrLatHist.inc(lat);
     inflight_w--;
   }
   else {
     profReads.inc();
     profTotalRdLat.inc(lat);
+    profRdLatHist.inc(lat);
     inflight_r--;
   }
 
@@ -6,6 +6,7 @@
 #include <string>
 #include <functional>
 #include "g_std/g_string.h"
+#include "locks.h"
 #include "memory_hierarchy.h"
 #include "pad.h"
 #include <list>
@@ -19,6 +20,9 @@ namespace ramulator {
   class RamulatorWrapper;
 };
 
+class Checkpoint;
+class Compressor;
+class DataShadow;
 class RamulatorAccEvent;
 class Ramulator : public MemObject { //one Ramulator controller
   private:
@@ -61,7 +65,12 @@ class Ramulator : public MemObject { //one Ramulator controller
     Counter profWrites;
     Counter profTotalRdLat;
     Counter profTotalWrLat;
+    LatencyHistogram profRdLatHist;
+    LatencyHistogram profWrLatHist;
   	Counter reissuedAccesses;
+    Counter profBackgroundReqs;
+    Counter profLinkLines;
+    Counter profLinkBytes;
     PAD();
     int inflight_r = 0;
     int inflight_w = 0;
@@ -81,14 +90,36 @@ class Ramulator : public MemObject { //one Ramulator controller
     uint32_t tick(uint64_t cycle);
     void enqueue(RamulatorAccEvent* ev, uint64_t cycle);
 
+    // Traffic that no core waits for (e.g., page migrations). It is sent to
+    // the DRAM when there are no demand requests waiting, so it only delays
+    // them through bank and bus contention. Can be called in the bound phase.
+    // done, if given, is called from the weave phase when the request completes.
+    void enqueueBackground(Address lineAddr, bool isWrite, std::function<void()> done = nullptr);
+
+    // Saves or restores the open rows in its own section (see checkpoint.h)
+    void serialize(Checkpoint& ckpt);
+
+    // Compresses the lines sent over the memory link, so they take fewer
+    // bursts (see compressors.h). Call before initStats()
+    void setLinkCompression(Compressor* compressor, DataShadow* shadow) {
+      linkCompressor = compressor;
+      dataShadow = shadow;
+    }
+
   private:
     std::function<void(ramulator::Request&)> read_cb_func;
 	  std::function<void(ramulator::Request&)> write_cb_func;
+    std::function<void(ramulator::Request&)> background_cb_func;
 	  bool resp_stall;
 	  bool req_stall;
 
+    Compressor* linkCompressor;
+    DataShadow* dataShadow;
+    uint32_t linkBytes(Address lineAddr); //of a compressed line
+
     void DRAM_read_return_cb(ramulator::Request&);
     void DRAM_write_return_cb(ramulator::Request&);
+    void initRamulatorStats(AggregateStat* memStats); //exports Ramulator's own stats into zsim's tree
 	  unsigned m_num_cores;
 
     vector<RamulatorAccEvent> ramulatorAccEvent;
@@ -97,6 +128,17 @@ class Ramulator : public MemObject { //one Ramulator controller
     map<uint64_t, uint64_t> addr_counter;
 
     std::list<RamulatorAccEvent*> overflowQueue;
+    struct BackgroundReq {
+      Address addr;
+      bool isWrite;
+      std::function<void()> done;
+    };
+    std::list<BackgroundReq> backgroundQueue;
+    lock_t backgroundLock;
+    volatile uint32_t backgroundPending; //size of backgroundQueue, so tick() can skip the lock when it is empty
+
+    bool externalUpdates; //true if the open rows may change outside tick() (sim.ffWarming, sim.checkpoint)
+    lock_t stateLock; //serializes those updates (and stats reads) with tick()
 };
 
 #endif  // RAMULATOR_MEM_CTRL_H_
@@ -29,6 +29,7 @@
 #include <functional>
 #include "bithacks.h"
 #include "cache_arrays.h"
+#include "checkpoint.h"
 #include "coherence_ctrls.h"
 #include "memory_hierarchy.h"
 #include "mtrand.h"
@@ -54,6 +55,9 @@ class ReplPolicy : public GlobAlloc {
         virtual uint32_t rankCands(const MemReq* req, ZCands cands) = 0;
 
         virtual void initStats(AggregateStat* parent) {}
+
+        //Saves or restores the replacement state; returns false if the policy does not support checkpoints
+        virtual bool serialize(Checkpoint& ckpt) {return false;}
 };
 
 /* Add DECL_RANK_BINDINGS to each class that implements the new interface,
@@ -118,6 +122,12 @@ class LRUReplPolicy : public ReplPolicy {
             array[id] = 0;
         }
 
+        bool serialize(Checkpoint& ckpt) {
+            ckpt.io(timestamp);
+            ckpt.io(array, numLines);
+            return true;
+        }
+
         template <typename C> inline uint32_t rank(const MemReq* req, C cands) {
             uint32_t bestCand = -1;
             uint64_t bestScore = (uint64_t)-1L;
@@ -249,6 +259,12 @@ class NRUReplPolicy : public LegacyReplPolicy {
             candIdx = 0;
             array[id] = 0;
         }
+
+        bool serialize(Checkpoint& ckpt) {
+            ckpt.io(array, numLines);
+            ckpt.io(youngLines);
+            return true;
+        }
 };
 
 class RandReplPolicy : public LegacyReplPolicy {
@@ -286,6 +302,8 @@ class RandReplPolicy : public LegacyReplPolicy {
         void replaced(uint32_t id) {
             candIdx = 0;
         }
+
+        bool serialize(Checkpoint& ckpt) {return true;} //stateless
 };
 
 class LFUReplPolicy : public LegacyReplPolicy {
@@ -370,6 +388,12 @@ class LFUReplPolicy : public LegacyReplPolicy {
             bestRank.reset();
             array[id].acc = 0;
         }
+
+        bool serialize(Checkpoint& ckpt) {
+            ckpt.io(timestamp);
+            ckpt.io(array, numLines);
+            return true;
+        }
 };
 
 //Extends a given replacement policy to profile access ordering violations
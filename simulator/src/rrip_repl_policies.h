@@ -0,0 +1,433 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RRIP_REPL_POLICIES_H_
+#define RRIP_REPL_POLICIES_H_
+
+#include <stdint.h>
+#include "repl_policies.h"
+
+/* Re-reference interval prediction policies (Jaleel et al., ISCA 2010), and the
+ * PC-based SHiP (Wu et al., MICRO 2011) and Hawkeye (Jain and Lin, ISCA 2016),
+ * which fare much better than LRU on the streaming and thrashing patterns of
+ * memory-bound code.
+ *
+ * They all rank candidates as a group and never look at sets, so they work on
+ * both SetAssoc and Z arrays. Where the originals pick a few sets (leader sets
+ * for set dueling, sampled sets for OPTgen), these pick lines by address
+ * instead, which comes down to the same thing on a set-associative array.
+ *
+ * update() is called both on hits and, right after replaced(), on insertions;
+ * replaced() leaves a mark so that update() can tell them apart.
+ */
+
+//Picks about 1/2^bits of all line addresses, spreading them across sets and banks
+static inline uint32_t LineGroup(Address lineAddr, uint32_t bits) {
+    return (lineAddr ^ (lineAddr >> 13) ^ (lineAddr >> 27)) & ((1 << bits) - 1);
+}
+
+//Folds an instruction address into a table index
+static inline uint32_t PCSignature(Address pc, uint32_t bits) {
+    return (pc ^ (pc >> bits) ^ (pc >> 2*bits)) & ((1 << bits) - 1);
+}
+
+/* SRRIP, BRRIP and DRRIP. Each line has a re-reference prediction value
+ * (RRPV, rrpvBits bits); hits predict a near-immediate re-reference (0), and
+ * the victim is the first candidate with a distant one (max), after aging all
+ * candidates until there is one. They differ on insertion:
+ *  - SRRIP inserts at max-1 (long), so lines not reused soon go before those that were,
+ *  - BRRIP inserts at max (distant), and at max-1 only once every 32 insertions, which resists thrashing,
+ *  - DRRIP picks one of them by set dueling, with 1/64 of the lines always using each.
+ */
+class RRIPReplPolicy : public ReplPolicy {
+    public:
+        enum Mode {SRRIP, BRRIP, DRRIP};
+
+    protected:
+        static const uint8_t INSERTING = 0xff; //set by replaced()
+
+        uint8_t* rrpv;
+        uint32_t numLines;
+        const uint8_t maxRRPV;
+
+    private:
+        const Mode mode;
+        uint32_t psel; //DRRIP's selector: SRRIP leader misses count up, BRRIP leader misses down
+        uint32_t brripInsertions;
+
+        static const uint32_t PSEL_MAX = 1023; //10 bits
+        static const uint32_t DUEL_BITS = 6; //1 in 64 lines leads for each policy
+
+    public:
+        RRIPReplPolicy(uint32_t _numLines, uint32_t rrpvBits, Mode _mode)
+            : numLines(_numLines), maxRRPV((1 << rrpvBits) - 1), mode(_mode), psel(PSEL_MAX/2), brripInsertions(0)
+        {
+            assert(rrpvBits > 0 && rrpvBits < 8);
+            rrpv = gm_calloc<uint8_t>(numLines);
+            for (uint32_t i = 0; i < numLines; i++) rrpv[i] = maxRRPV;
+        }
+
+        ~RRIPReplPolicy() {
+            gm_free(rrpv);
+        }
+
+        void initStats(AggregateStat* parentStat) {
+            if (mode != DRRIP) return;
+            auto pselStat = makeLambdaStat([this]() {return (uint64_t)psel;});
+            pselStat->init("psel", "DRRIP policy selector (above 511, followers use BRRIP)");
+            parentStat->append(pselStat);
+        }
+
+        void update(uint32_t id, const MemReq* req) {
+            rrpv[id] = (rrpv[id] == INSERTING)? insertionRRPV(req) : 0;
+        }
+
+        void replaced(uint32_t id) {
+            rrpv[id] = INSERTING;
+        }
+
+        bool serialize(Checkpoint& ckpt) {
+            ckpt.io(rrpv, numLines);
+            ckpt.io(psel);
+            ckpt.io(brripInsertions);
+            return true;
+        }
+
+        template <typename C> inline uint32_t rank(const MemReq* req, C cands) {
+            return rankRRPV(cands);
+        }
+
+        DECL_RANK_BINDINGS;
+
+    protected:
+        //Invalid lines first, then the first one with the highest RRPV; ages all candidates so that it is at max.
+        //ZArray walks may list a line more than once, so aging saturates instead of adding once per appearance.
+        template <typename C> inline uint32_t rankRRPV(C cands) {
+            uint32_t bestCand = -1;
+            uint32_t bestRRPV = 0;
+            for (auto ci = cands.begin(); ci != cands.end(); ci.inc()) {
+                uint32_t id = *ci;
+                if (!cc->isValid(id)) return id;
+                assert(rrpv[id] <= maxRRPV);
+                if (bestCand == (uint32_t)-1 || rrpv[id] > bestRRPV) {
+                    bestCand = id;
+                    bestRRPV = rrpv[id];
+                }
+            }
+            uint32_t age = maxRRPV - bestRRPV;
+            if (age) {
+                for (auto ci = cands.begin(); ci != cands.end(); ci.inc()) rrpv[*ci] = MIN(rrpv[*ci] + age, maxRRPV);
+            }
+            return bestCand;
+        }
+
+        inline uint8_t brripRRPV() {
+            return (brripInsertions++ % 32 == 0)? maxRRPV - 1 : maxRRPV;
+        }
+
+    private:
+        inline uint8_t insertionRRPV(const MemReq* req) {
+            if (mode == SRRIP) return maxRRPV - 1;
+            if (mode == BRRIP) return brripRRPV();
+
+            //Set dueling: every insertion is a miss
+            uint32_t group = req? LineGroup(req->lineAddr, DUEL_BITS) : 2;
+            if (group == 0) {
+                if (psel < PSEL_MAX) psel++;
+                return maxRRPV - 1;
+            } else if (group == 1) {
+                if (psel > 0) psel--;
+                return brripRRPV();
+            } else {
+                return (psel > PSEL_MAX/2)? brripRRPV() : maxRRPV - 1;
+            }
+        }
+};
+
+/* SHiP-PC: SRRIP, but lines are inserted at max (distant) if the instruction
+ * that brought them in has not seen its lines reused lately. A table of
+ * saturating counters (SHCT), indexed by a signature of the PC, counts up on
+ * hits and down on evictions of lines that were never hit. Accesses without a
+ * PC (MemReq::pc == 0) share a signature.
+ */
+class SHiPReplPolicy : public RRIPReplPolicy {
+    private:
+        enum Outcome : uint8_t {EMPTY, INSERTED, REUSED};
+
+        uint16_t* signatures;
+        uint8_t* outcomes;
+        uint8_t* shct;
+
+        Counter profDistantInsertions;
+
+        static const uint32_t SHCT_BITS = 14; //16K entries
+        static const uint8_t SHCT_MAX = 7; //3-bit counters
+
+    public:
+        SHiPReplPolicy(uint32_t _numLines, uint32_t rrpvBits) : RRIPReplPolicy(_numLines, rrpvBits, SRRIP) {
+            signatures = gm_calloc<uint16_t>(numLines);
+            outcomes = gm_calloc<uint8_t>(numLines); //EMPTY
+            shct = gm_calloc<uint8_t>(1 << SHCT_BITS);
+            for (uint32_t i = 0; i < (1u << SHCT_BITS); i++) shct[i] = 1; //weakly reused, so that cold signatures are not bypassed
+        }
+
+        ~SHiPReplPolicy() {
+            gm_free(signatures);
+            gm_free(outcomes);
+            gm_free(shct);
+        }
+
+        void initStats(AggregateStat* parentStat) {
+            profDistantInsertions.init("distantIns", "Insertions predicted not to be reused (inserted at distant RRPV)");
+            parentStat->append(&profDistantInsertions);
+        }
+
+        void update(uint32_t id, const MemReq* req) {
+            if (rrpv[id] == INSERTING) {
+                uint16_t sig = PCSignature(req? req->pc : 0, SHCT_BITS);
+                signatures[id] = sig;
+                outcomes[id] = INSERTED;
+                if (shct[sig] == 0) {
+                    rrpv[id] = maxRRPV;
+                    profDistantInsertions.inc();
+                } else {
+                    rrpv[id] = maxRRPV - 1;
+                }
+            } else {
+                rrpv[id] = 0;
+                if (outcomes[id] != EMPTY) {
+                    outcomes[id] = REUSED;
+                    if (shct[signatures[id]] < SHCT_MAX) shct[signatures[id]]++;
+                }
+            }
+        }
+
+        void replaced(uint32_t id) {
+            if (outcomes[id] == INSERTED && shct[signatures[id]] > 0) shct[signatures[id]]--;
+            outcomes[id] = EMPTY;
+            RRIPReplPolicy::replaced(id);
+        }
+
+        bool serialize(Checkpoint& ckpt) {
+            RRIPReplPolicy::serialize(ckpt);
+            ckpt.io(signatures, numLines);
+            ckpt.io(outcomes, numLines);
+            ckpt.io(shct, 1 << SHCT_BITS);
+            return true;
+        }
+};
+
+/* Hawkeye. OPTgen replays the accesses to a few sampled sets (here, groups of
+ * lines; see above) to find out whether Belady's OPT, with the cache's
+ * associativity, would have kept each line until its next use. That trains a
+ * predictor of saturating counters indexed by the PC signature of the access
+ * before: lines brought in or hit by cache-friendly PCs are kept in LRU order,
+ * and cache-averse ones are evicted first. Evicting a friendly line means the
+ * prediction was wrong, so its PC is detrained.
+ */
+class HawkeyeReplPolicy : public ReplPolicy {
+    private:
+        //Per line
+        uint64_t* timestamps; //LRU order among friendly lines
+        uint16_t* signatures;
+        uint8_t* averse;
+        uint64_t timestamp;
+
+        uint8_t* predictor;
+
+        //OPTgen: each sampled set keeps the last histLen accesses (8x the associativity, as in the paper). occupancy[t % histLen]
+        //is how many lines OPT holds over the interval that starts at the set's access t
+        struct SampledAccess {
+            Address lineAddr;
+            uint64_t time;
+            uint16_t signature;
+            bool valid;
+        };
+        SampledAccess* history; //sampledSets*histLen
+        uint8_t* occupancy; //sampledSets*histLen
+        uint64_t* setTimes; //sampledSets
+        uint32_t numLines;
+        uint32_t assoc; //ways, or candidates on Z arrays
+        uint32_t histLen;
+        uint32_t sampleBits; //1 in 2^sampleBits lines is sampled
+
+        Counter profOptAccesses, profOptHits, profAverseInsertions, profDetrains;
+
+        static const uint32_t PRED_BITS = 13; //8K entries
+        static const uint8_t PRED_MAX = 7; //3-bit counters
+        static const uint8_t PRED_FRIENDLY = 4;
+        static const uint32_t SAMPLED_SETS_BITS = 6; //64 sampled sets
+
+    public:
+        HawkeyeReplPolicy(uint32_t _numLines, uint32_t _assoc) : timestamp(1), numLines(_numLines), assoc(_assoc), histLen(8*_assoc) {
+            assert(assoc > 0 && assoc < 256); //occupancy counts fit in 8 bits
+            timestamps = gm_calloc<uint64_t>(numLines);
+            signatures = gm_calloc<uint16_t>(numLines);
+            averse = gm_calloc<uint8_t>(numLines);
+            predictor = gm_calloc<uint8_t>(1 << PRED_BITS);
+            for (uint32_t i = 0; i < (1u << PRED_BITS); i++) predictor[i] = PRED_FRIENDLY;
+
+            //Sample as many lines as 64 sets of the array hold
+            uint32_t sets = numLines/assoc;
+            sampleBits = 0;
+            while ((sets >> (sampleBits + 1)) >= (1u << SAMPLED_SETS_BITS)) sampleBits++;
+
+            uint32_t sampledSets = 1 << SAMPLED_SETS_BITS;
+            history = gm_calloc<SampledAccess>(sampledSets*histLen);
+            occupancy = gm_calloc<uint8_t>(sampledSets*histLen);
+            setTimes = gm_calloc<uint64_t>(sampledSets);
+        }
+
+        ~HawkeyeReplPolicy() {
+            gm_free(timestamps);
+            gm_free(signatures);
+            gm_free(averse);
+            gm_free(predictor);
+            gm_free(history);
+            gm_free(occupancy);
+            gm_free(setTimes);
+        }
+
+        void initStats(AggregateStat* parentStat) {
+            profOptAccesses.init("optAccs", "Accesses replayed by OPTgen (sampled)");
+            profOptHits.init("optHits", "OPTgen hits, i.e., sampled accesses that OPT would have hit");
+            profAverseInsertions.init("averseIns", "Insertions predicted cache-averse");
+            profDetrains.init("detrains", "Cache-friendly lines evicted (their PCs are detrained)");
+            parentStat->append(&profOptAccesses);
+            parentStat->append(&profOptHits);
+            parentStat->append(&profAverseInsertions);
+            parentStat->append(&profDetrains);
+        }
+
+        void update(uint32_t id, const MemReq* req) {
+            bool insertion = timestamps[id] == 0;
+            uint16_t sig = PCSignature(req? req->pc : 0, PRED_BITS);
+            if (req && LineGroup(req->lineAddr, sampleBits) == 0) optgen(req->lineAddr, sig);
+
+            signatures[id] = sig;
+            averse[id] = predictor[sig] < PRED_FRIENDLY;
+            timestamps[id] = timestamp++;
+            if (insertion && averse[id]) profAverseInsertions.inc();
+        }
+
+        void replaced(uint32_t id) {
+            timestamps[id] = 0;
+        }
+
+        bool serialize(Checkpoint& ckpt) {
+            uint32_t sampledSets = 1 << SAMPLED_SETS_BITS;
+            ckpt.io(timestamps, numLines);
+            ckpt.io(signatures, numLines);
+            ckpt.io(averse, numLines);
+            ckpt.io(timestamp);
+            ckpt.io(predictor, 1 << PRED_BITS);
+            ckpt.io(history, sampledSets*histLen);
+            ckpt.io(occupancy, sampledSets*histLen);
+            ckpt.io(setTimes, sampledSets);
+            return true;
+        }
+
+        //Invalid lines first, then the LRU cache-averse line, then the LRU friendly one
+        template <typename C> inline uint32_t rank(const MemReq* req, C cands) {
+            uint32_t bestCand = -1;
+            uint64_t bestScore = (uint64_t)-1L;
+            for (auto ci = cands.begin(); ci != cands.end(); ci.inc()) {
+                uint32_t id = *ci;
+                if (!cc->isValid(id)) return id;
+                uint64_t s = averse[id]? timestamps[id] : timestamp + timestamps[id]; //lower is more evictable
+                if (s < bestScore) {
+                    bestCand = id;
+                    bestScore = s;
+                }
+            }
+            if (!averse[bestCand]) {
+                uint8_t& p = predictor[signatures[bestCand]];
+                if (p > 0) p--;
+                profDetrains.inc();
+            }
+            return bestCand;
+        }
+
+        DECL_RANK_BINDINGS;
+
+    private:
+        inline void train(uint16_t sig, bool friendly) {
+            uint8_t& p = predictor[sig];
+            if (friendly) {
+                if (p < PRED_MAX) p++;
+            } else {
+                if (p > 0) p--;
+            }
+        }
+
+        void optgen(Address lineAddr, uint16_t sig) {
+            uint32_t set = (LineGroup(lineAddr, sampleBits + SAMPLED_SETS_BITS) >> sampleBits);
+            SampledAccess* hist = &history[set*histLen];
+            uint8_t* occ = &occupancy[set*histLen];
+            uint64_t now = setTimes[set]++;
+            profOptAccesses.inc();
+
+            //Find the previous access to the line, or the oldest one to replace
+            SampledAccess* entry = nullptr;
+            SampledAccess* oldest = &hist[0];
+            for (uint32_t i = 0; i < histLen; i++) {
+                if (hist[i].valid && hist[i].lineAddr == lineAddr) {
+                    entry = &hist[i];
+                    break;
+                }
+                if (!hist[i].valid || (oldest->valid && hist[i].time < oldest->time)) oldest = &hist[i];
+            }
+
+            occ[now % histLen] = 0;
+            if (entry) {
+                if (now - entry->time < histLen) {
+                    //OPT would have hit if the line fits over the whole interval
+                    bool fits = true;
+                    for (uint64_t t = entry->time; t < now; t++) {
+                        if (occ[t % histLen] >= assoc) {
+                            fits = false;
+                            break;
+                        }
+                    }
+                    if (fits) {
+                        for (uint64_t t = entry->time; t < now; t++) occ[t % histLen]++;
+                        profOptHits.inc();
+                    }
+                    train(entry->signature, fits);
+                } else {
+                    train(entry->signature, false); //too far apart for OPT to keep it
+                }
+            } else {
+                if (oldest->valid) train(oldest->signature, false); //never reused while in the history
+                entry = oldest;
+                entry->lineAddr = lineAddr;
+                entry->valid = true;
+            }
+            entry->time = now;
+            entry->signature = sig;
+        }
+};
+
+#endif  // RRIP_REPL_POLICIES_H_
@@ -0,0 +1,229 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sampling.h"
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <math.h>
+#include <vector>
+#include "log.h"
+#include "process_stats.h"
+#include "zsim.h"
+
+SamplingController::SamplingController(Mode _mode, uint32_t _procIdx, const char* _outputFile)
+    : mode(_mode), procIdx(_procIdx), outputFile(_outputFile)
+{
+    period = warmupInstrs = detailedInstrs = samples = intervalInstrs = 0;
+    state = IDLE;
+    curWindow = 0;
+    windowStartInstrs = measureStartInstrs = measureStartCycles = 0;
+    measurePhaseCycles = measureDramReqs = 0;
+    lastInstrs = 0;
+    setConfidence(95);
+}
+
+void SamplingController::setPeriodic(uint64_t _period, uint64_t _warmupInstrs, uint64_t _detailedInstrs, uint64_t _samples) {
+    if (_detailedInstrs == 0) panic("Sampling: detailedInstrs must be > 0");
+    if (_period <= _warmupInstrs + _detailedInstrs) {
+        panic("Sampling: period (%ld) must exceed warmupInstrs + detailedInstrs (%ld)", _period, _warmupInstrs + _detailedInstrs);
+    }
+    period = _period;
+    warmupInstrs = _warmupInstrs;
+    detailedInstrs = _detailedInstrs;
+    samples = _samples;
+}
+
+void SamplingController::setSimPoints(const char* simpointsFile, const char* weightsFile, uint64_t _intervalInstrs, uint64_t _warmupInstrs) {
+    intervalInstrs = _intervalInstrs;
+    warmupInstrs = _warmupInstrs;
+    if (intervalInstrs < 2) panic("Sampling: sim.sampling.intervalInstrs must be at least 2");
+
+    //SimPoint output: "<interval> <cluster>" and "<weight> <cluster>" lines
+    std::map<uint32_t, double> clusterWeights;
+    std::ifstream wf(weightsFile);
+    if (!wf.good()) panic("Sampling: could not open SimPoint weights file %s", weightsFile);
+    double weight;
+    uint32_t cluster;
+    while (wf >> weight >> cluster) clusterWeights[cluster] = weight;
+
+    std::vector<std::pair<uint64_t, double>> points;
+    std::ifstream sf(simpointsFile);
+    if (!sf.good()) panic("Sampling: could not open SimPoint file %s", simpointsFile);
+    uint64_t interval;
+    while (sf >> interval >> cluster) {
+        if (clusterWeights.find(cluster) == clusterWeights.end()) panic("Sampling: SimPoint cluster %d has no weight", cluster);
+        points.push_back(std::make_pair(interval, clusterWeights[cluster]));
+    }
+    if (points.empty()) panic("Sampling: no SimPoints in %s", simpointsFile);
+    std::sort(points.begin(), points.end());
+
+    //Fast-forward up to each point's warmup, then simulate warmup and the point itself
+    uint64_t pos = 0;
+    for (auto& p : points) {
+        uint64_t start = p.first*intervalInstrs;
+        if (start < pos) {
+            warn("Sampling: SimPoint %ld is listed twice, skipping it", p.first);
+            continue;
+        }
+        //Fast-forward intervals must not be empty, so a point that starts where the previous one ended (or at
+        //instruction 0) is simulated from its second instruction, without warmup
+        uint64_t warmStart = (start > pos + warmupInstrs)? start - warmupInstrs : pos + 1;
+        intervals.push_back(warmStart - pos);
+        intervals.push_back(start + intervalInstrs - warmStart);
+        windowWarmup.push_back((start > warmStart)? start - warmStart : 0);
+        windowWeight.push_back(p.second);
+        pos = start + intervalInstrs;
+    }
+    info("Sampling: %ld SimPoints, %ld-instruction intervals", windowWeight.size(), intervalInstrs);
+}
+
+void SamplingController::setConfidence(uint32_t percent) {
+    switch (percent) {
+        case 90: z = 1.645; break;
+        case 95: z = 1.960; break;
+        case 99: z = 2.576; break;
+        default: panic("Sampling: unsupported confidence level %d%% (use 90, 95 or 99)", percent);
+    }
+}
+
+void SamplingController::initStats(AggregateStat* parentStat) {
+    AggregateStat* samplingStat = new AggregateStat();
+    samplingStat->init("sampling", "Sampled simulation stats");
+    profWindows.init("windows", "Measured detailed windows");
+    samplingStat->append(&profWindows);
+    profDiscarded.init("discarded", "Windows that ended before their warmup did");
+    samplingStat->append(&profDiscarded);
+    parentStat->append(samplingStat);
+}
+
+uint64_t SamplingController::getInterval(uint32_t idx) const {
+    if (mode == PERIODIC) {
+        if (samples && idx >= 2*samples) return 0;
+        return (idx % 2 == 0)? period - warmupInstrs - detailedInstrs : warmupInstrs + detailedInstrs;
+    }
+    return (idx < intervals.size())? intervals[idx] : 0;
+}
+
+void SamplingController::start() {
+    lastInstrs = zinfo->processStats->getProcessInstrs(procIdx);
+    state = IDLE;
+    curWindow = 0;
+    info("Sampling: starting at %ld simulated instructions", lastInstrs);
+}
+
+void SamplingController::windowStart() {
+    assert(state == IDLE);
+    //The process did not run since it entered fast-forward, so its instruction count has not moved
+    windowStartInstrs = lastInstrs;
+    state = WARMUP;
+}
+
+void SamplingController::windowEnd() {
+    uint64_t instrs = zinfo->processStats->getProcessInstrs(procIdx);
+    if (state == MEASURE) {
+        Sample s;
+        s.instrs = instrs - measureStartInstrs;
+        s.cycles = zinfo->processStats->getProcessCycles(procIdx) - measureStartCycles;
+        s.phaseCycles = measurePhaseCycles;
+        s.dramReqs = measureDramReqs;
+        s.weight = (mode == SIMPOINTS)? windowWeight[curWindow] : 1.0;
+        if (s.instrs && s.cycles && s.phaseCycles) {
+            results.push_back(s);
+            profWindows.inc();
+        } else {
+            profDiscarded.inc();
+        }
+    } else if (state == WARMUP) {
+        profDiscarded.inc();
+    }
+    lastInstrs = instrs;
+    state = IDLE;
+    curWindow++;
+}
+
+void SamplingController::phaseDone(uint64_t dramReqs) {
+    if (state == WARMUP) {
+        uint64_t warmup = (mode == SIMPOINTS)? windowWarmup[curWindow] : warmupInstrs;
+        uint64_t instrs = zinfo->processStats->getProcessInstrs(procIdx);
+        if (instrs - windowStartInstrs >= warmup) {
+            measureStartInstrs = instrs;
+            measureStartCycles = zinfo->processStats->getProcessCycles(procIdx);
+            measurePhaseCycles = 0;
+            measureDramReqs = 0;
+            state = MEASURE;
+        }
+    } else if (state == MEASURE) {
+        measurePhaseCycles += zinfo->phaseLength;
+        measureDramReqs += dramReqs;
+    }
+}
+
+void SamplingController::report() {
+    if (mode == BBV) return;
+
+    std::ofstream out(outputFile.c_str());
+    out << "# window instrs cycles phaseCycles dramReqs weight ipc mpki dramGBps" << std::endl;
+
+    const uint32_t METRICS = 3;
+    const char* names[METRICS] = {"ipc", "mpki", "dramGBps"};
+    std::vector<double> vals[METRICS];
+    std::vector<double> weights;
+    for (uint32_t i = 0; i < results.size(); i++) {
+        const Sample& s = results[i];
+        double v[METRICS];
+        v[0] = ((double)s.instrs)/s.cycles;
+        v[1] = 1000.0*s.dramReqs/s.instrs;
+        v[2] = ((double)s.dramReqs)*zinfo->lineSize*zinfo->freqMHz/(1000.0*s.phaseCycles);
+        for (uint32_t m = 0; m < METRICS; m++) vals[m].push_back(v[m]);
+        weights.push_back(s.weight);
+        out << i << " " << s.instrs << " " << s.cycles << " " << s.phaseCycles << " " << s.dramReqs << " " << s.weight
+            << " " << v[0] << " " << v[1] << " " << v[2] << std::endl;
+    }
+
+    uint32_t n = results.size();
+    out << "# samples " << n << std::endl;
+    info("Sampling: %d windows measured", n);
+    if (n == 0) return;
+    if (mode == PERIODIC && n < 30) warn("Sampling: only %d samples, confidence intervals are unreliable", n);
+
+    double totalWeight = 0.0;
+    for (double w : weights) totalWeight += w;
+    for (uint32_t m = 0; m < METRICS; m++) {
+        double mean = 0.0;
+        for (uint32_t i = 0; i < n; i++) mean += weights[i]*vals[m][i];
+        mean /= totalWeight;
+        if (mode == SIMPOINTS) {
+            out << names[m] << " " << mean << std::endl;
+            info("Sampling: %s %.4f (SimPoint estimate)", names[m], mean);
+        } else {
+            double var = 0.0;
+            for (uint32_t i = 0; i < n; i++) var += (vals[m][i] - mean)*(vals[m][i] - mean);
+            double ci = (n > 1)? z*sqrt(var/(n - 1))/sqrt((double)n) : 0.0;
+            out << names[m] << " " << mean << " +- " << ci << std::endl;
+            info("Sampling: %s %.4f +- %.4f", names[m], mean, ci);
+        }
+    }
+}
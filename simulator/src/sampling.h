@@ -0,0 +1,129 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SAMPLING_H_
+#define SAMPLING_H_
+
+#include <stdint.h>
+#include "g_std/g_string.h"
+#include "g_std/g_vector.h"
+#include "galloc.h"
+#include "stats.h"
+
+/* Sampled simulation of one process, built on instruction-based
+ * fast-forwarding (FFI, see zsim.cpp). Starting at ROI begin (or at process
+ * start if hooks are ignored), the process alternates between fast-forward
+ * intervals and detailed windows. The first warmupInstrs of each window warm
+ * up caches, predictors and memory state; the rest are measured. Supported
+ * schedules:
+ *
+ *  - periodic (SMARTS-like): every period instructions, a window of
+ *    warmupInstrs + detailedInstrs, for the given number of samples (0 runs
+ *    until ROI end).
+ *  - simpoints: the intervals chosen by SimPoint from a BBV profile, each
+ *    preceded by warmupInstrs of warming (less if the previous point or the
+ *    start of the ROI is closer) and weighted by its cluster weight.
+ *  - bbv: no detailed simulation; fast-forwards the whole ROI and writes a
+ *    basic-block vector per intervalInstrs to zsim.bbv, in SimPoint's format.
+ *
+ * Each measured window yields an IPC, an MPKI (DRAM requests, i.e., LLC misses
+ * and writebacks, per 1000 instructions) and a DRAM bandwidth. At the end, the
+ * sample means and their confidence intervals (normal approximation, which
+ * needs ~30 samples or more) go to zsim-sampling.txt. SimPoint estimates are
+ * weighted means and have no confidence interval.
+ *
+ * Window boundaries are only observed at phase ends, so windows run up to a
+ * phase longer than configured; the extra instructions come out of the next
+ * fast-forward interval, so windows stay aligned with the schedule.
+ */
+class SamplingController : public GlobAlloc {
+    public:
+        enum Mode {PERIODIC, SIMPOINTS, BBV};
+
+    private:
+        enum State {IDLE, WARMUP, MEASURE};
+
+        struct Sample {
+            uint64_t instrs;
+            uint64_t cycles; //unhalted core cycles of the process
+            uint64_t phaseCycles; //simulated time
+            uint64_t dramReqs;
+            double weight;
+        };
+
+        Mode mode;
+        uint32_t procIdx;
+        g_string outputFile;
+
+        //Schedule, alternating fast-forward and detailed intervals (starting with fast-forward); empty for open-ended periodic
+        g_vector<uint64_t> intervals;
+        g_vector<uint64_t> windowWarmup; //per window
+        g_vector<double> windowWeight; //per window
+        uint64_t period, warmupInstrs, detailedInstrs; //periodic
+        uint64_t samples; //periodic, 0 if unbounded
+        uint64_t intervalInstrs; //simpoints and bbv
+        double z; //for the confidence level
+
+        State state;
+        uint32_t curWindow;
+        uint64_t windowStartInstrs;
+        uint64_t measureStartInstrs, measureStartCycles;
+        uint64_t measurePhaseCycles, measureDramReqs;
+        uint64_t lastInstrs; //process instructions when it last entered fast-forward
+
+        g_vector<Sample> results;
+        Counter profWindows;
+        Counter profDiscarded;
+
+    public:
+        SamplingController(Mode _mode, uint32_t _procIdx, const char* _outputFile);
+
+        void setPeriodic(uint64_t _period, uint64_t _warmupInstrs, uint64_t _detailedInstrs, uint64_t _samples);
+        void setSimPoints(const char* simpointsFile, const char* weightsFile, uint64_t _intervalInstrs, uint64_t _warmupInstrs);
+        void setBBV(uint64_t _intervalInstrs) {intervalInstrs = _intervalInstrs;}
+        void setConfidence(uint32_t percent);
+
+        void initStats(AggregateStat* parentStat);
+
+        Mode getMode() const {return mode;}
+        uint32_t getProcIdx() const {return procIdx;}
+        uint64_t getIntervalInstrs() const {return intervalInstrs;}
+
+        //Length of the idx-th interval of the schedule (even: fast-forward, odd: detailed), or 0 when the schedule is done
+        uint64_t getInterval(uint32_t idx) const;
+
+        //Called by the sampled process when sampling starts, and when it leaves/enters fast-forward
+        void start();
+        void windowStart();
+        void windowEnd();
+
+        //Called at the end of every phase, with the DRAM requests the phase issued
+        void phaseDone(uint64_t dramReqs);
+
+        //Writes the estimates; called once, on termination
+        void report();
+};
+
+#endif  // SAMPLING_H_
@@ -180,8 +180,7 @@ void Scheduler::watchdogThreadFunc() {
 
         if (lastPhase == curPhase && scheduledThreads == outQueue.size() && !sleepQueue.empty()) {
             //info("Watchdog Thread: Sleep dep detected...")
-            int64_t wakeupPhase = sleepQueue.front()->wakeupPhase;
-            int64_t wakeupCycles = (wakeupPhase - curPhase)*zinfo->phaseLength;
+            int64_t wakeupCycles = sleepQueue.front()->wakeupCycle - zinfo->globPhaseCycles;
             int64_t wakeupUsec = (wakeupCycles > 0)? wakeupCycles/zinfo->freqMHz : 0;
 
             //info("Additional usecs of sleep %ld", wakeupUsec);
@@ -193,8 +192,8 @@ void Scheduler::watchdogThreadFunc() {
 
             if (lastPhase == curPhase && scheduledThreads == outQueue.size() && !sleepQueue.empty()) {
                 ThreadInfo* sth = sleepQueue.front();
-                uint64_t curMs = curPhase*zinfo->phaseLength/zinfo->freqMHz/1000;
-                uint64_t endMs = sth->wakeupPhase*zinfo->phaseLength/zinfo->freqMHz/1000;
+                uint64_t curMs = zinfo->globPhaseCycles/zinfo->freqMHz/1000;
+                uint64_t endMs = sth->wakeupCycle/zinfo->freqMHz/1000;
                 (void)curMs; (void)endMs; //make gcc happy
                 if (curMs > lastMs + 1000) {
                     info("Watchdog Thread: Driving time forward to avoid deadlock on sleep (%ld -> %ld ms)", curMs, endMs);
@@ -102,7 +102,7 @@ class Scheduler : public GlobAlloc, public Callee {
             volatile bool needsJoin; //after waiting on the scheduler, should we join the barrier, or is our cid good to go already?
 
             bool markedForSleep; //if true, we will go to sleep on the next leave()
-            uint64_t wakeupPhase; //if SLEEPING, when do we have to wake up?
+            uint64_t wakeupCycle; //if SLEEPING, when do we have to wake up? Absolute, since phase lengths may vary
 
             g_vector<bool> mask;
 
@@ -118,7 +118,7 @@ class Scheduler : public GlobAlloc, public Callee {
                 handoffThread = nullptr;
                 futexWord = 0;
                 markedForSleep = false;
-                wakeupPhase = 0;
+                wakeupCycle = 0;
                 assert(mask.size() == zinfo->numCores);
                 uint32_t count = 0;
                 for (auto b : mask) if (b) count++;
@@ -337,20 +337,20 @@ class Scheduler : public GlobAlloc, public Callee {
             zinfo->cores[cid]->leave();
 
             if (th->markedForSleep) { //transition to SLEEPING, eagerly deschedule
-                trace(Sched, "Sched: %d going to SLEEP, wakeup on phase %ld", gid, th->wakeupPhase);
+                trace(Sched, "Sched: %d going to SLEEP, wakeup on cycle %ld", gid, th->wakeupCycle);
                 th->markedForSleep = false;
                 ContextInfo* ctx = &contexts[cid];
                 deschedule(th, ctx, SLEEPING);
 
                 //Ordered insert into sleepQueue
-                if (sleepQueue.empty() || sleepQueue.front()->wakeupPhase > th->wakeupPhase) {
+                if (sleepQueue.empty() || sleepQueue.front()->wakeupCycle > th->wakeupCycle) {
                     sleepQueue.push_front(th);
                 } else {
                     ThreadInfo* cur = sleepQueue.front();
-                    while (cur->next && cur->next->wakeupPhase <= th->wakeupPhase) {
+                    while (cur->next && cur->next->wakeupCycle <= th->wakeupCycle) {
                         cur = cur->next;
                     }
-                    trace(Sched, "Put %d in sleepQueue (deadline %ld), after %d (deadline %ld)", gid, th->wakeupPhase, cur->gid, cur->wakeupPhase);
+                    trace(Sched, "Put %d in sleepQueue (deadline %ld), after %d (deadline %ld)", gid, th->wakeupCycle, cur->gid, cur->wakeupCycle);
                     sleepQueue.insertAfter(cur, th);
                 }
                 sleepEvents.inc();
@@ -432,16 +432,16 @@ class Scheduler : public GlobAlloc, public Callee {
             /* End of phase accounting */
             zinfo->numPhases++;
             zinfo->globPhaseCycles += zinfo->phaseLength;
+            zinfo->phaseLength = zinfo->nextPhaseLength;
             curPhase++;
 
             assert(curPhase == zinfo->numPhases); //check they don't skew
 
-            //Wake up all sleeping threads where deadline is met
+            //Wake up all sleeping threads where deadline is met (at the first phase boundary at or past it)
             if (!sleepQueue.empty()) {
                 ThreadInfo* th = sleepQueue.front();
-                while (th && th->wakeupPhase <= curPhase) {
-                    assert(th->wakeupPhase == curPhase);
-                    trace(Sched, "%d SLEEPING -> BLOCKED, waking up from timeout syscall (curPhase %ld, wakeupPhase %ld)", th->gid, curPhase, th->wakeupPhase);
+                while (th && th->wakeupCycle <= zinfo->globPhaseCycles) {
+                    trace(Sched, "%d SLEEPING -> BLOCKED, waking up from timeout syscall (curPhase %ld, wakeupCycle %ld)", th->gid, curPhase, th->wakeupCycle);
 
                     // Try to deschedule ourselves
                     th->state = BLOCKED;
@@ -460,14 +460,14 @@ class Scheduler : public GlobAlloc, public Callee {
             }
         }
 
-        volatile uint32_t* markForSleep(uint32_t pid, uint32_t tid, uint64_t wakeupPhase) {
+        volatile uint32_t* markForSleep(uint32_t pid, uint32_t tid, uint64_t wakeupCycle) {
             futex_lock(&schedLock);
             uint32_t gid = getGid(pid, tid);
             trace(Sched, "%d marking for sleep", gid);
             ThreadInfo* th = gidMap[gid];
             assert(!th->markedForSleep);
             th->markedForSleep = true;
-            th->wakeupPhase = wakeupPhase;
+            th->wakeupCycle = wakeupCycle;
             th->futexWord = 1; //to avoid races, this must be set here.
             futex_unlock(&schedLock);
             return &(th->futexWord);
@@ -43,7 +43,7 @@ void SimpleCore::initStats(AggregateStat* parentStat) {
 }
 
 uint64_t SimpleCore::getPhaseCycles() const {
-    return curCycle % zinfo->phaseLength;
+    return (curCycle > zinfo->globPhaseCycles)? curCycle - zinfo->globPhaseCycles : 0;
 }
 
 void SimpleCore::OffloadBegin(THREADID tid) {
@@ -128,5 +128,6 @@ void SimpleCore::BblFunc(THREADID tid, ADDRINT bblAddr, BblInfo* bblInfo) {
         //we're not at risk of racing, even if we were switched out and then switched in.
         uint32_t newCid = TakeBarrier(tid, cid);
         if (newCid != cid) break; /*context-switch*/
+        core->phaseEndCycle = zinfo->globPhaseCycles + zinfo->phaseLength; //the phase length may change at the barrier
     }
 }
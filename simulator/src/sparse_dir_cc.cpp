@@ -0,0 +1,297 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sparse_dir_cc.h"
+#include "cache.h"
+#include "network.h"
+
+MESISparseDirCC::MESISparseDirCC(uint32_t _numLines, uint32_t _dirEntries, uint32_t _dirWays, const g_string& _name)
+    : tcc(nullptr), dirTimestamp(0), network(nullptr), numLines(_numLines), dirEntries(_dirEntries), dirWays(_dirWays), selfId(0), name(_name)
+{
+    if (dirWays == 0 || dirEntries % dirWays != 0) panic("[%s] Directory entries (%d) must be a multiple of its ways (%d)", name.c_str(), dirEntries, dirWays);
+    dirSets = dirEntries/dirWays;
+    if (dirSets & (dirSets - 1)) panic("[%s] Directory sets (%d) must be a power of 2", name.c_str(), dirSets);
+    dirSetBits = 0;
+    while ((1u << dirSetBits) < dirSets) dirSetBits++;
+
+    array = gm_calloc<MESIState>(numLines);
+    for (uint32_t i = 0; i < numLines; i++) {
+        array[i] = I;
+    }
+    dirTags = gm_calloc<Address>(dirEntries);
+    dirTimestamps = gm_calloc<uint64_t>(dirEntries);
+    dirFlags = gm_calloc<uint8_t>(dirEntries);
+    futex_init(&ccLock);
+}
+
+void MESISparseDirCC::setParents(uint32_t childId, const g_vector<MemObject*>& _parents, Network* _network) {
+    for (MemObject* p : _parents) {
+        if (dynamic_cast<BaseCache*>(p)) panic("[%s] A sparse directory is only supported on the last-level cache, but parent %s is a cache", name.c_str(), p->getName());
+    }
+    selfId = childId;
+    network = _network;
+    parents.resize(_parents.size());
+    for (uint32_t p = 0; p < parents.size(); p++) {
+        parents[p] = _parents[p];
+    }
+}
+
+void MESISparseDirCC::setChildren(const g_vector<BaseCache*>& children, Network* network) {
+    tcc = new MESITopCC(dirEntries, false /*inclusive*/, false /*no bypass*/);
+    tcc->init(children, network, name.c_str());
+}
+
+void MESISparseDirCC::initStats(AggregateStat* cacheStat) {
+    //Same names as MESIBottomCC where they mean the same, so that tools that compute miss rates keep working
+    profGETSHit.init("hGETS", "GETS hits (in the data array)");
+    profGETXHit.init("hGETX", "GETX hits (in the data array)");
+    profGETSMiss.init("mGETS", "GETS misses (to memory)");
+    profGETXMiss.init("mGETXIM", "GETX I->M misses (to memory)");
+    profGETSFwd.init("fwdGETS", "GETS served from children through the directory");
+    profGETXFwd.init("fwdGETX", "GETX served from children through the directory (including upgrades)");
+    profPUTS.init("PUTS", "Clean evictions (from lower level)");
+    profPUTX.init("PUTX", "Dirty evictions (from lower level)");
+    profVictimFills.init("victimFills", "Evictions from lower level that filled the data array");
+    profDirEvictions.init("dirEvictions", "Directory evictions");
+    profDirBackInvs.init("dirBackInvs", "Invalidations sent to children on directory evictions");
+    profDirWritebacks.init("dirWritebacks", "Dirty lines written back to memory on directory evictions");
+    profGETNextLevelLat.init("latGETnl", "GET request latency on next level");
+    profGETNetLat.init("latGETnet", "GET request latency on network to next level");
+    profNTWr.init("ntWr", "Non-temporal writes forwarded to memory");
+    profNTWrWB.init("ntWrWB", "Dirty lines written back ahead of partial non-temporal writes");
+
+    cacheStat->append(&profGETSHit);
+    cacheStat->append(&profGETXHit);
+    cacheStat->append(&profGETSMiss);
+    cacheStat->append(&profGETXMiss);
+    cacheStat->append(&profGETSFwd);
+    cacheStat->append(&profGETXFwd);
+    cacheStat->append(&profPUTS);
+    cacheStat->append(&profPUTX);
+    cacheStat->append(&profVictimFills);
+    cacheStat->append(&profDirEvictions);
+    cacheStat->append(&profDirBackInvs);
+    cacheStat->append(&profDirWritebacks);
+    cacheStat->append(&profGETNextLevelLat);
+    cacheStat->append(&profGETNetLat);
+    cacheStat->append(&profNTWr);
+    cacheStat->append(&profNTWrWB);
+
+    //Occupancy at dump time. childOnlyLines are the capacity savings over an inclusive cache: lines that only children hold
+    auto dirLinesStat = makeLambdaStat([this]() {
+        uint64_t n = 0;
+        for (uint32_t e = 0; e < dirEntries; e++) n += (dirFlags[e] & VALID)? 1 : 0;
+        return n;
+    });
+    dirLinesStat->init("dirLines", "Valid directory entries");
+    cacheStat->append(dirLinesStat);
+    auto childOnlyStat = makeLambdaStat([this]() {
+        uint64_t n = 0;
+        for (uint32_t e = 0; e < dirEntries; e++) n += ((dirFlags[e] & (VALID | INDATA)) == VALID)? 1 : 0;
+        return n;
+    });
+    childOnlyStat->init("childOnlyLines", "Valid directory entries whose line is not in the data array");
+    cacheStat->append(childOnlyStat);
+}
+
+uint64_t MESISparseDirCC::fetch(const MemReq& req, AccessType type, MESIState* state, uint64_t cycle, uint32_t flags) {
+    uint32_t parentId = ParentBankId(req.lineAddr, parents.size());
+    MemReq memReq = {req.lineAddr, type, selfId, state, cycle, &ccLock, *state, req.srcId, flags, req.pc};
+    uint64_t nextLevelLat = parents[parentId]->access(memReq) - cycle;
+    if (unlikely(flags & MemReq::WARM)) return cycle;
+
+    uint32_t netLat = (network)? network->getRTT(cycle, nextLevelLat, name.c_str(), parents[parentId]->getName()) : 0;
+    profGETNextLevelLat.inc(nextLevelLat);
+    profGETNetLat.inc(netLat);
+    if (type == GETS) profGETSMiss.inc();
+    else profGETXMiss.inc();
+    return cycle + nextLevelLat + netLat;
+}
+
+uint64_t MESISparseDirCC::writeback(const MemReq& triggerReq, Address wbLineAddr, MESIState* state, uint64_t cycle) {
+    assert(*state != I);
+    MemReq req = {wbLineAddr, (*state == M)? PUTX : PUTS, selfId, state, cycle, &ccLock, *state, triggerReq.srcId, triggerReq.flags & MemReq::WARM};
+    uint64_t respCycle = parents[ParentBankId(wbLineAddr, parents.size())]->access(req);
+    assert_msg(*state == I, "Wrong final state %s on writeback", MESIStateName(*state));
+    return respCycle;
+}
+
+uint64_t MESISparseDirCC::processEviction(const MemReq& triggerReq, Address wbLineAddr, int32_t lineId, uint64_t startCycle) {
+    MESIState* state = &array[lineId];
+    if (*state == I) return startCycle; //wbLineAddr is meaningless
+
+    int32_t dirId = dirLookup(wbLineAddr);
+    if (dirId != -1) dirFlags[dirId] &= ~INDATA; //children keep their copies
+    return writeback(triggerReq, wbLineAddr, state, startCycle);
+}
+
+uint64_t MESISparseDirCC::processDirEviction(const MemReq& req, int32_t lineId, uint64_t startCycle) {
+    //Only demand GETs need an entry; PUTs come from sharers, which have one
+    if ((req.type != GETS && req.type != GETX) || req.is(MemReq::PREFETCH)) return 0;
+    if (dirLookup(req.lineAddr) != -1) return 0;
+
+    uint32_t first = dirSetStart(req.lineAddr);
+    uint32_t victim = first;
+    for (uint32_t e = first; e < first + dirWays; e++) {
+        if (!(dirFlags[e] & VALID)) {
+            victim = e;
+            break;
+        }
+        if (dirTimestamps[e] < dirTimestamps[victim]) victim = e;
+    }
+
+    uint64_t respCycle = 0;
+    if (dirFlags[victim] & VALID) {
+        bool warm = req.is(MemReq::WARM);
+        Address wbLineAddr = dirTags[victim];
+        if (!warm) {
+            profDirEvictions.inc();
+            profDirBackInvs.inc(tcc->numSharers(victim));
+        }
+
+        bool lowerLevelWriteback = false;
+        respCycle = tcc->processEviction(wbLineAddr, victim, &lowerLevelWriteback, startCycle, req.srcId); //back-invalidate all sharers
+        if (lowerLevelWriteback || (dirFlags[victim] & DIRTY)) {
+            //Recalled dirty data goes to memory. If the data array has a (now stale) copy, it is left alone; a later
+            //eviction of it only costs a redundant writeback
+            if (!warm) profDirWritebacks.inc();
+            MESIState wbState = M;
+            respCycle = writeback(req, wbLineAddr, &wbState, respCycle);
+        }
+    }
+
+    dirTags[victim] = req.lineAddr;
+    dirFlags[victim] = VALID | ((lineId != -1 && array[lineId] != I)? INDATA : 0);
+    dirTimestamps[victim] = ++dirTimestamp;
+    return respCycle;
+}
+
+uint64_t MESISparseDirCC::processAccess(const MemReq& req, int32_t lineId, uint64_t startCycle, uint64_t* getDoneCycle) {
+    uint64_t respCycle = startCycle;
+    bool warm = req.is(MemReq::WARM);
+    uint32_t flags = req.flags & ~MemReq::PREFETCH; //always clear PREFETCH, this flag cannot propagate up
+
+    if (req.is(MemReq::PREFETCH)) {
+        //Prefetches only fill the data array, and only if no child has the line
+        assert(req.type == GETS);
+        if (lineId != -1 && array[lineId] == I) {
+            respCycle = fetch(req, GETS, &array[lineId], startCycle, flags);
+        }
+        if (getDoneCycle) *getDoneCycle = respCycle;
+        return respCycle;
+    }
+
+    int32_t dirId = dirLookup(req.lineAddr);
+    if (unlikely(req.is(MemReq::NONTEMPORAL))) {
+        //Write memory first, then drop every other copy: the directory entry's sharers and the data array's. A partial
+        //write (MemReq::NTPARTIAL) merges with memory, so sharers are recalled first and dirty data is written back
+        assert(req.type == PUTX);
+        bool partial = req.is(MemReq::NTPARTIAL);
+        uint64_t wrCycle = startCycle;
+        if (partial) {
+            bool dirty = lineId != -1 && array[lineId] == M;
+            if (dirId != -1) {
+                bool lowerLevelWriteback = false;
+                wrCycle = tcc->processNonTemporalWrite(req.lineAddr, dirId, req.childId, startCycle, req.srcId, &lowerLevelWriteback);
+                dirty = dirty || lowerLevelWriteback || (dirFlags[dirId] & DIRTY);
+                dirFlags[dirId] = 0;
+            }
+            if (dirty) {
+                if (!warm) profNTWrWB.inc();
+                MESIState wbState = M;
+                wrCycle = writeback(req, req.lineAddr, &wbState, wrCycle);
+            }
+        }
+        MESIState memState = I;
+        MemReq memReq = {req.lineAddr, PUTX, selfId, &memState, wrCycle, &ccLock, memState, req.srcId, flags};
+        respCycle = parents[ParentBankId(req.lineAddr, parents.size())]->access(memReq);
+        if (!warm) profNTWr.inc();
+        if (!partial && dirId != -1) {
+            bool superseded = false;
+            respCycle = MAX(respCycle, tcc->processNonTemporalWrite(req.lineAddr, dirId, req.childId, startCycle, req.srcId, &superseded));
+            dirFlags[dirId] = 0;
+        }
+        if (lineId != -1) array[lineId] = I;
+        if (getDoneCycle) *getDoneCycle = respCycle;
+        return respCycle;
+    }
+    assert_msg(dirId != -1, "[%s] No directory entry for 0x%lx, type %s, childId %d", name.c_str(), req.lineAddr, AccessTypeName(req.type), req.childId);
+    bool inData = lineId != -1 && array[lineId] != I;
+    bool lowerLevelWriteback = false;
+
+    switch (req.type) {
+        case GETS:
+        case GETX:
+            dirTimestamps[dirId] = ++dirTimestamp;
+            if (inData) {
+                if (!warm) (req.type == GETS)? profGETSHit.inc() : profGETXHit.inc();
+            } else if (tcc->numSharers(dirId)) {
+                //tcc downgrades or invalidates the sharers below, which supplies the data
+                if (!warm) (req.type == GETS)? profGETSFwd.inc() : profGETXFwd.inc();
+            } else {
+                MESIState memState = I;
+                respCycle = fetch(req, req.type, &memState, startCycle, flags);
+            }
+            if (getDoneCycle) *getDoneCycle = respCycle;
+
+            respCycle = tcc->processAccess(req.lineAddr, dirId, req.type, req.childId, true /*exclusive w.r.t. memory*/, req.state,
+                    &lowerLevelWriteback, respCycle, req.srcId, flags);
+            if (lowerLevelWriteback) {
+                if (inData) array[lineId] = M;
+                else dirFlags[dirId] |= DIRTY;
+            }
+            if (req.type == GETX) dirFlags[dirId] &= ~DIRTY; //the requester is now responsible for the data
+            break;
+
+        case PUTS:
+        case PUTX:
+            assert(lineId != -1); //PUTs always allocate
+            respCycle = tcc->processAccess(req.lineAddr, dirId, req.type, req.childId, true, req.state,
+                    &lowerLevelWriteback, respCycle, req.srcId, flags);
+            if (array[lineId] == I) {
+                array[lineId] = E;
+                if (!warm) profVictimFills.inc();
+            }
+            if (req.type == PUTX || (dirFlags[dirId] & DIRTY)) array[lineId] = M;
+            if (!warm) (req.type == PUTS)? profPUTS.inc() : profPUTX.inc();
+
+            dirFlags[dirId] = (dirFlags[dirId] & ~DIRTY) | INDATA;
+            if (tcc->numSharers(dirId) == 0) dirFlags[dirId] = 0; //free the entry, the data array has the line
+            break;
+
+        default: panic("!?");
+    }
+    return respCycle;
+}
+
+bool MESISparseDirCC::serialize(Checkpoint& ckpt) {
+    ckpt.io(array, numLines);
+    ckpt.io(dirTags, dirEntries);
+    ckpt.io(dirTimestamps, dirEntries);
+    ckpt.io(dirFlags, dirEntries);
+    ckpt.io(dirTimestamp);
+    tcc->serialize(ckpt);
+    return true;
+}
@@ -0,0 +1,159 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SPARSE_DIR_CC_H_
+#define SPARSE_DIR_CC_H_
+
+#include "coherence_ctrls.h"
+
+/* Non-inclusive last-level cache backed by a sparse directory. The data array
+ * only holds lines that children evicted (victim fills) or that were
+ * prefetched, so its capacity is not spent replicating the children's lines;
+ * a separate set-associative directory (dirEntries entries, dirWays ways,
+ * LRU) tracks every line that some child holds. Misses that neither array
+ * covers go to memory, and lines held by children are forwarded or upgraded
+ * through the directory. Evicting a directory entry back-invalidates its
+ * sharers, and dirty data it recalls is written back to memory.
+ *
+ * The sharers of each directory entry are kept by a MESITopCC indexed by
+ * entry id, so they are exact. The data array keeps its own state w.r.t.
+ * memory: I, S/E (clean) or M (dirty).
+ *
+ * Only valid for caches whose parents are memories (the LLC banks).
+ */
+class MESISparseDirCC : public CC {
+    private:
+        enum DirFlag {
+            VALID  = (1<<0),
+            DIRTY  = (1<<1), //a sharer wrote back through the directory, and memory is stale (only if not INDATA)
+            INDATA = (1<<2), //line also in the data array
+        };
+
+        MESITopCC* tcc;
+        MESIState* array; //data array
+        Address* dirTags;
+        uint64_t* dirTimestamps; //LRU
+        uint8_t* dirFlags;
+        uint64_t dirTimestamp;
+
+        g_vector<MemObject*> parents;
+        Network* network;
+        uint32_t numLines;
+        uint32_t dirEntries;
+        uint32_t dirWays;
+        uint32_t dirSets;
+        uint32_t dirSetBits;
+        uint32_t selfId;
+        g_string name;
+
+        //Profiling counters
+        Counter profGETSHit, profGETXHit, profGETSMiss, profGETXMiss;
+        Counter profGETSFwd, profGETXFwd; //served by the directory, the line is only in children
+        Counter profPUTS, profPUTX, profVictimFills;
+        Counter profDirEvictions, profDirBackInvs, profDirWritebacks;
+        Counter profGETNextLevelLat, profGETNetLat;
+        Counter profNTWr, profNTWrWB;
+
+        PAD();
+        lock_t ccLock;
+        PAD();
+
+    public:
+        MESISparseDirCC(uint32_t _numLines, uint32_t _dirEntries, uint32_t _dirWays, const g_string& _name);
+
+        //Initialization
+        void setParents(uint32_t childId, const g_vector<MemObject*>& parents, Network* network);
+        void setChildren(const g_vector<BaseCache*>& children, Network* network);
+        void initStats(AggregateStat* cacheStat);
+
+        //Access methods
+        bool startAccess(MemReq& req) {
+            assert((req.type == GETS) || (req.type == GETX) || (req.type == PUTS) || (req.type == PUTX));
+
+            //Same hand-over-hand scheme as MESICC; our lock plays the role of bcc's
+            if (req.childLock) {
+                futex_unlock(req.childLock);
+            }
+
+            tcc->lock(); //must lock tcc FIRST
+            futex_lock(&ccLock);
+
+            return CheckForMESIRace(req.type /*may change*/, req.state, req.initialState);
+        }
+
+        bool shouldAllocate(const MemReq& req) {
+            if (req.is(MemReq::NONTEMPORAL)) return false; //streaming writes go straight to memory
+            if ((req.type == PUTS) || (req.type == PUTX)) return true; //victim fill
+            //Demand GETs only allocate a directory entry; prefetches fill the data array, unless children have the line
+            return req.is(MemReq::PREFETCH) && dirLookup(req.lineAddr) == -1;
+        }
+
+        uint64_t processEviction(const MemReq& triggerReq, Address wbLineAddr, int32_t lineId, uint64_t startCycle);
+        uint64_t processDirEviction(const MemReq& req, int32_t lineId, uint64_t startCycle);
+        uint64_t processAccess(const MemReq& req, int32_t lineId, uint64_t startCycle, uint64_t* getDoneCycle = nullptr);
+
+        void endAccess(const MemReq& req) {
+            //Relock child before we unlock ourselves (hand-over-hand)
+            if (req.childLock) {
+                futex_lock(req.childLock);
+            }
+
+            futex_unlock(&ccLock);
+            tcc->unlock();
+        }
+
+        //Inv methods
+        void startInv() {
+            panic("[%s] MESISparseDirCC cannot be invalidated, it must be the last-level cache", name.c_str());
+        }
+
+        uint64_t processInv(const InvReq& req, int32_t lineId, uint64_t startCycle) {
+            panic("[%s] MESISparseDirCC cannot be invalidated, it must be the last-level cache", name.c_str());
+        }
+
+        //Repl policy interface. Evicting data never affects children, so data lines have no sharers
+        uint32_t numSharers(uint32_t lineId) {return 0;}
+        bool isValid(uint32_t lineId) {return array[lineId] != I;}
+
+        bool serialize(Checkpoint& ckpt);
+
+    private:
+        inline uint32_t dirSetStart(Address lineAddr) {
+            return ((lineAddr ^ (lineAddr >> dirSetBits)) & (dirSets - 1))*dirWays;
+        }
+
+        inline int32_t dirLookup(Address lineAddr) {
+            uint32_t first = dirSetStart(lineAddr);
+            for (uint32_t e = first; e < first + dirWays; e++) {
+                if ((dirFlags[e] & VALID) && dirTags[e] == lineAddr) return e;
+            }
+            return -1;
+        }
+
+        uint64_t fetch(const MemReq& req, AccessType type, MESIState* state, uint64_t cycle, uint32_t flags);
+        uint64_t writeback(const MemReq& triggerReq, Address wbLineAddr, MESIState* state, uint64_t cycle);
+};
+
+#endif  // SPARSE_DIR_CC_H_
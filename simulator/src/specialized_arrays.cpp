@@ -0,0 +1,59 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "specialized_arrays.h"
+#include <typeinfo>
+
+template <typename H, typename R>
+static CacheArray* BuildForWays(uint32_t numLines, uint32_t assoc, R* rp, H* hf) {
+    switch (assoc) {
+        case 8: return new SpecializedSetAssocArray<H, R, 8>(numLines, assoc, rp, hf);
+        case 16: return new SpecializedSetAssocArray<H, R, 16>(numLines, assoc, rp, hf);
+        default: return new SpecializedSetAssocArray<H, R, 0>(numLines, assoc, rp, hf);
+    }
+}
+
+template <typename H>
+static CacheArray* BuildForRepl(uint32_t numLines, uint32_t assoc, ReplPolicy* rp, H* hf) {
+    const std::type_info& t = typeid(*rp);
+    if (t == typeid(LRUReplPolicy<true>)) {
+        return BuildForWays(numLines, assoc, static_cast<LRUReplPolicy<true>*>(rp), hf);
+    } else if (t == typeid(LRUReplPolicy<false>)) {
+        return BuildForWays(numLines, assoc, static_cast<LRUReplPolicy<false>*>(rp), hf);
+    } else if (t == typeid(RRIPReplPolicy)) {
+        return BuildForWays(numLines, assoc, static_cast<RRIPReplPolicy*>(rp), hf);
+    }
+    return nullptr;
+}
+
+CacheArray* BuildSpecializedSetAssocArray(uint32_t numLines, uint32_t assoc, ReplPolicy* rp, HashFamily* hf) {
+    const std::type_info& t = typeid(*hf);
+    if (t == typeid(IdHashFamily)) {
+        return BuildForRepl(numLines, assoc, rp, static_cast<IdHashFamily*>(hf));
+    } else if (t == typeid(H3HashFamily)) {
+        return BuildForRepl(numLines, assoc, rp, static_cast<H3HashFamily*>(hf));
+    }
+    return nullptr;
+}
@@ -0,0 +1,126 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SPECIALIZED_ARRAYS_H_
+#define SPECIALIZED_ARRAYS_H_
+
+#include <emmintrin.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#include "cache_arrays.h"
+#include "hash.h"
+#include "repl_policies.h"
+#include "rrip_repl_policies.h"
+
+/* Returns the way that holds lineAddr in a set of W (a multiple of 4) tags, or
+ * -1. Compares 4 tags at a time with AVX2 if the build enables it (e.g.,
+ * march=native), else 2 at a time with SSE2, which every x86-64 has (SSE2 has
+ * no 64-bit compare, so it ANDs the two 32-bit halves). set must be aligned to
+ * 32 bytes.
+ */
+template <uint32_t W>
+static inline int32_t FindTag(const Address* set, Address lineAddr) {
+    uint32_t mask = 0;
+#ifdef __AVX2__
+    __m256i key = _mm256_set1_epi64x(lineAddr);
+    for (uint32_t w = 0; w < W; w += 4) {
+        __m256i eq = _mm256_cmpeq_epi64(_mm256_load_si256((const __m256i*)&set[w]), key);
+        mask |= _mm256_movemask_pd(_mm256_castsi256_pd(eq)) << w;
+    }
+#else
+    __m128i key = _mm_set1_epi64x(lineAddr);
+    for (uint32_t w = 0; w < W; w += 2) {
+        __m128i eq = _mm_cmpeq_epi32(_mm_load_si128((const __m128i*)&set[w]), key);
+        eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+        mask |= _mm_movemask_pd(_mm_castsi128_pd(eq)) << w;
+    }
+#endif
+    return mask? __builtin_ctz(mask) : -1;
+}
+
+/* SetAssocArray specialized to the concrete types of its hash function (H) and
+ * replacement policy (R), and optionally to its associativity (W; 0 for any).
+ * Calls to them are qualified, so they are not virtual and get inlined, and
+ * with W = 8 or 16, tags are compared with SIMD. Otherwise, it behaves exactly
+ * like SetAssocArray, so results do not change.
+ */
+template <typename H, typename R, uint32_t W>
+class SpecializedSetAssocArray : public SetAssocArray {
+    private:
+        H* const shf;
+        R* const srp;
+
+    public:
+        SpecializedSetAssocArray(uint32_t _numLines, uint32_t _assoc, R* _rp, H* _hf)
+            : SetAssocArray(_numLines, _assoc, _rp, _hf), shf(_hf), srp(_rp)
+        {
+            assert(W == 0 || _assoc == W);
+        }
+
+        int32_t lookup(const Address lineAddr, const MemReq* req, bool updateReplacement) {
+            const uint32_t ways = W? W : assoc;
+            uint32_t first = (shf->H::hash(0, lineAddr) & setMask)*ways;
+            int32_t way;
+            if (W) {
+                way = FindTag<W>(&array[first], lineAddr);
+            } else {
+                way = -1;
+                for (uint32_t w = 0; w < ways; w++) {
+                    if (array[first + w] == lineAddr) {
+                        way = w;
+                        break;
+                    }
+                }
+            }
+            if (way == -1) return -1;
+            uint32_t id = first + way;
+            if (updateReplacement) srp->R::update(id, req);
+            return id;
+        }
+
+        uint32_t preinsert(const Address lineAddr, const MemReq* req, Address* wbLineAddr) {
+            const uint32_t ways = W? W : assoc;
+            uint32_t first = (shf->H::hash(0, lineAddr) & setMask)*ways;
+            uint32_t candidate = srp->R::rank(req, SetAssocCands(first, first + ways));
+            *wbLineAddr = array[candidate];
+            return candidate;
+        }
+
+        void postinsert(const Address lineAddr, const MemReq* req, uint32_t candidate) {
+            srp->R::replaced(candidate);
+            array[candidate] = lineAddr;
+            srp->R::update(candidate, req);
+        }
+};
+
+/* Returns a SpecializedSetAssocArray if there is one for this hash function
+ * and replacement policy (None or H3 hashing, with LRU, LRUNoSh or the RRIP
+ * policies), or nullptr, in which case the caller should use SetAssocArray.
+ * Types must match exactly: e.g., SHiP derives from RRIP, but is not one.
+ */
+CacheArray* BuildSpecializedSetAssocArray(uint32_t numLines, uint32_t assoc, ReplPolicy* rp, HashFamily* hf);
+
+#endif  // SPECIALIZED_ARRAYS_H_
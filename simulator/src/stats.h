@@ -31,12 +31,11 @@
  * - Counter: A plain single counter.
  * - VectorCounter: A fixed-size vector of logically related counters. Each
  *   vector element may be unnamed or named (useful when enum-indexed vectors).
- * - Histogram: A GEMS-style histogram, intended to profile a distribution.
- *   It has a fixed amount of buckets, and buckets are resized as samples
- *   are added, making profiling increasingly coarser but keeping storage
- *   space constant. Unlike GEMS-style stats, though, at some configurable
- *   point part of the array starts growing logarithmically, to capture
- *   outliers without hurting accuracy of most samples.
+ * - LatencyHistogram: A log-linear (HDR-style) histogram, intended to profile
+ *   a distribution such as latencies. It has a fixed amount of buckets, linear
+ *   within each power of two, so it captures outliers without hurting the
+ *   accuracy of most samples, and dumps as its percentiles (and optionally
+ *   its buckets).
  * - ProxyStat takes a function pointer uint64_t(*)(void) at initialization,
  *   and calls it to get its value. It is used for cases where a stat can't
  *   be stored as a counter (e.g. aggregates, RDTSC, performance counters,...)
@@ -75,6 +74,7 @@
 /* TODO: I want these to be POD types, but polymorphism (needed by dynamic_cast) probably disables it. Dang. */
 
 #include <stdint.h>
+#include <algorithm>
 #include <string>
 #include "g_std/g_vector.h"
 #include "log.h"
@@ -302,12 +302,6 @@ class VectorCounter : public VectorStat {
         }
 };
 
-/*
-class Histogram : public Stat {
-    //TBD
-};
-*/
-
 class ProxyStat : public ScalarStat {
     private:
         uint64_t* _statPtr;
@@ -395,6 +389,102 @@ LambdaStat<F>* makeLambdaStat(F f) { return new LambdaStat<F>(f); }
 template<typename F>
 LambdaVectorStat<F>* makeLambdaVectorStat(F f, uint32_t size) { return new LambdaVectorStat<F>(f, size); }
 
+/* Log-linear (HDR-style) histogram, e.g., of latencies, for the tails that
+ * cumulative latencies hide. Values below 2^SUB_BITS have a bucket each, and
+ * each higher power of two is split in 2^SUB_BITS buckets, so a bucket spans
+ * at most 1/2^SUB_BITS of its values. Values of 2^maxBits or more share the
+ * last bucket. Recording is a constant-time bucket increment.
+ *
+ * It is an aggregate of its max and its p50/p95/p99, which are the upper
+ * bounds of the buckets that hold them (so they can be up to 1/2^SUB_BITS
+ * high), plus the bucket counts ("hist") if dumpBuckets is set. Bucket i
+ * holds [lowerBound(i), lowerBound(i+1)).
+ */
+class LatencyHistogram : public AggregateStat {
+    public:
+        static const uint32_t SUB_BITS = 3;
+        static const uint32_t SUB_BUCKETS = 1 << SUB_BITS;
+
+    private:
+        class Percentile : public ScalarStat {
+            private:
+                const LatencyHistogram* _hist;
+                double _fraction;
+
+            public:
+                Percentile() : ScalarStat(), _hist(nullptr), _fraction(0.0) {}
+
+                void init(const char* name, const char* desc, const LatencyHistogram* hist, double fraction) {
+                    initStat(name, desc);
+                    _hist = hist;
+                    _fraction = fraction;
+                }
+
+                uint64_t get() const {return _hist->percentile(_fraction);}
+                std::string getS() const {return std::to_string(get());}
+        };
+
+        VectorCounter _buckets;
+        uint64_t _max;
+        uint32_t _maxBits;
+        ProxyStat _maxStat;
+        Percentile _p50, _p95, _p99;
+
+    public:
+        LatencyHistogram() : AggregateStat(), _max(0), _maxBits(0) {}
+
+        void init(const char* name, const char* desc, bool dumpBuckets, uint32_t maxBits = 24) {
+            assert(maxBits > SUB_BITS && maxBits <= 64);
+            AggregateStat::init(name, desc);
+            _maxBits = maxBits;
+            _max = 0;
+            _buckets.init("hist", "Samples per bucket (log-linear)", (maxBits - SUB_BITS + 1) << SUB_BITS);
+            _maxStat.init("max", "Largest sample", &_max);
+            _p50.init("p50", "Median (bucket upper bound)", this, 0.50);
+            _p95.init("p95", "95th percentile (bucket upper bound)", this, 0.95);
+            _p99.init("p99", "99th percentile (bucket upper bound)", this, 0.99);
+            append(&_maxStat);
+            append(&_p50);
+            append(&_p95);
+            append(&_p99);
+            if (dumpBuckets) append(&_buckets);
+        }
+
+        static inline uint32_t bucket(uint64_t value, uint32_t maxBits) {
+            if (value < SUB_BUCKETS) return value;
+            uint32_t msb = 63 - __builtin_clzll(value);
+            if (msb >= maxBits) return ((maxBits - SUB_BITS + 1) << SUB_BITS) - 1;
+            uint32_t shift = msb - SUB_BITS;
+            return ((shift + 1) << SUB_BITS) + ((value >> shift) & (SUB_BUCKETS - 1));
+        }
+
+        static inline uint64_t lowerBound(uint32_t idx) {
+            if (idx < SUB_BUCKETS) return idx;
+            uint32_t shift = (idx >> SUB_BITS) - 1;
+            return (uint64_t)(SUB_BUCKETS + (idx & (SUB_BUCKETS - 1))) << shift;
+        }
+
+        inline void inc(uint64_t value) {
+            _buckets.inc(bucket(value, _maxBits));
+            if (value > _max) _max = value;
+        }
+
+        //Upper bound of the bucket that holds this fraction of the samples (0 if there are none)
+        uint64_t percentile(double fraction) const {
+            uint64_t samples = 0;
+            for (uint32_t i = 0; i < _buckets.size(); i++) samples += _buckets.count(i);
+            if (!samples) return 0;
+            uint64_t target = (uint64_t)(fraction*samples + 0.5);
+            if (target == 0) target = 1;
+            uint64_t seen = 0;
+            for (uint32_t i = 0; i < _buckets.size(); i++) {
+                seen += _buckets.count(i);
+                if (seen >= target) return std::min(lowerBound(i+1) - 1, _max);
+            }
+            return _max;
+        }
+};
+
 //Stat Backends declarations.
 
 class StatsBackend : public GlobAlloc {
@@ -0,0 +1,345 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stats_reader.h"
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdlib.h>
+#include <string.h>
+#include "log.h"
+
+// Concatenate HDF5 header path prefix with the header file names, because
+// // Ubuntu 15.04 and later change the HDF5 header path.
+ #define _STR(x) #x
+ #define STR(x) _STR(x)
+ #ifdef HDF5INCPREFIX
+ #include STR(HDF5INCPREFIX/hdf5.h)
+ #else
+ #include <hdf5.h>
+ #endif
+ #undef STR
+ #undef _STR
+
+void StatsReader::add(const std::string& name, double value) {
+    auto it = index.find(name);
+    if (it != index.end()) {
+        values[it->second] = value;
+    } else {
+        index[name] = names.size();
+        names.push_back(name);
+        values.push_back(value);
+    }
+}
+
+/* HDF5 */
+
+// Serializes HDF5 calls unless the library was built thread-safe
+static std::mutex h5Lock;
+
+// Flattens a (native) record type into leaf names and byte offsets
+static void FlattenH5Type(hid_t type, const std::string& prefix, size_t offset,
+        std::vector<std::pair<std::string, size_t>>& leaves) {
+    H5T_class_t cls = H5Tget_class(type);
+    if (cls == H5T_COMPOUND) {
+        int members = H5Tget_nmembers(type);
+        for (int i = 0; i < members; i++) {
+            char* name = H5Tget_member_name(type, i);
+            hid_t mtype = H5Tget_member_type(type, i);
+            FlattenH5Type(mtype, prefix.empty()? name : prefix + "." + name, offset + H5Tget_member_offset(type, i), leaves);
+            H5Tclose(mtype);
+            free(name);
+        }
+    } else if (cls == H5T_ARRAY) {
+        int rank = H5Tget_array_ndims(type);
+        std::vector<hsize_t> dims(rank);
+        H5Tget_array_dims2(type, dims.data());
+        hsize_t elems = 1;
+        for (hsize_t d : dims) elems *= d;
+        hid_t super = H5Tget_super(type);
+        size_t elemSize = H5Tget_size(super);
+        for (hsize_t i = 0; i < elems; i++) {
+            std::stringstream ss;
+            ss << prefix << "." << i;
+            FlattenH5Type(super, ss.str(), offset + i*elemSize, leaves);
+        }
+        H5Tclose(super);
+    } else if (cls == H5T_INTEGER && H5Tget_size(type) == sizeof(uint64_t)) {
+        leaves.push_back(std::make_pair(prefix, offset));
+    } else {
+        warn("Skipping stat %s, unexpected HDF5 type", prefix.c_str());
+    }
+}
+
+bool StatsReader::readHDF5(const char* file) {
+    hbool_t threadSafe = false;
+    H5is_library_threadsafe(&threadSafe);
+    std::unique_lock<std::mutex> lock(h5Lock, std::defer_lock);
+    if (!threadSafe) lock.lock();
+
+    hid_t fid = H5Fopen(file, H5F_ACC_RDONLY, H5P_DEFAULT);
+    if (fid < 0) {
+        warn("Could not open HDF5 file %s", file);
+        return false;
+    }
+    hid_t dset = H5Dopen2(fid, "stats", H5P_DEFAULT);
+    if (dset < 0) {
+        warn("%s has no stats table", file);
+        H5Fclose(fid);
+        return false;
+    }
+
+    hid_t fileType = H5Dget_type(dset);
+    hid_t memType = H5Tget_native_type(fileType, H5T_DIR_ASCEND);
+    hid_t fileSpace = H5Dget_space(dset);
+    hsize_t records = 0;
+    H5Sget_simple_extent_dims(fileSpace, &records, nullptr);
+
+    bool ok = records > 0;
+    if (ok) {
+        hsize_t start[] = {records - 1};
+        hsize_t count[] = {1};
+        H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, start, nullptr, count, nullptr);
+        hid_t memSpace = H5Screate_simple(1, count, nullptr);
+        std::vector<char> buf(H5Tget_size(memType));
+        ok = H5Dread(dset, memType, memSpace, fileSpace, H5P_DEFAULT, buf.data()) >= 0;
+        H5Sclose(memSpace);
+
+        if (ok) {
+            std::vector<std::pair<std::string, size_t>> leaves;
+            FlattenH5Type(memType, "", 0, leaves);
+            for (auto& l : leaves) {
+                uint64_t v;
+                memcpy(&v, &buf[l.second], sizeof(v));
+                add(l.first, v);
+            }
+        }
+    }
+    if (!ok) warn("Could not read the stats of %s", file);
+
+    H5Sclose(fileSpace);
+    H5Tclose(memType);
+    H5Tclose(fileType);
+    H5Dclose(dset);
+    H5Fclose(fid);
+    return ok;
+}
+
+/* Text dumps */
+
+bool StatsReader::readText(const char* file) {
+    std::ifstream in(file);
+    if (!in.good()) {
+        warn("Could not open %s", file);
+        return false;
+    }
+
+    //Keep the lines of the last complete dump, delimited by ===
+    std::vector<std::string> lines, dump;
+    std::string line;
+    bool inDump = false;
+    while (std::getline(in, line)) {
+        if (line == "===") {
+            if (inDump) dump.swap(lines);
+            lines.clear();
+            inDump = !inDump;
+        } else if (inDump) {
+            lines.push_back(line);
+        }
+    }
+    if (dump.empty()) {
+        warn("%s has no complete stats dump", file);
+        return false;
+    }
+
+    std::vector<std::pair<size_t, std::string>> stack; //indent, group name
+    for (const std::string& l : dump) {
+        size_t indent = l.find_first_not_of(' ');
+        if (indent == std::string::npos) continue;
+        size_t colon = l.find(':', indent);
+        if (colon == std::string::npos) continue;
+        std::string name = l.substr(indent, colon - indent);
+        std::string rest = l.substr(colon + 1);
+        rest = rest.substr(0, rest.find('#'));
+        rest.erase(0, rest.find_first_not_of(' '));
+        rest.erase(rest.find_last_not_of(' ') + 1);
+
+        while (!stack.empty() && stack.back().first >= indent) stack.pop_back();
+        std::string path;
+        for (auto& s : stack) path += s.second + ".";
+        path += name;
+        if (rest.empty()) {
+            stack.push_back(std::make_pair(indent, name));
+        } else {
+            add(path, strtod(rest.c_str(), nullptr));
+        }
+    }
+    return true;
+}
+
+/* Ramulator's "<name> <value> # <desc>" lines; vector elements ([i]) follow their vector */
+
+bool StatsReader::readRamulator(const char* file, const std::string& prefix) {
+    std::ifstream in(file);
+    if (!in.good()) {
+        warn("Could not open %s", file);
+        return false;
+    }
+    std::string line, vector;
+    while (std::getline(in, line)) {
+        std::stringstream ss(line.substr(0, line.find('#')));
+        std::string name, value, extra;
+        if (!(ss >> name >> value) || (ss >> extra)) continue;
+        if (name[0] == '[') {
+            if (!vector.empty()) add(prefix + vector + name, strtod(value.c_str(), nullptr));
+        } else {
+            vector = name;
+            add(prefix + name, strtod(value.c_str(), nullptr));
+        }
+    }
+    return true;
+}
+
+/* Queries */
+
+double StatsReader::get(const std::string& name, double dflt) const {
+    auto it = index.find(name);
+    return (it == index.end())? dflt : values[it->second];
+}
+
+static bool MatchPattern(const std::string& pattern, const std::string& name) {
+    size_t p = 0, n = 0;
+    while (p < pattern.size() && n < name.size()) {
+        if (pattern[p] == '*') {
+            p++;
+            while (n < name.size() && name[n] != '.') n++;
+        } else if (pattern[p] == name[n]) {
+            p++;
+            n++;
+        } else {
+            return false;
+        }
+    }
+    return p == pattern.size() && n == name.size();
+}
+
+std::vector<size_t> StatsReader::match(const std::string& pattern) const {
+    std::vector<size_t> res;
+    if (pattern.find('*') == std::string::npos) {
+        auto it = index.find(pattern);
+        if (it != index.end()) res.push_back(it->second);
+        return res;
+    }
+    for (size_t i = 0; i < names.size(); i++) {
+        if (MatchPattern(pattern, names[i])) res.push_back(i);
+    }
+    return res;
+}
+
+double StatsReader::sum(const std::string& pattern) const {
+    double res = 0.0;
+    for (size_t i : match(pattern)) res += values[i];
+    return res;
+}
+
+double StatsReader::max(const std::string& pattern) const {
+    double res = 0.0;
+    for (size_t i : match(pattern)) res = (values[i] > res)? values[i] : res;
+    return res;
+}
+
+std::vector<std::string> StatsReader::children(const std::string& group) const {
+    std::vector<std::string> res;
+    std::set<std::string> seen;
+    std::string prefix = group + ".";
+    for (const std::string& n : names) {
+        if (n.compare(0, prefix.size(), prefix) != 0) continue;
+        std::string child = n.substr(prefix.size(), n.find('.', prefix.size()) - prefix.size());
+        if (seen.insert(child).second) res.push_back(child);
+    }
+    return res;
+}
+
+/* DAMOV metrics */
+
+static double Ratio(double num, double den) {
+    return den? num/den : 0.0;
+}
+
+DamovMetrics ComputeDamovMetrics(const StatsReader& stats, std::string l1, std::string llc) {
+    DamovMetrics m;
+
+    //Cache groups are the children of root with coherence stats
+    std::vector<std::string> caches;
+    for (const std::string& g : stats.children("root")) {
+        if (!stats.match("root." + g + ".*.hGETS").empty()) caches.push_back(g);
+    }
+    if (l1.empty()) l1 = "l1d";
+    if (llc.empty()) {
+        llc = l1;
+        for (const std::string& g : caches) {
+            if (g.size() == 2 && g[0] == 'l' && g[1] >= '2' && g[1] <= '9' && (llc == l1 || g > llc)) llc = g;
+        }
+    }
+
+    //Cores: groups of root with instrs; cycles of the slowest one, like get_stats_per_app.py
+    m.instrs = stats.sum("root.*.*.instrs");
+    m.cycles = stats.max("root.*.*.cycles");
+    double ops = stats.sum("root.*.*.uops");
+    if (!ops) ops = m.instrs; //cores without uop counts
+
+    std::string l1p = "root." + l1 + ".*.";
+    std::string llcp = "root." + llc + ".*.";
+    double l1Hits = stats.sum(l1p + "hGETS") + stats.sum(l1p + "hGETX");
+    m.l1Misses = stats.sum(l1p + "mGETS") + stats.sum(l1p + "mGETXIM");
+    m.l1Accesses = l1Hits + m.l1Misses + stats.sum(l1p + "mGETXSM");
+    double llcHits = stats.sum(llcp + "hGETS") + stats.sum(llcp + "hGETX");
+    m.llcMisses = stats.sum(llcp + "mGETS") + stats.sum(llcp + "mGETXIM");
+
+    m.ipc = Ratio(m.instrs, m.cycles);
+    m.l1MissRate = Ratio(m.l1Misses, l1Hits + m.l1Misses);
+    m.llcMissRate = Ratio(m.llcMisses, llcHits + m.llcMisses);
+    m.mpki = Ratio(m.llcMisses*1000.0, m.instrs);
+    m.lfmr = Ratio(m.llcMisses, m.l1Misses);
+    m.ai = Ratio(ops - m.l1Accesses, m.l1Accesses);
+    if (m.ai < 0) m.ai = 0;
+
+    //Locality is kept times 10000 per core, and stays 0 on cores that did not measure it
+    const char* locStats[] = {"temporalLocality", "spatialLocality"};
+    double* locMetrics[] = {&m.temporalLocality, &m.spatialLocality};
+    for (uint32_t s = 0; s < 2; s++) {
+        double total = 0.0;
+        uint32_t n = 0;
+        for (size_t i : stats.match(std::string("root.*.*.") + locStats[s])) {
+            if (stats.value(i)) {
+                total += stats.value(i);
+                n++;
+            }
+        }
+        *locMetrics[s] = Ratio(total, n*10000.0);
+    }
+    return m;
+}
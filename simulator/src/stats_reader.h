@@ -0,0 +1,96 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STATS_READER_H_
+#define STATS_READER_H_
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* Reads the final stats of a finished simulation, for post-processing tools
+ * (see zsimstats.cpp). Every counter becomes one value, named by its path in
+ * the stats tree, e.g. root.l1d.3.hGETS or ramulator.read_latency_avg.
+ *
+ * Sources are the HDF5 table HDF5Backend writes (<stats>.zsim.h5, with
+ * sim.hdf5Stats = true), the text dump (<stats>.zsim.out) for runs without
+ * it, and Ramulator's <stats>[.<mem>].ramulator.stats. HDF5 files name the
+ * elements of regular aggregates by index and text dumps by name (l1d-3), so
+ * code that must work on both should use patterns, where * matches a single
+ * path component (root.l1d.*.hGETS).
+ */
+class StatsReader {
+    private:
+        std::vector<std::string> names;
+        std::vector<double> values;
+        std::unordered_map<std::string, size_t> index;
+
+        void add(const std::string& name, double value);
+
+    public:
+        //Each returns false (with a warning) if the file cannot be read; later reads add to earlier ones
+        bool readHDF5(const char* file); //last record of the stats table
+        bool readText(const char* file); //last dump in the file
+        bool readRamulator(const char* file, const std::string& prefix); //prefix is prepended to each name
+
+        size_t size() const {return names.size();}
+        const std::string& name(size_t i) const {return names[i];}
+        double value(size_t i) const {return values[i];}
+
+        //Returns the value of an exact name, or dflt if there is none
+        double get(const std::string& name, double dflt = 0.0) const;
+
+        //Indices of the stats that match a pattern, in file order
+        std::vector<size_t> match(const std::string& pattern) const;
+
+        double sum(const std::string& pattern) const;
+        double max(const std::string& pattern) const;
+
+        //Names of the children of a group (root -> l1d, l2, mem, ...)
+        std::vector<std::string> children(const std::string& group) const;
+};
+
+/* The metrics DAMOV classifies functions by (see the DAMOV paper, IEEE Access 2021) */
+struct DamovMetrics {
+    double instrs;
+    double cycles; //of the slowest core
+    double ipc;
+    double l1Accesses;
+    double l1Misses;
+    double llcMisses;
+    double l1MissRate;
+    double llcMissRate;
+    double mpki; //LLC misses per kilo-instruction
+    double lfmr; //last-to-first miss ratio, LLC misses / L1 misses
+    double ai; //arithmetic intensity, non-memory operations per L1 access
+    double temporalLocality; //mean over the cores that measured it, 0-1
+    double spatialLocality;
+};
+
+//l1 and llc name the cache groups (empty: l1d, and the highest lN group, or l1d if there is none)
+DamovMetrics ComputeDamovMetrics(const StatsReader& stats, std::string l1 = "", std::string llc = "");
+
+#endif  // STATS_READER_H_
@@ -34,7 +34,10 @@ class HitEvent : public TimingEvent {
         TimingCache* cache;
 
     public:
-        HitEvent(TimingCache* _cache,  uint32_t postDelay, int32_t domain) : TimingEvent(0, postDelay, domain), cache(_cache) {}
+        Address lineAddr;
+        uint64_t coalescedCycle; //if nonzero, the hit waited for an outstanding miss since then
+        HitEvent(TimingCache* _cache, Address _lineAddr, uint32_t postDelay, int32_t domain)
+            : TimingEvent(0, postDelay, domain), cache(_cache), lineAddr(_lineAddr), coalescedCycle(0) {}
 
         void simulate(uint64_t startCycle) {
             cache->simulateHit(this, startCycle);
@@ -47,7 +50,11 @@ class MissStartEvent : public TimingEvent {
         TimingCache* cache;
     public:
         uint64_t startCycle; //for profiling purposes
-        MissStartEvent(TimingCache* _cache,  uint32_t postDelay, int32_t domain) : TimingEvent(0, postDelay, domain), cache(_cache) {}
+        Address lineAddr;
+        bool dirtyEviction; //the miss writes back a dirty line, and needs a writeback buffer
+        uint32_t mshr; //with coalescing
+        MissStartEvent(TimingCache* _cache, Address _lineAddr, bool _dirtyEviction, uint32_t postDelay, int32_t domain)
+            : TimingEvent(0, postDelay, domain), cache(_cache), lineAddr(_lineAddr), dirtyEviction(_dirtyEviction), mshr(0) {}
         void simulate(uint64_t startCycle) {cache->simulateMissStart(this, startCycle);}
 };
 
@@ -56,7 +63,8 @@ class MissResponseEvent : public TimingEvent {
         TimingCache* cache;
         MissStartEvent* mse;
     public:
-        MissResponseEvent(TimingCache* _cache, MissStartEvent* _mse, int32_t domain) : TimingEvent(0, 0, domain), cache(_cache), mse(_mse) {}
+        uint64_t stallCycle; //if nonzero, the response has been waiting for a fill buffer since then
+        MissResponseEvent(TimingCache* _cache, MissStartEvent* _mse, int32_t domain) : TimingEvent(0, 0, domain), cache(_cache), mse(_mse), stallCycle(0) {}
         void simulate(uint64_t startCycle) {cache->simulateMissResponse(this, startCycle, mse);}
 };
 
@@ -78,15 +86,34 @@ class ReplAccessEvent : public TimingEvent {
         void simulate(uint64_t startCycle) {cache->simulateReplAccess(this, startCycle);}
 };
 
+class WritebackDoneEvent : public TimingEvent {
+    private:
+        TimingCache* cache;
+    public:
+        WritebackDoneEvent(TimingCache* _cache, int32_t domain) : TimingEvent(0, 0, domain), cache(_cache) {}
+        void simulate(uint64_t startCycle) {cache->simulateWritebackDone(this, startCycle);}
+};
+
 TimingCache::TimingCache(uint32_t _numLines, CC* _cc, CacheArray* _array, ReplPolicy* _rp,
-                         uint32_t _accLat, uint32_t _invLat, uint32_t mshrs, uint32_t _tagLat, uint32_t _ways, uint32_t _cands, uint32_t _domain, bool _bypass, const g_string& _name)
-                     : Cache(_numLines, _cc, _array, _rp, _accLat, _invLat, _bypass, _name), numMSHRs(mshrs), tagLat(_tagLat), ways(_ways), cands(_cands), bypass(_bypass)
+                         uint32_t _accLat, uint32_t _invLat, uint32_t mshrs, uint32_t _tagLat, uint32_t _ways, uint32_t _cands, uint32_t _domain, bool _bypass, const g_string& _name,
+                         const TimingCacheBandwidth& _bw)
+                     : Cache(_numLines, _cc, _array, _rp, _accLat, _invLat, _bypass, _name), numMSHRs(mshrs), bw(_bw), bypass(_bypass), tagLat(_tagLat), ways(_ways), cands(_cands)
 {
     lastFreeCycle = 0;
     lastAccCycle = 0;
+    lastAccCount = 0;
     assert(numMSHRs > 0);
     activeMisses = 0;
+    activeFills = 0;
+    activeWbs = 0;
     domain = _domain;
+    if (!bw.tagPorts) panic("%s: needs at least one tag port", name.c_str());
+    if (bw.dataPorts && !bw.dataCycles) panic("%s: data accesses must take at least one cycle", name.c_str());
+    dataPortFreeCycles.resize(bw.dataPorts, 0);
+    if (bw.coalesce) {
+        mshrTable.resize(numMSHRs);
+        for (MSHR& m : mshrTable) m.lineAddr = 0;
+    }
     info("%s: mshrs %d domain %d", name.c_str(), numMSHRs, domain);
 }
 
@@ -98,6 +125,26 @@ void TimingCache::initStats(AggregateStat* parentStat) {
     //Stats specific to timing cache
     profOccHist.init("occHist", "Occupancy MSHR cycle histogram", numMSHRs+1);
     cacheStat->append(&profOccHist);
+    if (bw.fillBuffers) {
+        profFillOccHist.init("fillOccHist", "Occupancy fill buffer cycle histogram", bw.fillBuffers+1);
+        cacheStat->append(&profFillOccHist);
+        profFillStallLat.init("latFillStall", "Cumulative cycles miss responses waited for a fill buffer");
+        cacheStat->append(&profFillStallLat);
+    }
+    if (bw.wbBuffers) {
+        profWbOccHist.init("wbOccHist", "Occupancy writeback buffer cycle histogram", bw.wbBuffers+1);
+        cacheStat->append(&profWbOccHist);
+    }
+    if (bw.dataPorts) {
+        profDataPortLat.init("latDataPort", "Cumulative cycles hits waited for a data port");
+        cacheStat->append(&profDataPortLat);
+    }
+    if (bw.coalesce) {
+        profCoalesced.init("coalesced", "Hits that waited for an outstanding miss to the same line");
+        cacheStat->append(&profCoalesced);
+        profCoalescedLat.init("latCoalesced", "Cumulative cycles coalesced hits waited for their miss");
+        cacheStat->append(&profCoalescedLat);
+    }
 
     profHitLat.init("latHit", "Cumulative latency accesses that hit (demand and non-demand)");
     profMissRespLat.init("latMissResp", "Cumulative latency for miss start to response");
@@ -107,11 +154,16 @@ void TimingCache::initStats(AggregateStat* parentStat) {
     cacheStat->append(&profMissRespLat);
     cacheStat->append(&profMissLat);
 
+    profMissRespLatHist.init("latMissRespHist", "Latency for miss start to response", zinfo->latencyHistograms);
+    cacheStat->append(&profMissRespLatHist);
+
     parentStat->append(cacheStat);
 }
 
 // TODO(dsm): This is copied verbatim from Cache. We should split Cache into different methods, then call those.
 uint64_t TimingCache::access(MemReq& req) {
+    if (unlikely(req.is(MemReq::WARM))) return Cache::access(req); //functional warming, no timing to model
+
     EventRecorder* evRec = zinfo->eventRecorders[req.srcId];
     assert_msg(evRec, "TimingCache is not connected to TimingCore");
 
@@ -119,6 +171,7 @@ uint64_t TimingCache::access(MemReq& req) {
     writebackRecord.clear();
     accessRecord.clear();
     uint64_t evDoneCycle = 0;
+    bool arrayEviction = false; //if so, the replacement is modeled too
 
     uint64_t respCycle = req.cycle;
     bool skipAccess = cc->startAccess(req); //may need to skip access due to races (NOTE: may change req.type!)
@@ -127,9 +180,7 @@ uint64_t TimingCache::access(MemReq& req) {
         int32_t lineId = array->lookup(req.lineAddr, &req, updateReplacement);
         respCycle += accLat;
 
-        if (lineId == -1 /*&& cc->shouldAllocate(req)*/) {
-            assert(cc->shouldAllocate(req)); //dsm: for now, we don't deal with non-inclusion in TimingCache
-
+        if (lineId == -1 && cc->shouldAllocate(req)) { //only non-inclusive CCs (e.g., MESISparseDirCC) do not allocate
             //Make space for new line
             Address wbLineAddr;
             lineId = array->preinsert(req.lineAddr, &req, &wbLineAddr); //find the lineId to replace
@@ -142,6 +193,19 @@ uint64_t TimingCache::access(MemReq& req) {
             array->postinsert(req.lineAddr, &req, lineId); //do the actual insertion. NOTE: Now we must split insert into a 2-phase thing because cc unlocks us.
 
             if (evRec->hasRecord()) writebackRecord = evRec->popRecord();
+            arrayEviction = true;
+        }
+
+        uint64_t dirEvDoneCycle = cc->processDirEviction(req, lineId, respCycle); //e.g., sparse directory replacement
+        if (dirEvDoneCycle) {
+            assert(!arrayEviction);
+            evDoneCycle = dirEvDoneCycle;
+            if (evRec->hasRecord()) writebackRecord = evRec->popRecord();
+        }
+
+        if (unlikely(array->isOverflowing())) { //compressed arrays evict more lines to fit a new or grown one
+            uint64_t ovDoneCycle = evictOverflow(req, respCycle, evRec, writebackRecord);
+            evDoneCycle = MAX(evDoneCycle, ovDoneCycle);
         }
 
         uint64_t getDoneCycle = respCycle;
@@ -154,19 +218,32 @@ uint64_t TimingCache::access(MemReq& req) {
 
         if (getDoneCycle - req.cycle == accLat) {
             // Hit
-            assert(!writebackRecord.isValid());
             assert(!accessRecord.isValid());
             uint64_t hitLat = respCycle - req.cycle; // accLat + invLat
-            HitEvent* ev = new (evRec) HitEvent(this, hitLat, domain);
+            HitEvent* ev = new (evRec) HitEvent(this, req.lineAddr, hitLat, domain);
             ev->setMinStartCycle(req.cycle);
             tr.startEvent = tr.endEvent = ev;
+
+            // Non-inclusive CCs can write back on a hit (e.g., a directory eviction, or a victim fill). As in Cache::access,
+            // the writeback starts in parallel with the hit, and its end is not connected
+            if (writebackRecord.isValid()) {
+                assert(writebackRecord.reqCycle >= req.cycle);
+                DelayEvent* startEv = new (evRec) DelayEvent(0);
+                DelayEvent* dWbEv = new (evRec) DelayEvent(writebackRecord.reqCycle - req.cycle);
+                startEv->setMinStartCycle(req.cycle);
+                dWbEv->setMinStartCycle(req.cycle);
+                startEv->addChild(dWbEv, evRec)->addChild(writebackRecord.startEvent, evRec);
+                startEv->addChild(ev, evRec);
+                tr.startEvent = startEv;
+            }
         } else {
             assert_msg(getDoneCycle == respCycle, "gdc %ld rc %ld", getDoneCycle, respCycle);
 
             // Miss events:
             // MissStart (does high-prio lookup) -> getEvent || evictionEvent || replEvent (if needed) -> MissWriteback
 
-            MissStartEvent* mse = new (evRec) MissStartEvent(this, accLat, domain);
+            bool dirtyEviction = writebackRecord.isValid() && writebackRecord.type == PUTX;
+            MissStartEvent* mse = new (evRec) MissStartEvent(this, req.lineAddr, dirtyEviction, accLat, domain);
             MissResponseEvent* mre = new (evRec) MissResponseEvent(this, mse, domain);
             MissWritebackEvent* mwe = new (evRec) MissWritebackEvent(this, mse, accLat, domain);
 
@@ -216,11 +293,18 @@ uint64_t TimingCache::access(MemReq& req) {
 
             // Eviction path
             if (evDoneCycle) {
-                connect(writebackRecord.isValid()? &writebackRecord : nullptr, mse, mwe, req.cycle + accLat, evDoneCycle);
+                if (dirtyEviction && bw.wbBuffers) { //the writeback buffer is freed when the parent accepts the writeback
+                    WritebackDoneEvent* wde = new (evRec) WritebackDoneEvent(this, domain);
+                    wde->setMinStartCycle(evDoneCycle);
+                    connect(&writebackRecord, mse, wde, req.cycle + accLat, evDoneCycle);
+                    wde->addChild(mwe, evRec);
+                } else {
+                    connect(writebackRecord.isValid()? &writebackRecord : nullptr, mse, mwe, req.cycle + accLat, evDoneCycle);
+                }
             }
 
             // Replacement path
-            if (evDoneCycle && cands > ways) {
+            if (arrayEviction && cands > ways) {
                 uint32_t replLookups = (cands + (ways-1))/ways - 1; // e.g., with 4 ways, 5-8 -> 1, 9-12 -> 2, etc.
                 assert(replLookups);
 
@@ -269,8 +353,18 @@ uint64_t TimingCache::access(MemReq& req) {
 
 uint64_t TimingCache::highPrioAccess(uint64_t cycle) {
     assert(cycle >= lastFreeCycle);
-    uint64_t lookupCycle = MAX(cycle, lastAccCycle+1);
-    if (lastAccCycle < cycle-1) lastFreeCycle = cycle-1; //record last free run
+    uint64_t lookupCycle;
+    if (cycle > lastAccCycle) {
+        if (lastAccCycle < cycle-1) lastFreeCycle = cycle-1; //record last free run
+        lookupCycle = cycle;
+        lastAccCount = 1;
+    } else if (lastAccCount < bw.tagPorts) { //a port is still free on the last booked cycle
+        lookupCycle = lastAccCycle;
+        lastAccCount++;
+    } else {
+        lookupCycle = lastAccCycle + 1;
+        lastAccCount = 1;
+    }
     lastAccCycle = lookupCycle;
     return lookupCycle;
 }
@@ -286,20 +380,76 @@ uint64_t TimingCache::highPrioAccess(uint64_t cycle) {
  * cycle in advance.
  */
 uint64_t TimingCache::tryLowPrioAccess(uint64_t cycle) {
-    if (lastAccCycle < cycle-1 || lastFreeCycle == cycle-1) {
+    bool portFree = lastAccCycle < cycle-1 || (lastAccCycle == cycle-1 && lastAccCount < bw.tagPorts);
+    if (portFree || lastFreeCycle == cycle-1) {
         lastFreeCycle = 0;
-        lastAccCycle = MAX(cycle-1, lastAccCycle);
+        if (lastAccCycle < cycle-1) {
+            lastAccCycle = cycle-1;
+            lastAccCount = 1;
+        } else if (portFree) {
+            lastAccCount++;
+        }
         return cycle;
     } else {
         return 0;
     }
 }
 
+/* Data array ports are pipelined: each access occupies a port for dataCycles,
+ * and starts on the first port that frees up. Only hits wait for their data
+ * access; fills and dirty victim reads book their slots without delaying the
+ * miss, as the fill and writeback buffers decouple them from the array.
+ */
+uint64_t TimingCache::dataAccess(uint64_t cycle) {
+    uint32_t port = 0;
+    for (uint32_t p = 1; p < bw.dataPorts; p++) {
+        if (dataPortFreeCycles[p] < dataPortFreeCycles[port]) port = p;
+    }
+    uint64_t startCycle = MAX(cycle, dataPortFreeCycles[port]);
+    dataPortFreeCycles[port] = startCycle + bw.dataCycles;
+    return startCycle;
+}
+
+void TimingCache::wakePending(uint64_t cycle) {
+    if (!pendingQueue.empty()) {
+        //info("XXX %ld elems in pending queue", pendingQueue.size());
+        for (TimingEvent* qev : pendingQueue) {
+            qev->requeue(cycle+1);
+        }
+        pendingQueue.clear();
+    }
+}
+
 void TimingCache::simulateHit(HitEvent* ev, uint64_t cycle) {
+    if (ev->coalescedCycle) { //woken up by the response of the miss it was waiting for
+        profCoalescedLat.inc(cycle - ev->coalescedCycle);
+        ev->done(cycle);
+        return;
+    }
+
     if (activeMisses < numMSHRs) {
         uint64_t lookupCycle = highPrioAccess(cycle);
         profHitLat.inc(lookupCycle-cycle);
-        ev->done(lookupCycle);  // postDelay includes accLat + invalLat
+
+        // The bound phase fills lines right away, so a hit may find its line still being fetched
+        if (bw.coalesce && activeMisses) {
+            for (MSHR& m : mshrTable) {
+                if (m.lineAddr == ev->lineAddr && !m.responded) {
+                    profCoalesced.inc();
+                    ev->coalescedCycle = lookupCycle;
+                    ev->hold();
+                    m.waiters.push_back(ev);
+                    return;
+                }
+            }
+        }
+
+        uint64_t doneCycle = lookupCycle;
+        if (bw.dataPorts) {
+            doneCycle = dataAccess(lookupCycle);
+            profDataPortLat.inc(doneCycle - lookupCycle);
+        }
+        ev->done(doneCycle);  // postDelay includes accLat + invalLat
     } else {
         // queue
         ev->hold();
@@ -308,12 +458,25 @@ void TimingCache::simulateHit(HitEvent* ev, uint64_t cycle) {
 }
 
 void TimingCache::simulateMissStart(MissStartEvent* ev, uint64_t cycle) {
-    if (activeMisses < numMSHRs) {
+    bool needsWb = ev->dirtyEviction && bw.wbBuffers;
+    if (activeMisses < numMSHRs && (!needsWb || activeWbs < bw.wbBuffers)) {
         activeMisses++;
         profOccHist.transition(activeMisses, cycle);
+        if (needsWb) {
+            activeWbs++;
+            profWbOccHist.transition(activeWbs, cycle);
+        }
+        if (bw.coalesce) {
+            uint32_t m = 0;
+            while (mshrTable[m].lineAddr) m++; //there is a free one, activeMisses <= numMSHRs
+            mshrTable[m].lineAddr = ev->lineAddr;
+            mshrTable[m].responded = false;
+            ev->mshr = m;
+        }
 
         ev->startCycle = cycle;
         uint64_t lookupCycle = highPrioAccess(cycle);
+        if (ev->dirtyEviction && bw.dataPorts) dataAccess(lookupCycle); //victim read
         ev->done(lookupCycle);
     } else {
         //info("Miss, all MSHRs used, queuing");
@@ -323,7 +486,27 @@ void TimingCache::simulateMissStart(MissStartEvent* ev, uint64_t cycle) {
 }
 
 void TimingCache::simulateMissResponse(MissResponseEvent* ev, uint64_t cycle, MissStartEvent* mse) {
+    if (bw.fillBuffers) {
+        if (activeFills == bw.fillBuffers) {
+            if (!ev->stallCycle) ev->stallCycle = cycle;
+            ev->hold();
+            pendingQueue.push_back(ev);
+            return;
+        }
+        if (ev->stallCycle) profFillStallLat.inc(cycle - ev->stallCycle);
+        activeFills++;
+        profFillOccHist.transition(activeFills, cycle);
+    }
+
+    if (bw.coalesce) {
+        MSHR& m = mshrTable[mse->mshr];
+        m.responded = true;
+        for (TimingEvent* wev : m.waiters) wev->requeue(cycle);
+        m.waiters.clear();
+    }
+
     profMissRespLat.inc(cycle - mse->startCycle);
+    profMissRespLatHist.inc(cycle - mse->startCycle);
     ev->done(cycle);
 }
 
@@ -334,19 +517,28 @@ void TimingCache::simulateMissWriteback(MissWritebackEvent* ev, uint64_t cycle,
         profMissLat.inc(cycle - mse->startCycle);
         activeMisses--;
         profOccHist.transition(activeMisses, lookupCycle);
-        if (!pendingQueue.empty()) {
-            //info("XXX %ld elems in pending queue", pendingQueue.size());
-            for (TimingEvent* qev : pendingQueue) {
-                qev->requeue(cycle+1);
-            }
-            pendingQueue.clear();
+        if (bw.coalesce) mshrTable[mse->mshr].lineAddr = 0;
+        if (bw.dataPorts) dataAccess(lookupCycle); //fill write
+        if (bw.fillBuffers) {
+            assert(activeFills);
+            activeFills--;
+            profFillOccHist.transition(activeFills, lookupCycle);
         }
+        wakePending(cycle);
         ev->done(cycle);
     } else {
         ev->requeue(cycle+1);
     }
 }
 
+void TimingCache::simulateWritebackDone(WritebackDoneEvent* ev, uint64_t cycle) {
+    assert(activeWbs);
+    activeWbs--;
+    profWbOccHist.transition(activeWbs, cycle);
+    wakePending(cycle);
+    ev->done(cycle);
+}
+
 void TimingCache::simulateReplAccess(ReplAccessEvent* ev, uint64_t cycle) {
     assert(ev->accsLeft);
     uint64_t lookupCycle = tryLowPrioAccess(cycle);
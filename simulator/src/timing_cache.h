@@ -35,17 +35,46 @@ class MissResponseEvent;
 class MissWritebackEvent;
 class ReplAccessEvent;
 class TimingEvent;
+class WritebackDoneEvent;
+
+/* Bandwidth and buffering limits of a TimingCache bank, all enforced in the
+ * weave phase. The defaults model the original single-ported cache, with no
+ * data array, fill buffer or writeback buffer limits, and no coalescing.
+ */
+struct TimingCacheBandwidth {
+    uint32_t tagPorts; //tag lookups per cycle
+    uint32_t dataPorts; //data array ports, 0 to not model the data array
+    uint32_t dataCycles; //cycles a data access occupies its port (the bank's initiation interval)
+    uint32_t fillBuffers; //fills waiting to be written into the array, 0 is unlimited
+    uint32_t wbBuffers; //dirty evictions in flight to the parent, 0 is unlimited
+    bool coalesce; //hits to lines with an outstanding miss wait for its response
+};
 
 class TimingCache : public Cache {
     private:
         uint64_t lastAccCycle, lastFreeCycle;
+        uint32_t lastAccCount; //tag lookups booked on lastAccCycle
         uint32_t numMSHRs, activeMisses;
-        g_vector<TimingEvent*> pendingQueue;
+        g_vector<TimingEvent*> pendingQueue; //events waiting for an MSHR, fill buffer or writeback buffer
+
+        // Outstanding misses, for coalescing
+        struct MSHR {
+            Address lineAddr; //0 if free
+            bool responded;
+            g_vector<TimingEvent*> waiters; //coalesced hits
+        };
+        g_vector<MSHR> mshrTable;
+
+        TimingCacheBandwidth bw;
+        uint32_t activeFills, activeWbs;
+        g_vector<uint64_t> dataPortFreeCycles;
 
         bool bypass;
         // Stats
-        CycleBreakdownStat profOccHist;
+        CycleBreakdownStat profOccHist, profFillOccHist, profWbOccHist;
         Counter profHitLat, profMissRespLat, profMissLat;
+        Counter profCoalesced, profCoalescedLat, profDataPortLat, profFillStallLat;
+        LatencyHistogram profMissRespLatHist;
 
         uint32_t domain;
 
@@ -58,7 +87,8 @@ class TimingCache : public Cache {
 
     public:
         TimingCache(uint32_t _numLines, CC* _cc, CacheArray* _array, ReplPolicy* _rp, uint32_t _accLat, uint32_t _invLat, uint32_t mshrs,
-                uint32_t tagLat, uint32_t ways, uint32_t cands, uint32_t _domain, bool bypass, const g_string& _name);
+                uint32_t tagLat, uint32_t ways, uint32_t cands, uint32_t _domain, bool bypass, const g_string& _name,
+                const TimingCacheBandwidth& _bw = {1, 0, 1, 0, 0, false});
         void initStats(AggregateStat* parentStat);
 
         uint64_t access(MemReq& req);
@@ -68,10 +98,13 @@ class TimingCache : public Cache {
         void simulateMissResponse(MissResponseEvent* ev, uint64_t cycle, MissStartEvent* mse);
         void simulateMissWriteback(MissWritebackEvent* ev, uint64_t cycle, MissStartEvent* mse);
         void simulateReplAccess(ReplAccessEvent* ev, uint64_t cycle);
+        void simulateWritebackDone(WritebackDoneEvent* ev, uint64_t cycle);
 
     private:
         uint64_t highPrioAccess(uint64_t cycle);
         uint64_t tryLowPrioAccess(uint64_t cycle);
+        uint64_t dataAccess(uint64_t cycle); //returns the cycle the data access starts
+        void wakePending(uint64_t cycle);
 };
 
 #endif  // TIMING_CACHE_H_
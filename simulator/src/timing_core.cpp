@@ -34,7 +34,7 @@ TimingCore::TimingCore(FilterCache* _l1i, FilterCache* _l1d, uint32_t _domain, g
     : Core(_name), l1i(_l1i), l1d(_l1d), instrs(0), curCycle(0), cRec(_domain, _name) {}
 
 uint64_t TimingCore::getPhaseCycles() const {
-    return curCycle % zinfo->phaseLength;
+    return (curCycle > zinfo->globPhaseCycles)? curCycle - zinfo->globPhaseCycles : 0;
 }
 
 void TimingCore::initStats(AggregateStat* parentStat) {
@@ -152,6 +152,7 @@ void TimingCore::BblAndRecordFunc(THREADID tid, ADDRINT bblAddr, BblInfo* bblInf
         uint32_t cid = getCid(tid);
         uint32_t newCid = TakeBarrier(tid, cid);
         if (newCid != cid) break; /*context-switch*/
+        core->phaseEndCycle = zinfo->globPhaseCycles + zinfo->phaseLength; //the phase length may change at the barrier
     }
 }
 
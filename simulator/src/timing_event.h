@@ -65,10 +65,8 @@ enum EventState {EV_INVALID, EV_NONE, EV_QUEUED, EV_RUNNING, EV_HELD, EV_DONE};
 class CrossingEvent;
 
 class TimingEvent {
-    private:
-        uint64_t privCycle; //only touched by ContentionSim
-
     public:
+        uint64_t pqCycle; //used by WheelPrioQueue --- PRIVATE
         TimingEvent* next; //used by PrioQueue --- PRIVATE
 
     private:
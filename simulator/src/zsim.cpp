@@ -37,6 +37,7 @@
 #include <sched.h>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 #include <sys/prctl.h>
 #include <sys/resource.h>
 #include <sys/time.h>
@@ -49,13 +50,17 @@
 #include "cpuid.h"
 #include "debug_zsim.h"
 #include "event_queue.h"
+#include "checkpoint.h"
+#include "filter_cache.h"
 #include "galloc.h"
 #include "init.h"
 #include "log.h"
 #include "pin.H"
+#include "phase_controller.h"
 #include "pin_cmd.h"
 #include "process_tree.h"
 #include "profile_stats.h"
+#include "sampling.h"
 #include "scheduler.h"
 #include "stats.h"
 #include "trace_driver.h"
@@ -259,6 +264,32 @@ VOID NOPPredLoadStoreSingle(THREADID tid, ADDRINT addr, BOOL pred, UINT32 size)
 VOID NOPPredOffloadBegin(THREADID tid) {}
 VOID NOPPredOffloadEnd(THREADID tid) {} 
 
+// Functional warming (sim.ffWarming): while fast-forwarding, loads and stores
+// go through the L1d of core tid % numCores as MemReq::WARM accesses, which
+// update tags, replacement, coherence and prefetcher state and the open DRAM
+// rows, but create no timing events. A small per-thread table of recently
+// warmed lines filters out most repeated accesses. It is not invalidated, so a
+// line that was evicted meanwhile may skip warming until it conflicts out.
+#define FF_WARM_LINES 32
+static Address ffWarmLines[MAX_THREADS][FF_WARM_LINES]; //(lineAddr << 2) | written << 1 | valid
+
+static inline void FFWarmAccess(THREADID tid, ADDRINT addr, bool isLoad) {
+    Address lineAddr = addr >> lineBits;
+    Address& entry = ffWarmLines[tid][lineAddr % FF_WARM_LINES];
+    Address tag = (lineAddr << 2) | (isLoad? 0x1 : 0x3);
+    if (entry == tag || (isLoad && entry == (tag | 0x2))) return;  // a store also warmed the line for loads
+
+    FilterCache* l1d = zinfo->ffWarmCaches[tid % zinfo->numCores];
+    if (!l1d) return;  // Null core
+    l1d->warm(addr, isLoad, zinfo->globPhaseCycles);
+    entry = tag;
+}
+
+VOID FFWarmLoadSingle(THREADID tid, ADDRINT addr, UINT32 size) {FFWarmAccess(tid, addr, true);}
+VOID FFWarmStoreSingle(THREADID tid, ADDRINT addr, UINT32 size) {FFWarmAccess(tid, addr, false);}
+VOID FFWarmPredLoadSingle(THREADID tid, ADDRINT addr, BOOL pred, UINT32 size) {if (pred) FFWarmAccess(tid, addr, true);}
+VOID FFWarmPredStoreSingle(THREADID tid, ADDRINT addr, BOOL pred, UINT32 size) {if (pred) FFWarmAccess(tid, addr, false);}
+
 // FF is basically NOP except for basic blocks
 VOID FFBasicBlock(THREADID tid, ADDRINT bblAddr, BblInfo* bblInfo) {
     if (unlikely(!procTreeNode->isInFastForward())) {
@@ -275,6 +306,10 @@ VOID FFBasicBlock(THREADID tid, ADDRINT bblAddr, BblInfo* bblInfo) {
  * entry, we install a special handler that advances to the next FFI point and
  * installs the normal FFI handlers (pretty much like joins work).
  *
+ * The FFI points come from the process config, or from the sampling controller
+ * if this process is sampled (see sampling.h). In the latter case, FFI starts
+ * at ROI begin rather than at process start.
+ *
  * REQUIREMENTS: Single-threaded during FF (non-FF can be MT)
  */
 
@@ -292,7 +327,17 @@ static bool ffiNFF;
 static uint64_t* ffiFFStartInstrs; //hack, needs to be a pointer, written to outside this process
 static uint64_t* ffiPrevFFStartInstrs;
 
-static const InstrFuncPtrs& GetFFPtrs();
+static SamplingController* ffiSampler; //non-null if this process is sampled
+static bool samplingActive;
+
+static InstrFuncPtrs GetFFPtrs();
+
+//Length of the idx-th FFI interval, 0 if there are no more
+static uint64_t FFIGetPoint(uint32_t idx) {
+    if (ffiSampler) return ffiSampler->getInterval(idx);
+    const g_vector<uint64_t>& ffiPoints = procTreeNode->getFFIPoints();
+    return (idx < ffiPoints.size())? ffiPoints[idx] : 0;
+}
 
 VOID FFITrackNFFInterval() {
     assert(!procTreeNode->isInFastForward());
@@ -314,42 +359,132 @@ VOID FFITrackNFFInterval() {
         futex_unlock(&zinfo->ffLock);
         *_ffiPrevFFStartInstrs = *_ffiFFStartInstrs;
         *_ffiFFStartInstrs = zinfo->processStats->getProcessInstrs(p);
+        if (zinfo->sampler && zinfo->sampler->getProcIdx() == p) zinfo->sampler->windowEnd();
     };
     zinfo->eventQueue->insert(makeAdaptiveEvent(ffiGet, ffiFire, 0, ffiInstrsLimit - ffiInstrsDone, MAX_IPC*zinfo->phaseLength));
 
     ffiNFF = true;
 }
 
+static VOID FFIStart() {
+    if (zinfo->ffReinstrument) panic("FFI and reinstrumenting on FF switches are incompatible");
+    ffiEnabled = true;
+    ffiPoint = 0;
+    ffiInstrsDone = 0;
+    ffiInstrsLimit = FFIGetPoint(0);
+    assert(ffiInstrsLimit);
+
+    ffiFFStartInstrs = gm_calloc<uint64_t>(1);
+    ffiPrevFFStartInstrs = gm_calloc<uint64_t>(1);
+    ffiNFF = false;
+    if (!procTreeNode->isInFastForward()) FFITrackNFFInterval();
+}
+
+// BBV profiling: while sampling in bbv mode, count the instructions of each
+// basic block in fast-forward and write one vector per interval, in the
+// format SimPoint reads (T:<bbl id>:<count> :<bbl id>:<count> ...).
+static bool bbvEnabled;
+static FILE* bbvFile;
+static std::unordered_map<ADDRINT, uint32_t> bbvIds;
+static std::unordered_map<uint32_t, uint64_t> bbvCounts;
+static uint64_t bbvInstrs;
+
+static VOID BBVDump() {
+    if (bbvCounts.empty()) return;
+    fprintf(bbvFile, "T");
+    for (auto& kv : bbvCounts) fprintf(bbvFile, ":%d:%ld ", kv.first, kv.second);
+    fprintf(bbvFile, "\n");
+    bbvCounts.clear();
+}
+
+VOID BBVBasicBlock(THREADID tid, ADDRINT bblAddr, BblInfo* bblInfo) {
+    if (unlikely(!procTreeNode->isInFastForward())) {
+        SimThreadStart(tid);
+        return;
+    }
+    uint32_t id;
+    auto it = bbvIds.find(bblAddr);
+    if (it == bbvIds.end()) {
+        id = bbvIds.size() + 1; //SimPoint ids start at 1
+        bbvIds[bblAddr] = id;
+    } else {
+        id = it->second;
+    }
+    bbvCounts[id] += bblInfo->instrs;
+    bbvInstrs += bblInfo->instrs;
+    if (unlikely(bbvInstrs >= ffiSampler->getIntervalInstrs())) {
+        BBVDump();
+        bbvInstrs -= ffiSampler->getIntervalInstrs();
+    }
+}
+
+static VOID BBVStart() {
+    if (zinfo->ffReinstrument) panic("BBV profiling and reinstrumenting on FF switches are incompatible");
+    std::string path = std::string(zinfo->outputDir) + "/zsim.bbv";
+    bbvFile = fopen(path.c_str(), "w");
+    if (!bbvFile) panic("Could not open %s", path.c_str());
+    bbvInstrs = 0;
+    bbvEnabled = true;
+    info("BBV profiling started, %ld-instruction intervals, writing %s", ffiSampler->getIntervalInstrs(), path.c_str());
+}
+
+static VOID BBVEnd() {
+    BBVDump();
+    fclose(bbvFile);
+    bbvEnabled = false;
+    info("BBV profiling done, %ld distinct basic blocks", bbvIds.size());
+}
+
+//Starts sampling or BBV profiling; the process must be fast-forwarding
+static VOID SamplingStart(THREADID tid) {
+    assert(procTreeNode->isInFastForward());
+    samplingActive = true;
+    if (ffiSampler->getMode() == SamplingController::BBV) {
+        BBVStart();
+    } else {
+        ffiSampler->start();
+        FFIStart();
+        info("Sampling started");
+    }
+    fPtrs[tid] = GetFFPtrs();
+}
+
 // Called on process start
 VOID FFIInit() {
-    const g_vector<uint64_t>& ffiPoints = procTreeNode->getFFIPoints();
-    if (!ffiPoints.empty()) {
-        if (zinfo->ffReinstrument) panic("FFI and reinstrumenting on FF switches are incompatible");
-        ffiEnabled = true;
-        ffiPoint = 0;
-        ffiInstrsDone = 0;
-        ffiInstrsLimit = ffiPoints[0];
-
-        ffiFFStartInstrs = gm_calloc<uint64_t>(1);
-        ffiPrevFFStartInstrs = gm_calloc<uint64_t>(1);
-        ffiNFF = false;
-        info("FFI mode initialized, %ld ffiPoints", ffiPoints.size());
-        if (!procTreeNode->isInFastForward()) FFITrackNFFInterval();
-    } else {
-        ffiEnabled = false;
+    ffiEnabled = false;
+    bbvEnabled = false;
+    samplingActive = false;
+    ffiSampler = (zinfo->sampler && zinfo->sampler->getProcIdx() == (uint32_t)procIdx)? zinfo->sampler : nullptr;
+
+    if (ffiSampler) {
+        //With hooks, sampling covers the ROI; otherwise, the whole run
+        if (zinfo->ignoreHooks) {
+            if (!procTreeNode->isInFastForward()) panic("Sampled processes must start fast-forwarded when hooks are ignored");
+            samplingActive = true;
+            if (ffiSampler->getMode() == SamplingController::BBV) {
+                BBVStart();
+            } else {
+                ffiSampler->start();
+                FFIStart();
+            }
+        }
+        info("Sampling mode initialized");
+    } else if (!procTreeNode->getFFIPoints().empty()) {
+        FFIStart();
+        info("FFI mode initialized, %ld ffiPoints", procTreeNode->getFFIPoints().size());
     }
 }
 
 //Set the next ffiPoint, or finish
 VOID FFIAdvance() {
-    const g_vector<uint64_t>& ffiPoints = procTreeNode->getFFIPoints();
     ffiPoint++;
-    if (ffiPoint >= ffiPoints.size()) {
+    uint64_t next = FFIGetPoint(ffiPoint);
+    if (!next) {
         info("Last ffiPoint reached, %ld instrs, limit %ld", ffiInstrsDone, ffiInstrsLimit);
         SimEnd();
     } else {
         info("ffiPoint reached, %ld instrs, limit %ld", ffiInstrsDone, ffiInstrsLimit);
-        ffiInstrsLimit += ffiPoints[ffiPoint];
+        ffiInstrsLimit += next;
     }
 }
 
@@ -361,6 +496,7 @@ VOID FFIBasicBlock(THREADID tid, ADDRINT bblAddr, BblInfo* bblInfo) {
         futex_lock(&zinfo->ffLock);
         info("FFI: Exiting fast-forward");
         ExitFastForward();
+        if (ffiSampler) ffiSampler->windowStart();
         futex_unlock(&zinfo->ffLock);
         FFITrackNFFInterval();
 
@@ -386,9 +522,17 @@ static const InstrFuncPtrs ffPtrs = {NOPLoadStoreSingle, NOPLoadStoreSingle, FFB
 
 static const InstrFuncPtrs ffiPtrs = {NOPLoadStoreSingle, NOPLoadStoreSingle, FFIBasicBlock, NOPRecordBranch, NOPPredLoadStoreSingle, NOPPredLoadStoreSingle, NOPPredOffloadBegin, NOPPredOffloadEnd, FPTR_NOP};
 static const InstrFuncPtrs ffiEntryPtrs = {NOPLoadStoreSingle, NOPLoadStoreSingle, FFIEntryBasicBlock, NOPRecordBranch, NOPPredLoadStoreSingle, NOPPredLoadStoreSingle, NOPPredOffloadBegin, NOPPredOffloadEnd, FPTR_NOP};
+static const InstrFuncPtrs bbvPtrs = {NOPLoadStoreSingle, NOPLoadStoreSingle, BBVBasicBlock, NOPRecordBranch, NOPPredLoadStoreSingle, NOPPredLoadStoreSingle, NOPPredOffloadBegin, NOPPredOffloadEnd, FPTR_NOP};
 
-static const InstrFuncPtrs& GetFFPtrs() {
-    return ffiEnabled? (ffiNFF? ffiEntryPtrs : ffiPtrs) : ffPtrs;
+static InstrFuncPtrs GetFFPtrs() {
+    InstrFuncPtrs ptrs = bbvEnabled? bbvPtrs : ffiEnabled? (ffiNFF? ffiEntryPtrs : ffiPtrs) : ffPtrs;
+    if (zinfo->ffWarmCaches) {
+        ptrs.loadPtr = FFWarmLoadSingle;
+        ptrs.storePtr = FFWarmStoreSingle;
+        ptrs.predLoadPtr = FFWarmPredLoadSingle;
+        ptrs.predStorePtr = FFWarmPredStoreSingle;
+    }
+    return ptrs;
 }
 
 //Fast-forwarding
@@ -524,14 +668,18 @@ VOID EndOfPhaseActions() {
         info("Synced fast-forwarding done, resuming simulation");
     }
 
+    if (zinfo->sampler) zinfo->sampler->phaseDone(zinfo->num_dram_requests);
+
     //cout << "Phase: " << zinfo->numPhases << " - Memory Requests: " << zinfo->num_dram_requests << endl;
     dram_requests << zinfo->numPhases << "," << zinfo->num_dram_requests << "," << offloaded_region << endl;
 
+    if (zinfo->phaseController) zinfo->phaseController->phaseDone(zinfo->num_dram_requests);
     zinfo->num_dram_requests = 0;
 
     CheckForTermination();
     zinfo->contentionSim->simulatePhase(zinfo->globPhaseCycles + zinfo->phaseLength);
     zinfo->eventQueue->tick();
+    if (zinfo->phaseController) zinfo->phaseController->phaseResume();
     zinfo->profSimTime->transition(PROF_BOUND);
 }
 
@@ -925,11 +1073,11 @@ VOID ThreadFini(THREADID tid, const CONTEXT *ctxt, INT32 flags, VOID *v) {
     //NOTE: Thread has no valid cid here!
     if (fPtrs[tid].type == FPTR_NOP) {
         //info("Shadow/NOP thread %d finished", tid);
-        return;
     } else {
         SimThreadFini(tid);
         //info("Thread %d finished", tid);
     }
+    gm_thread_fini(tid);
 }
 
 //Need to remove ourselves from running threads in case the syscall is blocking
@@ -1095,6 +1243,7 @@ VOID AfterForkInParent(THREADID tid, const CONTEXT* ctxt, VOID * arg) {
 }
 
 VOID AfterForkInChild(THREADID tid, const CONTEXT* ctxt, VOID * arg) {
+    gm_forget_thread_caches(); //before any allocation, the parent's threads still use them
     assert(forkedChildNode);
     procTreeNode = forkedChildNode;
     procIdx = procTreeNode->getProcIdx();
@@ -1165,6 +1314,11 @@ VOID SimEnd() {
         for (uint32_t i = 0; i < zinfo->numCores; i++) {
             zinfo->cores[i]->finish();
         }
+        if (zinfo->sampler) zinfo->sampler->report();
+        //Before the dump, which includes the averages Ramulator computes on finish
+        if (zinfo->ramulator_memory) {
+            for (Ramulator* ramulator : *zinfo->ramulators) ramulator->finish();
+        }
         info("Dumping termination stats");
         zinfo->trigger = 20000;
         for (StatsBackend* backend : *(zinfo->statsBackends)) backend->dump(false /*unbuffered, write out*/);
@@ -1175,8 +1329,6 @@ VOID SimEnd() {
     //Uncomment when debugging termination races, which can be rare because they are triggered by threads of a dying process
     //sleep(5);
 
-
-    if(zinfo->ramulator_memory) zinfo->ramulator->finish();
     dram_requests.close();
     exit(0);
 }
@@ -1200,7 +1352,16 @@ VOID HandleMagicOp(THREADID tid, ADDRINT op) {
             if (!zinfo->ignoreHooks) {
                 //TODO: Test whether this is thread-safe
                 futex_lock(&zinfo->ffLock);
-                if (procTreeNode->isInFastForward()) {
+                if (zinfo->checkpoints && procTreeNode->isInFastForward() && zinfo->checkpoints->roiBegin()) {
+                    futex_unlock(&zinfo->ffLock);
+                    info("ROI_BEGIN, checkpoint saved, terminating");
+                    SimEnd();
+                }
+                if (ffiSampler && !samplingActive && procTreeNode->isInFastForward()) {
+                    //Sampling drives fast-forward from here on
+                    offloaded_region = 1;
+                    SamplingStart(tid);
+                } else if (procTreeNode->isInFastForward()) {
                     //info("ROI_BEGIN, exiting fast-forward");
  		    offloaded_region = 1; 
                     ExitFastForward();
@@ -1214,7 +1375,14 @@ VOID HandleMagicOp(THREADID tid, ADDRINT op) {
             if (!zinfo->ignoreHooks) {
                 //TODO: Test whether this is thread-safe
                 futex_lock(&zinfo->ffLock);
-                if (procTreeNode->getSyncedFastForward()) {
+                if (samplingActive) {
+                    //Nothing left to sample
+                    info("ROI_END, sampling done");
+                    if (bbvEnabled) BBVEnd();
+                    else if (!procTreeNode->isInFastForward()) ffiSampler->windowEnd();
+                    futex_unlock(&zinfo->ffLock);
+                    SimEnd();
+                } else if (procTreeNode->getSyncedFastForward()) {
                   //  warn("Ignoring ROI_END magic op on synced FF to avoid deadlock");
                 } else if (!procTreeNode->isInFastForward()) {
                     //info("ROI_END, entering fast-forward");
@@ -1524,6 +1692,7 @@ int main(int argc, char *argv[]) {
     //info("setpriority, new prio %d", getpriority(PRIO_PROCESS, getpid()));
 
     gm_attach(KnobShmid.Value());
+    gm_set_thread_id_func([]() -> uint32_t {return PIN_ThreadId();}); //Pin threads are numbered per process, below MAX_THREADS
 
     bool masterProcess = false;
     if (procIdx == 0 && !gm_isready()) {  // process 0 can exec() without fork()ing first, so we must check gm_isready() to ensure we don't initialize twice
@@ -1632,6 +1801,7 @@ int main(int argc, char *argv[]) {
             EndOfPhaseActions();
             zinfo->numPhases++;
             zinfo->globPhaseCycles += zinfo->phaseLength;
+            zinfo->phaseLength = zinfo->nextPhaseLength;
         }
         info("Finished trace-driven simulation");
         SimEnd();
@@ -45,12 +45,17 @@ class ProcessStats;
 class ProcStats;
 class EventQueue;
 class ContentionSim;
+class PhaseController;
+class SamplingController;
 class EventRecorder;
+class FilterCache;
+class CheckpointManager;
 class PinCmd;
 class PortVirtualizer;
 class VectorCounter;
 class AccessTraceWriter;
 class TraceDriver;
+class DataShadow;
 template <typename T> class g_vector;
 
 struct ClockDomainInfo {
@@ -92,12 +97,15 @@ struct GlobSimInfo {
     //Contention simulation
     uint32_t numDomains;
     ContentionSim* contentionSim;
+    PhaseController* phaseController; //nullptr if phase lengths are fixed
+    SamplingController* sampler; //nullptr unless sampling
     EventRecorder** eventRecorders; //CID->EventRecorder* array
 
     PAD();
 
     //World-readable
-    uint32_t phaseLength;
+    uint32_t phaseLength; //of the current phase
+    uint32_t nextPhaseLength; //takes effect when the current phase ends
     uint32_t statsPhaseInterval;
     uint32_t freqMHz;
 
@@ -120,7 +128,7 @@ struct GlobSimInfo {
 
     //Writable, rarely read, unshared in a single phase
     uint64_t numPhases;
-    uint64_t globPhaseCycles; //just numPhases*phaseCycles. It behooves us to precompute it, since it is very frequently used in tracing code.
+    uint64_t globPhaseCycles; //sum of the lengths of all past phases (numPhases*phaseLength if lengths are fixed). It behooves us to precompute it, since it is very frequently used in tracing code.
 
     uint64_t procEventualDumps;
 
@@ -166,6 +174,9 @@ struct GlobSimInfo {
     //If true, do not output vectors in stats -- they're bulky and we barely need them
     bool skipStatsVectors;
 
+    //If true, latency histograms (see LatencyHistogram) dump their buckets, not only their percentiles
+    bool latencyHistograms;
+
     //If true, all the regular aggregate stats are summed before dumped, e.g. getting one thread record with instrs&cycles for all the threads
     bool compactPeriodicStats;
 
@@ -175,6 +186,8 @@ struct GlobSimInfo {
     struct LibInfo libzsimAddrs;
 
     bool ffReinstrument; //true if we should reinstrument on ffwd, works fine with ST apps and it's faster since we run with basically no instrumentation, but it's not precise with MT apps
+    FilterCache** ffWarmCaches; //CID->L1d warmed by fast-forwarded threads; nullptr unless sim.ffWarming
+    CheckpointManager* checkpoints; //nullptr unless sim.checkpoint.save or .restore
 
     //fftoggle stuff
     lock_t ffToggleLocks[256]; //f*ing Pin and its f*ing inability to handle external signals...
@@ -190,7 +203,10 @@ struct GlobSimInfo {
     TraceDriver* traceDriver;
 
     bool ramulator_memory = false;
-    Ramulator  *ramulator;
+    g_vector<Ramulator*>* ramulators;
+
+    // Line values for cache and memory-link compression (see data_shadow.h), nullptr if nothing compresses
+    DataShadow* dataShadow;
     std::string application;
     std::string to_record_stats;
 
@@ -0,0 +1,204 @@
+/** $lic$
+ * Copyright (C) 2012-2015 by Massachusetts Institute of Technology
+ * Copyright (C) 2010-2013 by The Board of Trustees of Stanford University
+ *
+ * This file is part of zsim.
+ *
+ * zsim is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, version 2.
+ *
+ * If you use this software in your research, we request that you reference
+ * the zsim paper ("ZSim: Fast and Accurate Microarchitectural Simulation of
+ * Thousand-Core Systems", Sanchez and Kozyrakis, ISCA-40, June 2013) as the
+ * source of the simulator in any publications that use this software, and that
+ * you send us a citation of your work.
+ *
+ * zsim is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Aggregates the stats of many simulations into one CSV table, with a row per
+ * simulation: the DAMOV metrics (see stats_reader.h), and the sum of any
+ * stats given with -s. Simulations are found by their <stats>.zsim.h5 (or
+ * <stats>.zsim.out) files, in the given files and folders, and read in
+ * parallel. Their <stats>[.<mem>].ramulator.stats are included, with the
+ * memory controller name as prefix when there are several.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "log.h"
+#include "stats_reader.h"
+
+static bool EndsWith(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static bool IsDir(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+static void ListDir(const std::string& dir, bool recursive, std::vector<std::string>& files) {
+    DIR* d = opendir(dir.c_str());
+    if (!d) {
+        warn("Could not open folder %s", dir.c_str());
+        return;
+    }
+    while (struct dirent* e = readdir(d)) {
+        if (e->d_name[0] == '.') continue;
+        std::string path = dir + "/" + e->d_name;
+        if (IsDir(path)) {
+            if (recursive) ListDir(path, true, files);
+        } else {
+            files.push_back(path);
+        }
+    }
+    closedir(d);
+}
+
+struct Sim {
+    std::string prefix; //path without .zsim.h5 / .zsim.out
+    bool hdf5;
+    std::vector<double> row;
+    bool ok;
+};
+
+// Prefixes of all the simulations under the given paths; HDF5 stats take precedence over text ones
+static std::vector<Sim> FindSims(const std::vector<std::string>& paths) {
+    std::vector<std::string> files;
+    for (const std::string& p : paths) {
+        if (IsDir(p)) ListDir(p, true, files);
+        else files.push_back(p);
+    }
+    std::sort(files.begin(), files.end());
+
+    std::vector<Sim> sims;
+    for (const std::string& f : files) {
+        Sim s;
+        s.ok = false;
+        if (EndsWith(f, ".zsim.h5")) {
+            s.prefix = f.substr(0, f.size() - strlen(".zsim.h5"));
+            s.hdf5 = true;
+        } else if (EndsWith(f, ".zsim.out")) {
+            s.prefix = f.substr(0, f.size() - strlen(".zsim.out"));
+            s.hdf5 = false;
+            if (std::binary_search(files.begin(), files.end(), s.prefix + ".zsim.h5")) continue;
+        } else {
+            continue;
+        }
+        sims.push_back(s);
+    }
+    return sims;
+}
+
+static const char* metricNames[] = {"instrs", "cycles", "ipc", "l1Accesses", "l1Misses", "llcMisses", "l1MissRate",
+    "llcMissRate", "mpki", "lfmr", "ai", "temporalLocality", "spatialLocality"};
+
+static void ReadSim(Sim& s, const std::vector<std::string>& patterns, const std::string& l1, const std::string& llc) {
+    StatsReader stats;
+    s.ok = s.hdf5? stats.readHDF5((s.prefix + ".zsim.h5").c_str()) : stats.readText((s.prefix + ".zsim.out").c_str());
+    if (!s.ok) return;
+
+    // <prefix>.ramulator.stats, or <prefix>.<mem>.ramulator.stats with several controllers
+    size_t slash = s.prefix.rfind('/');
+    std::string dir = (slash == std::string::npos)? "." : s.prefix.substr(0, slash);
+    std::vector<std::string> files;
+    ListDir(dir, false, files);
+    std::sort(files.begin(), files.end());
+    const std::string suffix = ".ramulator.stats";
+    std::string base = (slash == std::string::npos)? "./" + s.prefix : s.prefix;
+    for (const std::string& f : files) {
+        if (!EndsWith(f, suffix) || f.compare(0, base.size(), base) != 0) continue;
+        std::string mem = f.substr(base.size(), f.size() - base.size() - suffix.size());
+        if (mem.empty()) {
+            stats.readRamulator(f.c_str(), "");
+        } else if (mem[0] == '.' && mem.find('/') == std::string::npos) {
+            stats.readRamulator(f.c_str(), mem.substr(1) + ".");
+        }
+    }
+
+    DamovMetrics m = ComputeDamovMetrics(stats, l1, llc);
+    double metrics[] = {m.instrs, m.cycles, m.ipc, m.l1Accesses, m.l1Misses, m.llcMisses, m.l1MissRate,
+        m.llcMissRate, m.mpki, m.lfmr, m.ai, m.temporalLocality, m.spatialLocality};
+    static_assert(sizeof(metrics)/sizeof(double) == sizeof(metricNames)/sizeof(const char*), "metric names out of sync");
+    s.row.assign(metrics, metrics + sizeof(metrics)/sizeof(double));
+    for (const std::string& p : patterns) s.row.push_back(stats.sum(p));
+}
+
+static void Usage(const char* prog) {
+    info("Aggregates the stats of simulations into a CSV table, with DAMOV metrics and the given stats");
+    info("Usage: %s [-j threads] [-o out.csv] [-s pattern]... [--l1 group] [--llc group] <stats files or folders>...", prog);
+    info("  -s pattern   adds a column with the sum of the stats that match, * matches one level");
+    info("               (e.g., -s 'root.l2.*.PUTX' -s ramulator.read_latency_avg)");
+    info("  --l1, --llc  cache groups for the metrics (default: l1d, and the highest lN group)");
+    exit(1);
+}
+
+int main(int argc, const char* argv[]) {
+    InitLog(""); //no log header
+    uint32_t threads = std::max(1u, std::thread::hardware_concurrency());
+    const char* outFile = nullptr;
+    std::vector<std::string> patterns, paths;
+    std::string l1, llc;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-j" && hasValue) threads = std::max(1, atoi(argv[++i]));
+        else if (arg == "-o" && hasValue) outFile = argv[++i];
+        else if (arg == "-s" && hasValue) patterns.push_back(argv[++i]);
+        else if (arg == "--l1" && hasValue) l1 = argv[++i];
+        else if (arg == "--llc" && hasValue) llc = argv[++i];
+        else if (arg[0] == '-') Usage(argv[0]);
+        else paths.push_back(arg);
+    }
+    if (paths.empty()) Usage(argv[0]);
+
+    std::vector<Sim> sims = FindSims(paths);
+    if (sims.empty()) panic("No simulation stats (*.zsim.h5 or *.zsim.out) found");
+
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    for (uint32_t t = 0; t < std::min((size_t)threads, sims.size()); t++) {
+        workers.push_back(std::thread([&]() {
+            for (size_t i = next++; i < sims.size(); i = next++) ReadSim(sims[i], patterns, l1, llc);
+        }));
+    }
+    for (std::thread& w : workers) w.join();
+
+    FILE* out = outFile? fopen(outFile, "w") : stdout;
+    if (!out) panic("Could not open %s", outFile);
+    fprintf(out, "sim");
+    for (const char* n : metricNames) fprintf(out, ",%s", n);
+    for (const std::string& p : patterns) fprintf(out, ",\"%s\"", p.c_str());
+    fprintf(out, "\n");
+    uint32_t failed = 0;
+    for (const Sim& s : sims) {
+        if (!s.ok) {
+            failed++;
+            continue;
+        }
+        fprintf(out, "\"%s\"", s.prefix.c_str());
+        for (double v : s.row) fprintf(out, ",%.10g", v);
+        fprintf(out, "\n");
+    }
+    if (outFile) fclose(out);
+    info("%ld simulations, %d could not be read", sims.size(), failed);
+    return 0;
+}